@@ -17,13 +17,15 @@ uniform mat4 viewMatrix;
 uniform mat4 projectionMatrix;
 
 uniform mat4 world2lightNDC;
+// texture repeats across the mesh, e.g. to tile the floor
+uniform vec2 uvScale = vec2(1.0f);
 	
 void main()
 {
 	o_position = vec3(modelMatrix * vec4(position, 1.0f));
     o_normal = normalize(mat3(inverse(transpose(modelMatrix))) * normal);
 	dir2camera = normalize(cameraPos - o_position);
-    o_texcoord = texcoord.xy;
+    o_texcoord = texcoord.xy * uvScale;
 
     // lightSpace
     o_position_in_light_space = world2lightNDC * modelMatrix * vec4(position, 1.0f);
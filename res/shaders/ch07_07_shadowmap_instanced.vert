@@ -0,0 +1,56 @@
+#version 430
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal;
+layout(location = 2) in vec2 texcoord;
+
+out vec3 o_position;
+out vec3 o_normal;
+out vec2 o_texcoord;
+out vec3 dir2camera;
+out vec4 o_position_in_light_space;	
+
+// per-instance transform (see InstanceBuffer.h)
+struct InstanceTransform {
+    vec3 position;
+    vec4 rotation; // quaternion
+    vec3 scale;
+};
+
+layout(std430, binding = 2) readonly buffer Instances {
+    InstanceTransform instances[];
+};
+
+uniform vec3 cameraPos;
+uniform mat4 viewMatrix;
+uniform mat4 projectionMatrix;
+
+uniform mat4 world2lightNDC;
+
+mat3 quatToMat3(vec4 q)
+{
+    vec3 q2 = q.xyz * 2.0;
+    float xx = q.x * q2.x, yy = q.y * q2.y, zz = q.z * q2.z;
+    float xy = q.x * q2.y, xz = q.x * q2.z, yz = q.y * q2.z;
+    float wx = q.w * q2.x, wy = q.w * q2.y, wz = q.w * q2.z;
+    return mat3(1.0 - (yy + zz), xy + wz, xz - wy,
+                xy - wz, 1.0 - (xx + zz), yz + wx,
+                xz + wy, yz - wx, 1.0 - (xx + yy));
+}
+
+void main()
+{
+	InstanceTransform instance = instances[gl_InstanceID];
+	mat3 rotation = quatToMat3(instance.rotation);
+
+	// model matrix = T * R * S, and its inverse transpose R * S^-1 for the normals
+	o_position = instance.position + rotation * (instance.scale * position);
+    o_normal = normalize(rotation * (normal / instance.scale));
+	dir2camera = normalize(cameraPos - o_position);
+    o_texcoord = texcoord.xy;
+
+    // lightSpace
+    o_position_in_light_space = world2lightNDC * vec4(o_position, 1.0f);
+
+    gl_Position = projectionMatrix * viewMatrix * vec4(o_position, 1.0f);
+}
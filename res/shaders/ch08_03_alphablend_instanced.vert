@@ -0,0 +1,34 @@
+#version 430
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoords;
+
+out vec2 o_texCoords;
+
+// per-instance transform (see InstanceBuffer.h)
+struct InstanceTransform {
+    vec3 position;
+    vec4 rotation; // quaternion
+    vec3 scale;
+};
+
+layout(std430, binding = 2) readonly buffer Instances {
+    InstanceTransform instances[];
+};
+
+uniform mat4 viewMatrix;
+uniform mat4 projectionMatrix;
+
+vec3 rotate(vec4 q, vec3 v)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+void main()
+{
+    InstanceTransform instance = instances[gl_InstanceID];
+    vec3 worldPos = instance.position + rotate(instance.rotation, instance.scale * aPos);
+
+    o_texCoords = aTexCoords;
+    gl_Position = projectionMatrix * viewMatrix * vec4(worldPos, 1.0);
+}
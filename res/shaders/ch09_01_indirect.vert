@@ -0,0 +1,37 @@
+#version 430
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal;
+layout(location = 2) in vec2 texcoord;
+// index of the draw inside the multi-draw, fed by baseInstance (see IndirectDraw.h)
+layout(location = 15) in uint drawId;
+
+struct ObjectData {
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+    uint materialIndex;
+};
+
+layout(std430, binding = 0) readonly buffer Objects {
+    ObjectData objects[];
+};
+
+out vec3 o_position;
+out vec3 o_normal;
+out vec2 o_texcoord;
+flat out uint o_material;
+
+uniform mat4 viewMatrix;
+uniform mat4 projectionMatrix;
+
+void main()
+{
+    ObjectData object = objects[drawId];
+
+    o_position = vec3(object.modelMatrix * vec4(position, 1.0f));
+    o_normal = normalize(mat3(object.normalMatrix) * normal);
+    o_texcoord = texcoord;
+    o_material = object.materialIndex;
+
+    gl_Position = projectionMatrix * viewMatrix * vec4(o_position, 1.0f);
+}
@@ -0,0 +1,26 @@
+#version 430
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal;
+layout(location = 2) in vec2 texcoord;
+
+// skinned vertices are already in world space (see Skinning.h)
+out vec3 o_position;
+out vec3 o_normal;
+out vec2 o_texcoord;
+flat out uint o_instance;
+
+uniform mat4 viewMatrix;
+uniform mat4 projectionMatrix;
+// vertices per character; gl_VertexID includes the base vertex of its draw
+uniform int vertexCount;
+
+void main()
+{
+    o_position = position;
+    o_normal = normal;
+    o_texcoord = texcoord;
+    o_instance = uint(gl_VertexID / vertexCount);
+
+    gl_Position = projectionMatrix * viewMatrix * vec4(position, 1.0);
+}
@@ -0,0 +1,35 @@
+#version 430
+
+out vec4 FragColor;
+
+in vec3 o_position;
+in vec3 o_normal;
+in vec2 o_texcoord;
+
+struct Light {
+    vec4 position; // directional light if w = 0.
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+uniform sampler2D diffuseMap;
+uniform Light light;
+uniform vec3 cameraPos;
+
+void main()
+{
+    vec3 albedo = texture(diffuseMap, o_texcoord).rgb;
+
+    vec3 N = normalize(o_normal);
+    vec3 V = normalize(cameraPos - o_position);
+    vec3 L = light.position.w == 0 ? -normalize(light.position.xyz) : normalize(light.position.xyz - o_position);
+    vec3 R = reflect(-L, N);
+
+    vec3 ambient  = 0.1 * light.ambient * albedo;
+    vec3 diffuse  = 0.7 * max(dot(N, L), 0.0) * light.diffuse * albedo;
+    vec3 specular = 0.3 * pow(max(dot(R, V), 0.0), 32.0) * light.specular;
+
+    FragColor = vec4(ambient + diffuse + specular, 1.f);
+}
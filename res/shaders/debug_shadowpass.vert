@@ -1,7 +1,7 @@
 #version 430
 
 layout(location = 0) in vec3 position;
-layout(location = 1) in vec2 texcoord;
+layout(location = 2) in vec2 texcoord;  // DefaultLayout, see Primitives.h
 
 out vec2 TexCoords;
 
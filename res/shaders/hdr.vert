@@ -1,6 +1,6 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec2 aTexCoords;
+layout (location = 2) in vec2 aTexCoords;  // DefaultLayout, see Primitives.h
 
 out vec2 TexCoords;
 
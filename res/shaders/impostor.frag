@@ -0,0 +1,81 @@
+#version 430
+
+out vec4 FragColor;
+
+in vec3 o_position;
+in vec2 o_frameUv[4];
+flat in ivec2 o_frames[4];
+flat in vec4 o_weights;
+flat in vec4 o_rotation;
+flat in vec3 o_toCamera;
+flat in float o_radius;
+
+struct Light {
+    vec4 position; // directional light if w = 0.
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+// premultiplied by the coverage in alpha (see Impostor.h)
+uniform sampler2D albedoAtlas;
+uniform sampler2D normalDepthAtlas;
+uniform int frames;
+// half a texel of a frame, keeps the filter inside the frame
+uniform float frameEdge;
+
+uniform mat4 viewMatrix;
+uniform mat4 projectionMatrix;
+uniform Light light;
+uniform vec3 cameraPos;
+
+mat3 quatToMat3(vec4 q)
+{
+    vec3 q2 = q.xyz * 2.0;
+    float xx = q.x * q2.x, yy = q.y * q2.y, zz = q.z * q2.z;
+    float xy = q.x * q2.y, xz = q.x * q2.z, yz = q.y * q2.z;
+    float wx = q.w * q2.x, wy = q.w * q2.y, wz = q.w * q2.z;
+    return mat3(1.0 - (yy + zz), xy + wz, xz - wy,
+                xy - wz, 1.0 - (xx + zz), yz + wx,
+                xz + wy, yz - wx, 1.0 - (xx + yy));
+}
+
+void main()
+{
+    vec4 albedo = vec4(0.0);
+    vec4 normalDepth = vec4(0.0);
+    for (int k = 0; k < 4; ++k)
+    {
+        // rays missing a frame see its empty background
+        vec2 uv = o_frameUv[k];
+        if (any(lessThan(uv, vec2(0.0))) || any(greaterThan(uv, vec2(1.0))))
+            continue;
+
+        vec2 atlasUv = (vec2(o_frames[k]) + clamp(uv, frameEdge, 1.0 - frameEdge)) / float(frames);
+        albedo += o_weights[k] * texture(albedoAtlas, atlasUv);
+        normalDepth += o_weights[k] * texture(normalDepthAtlas, atlasUv);
+    }
+
+    if (albedo.a < 0.5)
+        discard;
+
+    vec3 color = albedo.rgb / albedo.a;
+    vec3 N = normalize(quatToMat3(o_rotation) * (normalDepth.rgb / albedo.a * 2.0 - 1.0));
+    float depth = normalDepth.a / albedo.a;
+
+    // moved from the quad to the baked surface, for the depth test against the scene
+    vec3 position = o_position + o_toCamera * (0.5 - depth) * 2.0 * o_radius;
+    vec4 clip = projectionMatrix * viewMatrix * vec4(position, 1.0);
+    gl_FragDepth = clip.z / clip.w * 0.5 + 0.5;
+
+    vec3 V = normalize(cameraPos - position);
+    vec3 L = light.position.w == 0 ? -normalize(light.position.xyz) : normalize(light.position.xyz - position);
+    vec3 R = reflect(-L, N);
+
+    vec3 ambient  = 0.1 * light.ambient * color;
+    vec3 diffuse  = 0.7 * max(dot(N, L), 0.0) * light.diffuse * color;
+    vec3 specular = 0.3 * pow(max(dot(R, V), 0.0), 32.0) * light.specular;
+
+    FragColor = vec4(ambient + diffuse + specular, 1.f);
+}
@@ -0,0 +1,124 @@
+#version 430
+
+// One camera-facing quad per instance around the bounding sphere of the model, drawn as a
+// 4 vertex strip without vertex attributes (see Impostor.h)
+
+// per-instance transform (see InstanceBuffer.h)
+struct InstanceTransform {
+    vec3 position;
+    vec4 rotation; // quaternion
+    vec3 scale;
+};
+
+layout(std430, binding = 2) readonly buffer Instances {
+    InstanceTransform instances[];
+};
+
+out vec3 o_position;
+// where the view ray crosses each of the 4 blended frames, in [0, 1] inside the frame
+out vec2 o_frameUv[4];
+flat out ivec2 o_frames[4];
+flat out vec4 o_weights;
+flat out vec4 o_rotation;
+flat out vec3 o_toCamera;
+flat out float o_radius;
+
+uniform mat4 viewMatrix;
+uniform mat4 projectionMatrix;
+uniform vec3 cameraPos;
+uniform int firstInstance;
+
+uniform vec3 boundsCenter;
+uniform float boundsRadius;
+uniform int frames;
+
+mat3 quatToMat3(vec4 q)
+{
+    vec3 q2 = q.xyz * 2.0;
+    float xx = q.x * q2.x, yy = q.y * q2.y, zz = q.z * q2.z;
+    float xy = q.x * q2.y, xz = q.x * q2.z, yz = q.y * q2.z;
+    float wx = q.w * q2.x, wy = q.w * q2.y, wz = q.w * q2.z;
+    return mat3(1.0 - (yy + zz), xy + wz, xz - wy,
+                xy - wz, 1.0 - (xx + zz), yz + wx,
+                xz + wy, yz - wx, 1.0 - (xx + yy));
+}
+
+vec2 signNotZero(vec2 v)
+{
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// same mapping as Impostor::octahedral / Impostor::frameDirection
+vec2 octahedral(vec3 d)
+{
+    d /= abs(d.x) + abs(d.y) + abs(d.z);
+    return d.y >= 0.0 ? d.xz : (1.0 - abs(d.zx)) * signNotZero(d.xz);
+}
+
+vec3 frameDirection(ivec2 frame)
+{
+    vec2 e = (vec2(frame) + 0.5) / float(frames) * 2.0 - 1.0;
+    vec3 v = vec3(e.x, 1.0 - abs(e.x) - abs(e.y), e.y);
+    if (v.y < 0.0)
+        v.xz = (1.0 - abs(e.yx)) * signNotZero(e);
+    return normalize(v);
+}
+
+vec3 upFor(vec3 direction)
+{
+    return abs(direction.y) > 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+}
+
+void main()
+{
+    InstanceTransform instance = instances[firstInstance + gl_InstanceID];
+    mat3 rotation = quatToMat3(instance.rotation);
+    // the sphere has to cover the model along its most scaled axis
+    float scale = max(instance.scale.x, max(instance.scale.y, instance.scale.z));
+
+    vec3 center = instance.position + rotation * (instance.scale * boundsCenter);
+    float radius = boundsRadius * scale;
+    vec3 toCamera = normalize(cameraPos - center);
+
+    // the quad spans the bounding sphere as seen from the camera
+    vec3 right = normalize(cross(upFor(toCamera), toCamera));
+    vec3 up = cross(toCamera, right);
+    vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1)) * 2.0 - 1.0;
+    o_position = center + (right * corner.x + up * corner.y) * radius;
+
+    // object space, in units of the bounding radius
+    mat3 toObject = transpose(rotation);
+    vec3 objectView = toObject * toCamera;
+    vec3 objectPosition = toObject * (o_position - center) / radius;
+    vec3 objectRay = toObject * normalize(o_position - cameraPos);
+
+    // the 4 frames around the view direction, bilinearly weighted
+    vec2 grid = (octahedral(objectView) * 0.5 + 0.5) * float(frames) - 0.5;
+    ivec2 base = clamp(ivec2(floor(grid)), ivec2(0), ivec2(frames - 2));
+    vec2 f = clamp(grid - vec2(base), 0.0, 1.0);
+    o_weights = vec4((1.0 - f.x) * (1.0 - f.y), f.x * (1.0 - f.y), (1.0 - f.x) * f.y, f.x * f.y);
+
+    for (int k = 0; k < 4; ++k)
+    {
+        ivec2 frame = base + ivec2(k & 1, k >> 1);
+        vec3 d = frameDirection(frame);
+
+        // the frame's camera basis, as glm::lookAt builds it in Impostor::bake
+        vec3 s = normalize(cross(-d, upFor(d)));
+        vec3 u = cross(s, -d);
+
+        // where the view ray crosses the frame's plane through the center
+        float facing = dot(objectRay, d);
+        float t = abs(facing) > 1e-4 ? -dot(objectPosition, d) / facing : 0.0;
+        vec3 hit = objectPosition + t * objectRay;
+
+        o_frames[k] = frame;
+        o_frameUv[k] = vec2(dot(hit, s), dot(hit, u)) * 0.5 + 0.5;
+    }
+
+    o_rotation = instance.rotation;
+    o_toCamera = toCamera;
+    o_radius = radius;
+
+    gl_Position = projectionMatrix * viewMatrix * vec4(o_position, 1.0f);
+}
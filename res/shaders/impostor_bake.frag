@@ -0,0 +1,24 @@
+#version 430
+
+// one frame of the impostor atlases (see Impostor.h), premultiplied by a coverage of 1
+layout(location = 0) out vec4 albedo;
+layout(location = 1) out vec4 normalDepth;
+
+in vec3 o_position;
+in vec3 o_normal;
+in vec2 o_texcoord;
+
+uniform sampler2D diffuseMap;
+uniform vec3 boundsCenter;
+uniform float boundsRadius;
+// from the model toward the eye of the frame
+uniform vec3 viewDirection;
+
+void main()
+{
+    // 0 on the near side of the bounding sphere, 1 on the far side
+    float depth = 0.5 - dot(o_position - boundsCenter, viewDirection) / (2.0 * boundsRadius);
+
+    albedo = vec4(texture(diffuseMap, o_texcoord).rgb, 1.0);
+    normalDepth = vec4(normalize(o_normal) * 0.5 + 0.5, clamp(depth, 0.0, 1.0));
+}
@@ -0,0 +1,21 @@
+#version 430
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal;
+layout(location = 2) in vec2 texcoord;
+
+out vec3 o_position;
+out vec3 o_normal;
+out vec2 o_texcoord;
+
+// orthographic view of one frame, the model stays in object space
+uniform mat4 viewProjection;
+
+void main()
+{
+    o_position = position;
+    o_normal = normal;
+    o_texcoord = texcoord;
+
+    gl_Position = viewProjection * vec4(position, 1.0f);
+}
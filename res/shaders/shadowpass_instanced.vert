@@ -0,0 +1,29 @@
+#version 430
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal;
+layout(location = 2) in vec2 texcoord;
+
+// per-instance transform (see InstanceBuffer.h)
+struct InstanceTransform {
+    vec3 position;
+    vec4 rotation; // quaternion
+    vec3 scale;
+};
+
+layout(std430, binding = 2) readonly buffer Instances {
+    InstanceTransform instances[];
+};
+
+uniform mat4 world2lightNDC;
+
+vec3 rotate(vec4 q, vec3 v)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+void main()
+{
+    InstanceTransform instance = instances[gl_InstanceID];
+    gl_Position = world2lightNDC * vec4(instance.position + rotate(instance.rotation, instance.scale * position), 1.0f);
+}
@@ -0,0 +1,119 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+// Build, refit and query timings of the scene BVH over random boxes.
+//
+//   bench_bvh [max object count]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "rendering/Bvh.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double millisecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // n unit-ish boxes spread over a cube growing with n, so the density stays about the same
+    std::vector<Bounds> randomBounds(std::size_t n, std::mt19937& rng)
+    {
+        const float extent = 2.0f * std::cbrt(float(n));
+        std::uniform_real_distribution<float> position(-extent, extent);
+        std::uniform_real_distribution<float> size(0.25f, 1.0f);
+
+        std::vector<Bounds> bounds(n);
+        for (Bounds& b : bounds)
+        {
+            const glm::vec3 center(position(rng), position(rng), position(rng));
+            const glm::vec3 half(size(rng), size(rng), size(rng));
+            b.min = center - half;
+            b.max = center + half;
+            b.center = center;
+            b.radius = glm::length(half);
+        }
+        return bounds;
+    }
+
+    void move(std::vector<Bounds>& bounds, float time)
+    {
+        for (std::size_t i = 0; i < bounds.size(); ++i)
+        {
+            const glm::vec3 offset(0.0f, 0.05f * std::sin(time + 0.1f * i), 0.0f);
+            bounds[i].min += offset;
+            bounds[i].max += offset;
+            bounds[i].center += offset;
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::size_t maxCount = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+    std::printf("%10s %10s %10s %12s %14s %14s\n", "objects", "build ms", "refit ms", "frustum ms", "visible", "rays/s");
+
+    std::mt19937 rng(42);
+    for (std::size_t n = 1000; n <= maxCount; n *= 10)
+    {
+        std::vector<Bounds> bounds = randomBounds(n, rng);
+
+        Bvh bvh;
+        Clock::time_point start = Clock::now();
+        bvh.build(bounds);
+        const double buildMs = millisecondsSince(start);
+
+        move(bounds, 1.0f);
+        start = Clock::now();
+        bvh.refit(bounds);
+        const double refitMs = millisecondsSince(start);
+
+        // camera in the middle of the boxes, looking down -z
+        const float extent = 2.0f * std::cbrt(float(n));
+        const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, extent);
+        const glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        const Frustum frustum = Frustum::fromMatrix(projection * view);
+
+        std::vector<unsigned int> visible;
+        visible.reserve(n);
+        const int frustumQueries = 20;
+        start = Clock::now();
+        for (int i = 0; i < frustumQueries; ++i)
+        {
+            visible.clear();
+            bvh.queryFrustum(frustum, visible);
+        }
+        const double frustumMs = millisecondsSince(start) / frustumQueries;
+
+        // random rays from the center, closest hit against the boxes
+        std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+        const int rayCount = 100000;
+        std::size_t hits = 0;
+        start = Clock::now();
+        for (int i = 0; i < rayCount; ++i)
+        {
+            Ray ray;
+            ray.direction = glm::vec3(direction(rng), direction(rng), direction(rng));
+            float t;
+            if (bvh.closestHit(ray, t) != ~0u)
+                ++hits;
+        }
+        const double raysPerSecond = rayCount / (millisecondsSince(start) / 1000.0);
+
+        std::printf("%10zu %10.2f %10.3f %12.3f %14zu %14.0f\n", n, buildMs, refitMs, frustumMs, visible.size(), raysPerSecond);
+        (void)hits;
+    }
+
+    return 0;
+}
@@ -0,0 +1,163 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+// Load throughput of the OBJ / glb fast paths against Assimp, up to CPU side vertex and
+// index arrays of DefaultLayout (no meshlets, LODs or GL upload, those are the same for both).
+//
+//   bench_model_load [model files...]      defaults to res/models/alliance.obj
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "rendering/GlbFile.h"
+#include "rendering/ObjLoader.h"
+#include "rendering/VertexLayout.h"
+#include "helpers/RootDir.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+    using Vertex = DefaultLayout::Vertex;
+
+    const int RUNS = 5;
+
+    double millisecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    std::string extensionOf(const std::string& path)
+    {
+        std::string extension = path.substr(path.find_last_of('.') + 1);
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+        return extension;
+    }
+
+    // vertex count of the result, so the work can't be optimized away
+    std::size_t loadObj(const std::string& path)
+    {
+        std::vector<ObjMesh> meshes;
+        if (!ObjLoader::load(path, meshes, DefaultLayout::objFlags))
+            return 0;
+
+        std::size_t total = 0;
+        for (const ObjMesh& mesh : meshes)
+        {
+            std::vector<Vertex> vertices(mesh.positions.size());
+            for (unsigned int i = 0; i < vertices.size(); ++i)
+                DefaultLayout::read(vertices[i], mesh, i);
+            std::vector<unsigned int> indices = mesh.indices;
+            total += vertices.size();
+        }
+        return total;
+    }
+
+    std::size_t loadGlb(const std::string& path)
+    {
+        GlbFile glb;
+        if (!glb.open(path))
+            return 0;
+
+        std::size_t total = 0;
+        for (const GlbPrimitive& primitive : glb.primitives)
+        {
+            std::vector<Vertex> vertices(primitive.vertexCount);
+            DefaultLayout::read(vertices.data(), primitive);
+            DefaultLayout::transform(vertices.data(), vertices.size(), primitive.transform);
+            std::vector<unsigned int> indices;
+            primitive.readIndices(indices);
+            total += vertices.size();
+        }
+        return total;
+    }
+
+    std::size_t loadAssimp(const std::string& path)
+    {
+        Assimp::Importer importer;
+        const aiScene* scene = importer.ReadFile(path, DefaultLayout::importFlags);
+        if (!scene)
+            return 0;
+
+        std::size_t total = 0;
+        for (unsigned int m = 0; m < scene->mNumMeshes; ++m)
+        {
+            const aiMesh* mesh = scene->mMeshes[m];
+            std::vector<Vertex> vertices(mesh->mNumVertices);
+            for (unsigned int i = 0; i < mesh->mNumVertices; ++i)
+                DefaultLayout::read(vertices[i], mesh, i);
+
+            std::vector<unsigned int> indices;
+            indices.reserve(mesh->mNumFaces * 3);
+            for (unsigned int f = 0; f < mesh->mNumFaces; ++f)
+                indices.insert(indices.end(), mesh->mFaces[f].mIndices, mesh->mFaces[f].mIndices + mesh->mFaces[f].mNumIndices);
+            total += vertices.size();
+        }
+        return total;
+    }
+
+    // best of RUNS, the first run also pages the file in
+    double bestMilliseconds(std::size_t (*load)(const std::string&), const std::string& path, std::size_t& vertices)
+    {
+        double best = 1e30;
+        for (int run = 0; run < RUNS; ++run)
+        {
+            const Clock::time_point start = Clock::now();
+            vertices = load(path);
+            best = std::min(best, millisecondsSince(start));
+        }
+        return best;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i)
+        paths.push_back(argv[i]);
+    if (paths.empty())
+        paths.push_back(std::string(ROOT_DIR) + "res/models/alliance.obj");
+
+    std::printf("%-40s %10s | %10s %10s %10s | %10s %10s %10s | %8s\n",
+                "file", "MB", "fast ms", "MB/s", "vertices", "assimp ms", "MB/s", "vertices", "speedup");
+
+    for (const std::string& path : paths)
+    {
+        MappedFile file(path);
+        if (!file.isOpen())
+        {
+            std::printf("%-40s could not open\n", path.c_str());
+            continue;
+        }
+        const double megabytes = file.size() / (1024.0 * 1024.0);
+        file.close();
+
+        const std::string extension = extensionOf(path);
+        std::size_t (*fastPath)(const std::string&) = extension == "obj" ? loadObj : extension == "glb" ? loadGlb : nullptr;
+        if (!fastPath)
+        {
+            std::printf("%-40s no fast path for .%s\n", path.c_str(), extension.c_str());
+            continue;
+        }
+
+        std::size_t fastVertices = 0, assimpVertices = 0;
+        const double fastMs = bestMilliseconds(fastPath, path, fastVertices);
+        const double assimpMs = bestMilliseconds(loadAssimp, path, assimpVertices);
+
+        const std::string name = path.substr(path.find_last_of("/\\") + 1);
+        std::printf("%-40s %10.2f | %10.2f %10.1f %10zu | %10.2f %10.1f %10zu | %7.1fx\n",
+                    name.c_str(), megabytes,
+                    fastMs, megabytes / (fastMs / 1000.0), fastVertices,
+                    assimpMs, megabytes / (assimpMs / 1000.0), assimpVertices,
+                    assimpMs / fastMs);
+    }
+
+    return 0;
+}
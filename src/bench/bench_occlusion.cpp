@@ -0,0 +1,108 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+// Software occlusion culling of a city block: rows of buildings as box occluders, and small
+// objects scattered between and behind them as occludees, seen from street level.
+// Prints the CPU time of every stage and how many of the frustum visible objects were culled.
+//
+//   bench_occlusion [max object count]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "rendering/FrustumCuller.h"
+#include "rendering/OcclusionBuffer.h"
+#include "rendering/Parallel.h"
+
+namespace
+{
+    const int BUILDING_ROWS = 8;
+    const int BUILDINGS_PER_ROW = 16;
+    const float STREET_WIDTH = 6.0f;
+
+    Bounds box(const glm::vec3& min, const glm::vec3& max)
+    {
+        Bounds b;
+        b.min = min;
+        b.max = max;
+        b.center = 0.5f * (min + max);
+        b.radius = glm::length(0.5f * (max - min));
+        return b;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::size_t maxCount = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> height(4.0f, 20.0f);
+    std::vector<Bounds> buildings;
+    for (int row = 0; row < BUILDING_ROWS; ++row)
+    {
+        for (int i = 0; i < BUILDINGS_PER_ROW; ++i)
+        {
+            const float x = -80.0f + i * 10.0f;
+            const float z = -10.0f - row * (10.0f + STREET_WIDTH);
+            buildings.push_back(box(glm::vec3(x, 0.0f, z - 10.0f), glm::vec3(x + 9.0f, height(rng), z)));
+        }
+    }
+
+    // standing in the first street, looking down -z
+    const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+    const glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 1.7f, 0.0f), glm::vec3(0.0f, 1.7f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const glm::mat4 viewProjection = projection * view;
+
+    FrustumCuller frustumCuller;
+    frustumCuller.setFrustum(Frustum::fromMatrix(viewProjection));
+
+    std::printf("%u threads, %s\n", JobSystem::get().threadCount(), OcclusionBuffer::simdName());
+    std::printf("%10s %10s %10s %10s %10s %10s %10s\n", "objects", "in frustum", "occluded", "setup ms", "raster ms", "test ms", "ns/test");
+
+    for (std::size_t n = 1000; n <= maxCount; n *= 10)
+    {
+        std::uniform_real_distribution<float> x(-80.0f, 80.0f);
+        std::uniform_real_distribution<float> z(-140.0f, 0.0f);
+        std::uniform_real_distribution<float> size(0.25f, 1.0f);
+
+        BoundsBatch objects;
+        objects.reserve(n);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            const glm::vec3 center(x(rng), size(rng), z(rng));
+            objects.add(box(center - glm::vec3(size(rng)), center + glm::vec3(size(rng))));
+        }
+
+        std::vector<unsigned char> visible;
+        const std::size_t inFrustum = frustumCuller.cullBoxes(objects, visible);
+
+        OcclusionBuffer occlusion;
+        const int frames = 20;
+        std::size_t occluded = 0;
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            frustumCuller.cullBoxes(objects, visible);
+
+            occlusion.begin(viewProjection);
+            for (const Bounds& building : buildings)
+            {
+                occlusion.addBoxOccluder(building, glm::mat4(1.0f));
+            }
+            occlusion.rasterize();
+            occluded = occlusion.cullBoxes(objects, visible);
+        }
+
+        const OcclusionBuffer::Stats& stats = occlusion.stats();
+        std::printf("%10zu %10zu %10zu %10.3f %10.3f %10.3f %10.1f\n", n, inFrustum, occluded,
+            stats.setupMs / frames, stats.rasterMs / frames, stats.testMs / frames, 1e6 * stats.testMs / double(stats.tested));
+    }
+
+    return 0;
+}
@@ -0,0 +1,171 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+// Transform updates of a random hierarchy: rebuilding every world matrix from the local
+// transforms through a pointer tree (what the scenes did per draw) against the SoA SceneGraph
+// recomputing only the dirty subtrees, with the changed ranges a GPU upload would have to copy.
+//
+//   bench_scene_graph [node count]        defaults to 100000
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "rendering/SceneGraph.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const int FRAMES = 50;
+
+    double millisecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // the baseline: nodes allocated one by one, world matrices rebuilt top down every frame
+    struct TreeNode
+    {
+        glm::vec3 translation;
+        glm::quat rotation;
+        glm::vec3 scale;
+        glm::mat4 world;
+        std::vector<TreeNode*> children;
+    };
+
+    void updateTree(TreeNode* node, const glm::mat4& parent)
+    {
+        glm::mat4 local = glm::translate(glm::mat4(1.0f), node->translation);
+        local = local * glm::mat4_cast(node->rotation);
+        local = glm::scale(local, node->scale);
+        node->world = parent * local;
+        for (TreeNode* child : node->children)
+            updateTree(child, node->world);
+    }
+
+    struct Scenario
+    {
+        const char* name;
+        double fraction;        // of the nodes moved every frame
+    };
+}
+
+int main(int argc, char** argv)
+{
+    const std::size_t nodeCount = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    const std::size_t rootCount = std::max<std::size_t>(1, nodeCount / 1000);
+
+    // random recursive tree: every node picks its parent among the nodes before it, which
+    // gives a depth of around ln(n) and nodes of a level scattered over the creation order
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<unsigned int> parents(nodeCount, SceneGraph::InvalidNode);
+    for (std::size_t i = rootCount; i < nodeCount; ++i)
+        parents[i] = std::uniform_int_distribution<unsigned int>(0, unsigned(i - 1))(rng);
+
+    std::vector<TreeNode> tree(nodeCount);
+    std::vector<TreeNode*> roots;
+    SceneGraph graph;
+    std::vector<SceneGraph::Node> nodes(nodeCount);
+    for (std::size_t i = 0; i < nodeCount; ++i)
+    {
+        TreeNode& node = tree[i];
+        node.translation = glm::vec3(unit(rng), unit(rng), unit(rng)) * 4.0f;
+        node.rotation = glm::angleAxis(unit(rng) * 3.14159f, glm::vec3(0.0f, 1.0f, 0.0f));
+        node.scale = glm::vec3(1.0f);
+
+        if (parents[i] == SceneGraph::InvalidNode)
+            roots.push_back(&node);
+        else
+            tree[parents[i]].children.push_back(&node);
+
+        nodes[i] = graph.add(parents[i] == SceneGraph::InvalidNode ? SceneGraph::InvalidNode : nodes[parents[i]],
+                             node.translation, node.rotation, node.scale);
+    }
+
+    Clock::time_point start = Clock::now();
+    graph.update();
+    const double sortMs = millisecondsSince(start);
+
+    // both have to agree
+    for (TreeNode* root : roots)
+        updateTree(root, glm::mat4(1.0f));
+    float maxError = 0.0f;
+    for (std::size_t i = 0; i < nodeCount; ++i)
+    {
+        const glm::mat4 difference = tree[i].world - graph.worldMatrix(nodes[i]);
+        for (int c = 0; c < 4; ++c)
+            maxError = std::max(maxError, glm::length(difference[c]));
+    }
+
+    std::printf("%zu nodes, %zu roots, %zu levels, sorted by depth in %.2f ms, max difference to the tree %g\n\n",
+                nodeCount, rootCount, graph.levelCount(), sortMs, maxError);
+
+    start = Clock::now();
+    for (int frame = 0; frame < FRAMES; ++frame)
+    {
+        for (TreeNode* root : roots)
+            updateTree(root, glm::mat4(1.0f));
+    }
+    const double treeMs = millisecondsSince(start) / FRAMES;
+    std::printf("%-28s %10.3f ms/frame, every matrix rebuilt and uploaded\n\n", "pointer tree, full rebuild", treeMs);
+
+    std::printf("%-28s %10s %8s %12s %10s %12s %8s\n", "scene graph, moved nodes", "ms/frame", "speedup", "recomputed", "ranges", "upload KB", "of all");
+
+    const Scenario scenarios[] = {
+        { "roots (everything)", -1.0 },
+        { "10%", 0.1 },
+        { "1%", 0.01 },
+        { "0.1%", 0.001 },
+        { "10 nodes", 10.0 / nodeCount },
+        { "none", 0.0 },
+    };
+
+    for (const Scenario& scenario : scenarios)
+    {
+        // the same moved nodes every frame, picked up front so only the update is timed
+        std::vector<SceneGraph::Node> moved;
+        if (scenario.fraction < 0.0)
+        {
+            moved.assign(nodes.begin(), nodes.begin() + rootCount);
+        }
+        else
+        {
+            const std::size_t count = std::size_t(std::llround(scenario.fraction * nodeCount));
+            for (std::size_t i = 0; i < count; ++i)
+                moved.push_back(nodes[std::uniform_int_distribution<std::size_t>(0, nodeCount - 1)(rng)]);
+        }
+
+        std::size_t recomputed = 0, ranges = 0, uploaded = 0;
+        start = Clock::now();
+        for (int frame = 0; frame < FRAMES; ++frame)
+        {
+            const float time = frame * 0.016f;
+            for (SceneGraph::Node node : moved)
+                graph.setRotation(node, glm::angleAxis(time, glm::vec3(0.0f, 1.0f, 0.0f)));
+            graph.update();
+
+            recomputed += graph.recomputedCount();
+            ranges += graph.changedRanges().size();
+            for (const SceneGraph::Range& range : graph.changedRanges())
+                uploaded += range.count;
+        }
+        const double graphMs = millisecondsSince(start) / FRAMES;
+
+        std::printf("%-28s %10.3f %7.1fx %12zu %10zu %12.1f %7.1f%%\n",
+                    scenario.name, graphMs, treeMs / graphMs, recomputed / FRAMES, ranges / FRAMES,
+                    uploaded / FRAMES * sizeof(glm::mat4) / 1024.0, 100.0 * uploaded / FRAMES / nodeCount);
+    }
+
+    return 0;
+}
@@ -0,0 +1,195 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+// Animates and skins a crowd of procedural characters (see SkinnedCharacter::procedural),
+// 1000 by default. Prints the CPU time per frame of sampling the animations, of CpuSkinner on
+// all threads, and, if an OpenGL 4.3 context can be created, the GPU time of GpuSkinner and
+// the time of skinning on the CPU and uploading the result instead.
+//
+//   bench_skinning [character count] [frames]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "rendering/Parallel.h"
+#include "rendering/Skinning.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double msSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    struct Crowd
+    {
+        std::vector<AnimationSampler> samplers;
+        std::vector<std::vector<JointPose>> poses;
+        std::vector<glm::mat4> worlds;
+        std::vector<glm::mat4> skinMatrices;
+
+        Crowd(const SkinnedCharacter& character, std::size_t count)
+            : samplers(count), poses(count), worlds(count), skinMatrices(count * character.skeleton.boneCount())
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                worlds[i] = glm::translate(glm::mat4(1.0f), glm::vec3(float(i % 32), 0.0f, float(i / 32)) * 1.5f);
+            }
+        }
+
+        void animate(const SkinnedCharacter& character, float time)
+        {
+            const std::size_t boneCount = character.skeleton.boneCount();
+            parallelFor(samplers.size(), 16, [&](std::size_t begin, std::size_t end)
+            {
+                std::vector<glm::mat4> globals;
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    character.skeleton.bindPose(poses[i]);
+                    samplers[i].sample(character.clips[0], time + 0.137f * i, poses[i]);
+                    character.skeleton.computeSkinMatrices(poses[i], worlds[i], &skinMatrices[i * boneCount], globals);
+                }
+            });
+        }
+    };
+
+    // GPU timings need a context; a hidden window is enough
+    GLFWwindow* createContext()
+    {
+        if (!glfwInit())
+            return nullptr;
+
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+        GLFWwindow* window = glfwCreateWindow(64, 64, "bench_skinning", nullptr, nullptr);
+        if (!window)
+            return nullptr;
+
+        glfwMakeContextCurrent(window);
+        if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+        {
+            glfwDestroyWindow(window);
+            return nullptr;
+        }
+        return window;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000;
+    const int frames = argc > 2 ? std::atoi(argv[2]) : 60;
+    const float frameTime = 1.0f / 60.0f;
+
+    const SkinnedCharacter character = SkinnedCharacter::procedural();
+    const std::size_t boneCount = character.skeleton.boneCount();
+    const std::size_t vertexCount = character.source.vertexCount();
+
+    std::printf("%zu characters, %zu bones, %zu vertices each, %d frames\n", count, boneCount, vertexCount, frames);
+    std::printf("%u threads, %s\n", JobSystem::get().threadCount(), CpuSkinner::simdName());
+
+    Crowd crowd(character, count);
+    std::vector<SkinnedVertex> vertices(count * vertexCount);
+
+    // sampling and skin matrices
+    crowd.animate(character, 0.0f);
+    Clock::time_point start = Clock::now();
+    for (int f = 0; f < frames; ++f)
+    {
+        crowd.animate(character, f * frameTime);
+    }
+    const double animateMs = msSince(start) / frames;
+
+    std::size_t cached = 0, searched = 0;
+    for (const AnimationSampler& sampler : crowd.samplers)
+    {
+        cached += sampler.stats().cachedLookups;
+        searched += sampler.stats().searchedLookups;
+    }
+
+    CpuSkinner::skin(character.source, crowd.skinMatrices.data(), boneCount, count, vertices.data());
+    start = Clock::now();
+    for (int f = 0; f < frames; ++f)
+    {
+        CpuSkinner::skin(character.source, crowd.skinMatrices.data(), boneCount, count, vertices.data());
+    }
+    const double cpuMs = msSince(start) / frames;
+
+    std::printf("%-24s %10.3f ms  (%.1f%% of key lookups from the cached key)\n", "animation", animateMs,
+                100.0 * cached / std::max<std::size_t>(cached + searched, 1));
+    std::printf("%-24s %10.3f ms  (%.1f M vertices/s)\n", "CPU skinning", cpuMs, count * vertexCount / (cpuMs * 1000.0));
+
+    GLFWwindow* window = createContext();
+    if (!window)
+    {
+        std::printf("no OpenGL 4.3 context, GPU skinning skipped\n");
+        glfwTerminate();
+        return 0;
+    }
+
+    {
+        SkinnedBuffer buffer;
+        buffer.resize(character.source, count);
+        GpuSkinner gpuSkinner;
+        gpuSkinner.setSource(character.source);
+
+        GLuint query;
+        glGenQueries(1, &query);
+
+        // compute skinning, timed on the GPU
+        gpuSkinner.skin(crowd.skinMatrices.data(), boneCount, count, buffer);
+        glFinish();
+        double gpuMs = 0.0;
+        start = Clock::now();
+        for (int f = 0; f < frames; ++f)
+        {
+            glBeginQuery(GL_TIME_ELAPSED, query);
+            gpuSkinner.skin(crowd.skinMatrices.data(), boneCount, count, buffer);
+            glEndQuery(GL_TIME_ELAPSED);
+
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+            gpuMs += elapsed / 1e6;
+        }
+        const double gpuWallMs = msSince(start) / frames;
+        gpuMs /= frames;
+
+        // the CPU path as a frame sees it: skin, then upload
+        glFinish();
+        start = Clock::now();
+        for (int f = 0; f < frames; ++f)
+        {
+            CpuSkinner::skin(character.source, crowd.skinMatrices.data(), boneCount, count, vertices.data());
+            buffer.upload(vertices.data());
+            glFinish();
+        }
+        const double cpuUploadMs = msSince(start) / frames;
+
+        std::printf("%-24s %10.3f ms  (%.1f M vertices/s, %.3f ms wall with matrix upload)\n", "GPU skinning", gpuMs,
+                    count * vertexCount / (gpuMs * 1000.0), gpuWallMs);
+        std::printf("%-24s %10.3f ms  (%.1f MB per frame)\n", "CPU skinning + upload", cpuUploadMs,
+                    count * vertexCount * sizeof(SkinnedVertex) / (1024.0 * 1024.0));
+
+        glDeleteQueries(1, &query);
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,153 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+// Moving objects: loose spatial grid (move + query) against the BVH (refit or rebuild + query).
+//
+//   bench_spatial_grid [max object count]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "rendering/Bvh.h"
+#include "rendering/SpatialGrid.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double millisecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    struct Mover
+    {
+        glm::vec3 position;
+        glm::vec3 velocity;
+        glm::vec3 halfSize;
+    };
+
+    Bounds boundsOf(const Mover& mover)
+    {
+        Bounds b;
+        b.min = mover.position - mover.halfSize;
+        b.max = mover.position + mover.halfSize;
+        b.center = mover.position;
+        b.radius = glm::length(mover.halfSize);
+        return b;
+    }
+
+    // objects drifting through a box that grows with n, bouncing off its walls
+    void step(std::vector<Mover>& movers, float extent, float dt)
+    {
+        for (Mover& mover : movers)
+        {
+            mover.position += mover.velocity * dt;
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                if (std::fabs(mover.position[axis]) > extent)
+                    mover.velocity[axis] = -mover.velocity[axis];
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::size_t maxCount = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    const int frames = 10;
+
+    std::printf("per frame, %d frames of moving objects\n", frames);
+    std::printf("%10s | %10s %10s | %10s %10s | %10s %10s\n",
+                "objects", "grid move", "grid query", "bvh refit", "bvh query", "bvh build", "bvh query");
+
+    std::mt19937 rng(7);
+    for (std::size_t n = 1000; n <= maxCount; n *= 10)
+    {
+        const float extent = 2.0f * std::cbrt(float(n));
+        std::uniform_real_distribution<float> position(-extent, extent);
+        std::uniform_real_distribution<float> velocity(-2.0f, 2.0f);
+        std::uniform_real_distribution<float> size(0.25f, 1.0f);
+
+        std::vector<Mover> movers(n);
+        for (Mover& mover : movers)
+        {
+            mover.position = glm::vec3(position(rng), position(rng), position(rng));
+            mover.velocity = glm::vec3(velocity(rng), velocity(rng), velocity(rng));
+            mover.halfSize = glm::vec3(size(rng), size(rng), size(rng));
+        }
+
+        const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 0.5f * extent);
+        const glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        const Frustum frustum = Frustum::fromMatrix(projection * view);
+
+        std::vector<Bounds> bounds(n);
+        for (std::size_t i = 0; i < n; ++i)
+            bounds[i] = boundsOf(movers[i]);
+
+        SpatialGrid grid(4.0f, 1u << 16);
+        std::vector<SpatialGrid::Handle> handles(n);
+        for (std::size_t i = 0; i < n; ++i)
+            handles[i] = grid.insert(bounds[i], static_cast<unsigned int>(i));
+
+        Bvh refitted;
+        refitted.build(bounds);
+        Bvh rebuilt;
+
+        double gridMove = 0, gridQuery = 0, refit = 0, refitQuery = 0, build = 0, buildQuery = 0;
+        std::vector<unsigned int> visible;
+        visible.reserve(n);
+        std::size_t gridVisible = 0, bvhVisible = 0;
+
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            step(movers, extent, 0.1f);
+            for (std::size_t i = 0; i < n; ++i)
+                bounds[i] = boundsOf(movers[i]);
+
+            Clock::time_point start = Clock::now();
+            for (std::size_t i = 0; i < n; ++i)
+                grid.move(handles[i], bounds[i]);
+            gridMove += millisecondsSince(start);
+
+            visible.clear();
+            start = Clock::now();
+            grid.queryFrustum(frustum, visible);
+            gridQuery += millisecondsSince(start);
+            gridVisible = visible.size();
+
+            start = Clock::now();
+            refitted.refit(bounds);
+            refit += millisecondsSince(start);
+
+            visible.clear();
+            start = Clock::now();
+            refitted.queryFrustum(frustum, visible);
+            refitQuery += millisecondsSince(start);
+            bvhVisible = visible.size();
+
+            start = Clock::now();
+            rebuilt.build(bounds);
+            build += millisecondsSince(start);
+
+            visible.clear();
+            start = Clock::now();
+            rebuilt.queryFrustum(frustum, visible);
+            buildQuery += millisecondsSince(start);
+        }
+
+        std::printf("%10zu | %10.3f %10.3f | %10.3f %10.3f | %10.3f %10.3f   (visible %zu/%zu)\n", n,
+                    gridMove / frames, gridQuery / frames, refit / frames, refitQuery / frames,
+                    build / frames, buildQuery / frames, gridVisible, bvhVisible);
+    }
+
+    return 0;
+}
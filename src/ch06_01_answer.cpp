@@ -10,6 +10,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "rendering/GLState.h"
 #include "rendering/Shader.h"
 #include "rendering/Texture.h"
 #include "rendering/Model.h"
@@ -66,7 +67,7 @@ void mouse_callback(GLFWwindow* window, double xpos_in, double ypos_in)
 
 void window_size_callback(GLFWwindow* window, int width, int height)
 {
-    glViewport(0, 0, width, height);
+    GLState::get().viewport(0, 0, width, height);
     projection_matrix = glm::perspectiveFov(glm::radians(60.0f), float(width), float(height), 0.1f, 10.0f);
 
     if (shader != nullptr)
@@ -109,9 +110,9 @@ int init()
 
     /* Set the viewport */
     glClearColor(0.6784f, 0.8f, 1.0f, 1.0f);
-    glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+    GLState::get().viewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
 
-    glEnable(GL_DEPTH_TEST);
+    GLState::get().enable(GL_DEPTH_TEST);
     
     // mouse focus
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -10,6 +10,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "rendering/GLState.h"
 #include "rendering/Shader.h"
 #include "rendering/Texture.h"
 #include "rendering/Model.h"
@@ -68,7 +69,7 @@ void mouse_callback(GLFWwindow* window, double xpos_in, double ypos_in)
 
 void window_size_callback(GLFWwindow* window, int width, int height)
 {
-    glViewport(0, 0, width, height);
+    GLState::get().viewport(0, 0, width, height);
     projection_matrix = glm::perspectiveFov(glm::radians(60.0f), float(width), float(height), 0.1f, 10.0f);
 
     if (shader != nullptr)
@@ -111,9 +112,9 @@ int init()
 
     /* Set the viewport */
     glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
-    glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+    GLState::get().viewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
 
-    glEnable(GL_DEPTH_TEST);
+    GLState::get().enable(GL_DEPTH_TEST);
     
     // mouse focus
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -183,7 +184,7 @@ int loadContent()
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
-	glBindVertexArray(cubeVAO);
+	GLState::get().bindVertexArray(cubeVAO);
 
 	// position attribute
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
@@ -195,7 +196,7 @@ int loadContent()
 
 	// second, configure the light's VAO (VBO stays the same; the vertices are the same for the light object which is also a 3D cube)
 	glGenVertexArrays(1, &lightCubeVAO);
-	glBindVertexArray(lightCubeVAO);
+	GLState::get().bindVertexArray(lightCubeVAO);
 
 	glBindBuffer(GL_ARRAY_BUFFER, VBO);
 
@@ -228,7 +229,7 @@ void render(float time)
     shader->apply();
 
     // render the cube
-    glBindVertexArray(cubeVAO);
+    GLState::get().bindVertexArray(cubeVAO);
     glDrawArrays(GL_TRIANGLES, 0, 36);
 
 	// also draw the lamp object
@@ -247,7 +248,7 @@ void render(float time)
 
 	shader->apply();
 
-	glBindVertexArray(lightCubeVAO);
+	GLState::get().bindVertexArray(lightCubeVAO);
 	glDrawArrays(GL_TRIANGLES, 0, 36);
 }
 
@@ -10,9 +10,12 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "rendering/GLState.h"
 #include "rendering/Shader.h"
 #include "rendering/Texture.h"
 #include "rendering/Model.h"
+#include "rendering/Primitives.h"
+#include "rendering/RenderQueue.h"
 #include "rendering/Camera.h"
 #include "rendering/Light.h"
 
@@ -37,9 +40,15 @@ Texture* specular_texture = nullptr;
 Camera* camera = nullptr;
 
 glm::mat4 model_matrix      = glm::mat4(1.0f);
-glm::mat4 projection_matrix = glm::perspectiveFov(glm::radians(60.0f), float(WINDOW_WIDTH), float(WINDOW_HEIGHT), 0.1f, 100.0f);
 
-unsigned int cubeVAO, lightCubeVAO;
+// the draws of a frame are queued with a sort key and submitted in key order, so each program
+// is applied and each set of textures bound once per frame instead of once per cube
+RenderQueue render_queue;
+std::vector<glm::mat4> draw_matrices;   // payload of the queued draws
+
+enum ShaderId { SHADER_LIT = 0, SHADER_LIGHTCUBE };
+enum MaterialId { MATERIAL_CONTAINER = 0, MATERIAL_NONE };
+glm::mat4 projection_matrix = glm::perspectiveFov(glm::radians(60.0f), float(WINDOW_WIDTH), float(WINDOW_HEIGHT), 0.1f, 100.0f);
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
@@ -95,7 +104,7 @@ void mouse_callback(GLFWwindow* window, double xpos_in, double ypos_in)
 
 void window_size_callback(GLFWwindow* window, int width, int height)
 {
-    glViewport(0, 0, width, height);
+    GLState::get().viewport(0, 0, width, height);
     projection_matrix = glm::perspectiveFov(glm::radians(60.0f), float(width), float(height), 0.1f, 10.0f);
 
     if (shader != nullptr)
@@ -138,9 +147,9 @@ int init()
 
     /* Set the viewport */
     glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
-    glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+    GLState::get().viewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
 
-    glEnable(GL_DEPTH_TEST);
+    GLState::get().enable(GL_DEPTH_TEST);
     
     // mouse focus
     //glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -185,145 +194,30 @@ int loadContent()
     lightcube_shader = new Shader("lightcube.vert", "lightcube.frag");
 	lightcube_shader->apply();
 
-	// set up vertex data (and buffer(s)) and configure vertex attributes
-	// ------------------------------------------------------------------
-	float vertices[] = {
-		// positions          // normals           // texture coords
-		-0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  0.0f,
-		 0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f,  0.0f,
-		 0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f,  1.0f,
-		 0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f,  1.0f,
-		-0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  1.0f,
-		-0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  0.0f,
-
-		-0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f,  0.0f,
-		 0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f,  0.0f,
-		 0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f,  1.0f,
-		 0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f,  1.0f,
-		-0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f,  1.0f,
-		-0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f,  0.0f,
-
-		-0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f,  0.0f,
-		-0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  1.0f,  1.0f,
-		-0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f,  1.0f,
-		-0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f,  1.0f,
-		-0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  0.0f,  0.0f,
-		-0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f,  0.0f,
-
-		 0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f,  0.0f,
-		 0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  1.0f,  1.0f,
-		 0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f,  1.0f,
-		 0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f,  1.0f,
-		 0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  0.0f,  0.0f,
-		 0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f,  0.0f,
-
-		-0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f,  1.0f,
-		 0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  1.0f,  1.0f,
-		 0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f,  0.0f,
-		 0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f,  0.0f,
-		-0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  0.0f,  0.0f,
-		-0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f,  1.0f,
-
-		-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  1.0f,
-		 0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f,  1.0f,
-		 0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f,  0.0f,
-		 0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f,  0.0f,
-		-0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  0.0f,
-		-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  1.0f
-	};
-
-	// first, configure the cube's VAO (and VBO)
-	unsigned int VBO;
-	glGenVertexArrays(1, &cubeVAO);
-	glGenBuffers(1, &VBO);
-
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-	glBindVertexArray(cubeVAO);
-
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-
-
-	// second, configure the light's VAO (VBO stays the same; the vertices are the same for the light object which is also a 3D cube)
-	float lightcube_vertices[] = {
-		-0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-		 0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-		 0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-		 0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-		-0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-		-0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-
-		-0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-		 0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-		 0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-		 0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-		-0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-		-0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-
-		-0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
-		-0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
-		-0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
-		-0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
-		-0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
-		-0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
-
-		 0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
-		 0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
-		 0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
-		 0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
-		 0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
-		 0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
-
-		-0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
-		 0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
-		 0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
-		 0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
-		-0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
-		-0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
-
-		-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,
-		 0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,
-		 0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
-		 0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
-		-0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
-		-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f
-	};
-	unsigned int lightCubeVBO;
-	glGenBuffers(1, &lightCubeVBO);
-
-	glBindBuffer(GL_ARRAY_BUFFER, lightCubeVBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(lightcube_vertices), lightcube_vertices, GL_STATIC_DRAW);
-
-	glGenVertexArrays(1, &lightCubeVAO);
-	glBindVertexArray(lightCubeVAO);
-
-	glBindBuffer(GL_ARRAY_BUFFER, lightCubeVBO);
+    return true;
+}
 
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	// normal attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
+void queueCube(const glm::mat4& m, unsigned int shaderId, unsigned int materialId)
+{
+	SortKey key;
+	key.shader = shaderId;
+	key.material = materialId;
+	key.depth = RenderQueue::depth(glm::distance(glm::vec3(m[3]), camera->getCamPosition()), 0.1f, 100.0f);
 
-    return true;
+	render_queue.submit(key, static_cast<std::uint32_t>(draw_matrices.size()));
+	draw_matrices.push_back(m);
 }
 
-void renderCube(float time, const glm::vec3& objectPos, const Light& light, float shininess)
+Shader* applyShader(unsigned int shaderId, const Light& light, float shininess)
 {
-	glm::mat4 m = glm::mat4(1.f);
-	m = glm::translate(m, objectPos);
-    m = glm::rotate(m, time * glm::radians(-90.0f), glm::vec3(0, 1, 0));
+	if (shaderId == SHADER_LIGHTCUBE)
+	{
+		lightcube_shader->setUniformMatrix4fv("viewMatrix", camera->getViewMatrix());
+		lightcube_shader->setUniformMatrix4fv("projectionMatrix", projection_matrix);
+		lightcube_shader->apply();
+		return lightcube_shader;
+	}
 
-	diffuse_texture->bind(0);
-	specular_texture->bind(1);
-	shader->setUniformMatrix4fv("modelMatrix", m);
 	shader->setUniformMatrix4fv("viewMatrix", camera->getViewMatrix());
 	shader->setUniformMatrix4fv("projectionMatrix", projection_matrix);
 
@@ -341,29 +235,21 @@ void renderCube(float time, const glm::vec3& objectPos, const Light& light, floa
 	// for material
 	shader->setUniform1f("material.shininess", shininess);
 	shader->apply();
-
-	// render the cube
-	glBindVertexArray(cubeVAO);
-	glDrawArrays(GL_TRIANGLES, 0, 36);
+	return shader;
 }
 
-void renderLightCube(const glm::vec3 &pos)
+void bindMaterial(unsigned int materialId)
 {
-	model_matrix = glm::mat4(1.0f);
-	model_matrix = glm::translate(model_matrix, pos);
-	model_matrix = glm::scale(model_matrix, glm::vec3(0.2f)); // a smaller cube
-	lightcube_shader->setUniformMatrix4fv("modelMatrix", model_matrix);
-	lightcube_shader->setUniformMatrix4fv("viewMatrix", camera->getViewMatrix());
-	lightcube_shader->setUniformMatrix4fv("projectionMatrix", projection_matrix);
-
-	lightcube_shader->apply();
-
-	glBindVertexArray(lightCubeVAO);
-	glDrawArrays(GL_TRIANGLES, 0, 36);
+	if (materialId == MATERIAL_CONTAINER)
+	{
+		diffuse_texture->bind(0);
+		specular_texture->bind(1);
+	}
 }
 
 void render(float time)
 {
+	GLState::get().beginFrame();
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	//Light light(glm::vec4(-0.2f, -1.0f, -0.3f, 0));
 	Light light(glm::vec4(1.f, 1.f, 1.f, 1));
@@ -402,14 +288,43 @@ void render(float time)
 		glm::vec3(-1.3f,  1.0f, -1.5f)
 	};
 
+	render_queue.clear();
+	draw_matrices.clear();
 	for (const auto& cubePos : cubePositions)
 	{
-		renderCube(time, cubePos, light, shininess);
+		glm::mat4 m = glm::mat4(1.f);
+		m = glm::translate(m, cubePos);
+		m = glm::rotate(m, time * glm::radians(-90.0f), glm::vec3(0, 1, 0));
+		queueCube(m, SHADER_LIT, MATERIAL_CONTAINER);
 	}
-	
+
 	if (light.position[3] == 1) {
-		renderLightCube(light.position);
+		model_matrix = glm::mat4(1.0f);
+		model_matrix = glm::translate(model_matrix, glm::vec3(light.position));
+		model_matrix = glm::scale(model_matrix, glm::vec3(0.2f)); // a smaller cube
+		queueCube(model_matrix, SHADER_LIGHTCUBE, MATERIAL_NONE);
 	}
+
+	render_queue.sort();
+
+	// all draws are cubes, the arena VAO stays bound
+	Primitives::Arena::get().bind();
+	Shader* current = nullptr;
+	render_queue.execute([&](const SortKey& key, std::uint32_t payload, unsigned int changes) {
+		if (changes & RenderQueue::SHADER_CHANGED)
+			current = applyShader(key.shader, light, shininess);
+		if (changes & RenderQueue::MATERIAL_CHANGED)
+			bindMaterial(key.material);
+
+		current->setUniformMatrix4fv("modelMatrix", draw_matrices[payload]);
+		Primitives::get().drawRange(Primitive::Cube);
+	});
+
+	const RenderQueue::Stats& stats = render_queue.stats();
+	ImGui::Text("draws: %d, program switches: %d, material switches: %d",
+		int(stats.draws), int(stats.shaderChanges), int(stats.materialChanges));
+	const GLState::Stats& state = GLState::get().stats();
+	ImGui::Text("state calls issued: %d, elided: %d", int(state.issued), int(state.elided));
 }
 
 void update()
@@ -10,16 +10,24 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "rendering/GLState.h"
 #include "rendering/Shader.h"
 #include "rendering/Texture.h"
 #include "rendering/Model.h"
+#include "rendering/Primitives.h"
+#include "rendering/VertexLayout.h"
 #include "rendering/Camera.h"
+#include "rendering/FrustumCuller.h"
+#include "rendering/InstanceBuffer.h"
+#include "rendering/Pvs.h"
 #include "rendering/Light.h"
 
 #include "imgui/imgui.h"
 #include "imgui/imgui_impl_glfw.h"
 #include "imgui/imgui_impl_opengl3.h"
 
+#include <helpers/RootDir.h>
+
 
 GLFWwindow* window;
 const int WINDOW_WIDTH = 1920;
@@ -34,6 +42,8 @@ Model* mesh = nullptr;
 Shader* cube_shader = nullptr;
 Shader* lightcube_shader = nullptr;
 Shader* shadowpass_shader = nullptr;
+Shader* cube_instanced_shader = nullptr;
+Shader* shadowpass_instanced_shader = nullptr;
 Shader* debug_shadowpass_shader = nullptr;
 
 Texture* shadowmap_texture = nullptr;
@@ -46,8 +56,39 @@ Camera* camera = nullptr;
 glm::mat4 model_matrix = glm::mat4(1.0f);
 glm::mat4 projection_matrix = glm::perspectiveFov(glm::radians(60.0f), float(WINDOW_WIDTH), float(WINDOW_HEIGHT), 0.1f, 100.0f);
 
-unsigned int cubeVAO, lightCubeVAO;
-unsigned int planeVAO, planeVBO;
+// cubes are culled against the camera for the base pass and against the light for the shadow pass
+const float CUBE_RADIUS = 0.87f; // half diagonal of the unit cube, covers any rotation
+FrustumCuller culler;
+BoundsBatch cube_bounds;
+std::vector<unsigned char> cube_visible;
+std::vector<unsigned char> cube_casts_shadow;
+
+const glm::vec3 cubePositions[] = {
+	glm::vec3(0.0f,  0.0f,  0.0f),
+	glm::vec3(2.0f,  5.0f, -15.0f),
+	glm::vec3(-1.5f, -2.2f, -2.5f),
+	glm::vec3(-3.8f, -2.0f, -12.3f),
+	glm::vec3(2.4f, -0.4f, -3.5f),
+	glm::vec3(-1.7f,  3.0f, -7.5f),
+	glm::vec3(1.3f, -2.0f, -2.5f),
+	glm::vec3(1.5f,  2.0f, -2.5f),
+	glm::vec3(1.5f,  0.2f, -1.5f),
+	glm::vec3(-1.3f,  1.0f, -1.5f)
+};
+const int cubeCount = sizeof(cubePositions) / sizeof(cubePositions[0]);
+
+// The cubes never move, so their visibility from every cell of the space around them is baked
+// once (occluded by the floor and each other) and cached under res/cache/. Cubes outside the set
+// of the camera's cell are dropped before the frustum test; the shadow pass still sees them all.
+Pvs cube_pvs;
+bool use_pvs = true;
+BoundsBatch camera_cube_bounds;
+std::vector<int> camera_cubes;     // cube of every entry of camera_cube_bounds
+std::vector<unsigned char> camera_cube_visible;
+
+// the cubes passing the culling, each pass drawn with one instanced draw call
+InstanceBuffer* visible_cubes = nullptr;
+InstanceBuffer* shadow_casting_cubes = nullptr;
 
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
@@ -109,7 +150,7 @@ void mouse_callback(GLFWwindow* window, double xpos_in, double ypos_in)
 
 void window_size_callback(GLFWwindow* window, int width, int height)
 {
-	glViewport(0, 0, width, height);
+	GLState::get().viewport(0, 0, width, height);
 	projection_matrix = glm::perspectiveFov(glm::radians(60.0f), float(width), float(height), 0.1f, 10.0f);
 
 	if (cube_shader != nullptr)
@@ -152,9 +193,9 @@ int init()
 
 	/* Set the viewport */
 	glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
-	glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+	GLState::get().viewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
 
-	glEnable(GL_DEPTH_TEST);
+	GLState::get().enable(GL_DEPTH_TEST);
 
 	// mouse focus
 	//glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -179,30 +220,6 @@ int init()
 
 void loadPlane()
 {
-	float planeVertices[] = {
-		// positions          // normals             // texture Coords 
-		 5.0f, -0.5f,  5.0f,  0.0f,  1.0f, 0.0f,	 2.0f, 0.0f,
-		-5.0f, -0.5f,  5.0f,  0.0f,  1.0f, 0.0f,	 0.0f, 0.0f,
-		-5.0f, -0.5f, -5.0f,  0.0f,  1.0f, 0.0f,	 0.0f, 2.0f,
-
-		 5.0f, -0.5f,  5.0f,  0.0f,  1.0f, 0.0f,	 2.0f, 0.0f,
-		-5.0f, -0.5f, -5.0f,  0.0f,  1.0f, 0.0f,	 0.0f, 2.0f,
-		 5.0f, -0.5f, -5.0f,  0.0f,  1.0f, 0.0f,	 2.0f, 2.0f
-	};
-
-	glGenVertexArrays(1, &planeVAO);
-	glGenBuffers(1, &planeVBO);
-	glBindVertexArray(planeVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, planeVBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(planeVertices), &planeVertices, GL_STATIC_DRAW);
-
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-
 	plane_texture = new Texture();
 	plane_texture->load("res/models/Stone_Tiles_003_COLOR.png");
 }
@@ -223,141 +240,20 @@ void loadCube()
 	cube_shader->setUniform1i("material.specular", 1);
 	cube_shader->setUniform1i("shadowMap", 2);
 
+	// same lighting, with the transforms read per instance
+	cube_instanced_shader = new Shader("ch07_07_shadowmap_instanced.vert", "ch07_07_shadowmap_pcf.frag");
+	cube_instanced_shader->setUniform1i("material.diffuse", 0);
+	cube_instanced_shader->setUniform1i("material.specular", 1);
+	cube_instanced_shader->setUniform1i("shadowMap", 2);
 
-	// set up vertex data (and buffer(s)) and configure vertex attributes
-	// ------------------------------------------------------------------
-	float vertices[] = {
-		// positions          // normals           // texture coords
-		-0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  0.0f,
-		 0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f,  0.0f,
-		 0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f,  1.0f,
-		 0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f,  1.0f,
-		-0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  1.0f,
-		-0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  0.0f,
-
-		-0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f,  0.0f,
-		 0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f,  0.0f,
-		 0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f,  1.0f,
-		 0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f,  1.0f,
-		-0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f,  1.0f,
-		-0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f,  0.0f,
-
-		-0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f,  0.0f,
-		-0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  1.0f,  1.0f,
-		-0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f,  1.0f,
-		-0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f,  1.0f,
-		-0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  0.0f,  0.0f,
-		-0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f,  0.0f,
-
-		 0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f,  0.0f,
-		 0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  1.0f,  1.0f,
-		 0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f,  1.0f,
-		 0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f,  1.0f,
-		 0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  0.0f,  0.0f,
-		 0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f,  0.0f,
-
-		-0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f,  1.0f,
-		 0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  1.0f,  1.0f,
-		 0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f,  0.0f,
-		 0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f,  0.0f,
-		-0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  0.0f,  0.0f,
-		-0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f,  1.0f,
-
-		-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  1.0f,
-		 0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f,  1.0f,
-		 0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f,  0.0f,
-		 0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f,  0.0f,
-		-0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  0.0f,
-		-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  1.0f
-	};
-
-	// first, configure the cube's VAO (and VBO)
-	unsigned int cubeVBO;
-	glGenVertexArrays(1, &cubeVAO);
-	glGenBuffers(1, &cubeVBO);
-
-	glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-	glBindVertexArray(cubeVAO);
-
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
+	visible_cubes = new InstanceBuffer();
+	shadow_casting_cubes = new InstanceBuffer();
 }
 
 void loadLightCube()
 {
 	lightcube_shader = new Shader("lightcube.vert", "lightcube.frag");
 	lightcube_shader->apply();
-
-
-	// second, configure the light's VAO (VBO stays the same; the vertices are the same for the light object which is also a 3D cube)
-	float lightcube_vertices[] = {
-		-0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-		 0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-		 0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-		 0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-		-0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-		-0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-
-		-0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-		 0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-		 0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-		 0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-		-0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-		-0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-
-		-0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
-		-0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
-		-0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
-		-0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
-		-0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
-		-0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
-
-		 0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
-		 0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
-		 0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
-		 0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
-		 0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
-		 0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
-
-		-0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
-		 0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
-		 0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
-		 0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
-		-0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
-		-0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
-
-		-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,
-		 0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,
-		 0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
-		 0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
-		-0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
-		-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f
-	};
-
-	unsigned int lightCubeVBO;
-	glGenBuffers(1, &lightCubeVBO);
-
-	glBindBuffer(GL_ARRAY_BUFFER, lightCubeVBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(lightcube_vertices), lightcube_vertices, GL_STATIC_DRAW);
-
-	glGenVertexArrays(1, &lightCubeVAO);
-	glBindVertexArray(lightCubeVAO);
-
-	glBindBuffer(GL_ARRAY_BUFFER, lightCubeVBO);
-
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	// normal attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-
 }
 
 void loadShadowMap()
@@ -369,11 +265,53 @@ void loadShadowMap()
 
 	// load shader for shadow pass
 	shadowpass_shader = new Shader("shadowpass.vert", "shadowpass.frag");
+	shadowpass_instanced_shader = new Shader("shadowpass_instanced.vert", "shadowpass.frag");
 	debug_shadowpass_shader = new Shader("debug_shadowpass.vert", "debug_shadowpass.frag");
 
 	debug_shadowpass_shader->setUniform1i("shadowMap", 0);
 }
 
+// bakes the cube PVS, unless the cached one was baked from the same scene
+void loadCubePvs()
+{
+	const float FLOOR_SIZE = 5.0f;
+	const float FLOOR_HEIGHT = -0.5f;
+	// the box a unit cube spinning around y never leaves
+	const glm::vec3 CUBE_CORE(0.5f / 1.41421356f, 0.5f, 0.5f / 1.41421356f);
+
+	Bounds region;
+	region.min = glm::vec3(-10.0f, -5.0f, -25.0f);
+	region.max = glm::vec3(10.0f, 10.0f, 10.0f);
+
+	std::vector<Bounds> occluders;
+	std::vector<Bounds> cubes;
+	Bounds floor;
+	floor.min = glm::vec3(-FLOOR_SIZE, FLOOR_HEIGHT - 0.01f, -FLOOR_SIZE);
+	floor.max = glm::vec3(FLOOR_SIZE, FLOOR_HEIGHT, FLOOR_SIZE);
+	occluders.push_back(floor);
+	for (const glm::vec3& position : cubePositions)
+	{
+		Bounds core;
+		core.min = position - CUBE_CORE;
+		core.max = position + CUBE_CORE;
+		occluders.push_back(core);
+
+		Bounds bounds;
+		bounds.min = position - glm::vec3(CUBE_RADIUS);
+		bounds.max = position + glm::vec3(CUBE_RADIUS);
+		cubes.push_back(bounds);
+	}
+
+	const std::string path = std::string(ROOT_DIR) + "res/cache/ch07_07_cubes.pvs";
+	const std::uint32_t signature = Pvs::signature(region, occluders, cubes);
+	if (!cube_pvs.load(path, signature, cubes.size()))
+	{
+		cube_pvs.bake(region, occluders, cubes);
+		cube_pvs.save(path, signature);
+		std::cout << "Baked cube PVS: " << cube_pvs.cellCount() << " cells in " << cube_pvs.bakeMilliseconds() << " ms" << std::endl;
+	}
+}
+
 int loadContent()
 {
 	camera = new Camera(glm::vec3(0.0f, 0.0f, 3.f), glm::vec3(0.0f, 1.0f, 0.0f));
@@ -382,52 +320,51 @@ int loadContent()
 	loadPlane();
 	loadLightCube();
 	loadShadowMap();
+	loadCubePvs();
 
 	return true;
 }
 
-void renderCube(float time, const glm::vec3& objectPos, const Light& light, float shininess, bool bShadowPass)
+// all cubes of the buffer with one draw call; the uniforms are set once per pass instead of per cube
+void renderCubes(InstanceBuffer& cubes, const Light& light, float shininess, bool bShadowPass)
 {
-	glm::mat4 m = glm::mat4(1.f);
-	m = glm::translate(m, objectPos);
-	m = glm::rotate(m, time * glm::radians(-90.0f), glm::vec3(0, 1, 0));
+	if (cubes.empty())
+		return;
 
 	if (bShadowPass)
 	{
-		shadowpass_shader->setUniformMatrix4fv("modelMatrix", m);
-		shadowpass_shader->setUniformMatrix4fv("world2lightNDC", light.GetWorld2LightNDC());
+		shadowpass_instanced_shader->setUniformMatrix4fv("world2lightNDC", light.GetWorld2LightNDC());
 
-		shadowpass_shader->apply();
+		shadowpass_instanced_shader->apply();
 	}
 	else // base pass
 	{
 		diffuse_texture->bind(0);
 		specular_texture->bind(1);
 		shadowmap_texture->bind(2);
-		cube_shader->setUniformMatrix4fv("modelMatrix", m);
-		cube_shader->setUniformMatrix4fv("viewMatrix", camera->getViewMatrix());
-		cube_shader->setUniformMatrix4fv("projectionMatrix", projection_matrix);
-		cube_shader->setUniformMatrix4fv("world2lightNDC", light.GetWorld2LightNDC());
+		cube_instanced_shader->setUniformMatrix4fv("viewMatrix", camera->getViewMatrix());
+		cube_instanced_shader->setUniformMatrix4fv("projectionMatrix", projection_matrix);
+		cube_instanced_shader->setUniformMatrix4fv("world2lightNDC", light.GetWorld2LightNDC());
 
 		// for light
-		cube_shader->setUniform3fv("cameraPos", camera->getCamPosition());
+		cube_instanced_shader->setUniform3fv("cameraPos", camera->getCamPosition());
 
-		cube_shader->setUniform4fv("light.position", light.position);
-		cube_shader->setUniform3fv("light.ambient", light.ambient);
-		cube_shader->setUniform3fv("light.diffuse", light.diffuse);
-		cube_shader->setUniform3fv("light.specular", light.specular);
-		cube_shader->setUniform1f("light.constant", light.constant);
-		cube_shader->setUniform1f("light.linear", light.linear);
-		cube_shader->setUniform1f("light.quadratic", light.quadratic);
+		cube_instanced_shader->setUniform4fv("light.position", light.position);
+		cube_instanced_shader->setUniform3fv("light.ambient", light.ambient);
+		cube_instanced_shader->setUniform3fv("light.diffuse", light.diffuse);
+		cube_instanced_shader->setUniform3fv("light.specular", light.specular);
+		cube_instanced_shader->setUniform1f("light.constant", light.constant);
+		cube_instanced_shader->setUniform1f("light.linear", light.linear);
+		cube_instanced_shader->setUniform1f("light.quadratic", light.quadratic);
 
 		// for material
-		cube_shader->setUniform1f("material.shininess", shininess);
-		cube_shader->apply();
+		cube_instanced_shader->setUniform1f("material.shininess", shininess);
+		cube_instanced_shader->apply();
 	}
 
-	// render the cube
-	glBindVertexArray(cubeVAO);
-	glDrawArrays(GL_TRIANGLES, 0, 36);
+	// render the cubes
+	cubes.bind();
+	Primitives::get().drawInstanced(Primitive::Cube, cubes.size());
 }
 
 void renderLightCube(const glm::vec3& pos)
@@ -441,13 +378,13 @@ void renderLightCube(const glm::vec3& pos)
 
 	lightcube_shader->apply();
 
-	glBindVertexArray(lightCubeVAO);
-	glDrawArrays(GL_TRIANGLES, 0, 36);
+	Primitives::get().draw(Primitive::Cube);
 }
 
 void renderPlane(const Light& light, float shininess, bool bShadowPass)
 {
-	glm::mat4 m = glm::mat4(1.f);
+	// the unit plane, as a 10 x 10 floor under the cubes
+	const glm::mat4 m = glm::scale(glm::translate(glm::mat4(1.f), glm::vec3(0.0f, -0.5f, 0.0f)), glm::vec3(10.0f, 1.0f, 10.0f));
 	
 	if (bShadowPass)
 	{
@@ -462,6 +399,8 @@ void renderPlane(const Light& light, float shininess, bool bShadowPass)
 		specular_texture->bind(1);
 		shadowmap_texture->bind(2);
 		cube_shader->setUniformMatrix4fv("modelMatrix", m);
+		// the unit plane maps the texture once, the floor tiles it twice
+		cube_shader->setUniform2fv("uvScale", glm::vec2(2.0f));
 		cube_shader->setUniformMatrix4fv("viewMatrix", camera->getViewMatrix());
 		cube_shader->setUniformMatrix4fv("projectionMatrix", projection_matrix);
 		cube_shader->setUniformMatrix4fv("world2lightNDC", light.GetWorld2LightNDC());
@@ -483,37 +422,7 @@ void renderPlane(const Light& light, float shininess, bool bShadowPass)
 	}
 
 	// floor
-	glBindVertexArray(planeVAO);
-	glDrawArrays(GL_TRIANGLES, 0, 6);
-}
-
-unsigned int quadVAO = 0;
-unsigned int quadVBO;
-void renderQuad()
-{
-	if (quadVAO == 0)
-	{
-		float quadVertices[] = {
-			// positions        // texture Coords
-			-1.0f,  1.0f, 0.0f, 0.0f, 1.0f,
-			-1.0f, -1.0f, 0.0f, 0.0f, 0.0f,
-			 1.0f,  1.0f, 0.0f, 1.0f, 1.0f,
-			 1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
-		};
-		// setup plane VAO
-		glGenVertexArrays(1, &quadVAO);
-		glGenBuffers(1, &quadVBO);
-		glBindVertexArray(quadVAO);
-		glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-	}
-	glBindVertexArray(quadVAO);
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-	glBindVertexArray(0);
+	Primitives::get().draw(Primitive::Plane);
 }
 
 void render(float time)
@@ -543,29 +452,63 @@ void render(float time)
 
 	// --------------------
 
-	glm::vec3 cubePositions[] = {
-		glm::vec3(0.0f,  0.0f,  0.0f),
-		glm::vec3(2.0f,  5.0f, -15.0f),
-		glm::vec3(-1.5f, -2.2f, -2.5f),
-		glm::vec3(-3.8f, -2.0f, -12.3f),
-		glm::vec3(2.4f, -0.4f, -3.5f),
-		glm::vec3(-1.7f,  3.0f, -7.5f),
-		glm::vec3(1.3f, -2.0f, -2.5f),
-		glm::vec3(1.5f,  2.0f, -2.5f),
-		glm::vec3(1.5f,  0.2f, -1.5f),
-		glm::vec3(-1.3f,  1.0f, -1.5f)
-	};
-	
+	// ------ Culling -----
+	cube_bounds.clear();
+	for (const auto& cubePos : cubePositions)
+	{
+		cube_bounds.addSphere(cubePos, CUBE_RADIUS);
+	}
+
+	// the PVS of the camera's cell goes first, the frustum test only sees what it lets through
+	ImGui::Checkbox("PVS", &use_pvs);
+	cube_pvs.setViewpoint(camera->getCamPosition());
+	camera_cube_bounds.clear();
+	camera_cubes.clear();
+	for (int i = 0; i < cubeCount; ++i)
+	{
+		if (use_pvs && !cube_pvs.isVisible(i))
+			continue;
+		camera_cube_bounds.addSphere(cubePositions[i], CUBE_RADIUS);
+		camera_cubes.push_back(i);
+	}
+
+	culler.resetStats();
+	culler.setFrustum(Frustum::fromMatrix(light.GetWorld2LightNDC()));
+	const std::size_t shadowCasters = culler.cullSpheres(cube_bounds, cube_casts_shadow);
+	culler.setFrustum(camera->getFrustum(projection_matrix));
+	culler.cullSpheres(camera_cube_bounds, camera_cube_visible);
+	cube_visible.assign(cubeCount, 0);
+	std::size_t visibleCubes = 0;
+	for (std::size_t i = 0; i < camera_cubes.size(); ++i)
+	{
+		cube_visible[camera_cubes[i]] = camera_cube_visible[i];
+		visibleCubes += camera_cube_visible[i];
+	}
+
+	ImGui::Text("cubes visible: %d/%d, shadow casters: %d/%d, culled: %d (%s)",
+		int(visibleCubes), cubeCount, int(shadowCasters), cubeCount, int(culler.stats().culled), FrustumCuller::simdName());
+	ImGui::Text("PVS cell %d of %d: %d cubes pass, %d/%d bytes compressed",
+		cube_pvs.getCurrentCell(), int(cube_pvs.cellCount()), int(camera_cubes.size()),
+		int(cube_pvs.compressedSize()), int(cube_pvs.uncompressedSize()));
+
+	const glm::quat cubeRotation = glm::angleAxis(time * glm::radians(-90.0f), glm::vec3(0, 1, 0));
+	visible_cubes->clear();
+	shadow_casting_cubes->clear();
+	for (int i = 0; i < cubeCount; ++i)
+	{
+		if (cube_visible[i])
+			visible_cubes->add(InstanceTransform(cubePositions[i], cubeRotation));
+		if (cube_casts_shadow[i])
+			shadow_casting_cubes->add(InstanceTransform(cubePositions[i], cubeRotation));
+	}
+
 	// ------ Shadow Pass -----
 	shadowmap_texture->bindFrameBuffer();
 	glClear(GL_DEPTH_BUFFER_BIT);
 
 	renderPlane(light, shininess, true);
-	for (const auto& cubePos : cubePositions)
-	{
-		renderCube(time, cubePos, light, shininess, true);
-	}
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	renderCubes(*shadow_casting_cubes, light, shininess, true);
+	GLState::get().bindFramebuffer(GL_FRAMEBUFFER, 0);
 	// -----------------------------
 	
 	if (debug_shadow_mode)
@@ -573,19 +516,15 @@ void render(float time)
 		shadowmap_texture->bind(0);
 		debug_shadowpass_shader->apply();
 
-		renderQuad();
+		Primitives::get().draw(Primitive::Quad);
 		return;
 	}
 	// reset viewport
-	glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+	GLState::get().viewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	renderPlane(light, shininess, false);
-
-	for (const auto& cubePos : cubePositions)
-	{
-		renderCube(time, cubePos, light, shininess, false);
-	}
+	renderCubes(*visible_cubes, light, shininess, false);
 
 	if (light.position[3] == 1) {
 		renderLightCube(light.position);
@@ -640,6 +579,10 @@ int main(void)
 
 	delete mesh;
 	delete cube_shader;
+	delete cube_instanced_shader;
+	delete shadowpass_instanced_shader;
+	delete visible_cubes;
+	delete shadow_casting_cubes;
 	delete diffuse_texture;
 	delete specular_texture;
 
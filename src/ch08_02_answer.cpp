@@ -10,6 +10,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "rendering/GLState.h"
 #include "rendering/Shader.h"
 #include "rendering/Texture.h"
 #include "rendering/Model.h"
@@ -98,7 +99,7 @@ void mouse_callback(GLFWwindow* window, double xpos_in, double ypos_in)
 
 void window_size_callback(GLFWwindow* window, int width, int height)
 {
-	glViewport(0, 0, width, height);
+	GLState::get().viewport(0, 0, width, height);
 	projection_matrix = glm::perspectiveFov(glm::radians(60.0f), float(width), float(height), 0.1f, 10.0f);
 
 	if (shader != nullptr)
@@ -141,9 +142,9 @@ int init()
 
 	/* Set the viewport */
 	glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
-	glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+	GLState::get().viewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
 
-	glEnable(GL_DEPTH_TEST);
+	GLState::get().enable(GL_DEPTH_TEST);
 
 	// mouse focus
 	//glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -243,7 +244,7 @@ int loadContent()
 	// cube VAO
 	glGenVertexArrays(1, &cubeVAO);
 	glGenBuffers(1, &cubeVBO);
-	glBindVertexArray(cubeVAO);
+	GLState::get().bindVertexArray(cubeVAO);
 	glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), &cubeVertices, GL_STATIC_DRAW);
 	glEnableVertexAttribArray(0);
@@ -253,7 +254,7 @@ int loadContent()
 	// plane VAO
 	glGenVertexArrays(1, &planeVAO);
 	glGenBuffers(1, &planeVBO);
-	glBindVertexArray(planeVAO);
+	GLState::get().bindVertexArray(planeVAO);
 	glBindBuffer(GL_ARRAY_BUFFER, planeVBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(planeVertices), &planeVertices, GL_STATIC_DRAW);
 	glEnableVertexAttribArray(0);
@@ -263,14 +264,14 @@ int loadContent()
 	// transparent VAO
 	glGenVertexArrays(1, &transparentVAO);
 	glGenBuffers(1, &transparentVBO);
-	glBindVertexArray(transparentVAO);
+	GLState::get().bindVertexArray(transparentVAO);
 	glBindBuffer(GL_ARRAY_BUFFER, transparentVBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(transparentVertices), transparentVertices, GL_STATIC_DRAW);
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
 	glEnableVertexAttribArray(1);
 	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-	glBindVertexArray(0);
+	GLState::get().bindVertexArray(0);
 
 
 	// load textures
@@ -308,7 +309,7 @@ void render(float time)
 
 	// cubes
 	cubeTexture->bind(0);
-	glBindVertexArray(cubeVAO);
+	GLState::get().bindVertexArray(cubeVAO);
 	model_m = glm::translate(glm::mat4(1.f), glm::vec3(-1.0f, 0.0f, -1.0f));
 	shader->setUniformMatrix4fv("modelMatrix", model_m);
 	glDrawArrays(GL_TRIANGLES, 0, 36);
@@ -320,14 +321,14 @@ void render(float time)
 
 	// floor
 	floorTexture->bind(0);
-	glBindVertexArray(planeVAO);
+	GLState::get().bindVertexArray(planeVAO);
 	model_m = glm::mat4(1.0f);
 	shader->setUniformMatrix4fv("modelMatrix", model_m);
 	glDrawArrays(GL_TRIANGLES, 0, 6);
 
 	// vegetation
 	transparentTexture->bind(0);
-	glBindVertexArray(transparentVAO);
+	GLState::get().bindVertexArray(transparentVAO);
 	for (unsigned int i = 0; i < vegetation.size(); i++)
 	{
 		model_m = glm::translate(glm::mat4(1.0f), vegetation[i]);
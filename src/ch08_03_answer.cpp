@@ -10,10 +10,14 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "rendering/GLState.h"
+#include "rendering/PipelineState.h"
 #include "rendering/Shader.h"
 #include "rendering/Texture.h"
 #include "rendering/Model.h"
+#include "rendering/VertexLayout.h"
 #include "rendering/Camera.h"
+#include "rendering/InstanceBuffer.h"
 
 #include "imgui/imgui.h"
 #include "imgui/imgui_impl_glfw.h"
@@ -31,6 +35,12 @@ bool cursor_enabled = true;
 
 Model* mesh = nullptr;
 Shader* shader = nullptr;
+Shader* vegetation_shader = nullptr;
+// the vegetation quads, back to front, drawn with one instanced draw call
+InstanceBuffer* vegetation_instances = nullptr;
+// blending is part of the pipeline of the vegetation, the cubes and the floor draw without it
+const PipelineState* opaque_pipeline = nullptr;
+const PipelineState* vegetation_pipeline = nullptr;
 
 Camera* camera = nullptr;
 
@@ -98,7 +108,7 @@ void mouse_callback(GLFWwindow* window, double xpos_in, double ypos_in)
 
 void window_size_callback(GLFWwindow* window, int width, int height)
 {
-	glViewport(0, 0, width, height);
+	GLState::get().viewport(0, 0, width, height);
 	projection_matrix = glm::perspectiveFov(glm::radians(60.0f), float(width), float(height), 0.1f, 10.0f);
 
 	if (shader != nullptr)
@@ -141,13 +151,9 @@ int init()
 
 	/* Set the viewport */
 	glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
-	glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+	GLState::get().viewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
 
-	glEnable(GL_DEPTH_TEST);
-
-	// enable blending
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	GLState::get().enable(GL_DEPTH_TEST);
 
 	// mouse focus
 	//glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -177,6 +183,8 @@ int loadContent()
 	/* Create and apply basic shader */
 	shader = new Shader("ch08_03_alphablend.vert", "ch08_03_alphablend.frag");
 	shader->apply();
+	vegetation_shader = new Shader("ch08_03_alphablend_instanced.vert", "ch08_03_alphablend.frag");
+	vegetation_instances = new InstanceBuffer();
 
 	float cubeVertices[] = {
 		// positions          // texture Coords
@@ -247,34 +255,35 @@ int loadContent()
 	// cube VAO
 	glGenVertexArrays(1, &cubeVAO);
 	glGenBuffers(1, &cubeVBO);
-	glBindVertexArray(cubeVAO);
+	GLState::get().bindVertexArray(cubeVAO);
 	glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), &cubeVertices, GL_STATIC_DRAW);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+	TexturedLayout::setup();
 	// plane VAO
 	glGenVertexArrays(1, &planeVAO);
 	glGenBuffers(1, &planeVBO);
-	glBindVertexArray(planeVAO);
+	GLState::get().bindVertexArray(planeVAO);
 	glBindBuffer(GL_ARRAY_BUFFER, planeVBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(planeVertices), &planeVertices, GL_STATIC_DRAW);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+	TexturedLayout::setup();
 	// transparent VAO
 	glGenVertexArrays(1, &transparentVAO);
 	glGenBuffers(1, &transparentVBO);
-	glBindVertexArray(transparentVAO);
+	GLState::get().bindVertexArray(transparentVAO);
 	glBindBuffer(GL_ARRAY_BUFFER, transparentVBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(transparentVertices), transparentVertices, GL_STATIC_DRAW);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-	glBindVertexArray(0);
+	TexturedLayout::setup();
+	GLState::get().bindVertexArray(0);
+
+	PipelineDesc opaque;
+	opaque.shader = shader;
+	opaque_pipeline = PipelineState::create(opaque);
+
+	PipelineDesc vegetation;
+	vegetation.shader = vegetation_shader;
+	vegetation.vertexArray = transparentVAO;
+	vegetation.blend = BlendState::alpha();
+	vegetation_pipeline = PipelineState::create(vegetation);
 
 
 	// load textures
@@ -307,11 +316,11 @@ void render(float time)
 	shader->setUniformMatrix4fv("modelMatrix", model_m);
 	shader->setUniformMatrix4fv("viewMatrix", camera->getViewMatrix());
 	shader->setUniformMatrix4fv("projectionMatrix", projection_matrix);
-	shader->apply();
+	opaque_pipeline->bind();
 
 	// cubes
 	cubeTexture->bind(0);
-	glBindVertexArray(cubeVAO);
+	GLState::get().bindVertexArray(cubeVAO);
 	model_m = glm::translate(glm::mat4(1.f), glm::vec3(-1.0f, 0.0f, -1.0f));
 	shader->setUniformMatrix4fv("modelMatrix", model_m);
 	glDrawArrays(GL_TRIANGLES, 0, 36);
@@ -323,14 +332,13 @@ void render(float time)
 
 	// floor
 	floorTexture->bind(0);
-	glBindVertexArray(planeVAO);
+	GLState::get().bindVertexArray(planeVAO);
 	model_m = glm::mat4(1.0f);
 	shader->setUniformMatrix4fv("modelMatrix", model_m);
 	glDrawArrays(GL_TRIANGLES, 0, 6);
 
-	// vegetation
-	transparentTexture->bind(0);
-	glBindVertexArray(transparentVAO);
+	// vegetation: instances are drawn in buffer order, so sorting the instances keeps the blending right
+	vegetation_instances->clear();
 
 	bool bTransparentSort = true;
 	if (bTransparentSort)
@@ -344,20 +352,23 @@ void render(float time)
 
 		for (std::map<float, glm::vec3>::reverse_iterator it = sorted.rbegin(); it != sorted.rend(); ++it)
 		{
-			model_m = glm::translate(glm::mat4(1.0f), it->second);
-			shader->setUniformMatrix4fv("modelMatrix", model_m);
-			glDrawArrays(GL_TRIANGLES, 0, 6);
+			vegetation_instances->add(InstanceTransform(it->second));
 		}
 	}
 	else
 	{
 		for (unsigned int i = 0; i < vegetation.size(); i++)
 		{
-			model_m = glm::translate(glm::mat4(1.0f), vegetation[i]);
-			shader->setUniformMatrix4fv("modelMatrix", model_m);
-			glDrawArrays(GL_TRIANGLES, 0, 6);
+			vegetation_instances->add(InstanceTransform(vegetation[i]));
 		}
 	}
+
+	transparentTexture->bind(0);
+	vegetation_shader->setUniformMatrix4fv("viewMatrix", camera->getViewMatrix());
+	vegetation_shader->setUniformMatrix4fv("projectionMatrix", projection_matrix);
+	vegetation_pipeline->bind();
+	vegetation_instances->bind();
+	glDrawArraysInstanced(GL_TRIANGLES, 0, 6, static_cast<GLsizei>(vegetation_instances->size()));
 }
 
 void update()
@@ -409,6 +420,8 @@ int main(void)
 
 	delete mesh;
 	delete shader;
+	delete vegetation_shader;
+	delete vegetation_instances;
 
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
@@ -0,0 +1,773 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include <iostream>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#define  GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "rendering/GLState.h"
+#include "rendering/Shader.h"
+#include "rendering/Texture.h"
+#include "rendering/Model.h"
+#include "rendering/Primitives.h"
+#include "rendering/DrawBucket.h"
+#include "rendering/Bvh.h"
+#include "rendering/FrustumCuller.h"
+#include "rendering/GpuCuller.h"
+#include "rendering/HiZPyramid.h"
+#include "rendering/OcclusionBuffer.h"
+#include "rendering/Meshlet.h"
+#include "rendering/SpatialGrid.h"
+#include "rendering/SceneGraph.h"
+#include "rendering/Lod.h"
+#include "rendering/Camera.h"
+#include "rendering/Light.h"
+
+#include "imgui/imgui.h"
+#include "imgui/imgui_impl_glfw.h"
+#include "imgui/imgui_impl_opengl3.h"
+
+#include <vector>
+
+// Multi-draw-indirect: every cube and every mesh of the model is one entry of a DrawBucket,
+// and the whole scene is submitted with a single glMultiDrawElementsIndirect.
+// With meshlet culling on, the model draws are rebuilt every frame from the meshlets that
+// pass the frustum and normal cone tests. Models far enough away switch to a coarser level of
+// detail instead, picked from the projected error of the levels. The object under the mouse
+// cursor is picked through the scene BVH and highlighted. Objects are culled either as one SIMD
+// batch, through the refitted BVH or through a loose spatial grid the objects move in.
+// Object transforms come from a scene graph (each row of cubes hangs off a row node), and only
+// the objects below changed nodes are updated and uploaded.
+// In GPU mode the whole draw list stays on the GPU, where a compute shader culls it against the
+// frustum and the Hi-Z pyramid of the previous frame's depth and compacts the survivors for
+// glMultiDrawElementsIndirectCount.
+// The CPU modes can add software occlusion culling instead: the models and the cubes close to
+// the camera are rasterized into a small depth buffer, which the other objects are tested against.
+
+GLFWwindow* window;
+const int WINDOW_WIDTH = 1920;
+const int WINDOW_HEIGHT = 1080;
+float lastX = WINDOW_WIDTH / 2.0;
+float lastY = WINDOW_HEIGHT / 2.0;
+bool firstMouse = true;
+bool cursor_enabled = true;
+
+Model* model = nullptr;
+Mesh* cube = nullptr;
+Shader* shader = nullptr;
+Texture* diffuse_texture = nullptr;
+Camera* camera = nullptr;
+
+DrawBucket<DefaultLayout>* bucket = nullptr;
+GLuint materialBuffer = 0;
+
+MeshletCuller culler;
+std::vector<DrawElementsIndirectCommand> meshlet_commands;
+const int MODEL_COUNT = 4;
+
+const GLuint HIGHLIGHT_MATERIAL = 4;
+
+struct SceneObject
+{
+	glm::mat4 matrix;
+	Bounds bounds;      // world space
+	GLuint material;
+};
+
+// in object index order
+std::vector<SceneObject> objects;
+
+// object culling. The three CPU modes give the same result. CULL_GPU tests the same world
+// boxes against the same frustum, in the frame they are drawn, so its frustum culling matches
+// them exactly; only its stats are read back a frame or more late (through the fence ring of
+// GpuCuller), and its Hi-Z occlusion uses the depth of the previous frame.
+enum CullMode { CULL_SIMD = 0, CULL_BVH, CULL_GRID, CULL_GPU };
+
+FrustumCuller object_culler;
+BoundsBatch object_bounds;
+std::vector<unsigned char> object_visible;
+std::vector<unsigned int> query_visible;
+
+// over the world bounds of the objects, refit while they move
+Bvh scene_bvh;
+std::vector<Bounds> scene_bounds;
+int hovered_object = -1;
+
+// the same bounds in a loose grid, moved along with the objects
+SpatialGrid scene_grid(2.0f);
+std::vector<SpatialGrid::Handle> grid_handles;
+
+// occluders: the models and the cubes closer than OCCLUDER_DISTANCE
+OcclusionBuffer occlusion_buffer;
+const float OCCLUDER_DISTANCE = 12.0f;
+
+// every draw with its object space box, culled on the GPU; the list only changes with the grid
+// and the model LODs
+GpuCuller* gpu_culler = nullptr;
+HiZPyramid* hi_z = nullptr;
+std::vector<Bounds> gpu_draw_bounds;
+bool gpu_draws_dirty = true;
+// the culler keeps a copy of the commands, with the arena offsets of this generation
+std::uint64_t gpu_draws_generation = 0;
+
+// models are roots, cubes are children of their row node
+SceneGraph scene_graph;
+std::vector<SceneGraph::Node> object_nodes;
+std::vector<SceneGraph::Node> row_nodes;
+std::vector<int> slot_objects;      // object of every scene graph slot, -1 for the row nodes
+
+LodSelector lod_selector;
+unsigned int model_lods[MODEL_COUNT] = {};
+float viewport_height = float(WINDOW_HEIGHT);
+
+glm::mat4 projection_matrix = glm::perspectiveFov(glm::radians(60.0f), float(WINDOW_WIDTH), float(WINDOW_HEIGHT), 0.1f, 200.0f);
+
+const int MAX_GRID = 100;
+int grid_size = 40;
+int built_grid_size = -1;
+
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	if (key == GLFW_KEY_F1 && action == GLFW_PRESS)
+	{
+		if (cursor_enabled)
+		{
+			glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+		}
+		else
+		{
+			glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+		}
+		cursor_enabled = !cursor_enabled;
+	}
+}
+
+void processInput(GLFWwindow* window, float deltaTime)
+{
+	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+		glfwSetWindowShouldClose(window, true);
+
+	if (camera)
+	{
+		camera->processInput(window, deltaTime);
+	}
+}
+
+// closest object hit by the ray through the cursor, -1 for none
+int pickObject(float x, float y)
+{
+	if (scene_bvh.empty())
+	{
+		return -1;
+	}
+
+	int width, height;
+	glfwGetWindowSize(window, &width, &height);
+	const Ray ray = Ray::fromScreen(x, y, float(width), float(height), projection_matrix * camera->getViewMatrix());
+
+	// the BVH narrows it down to the objects whose box is hit, then the triangles decide
+	float t;
+	const unsigned int hit = scene_bvh.closestHit(ray, t, 1.0f, [](unsigned int object, const Ray& worldRay, float maxT) {
+		const Ray objectRay = worldRay.transformed(glm::inverse(objects[object].matrix));
+		float objectT;
+		const bool hit = object < MODEL_COUNT ? model->raycast(objectRay, objectT, maxT) : cube->raycast(objectRay, objectT, maxT);
+		return hit ? objectT : FLT_MAX;
+	});
+
+	return hit == ~0u ? -1 : int(hit);
+}
+
+void setHoveredObject(int object)
+{
+	if (object == hovered_object)
+	{
+		return;
+	}
+
+	if (hovered_object >= 0 && hovered_object < int(objects.size()))
+	{
+		bucket->setMaterial(hovered_object, objects[hovered_object].material);
+	}
+	if (object >= 0)
+	{
+		bucket->setMaterial(object, HIGHLIGHT_MATERIAL);
+	}
+	hovered_object = object;
+}
+
+void mouse_callback(GLFWwindow* window, double xpos_in, double ypos_in)
+{
+	if (cursor_enabled)
+	{
+		// picking while the cursor is free, unless it is over the UI
+		if (!ImGui::GetIO().WantCaptureMouse)
+			setHoveredObject(pickObject(static_cast<float>(xpos_in), static_cast<float>(ypos_in)));
+		return;
+	}
+
+	float xpos = static_cast<float>(xpos_in);
+	float ypos = static_cast<float>(ypos_in);
+
+	if (firstMouse)
+	{
+		lastX = xpos;
+		lastY = ypos;
+		firstMouse = false;
+	}
+
+	float xoffset = xpos - lastX;
+	float yoffset = lastY - ypos; // reversed since y-coordinates go from bottom to top
+	lastX = xpos;
+	lastY = ypos;
+
+	if (camera)
+	{
+		camera->processMouseMovement(xoffset, yoffset);
+	}
+}
+
+void window_size_callback(GLFWwindow* window, int width, int height)
+{
+	GLState::get().viewport(0, 0, width, height);
+	projection_matrix = glm::perspectiveFov(glm::radians(60.0f), float(width), float(height), 0.1f, 200.0f);
+	viewport_height = float(height);
+}
+
+int init()
+{
+	/* Initialize the library */
+	if (!glfwInit())
+		return -1;
+
+	/* Create a windowed mode window and its OpenGL context */
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+	window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Hello Modern GL!", nullptr, nullptr);
+
+	if (!window)
+	{
+		glfwTerminate();
+		return -1;
+	}
+
+	/* Make the window's context current */
+	glfwMakeContextCurrent(window);
+
+	glfwSetWindowSizeCallback(window, window_size_callback);
+
+	/* Initialize glad */
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	{
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		return -1;
+	}
+
+	/* Set the viewport */
+	glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
+	GLState::get().viewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+
+	GLState::get().enable(GL_DEPTH_TEST);
+
+	// mouse callback
+	glfwSetCursorPosCallback(window, mouse_callback);
+
+	glfwSetKeyCallback(window, key_callback);
+
+	// IMGUI
+	// ------------
+	IMGUI_CHECKVERSION();
+	ImGui::CreateContext();
+	ImGuiIO& io = ImGui::GetIO();
+	io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;     // Enable Keyboard Controls
+
+	// Setup Platform/Renderer backends
+	ImGui_ImplGlfw_InitForOpenGL(window, true);          // Second param install_callback=true will install GLFW callbacks and chain to existing ones.
+	ImGui_ImplOpenGL3_Init();
+
+	return true;
+}
+
+Mesh* createCube()
+{
+	// its own copy of the shared cube, with the CPU side vertices for bounds and raycasts
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	Primitives::geometry(Primitive::Cube, vertices, indices);
+	return new Mesh(vertices, indices);
+}
+
+void loadMaterials()
+{
+	struct Material
+	{
+		glm::vec4 color;
+		glm::vec4 params;
+	};
+
+	const Material materials[] = {
+		{ glm::vec4(1.0f, 1.0f, 1.0f, 1.0f), glm::vec4(32.0f) },
+		{ glm::vec4(1.0f, 0.5f, 0.4f, 1.0f), glm::vec4(8.0f) },
+		{ glm::vec4(0.4f, 0.7f, 1.0f, 1.0f), glm::vec4(64.0f) },
+		{ glm::vec4(0.6f, 1.0f, 0.5f, 1.0f), glm::vec4(16.0f) },
+		{ glm::vec4(2.0f, 1.8f, 0.2f, 1.0f), glm::vec4(4.0f) },   // HIGHLIGHT_MATERIAL
+	};
+
+	glGenBuffers(1, &materialBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, materialBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(materials), materials, GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+int loadContent()
+{
+	camera = new Camera(glm::vec3(0.0f, 5.0f, 30.f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	shader = new Shader("ch09_01_indirect.vert", "ch09_01_indirect.frag");
+	shader->setUniform1i("diffuseMap", 0);
+
+	diffuse_texture = new Texture();
+	diffuse_texture->load("res/models/container_diffuse.png");
+
+	model = new Model("res/models/alliance.obj");
+	cube = createCube();
+	bucket = new DrawBucket<DefaultLayout>();
+	gpu_culler = new GpuCuller();
+	hi_z = new HiZPyramid();
+
+	loadMaterials();
+
+	return true;
+}
+
+void buildBucket()
+{
+	bucket->clear();
+	objects.clear();
+	hovered_object = -1;
+
+	scene_graph.clear();
+	object_nodes.clear();
+	row_nodes.clear();
+
+	// a few models up front (objects 0 .. MODEL_COUNT-1), then a grid of cubes
+	for (int i = 0; i < MODEL_COUNT; ++i)
+	{
+		object_nodes.push_back(scene_graph.add(SceneGraph::InvalidNode, glm::vec3(-6.0f + 4.0f * i, 2.0f, 8.0f)));
+	}
+
+	for (int z = 0; z < grid_size; ++z)
+	{
+		const SceneGraph::Node row = scene_graph.add(SceneGraph::InvalidNode, glm::vec3(0.0f, 0.0f, -z * 1.5f));
+		row_nodes.push_back(row);
+		for (int x = 0; x < grid_size; ++x)
+		{
+			object_nodes.push_back(scene_graph.add(row, glm::vec3((x - grid_size * 0.5f) * 1.5f, 0.0f, 0.0f)));
+		}
+	}
+
+	scene_graph.update();
+	slot_objects.assign(scene_graph.size(), -1);
+	for (std::size_t i = 0; i < object_nodes.size(); ++i)
+	{
+		slot_objects[scene_graph.slotOf(object_nodes[i])] = int(i);
+	}
+
+	for (std::size_t i = 0; i < object_nodes.size(); ++i)
+	{
+		const glm::mat4& m = scene_graph.worldMatrix(object_nodes[i]);
+		if (i < MODEL_COUNT)
+		{
+			objects.push_back({ m, model->bounds.transformed(m), 0 });
+		}
+		else
+		{
+			const int x = int(i - MODEL_COUNT) % grid_size;
+			const int z = int(i - MODEL_COUNT) / grid_size;
+			objects.push_back({ m, cube->bounds.transformed(m), GLuint((x + z) % 4) });
+		}
+	}
+
+	object_bounds.clear();
+	scene_bounds.clear();
+	scene_grid.clear();
+	grid_handles.clear();
+	for (const SceneObject& object : objects)
+	{
+		const std::size_t index = bucket->addObject(object.matrix, object.material);
+		object_bounds.add(object.bounds);
+		scene_bounds.push_back(object.bounds);
+		grid_handles.push_back(scene_grid.insert(object.bounds, unsigned(index)));
+	}
+	scene_bvh.build(scene_bounds);
+
+	built_grid_size = grid_size;
+	gpu_draws_dirty = true;
+}
+
+// all draws of the scene for the GPU culler, full model meshes at their current level of detail
+void buildGpuDraws(bool use_lods)
+{
+	bool changed = gpu_draws_dirty || gpu_draws_generation != GeometryArena<DefaultLayout>::get().generation();
+	for (int i = 0; i < MODEL_COUNT; ++i)
+	{
+		const glm::vec3 center(object_bounds.centerX[i], object_bounds.centerY[i], object_bounds.centerZ[i]);
+		const unsigned int level = use_lods ? lod_selector.select(model->lodErrors, center, 1.0f, model_lods[i]) : 0;
+		changed = changed || level != model_lods[i];
+		model_lods[i] = level;
+	}
+	if (!changed)
+		return;
+
+	bucket->clearDraws();
+	gpu_draw_bounds.clear();
+	for (int i = 0; i < MODEL_COUNT; ++i)
+	{
+		bucket->addModelDraws(*model, i, model_lods[i]);
+		for (const auto& mesh : model->meshes)
+			gpu_draw_bounds.push_back(mesh.bounds);
+	}
+
+	const std::size_t cube_count = std::size_t(grid_size) * grid_size;
+	for (std::size_t i = 0; i < cube_count; ++i)
+	{
+		bucket->addDraw(cube->allocation, MODEL_COUNT + i);
+		gpu_draw_bounds.push_back(cube->bounds);
+	}
+
+	gpu_culler->setDraws(bucket->getCommands(), gpu_draw_bounds);
+	gpu_draws_dirty = false;
+	gpu_draws_generation = GeometryArena<DefaultLayout>::get().generation();
+}
+
+// clears the visibility of the objects hidden behind the occluders
+void cullOccluded()
+{
+	occlusion_buffer.resetStats();
+	occlusion_buffer.begin(projection_matrix * camera->getViewMatrix());
+
+	for (int i = 0; i < MODEL_COUNT; ++i)
+	{
+		if (!object_visible[i])
+			continue;
+
+		for (const auto& mesh : model->meshes)
+		{
+			const MeshLod range = mesh.lod(0);
+			occlusion_buffer.addOccluder(&mesh.vertices[0].Position, sizeof(Vertex), mesh.vertices.size(),
+				mesh.indices.data() + range.firstIndex, range.indexCount, objects[i].matrix);
+		}
+	}
+
+	const glm::vec3 camera_position = camera->getCamPosition();
+	for (std::size_t i = MODEL_COUNT; i < objects.size(); ++i)
+	{
+		if (object_visible[i] && glm::distance(objects[i].bounds.center, camera_position) < OCCLUDER_DISTANCE)
+			occlusion_buffer.addBoxOccluder(cube->bounds, objects[i].matrix);
+	}
+
+	occlusion_buffer.rasterize();
+	occlusion_buffer.cullBoxes(object_bounds, object_visible);
+}
+
+void buildDraws(bool meshlet_culling, bool use_lods, int cull_mode, bool software_occlusion)
+{
+	culler.resetStats();
+	object_culler.resetStats();
+
+	lod_selector.setView(camera->getCamPosition(), projection_matrix, viewport_height);
+	if (cull_mode == CULL_GPU)
+	{
+		buildGpuDraws(use_lods);
+		return;
+	}
+
+	bucket->clearDraws();
+	gpu_draws_dirty = true;
+
+	const Frustum frustum = camera->getFrustum(projection_matrix);
+
+	if (cull_mode == CULL_BVH || cull_mode == CULL_GRID)
+	{
+		query_visible.clear();
+		if (cull_mode == CULL_BVH)
+			scene_bvh.queryFrustum(frustum, query_visible);
+		else
+			scene_grid.queryFrustum(frustum, query_visible);
+
+		object_visible.assign(objects.size(), 0);
+		for (unsigned int object : query_visible)
+			object_visible[object] = 1;
+	}
+	else
+	{
+		object_culler.setFrustum(frustum);
+		object_culler.cullSpheres(object_bounds, object_visible);
+	}
+
+	if (software_occlusion)
+	{
+		cullOccluded();
+	}
+
+	for (int i = 0; i < MODEL_COUNT; ++i)
+	{
+		if (!object_visible[i])
+			continue;
+
+		const glm::mat4& m = objects[i].matrix;
+		const glm::vec3 center(object_bounds.centerX[i], object_bounds.centerY[i], object_bounds.centerZ[i]);
+
+		model_lods[i] = use_lods ? lod_selector.select(model->lodErrors, center, 1.0f, model_lods[i]) : 0;
+
+		// the meshlets are built for the full detail level only
+		if (meshlet_culling && model_lods[i] == 0)
+		{
+			MeshletCuller::Params params;
+			params.modelMatrix = m;
+			params.frustum = frustum;
+			params.cameraPosition = camera->getCamPosition();
+			params.objectIndex = i;
+
+			meshlet_commands.clear();
+			model->cullMeshlets(culler, params, meshlet_commands);
+			bucket->addCommands(meshlet_commands);
+		}
+		else
+		{
+			bucket->addModelDraws(*model, i, model_lods[i]);
+		}
+	}
+
+	const std::size_t cube_count = std::size_t(grid_size) * grid_size;
+	for (std::size_t i = 0; i < cube_count; ++i)
+	{
+		if (object_visible[MODEL_COUNT + i])
+			bucket->addDraw(cube->allocation, MODEL_COUNT + i);
+	}
+}
+
+void render(float time)
+{
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	static bool animate = true;
+	static bool spin_cubes = true;
+	static bool meshlet_culling = true;
+	static bool use_lods = true;
+	static int cull_mode = CULL_SIMD;
+	static bool occlusion_culling = true;
+	static bool software_occlusion = false;
+	ImGui::SliderInt("grid size", &grid_size, 1, MAX_GRID);
+	ImGui::Checkbox("animate", &animate);
+	ImGui::Checkbox("spin cubes", &spin_cubes);
+	ImGui::Checkbox("meshlet culling", &meshlet_culling);
+	ImGui::Checkbox("frustum test", &culler.frustumCulling);
+	ImGui::Checkbox("backface cone test", &culler.backfaceCulling);
+	ImGui::Combo("object culling", &cull_mode, "SIMD batch\0BVH\0spatial grid\0GPU\0");
+	if (cull_mode == CULL_GPU)
+		ImGui::Checkbox("Hi-Z occlusion culling", &occlusion_culling);
+	else
+		ImGui::Checkbox("software occlusion culling", &software_occlusion);
+	ImGui::Checkbox("LOD", &use_lods);
+	ImGui::SliderFloat("LOD pixel error", &lod_selector.pixelError, 0.1f, 16.0f);
+	ImGui::SliderFloat("LOD hysteresis", &lod_selector.hysteresis, 0.0f, 0.9f);
+
+	if (built_grid_size != grid_size)
+	{
+		buildBucket();
+	}
+
+	if (animate)
+	{
+		// the rows bob, moving their cubes along
+		for (int z = 0; z < grid_size; ++z)
+		{
+			scene_graph.setTranslation(row_nodes[z], glm::vec3(0.0f, 0.5f * sin(time + 0.3f * z), -z * 1.5f));
+		}
+
+		if (spin_cubes)
+		{
+			const glm::quat spin = glm::angleAxis(time * glm::radians(-90.0f), glm::vec3(0, 1, 0));
+			for (std::size_t i = MODEL_COUNT; i < object_nodes.size(); ++i)
+				scene_graph.setRotation(object_nodes[i], spin);
+		}
+	}
+
+	// only the objects below changed nodes are touched, and only their ranges uploaded;
+	// the commands stay the same
+	scene_graph.update();
+	for (const SceneGraph::Range& range : scene_graph.changedRanges())
+	{
+		for (std::size_t slot = range.first; slot < range.first + range.count; ++slot)
+		{
+			const int index = slot_objects[slot];
+			if (index < 0)
+				continue;
+
+			const glm::mat4& m = scene_graph.worldMatrices()[slot];
+			bucket->setTransform(index, m);
+			objects[index].matrix = m;
+			objects[index].bounds = (index < MODEL_COUNT ? model->bounds : cube->bounds).transformed(m);
+			object_bounds.set(index, objects[index].bounds);
+			scene_bounds[index] = objects[index].bounds;
+			scene_grid.move(grid_handles[index], objects[index].bounds);
+		}
+	}
+
+	// the cubes only bob around their place, refitting keeps the tree good enough
+	if (!scene_graph.changedRanges().empty())
+	{
+		scene_bvh.refit(scene_bounds);
+	}
+
+	buildDraws(meshlet_culling, use_lods, cull_mode, software_occlusion);
+
+	ImGui::Text("objects: %d, draws: %d, GL draw calls: %d", int(bucket->objectCount()), int(bucket->drawCount()), int(bucket->drawCalls()));
+	ImGui::Text("scene graph: %d nodes, %d transforms recomputed, %d changed ranges",
+		int(scene_graph.size()), int(scene_graph.recomputedCount()), int(scene_graph.changedRanges().size()));
+	if (meshlet_culling && cull_mode != CULL_GPU)
+	{
+		const MeshletCuller::Stats& stats = culler.stats();
+		ImGui::Text("meshlets: %d, frustum culled: %d, backface culled: %d, visible: %d",
+			int(stats.total), int(stats.frustumCulled), int(stats.backfaceCulled), int(stats.visible));
+	}
+	if (cull_mode == CULL_BVH)
+	{
+		ImGui::Text("objects visible: %d, culled: %d (BVH, %d nodes)",
+			int(query_visible.size()), int(objects.size() - query_visible.size()), int(scene_bvh.nodeCount()));
+	}
+	else if (cull_mode == CULL_GRID)
+	{
+		ImGui::Text("objects visible: %d, culled: %d (grid, cell size %.1f)",
+			int(query_visible.size()), int(objects.size() - query_visible.size()), scene_grid.getCellSize());
+	}
+	else if (cull_mode == CULL_GPU)
+	{
+		// read back a frame or more late
+		const GpuCuller::Stats& stats = gpu_culler->stats();
+		ImGui::Text("draws visible: %d, frustum culled: %d, occlusion culled: %d (GPU, %s)",
+			int(stats.visible), int(stats.frustumCulled), int(stats.occlusionCulled),
+			GpuCuller::hasIndirectCount() ? "indirect count" : "zeroed commands");
+	}
+	else
+	{
+		ImGui::Text("objects visible: %d, culled: %d (%s)",
+			int(object_culler.stats().visible), int(object_culler.stats().culled), FrustumCuller::simdName());
+	}
+	if (software_occlusion && cull_mode != CULL_GPU)
+	{
+		const OcclusionBuffer::Stats& stats = occlusion_buffer.stats();
+		ImGui::Text("occluded: %d of %d tested, occluder triangles: %d (%d drawn, %s)",
+			int(stats.occluded), int(stats.tested), int(stats.occluderTriangles), int(stats.rasterizedTriangles), OcclusionBuffer::simdName());
+		ImGui::Text("occlusion CPU ms: setup %.3f, raster %.3f, test %.3f", stats.setupMs, stats.rasterMs, stats.testMs);
+	}
+	if (hovered_object >= 0)
+		ImGui::Text("hovered object: %d", hovered_object);
+	ImGui::Text("model LODs: %u %u %u %u (of %u)", model_lods[0], model_lods[1], model_lods[2], model_lods[3], model->lodCount());
+
+	shader->setUniformMatrix4fv("viewMatrix", camera->getViewMatrix());
+	shader->setUniformMatrix4fv("projectionMatrix", projection_matrix);
+	shader->setUniform3fv("cameraPos", camera->getCamPosition());
+	shader->setUniform4fv("light.position", glm::vec4(-0.2f, -1.0f, -0.3f, 0.0f));
+	shader->setUniform3fv("light.ambient", glm::vec3(1.0f));
+	shader->setUniform3fv("light.diffuse", glm::vec3(1.0f));
+	shader->setUniform3fv("light.specular", glm::vec3(1.0f));
+
+	// before the program is in use, the cull pass runs one of its own
+	if (cull_mode == CULL_GPU)
+	{
+		bucket->bindObjects();
+		gpu_culler->cull(camera->getFrustum(projection_matrix), occlusion_culling ? hi_z : nullptr);
+	}
+
+	shader->apply();
+
+	diffuse_texture->bind(0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, indirect::MATERIAL_BUFFER_BINDING, materialBuffer);
+
+	if (cull_mode == CULL_GPU)
+	{
+		GeometryArena<DefaultLayout>::get().bind();
+		gpu_culler->draw();
+
+		// the depth of this frame culls the next one
+		if (occlusion_culling)
+		{
+			int width, height;
+			glfwGetFramebufferSize(window, &width, &height);
+			hi_z->buildFromFramebuffer(width, height, projection_matrix * camera->getViewMatrix());
+		}
+	}
+	else
+	{
+		bucket->submit();
+	}
+}
+
+void update()
+{
+	float startTime = static_cast<float>(glfwGetTime());
+	float gameTime = 0.0f;
+	float frameStart = startTime;
+	/* Loop until the user closes the window */
+	while (!glfwWindowShouldClose(window))
+	{
+		ImGui_ImplOpenGL3_NewFrame();
+		ImGui_ImplGlfw_NewFrame();
+		ImGui::NewFrame();
+
+		float deltaTime = static_cast<float>(glfwGetTime()) - frameStart;
+		frameStart = static_cast<float>(glfwGetTime());
+		gameTime = frameStart - startTime;
+
+		processInput(window, deltaTime);
+
+		/* Render here */
+		render(gameTime);
+
+		ImGui::Render();
+		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+
+		/* Swap front and back buffers */
+		glfwSwapBuffers(window);
+
+		/* Poll for and process events */
+		glfwPollEvents();
+	}
+}
+
+int main(void)
+{
+	if (!init())
+		return -1;
+
+	if (!loadContent())
+		return -1;
+
+	update();
+
+	delete gpu_culler;
+	delete hi_z;
+	delete bucket;
+	delete model;
+	cube->release();
+	delete cube;
+	delete shader;
+	delete diffuse_texture;
+
+	glfwTerminate();
+
+	ImGui_ImplOpenGL3_Shutdown();
+	ImGui_ImplGlfw_Shutdown();
+	ImGui::DestroyContext();
+
+	return 0;
+}
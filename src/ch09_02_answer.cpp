@@ -0,0 +1,434 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include <iostream>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#define  GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "rendering/CommandBuffer.h"
+#include "rendering/Frustum.h"
+#include "rendering/GLState.h"
+#include "rendering/Shader.h"
+#include "rendering/Texture.h"
+#include "rendering/Model.h"
+#include "rendering/Primitives.h"
+#include "rendering/InstanceBuffer.h"
+#include "rendering/Camera.h"
+
+#include "imgui/imgui.h"
+#include "imgui/imgui_impl_glfw.h"
+#include "imgui/imgui_impl_opengl3.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+// Instancing stress test: up to 200k cubes (or copies of a model) whose transforms live in one
+// InstanceBuffer. Instanced, they take one draw call (one per mesh for the model) and the vertex
+// shader builds the model and normal matrices from position / rotation / scale. Switch to
+// "one draw per object" to see the same scene drawn the old way, with a draw call and a uniform
+// upload per object. "recorded per object" draws the same way, but the culling and the building
+// of the draws happen on all threads, as command packets the GL thread then submits front to back.
+
+GLFWwindow* window;
+const int WINDOW_WIDTH = 1920;
+const int WINDOW_HEIGHT = 1080;
+float lastX = WINDOW_WIDTH / 2.0;
+float lastY = WINDOW_HEIGHT / 2.0;
+bool firstMouse = true;
+bool cursor_enabled = true;
+
+Model* model = nullptr;
+Mesh* cube = nullptr;
+Shader* shader = nullptr;
+Texture* diffuse_texture = nullptr;
+Camera* camera = nullptr;
+
+InstanceBuffer* instances = nullptr;
+CommandRecorder* recorder = nullptr;
+
+// a draw of the recorded mode: which transform the shader reads, and the meshes drawn with it
+struct DrawObjectPacket
+{
+	Shader* shader;
+	const Mesh* meshes;
+	std::uint32_t meshCount;
+	GLint firstInstance;
+
+	// the arena is bound once before the submission
+	static void execute(const DrawObjectPacket& packet)
+	{
+		packet.shader->setUniform1i("firstInstance", packet.firstInstance);
+		for (std::uint32_t i = 0; i < packet.meshCount; ++i)
+			packet.meshes[i].DrawRangeInstanced(1);
+	}
+};
+
+enum DrawMode { DRAW_INSTANCED = 0, DRAW_PER_OBJECT, DRAW_RECORDED };
+enum ObjectType { OBJECT_CUBE = 0, OBJECT_MODEL };
+
+// bounded by the draw id attribute of the arena VAO (see GeometryArena::drawRangeInstanced)
+const int MAX_OBJECTS = 200000;
+int object_count = 100000;
+int built_object_count = -1;
+int built_object_type = -1;
+
+// per object, the rotation is animated around it
+std::vector<float> object_phases;
+
+glm::mat4 projection_matrix = glm::perspectiveFov(glm::radians(60.0f), float(WINDOW_WIDTH), float(WINDOW_HEIGHT), 0.1f, 1000.0f);
+
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	if (key == GLFW_KEY_F1 && action == GLFW_PRESS)
+	{
+		if (cursor_enabled)
+		{
+			glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+		}
+		else
+		{
+			glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+		}
+		cursor_enabled = !cursor_enabled;
+	}
+}
+
+void processInput(GLFWwindow* window, float deltaTime)
+{
+	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+		glfwSetWindowShouldClose(window, true);
+
+	if (camera)
+	{
+		camera->processInput(window, deltaTime);
+	}
+}
+
+void mouse_callback(GLFWwindow* window, double xpos_in, double ypos_in)
+{
+	if (cursor_enabled) return;
+
+	float xpos = static_cast<float>(xpos_in);
+	float ypos = static_cast<float>(ypos_in);
+
+	if (firstMouse)
+	{
+		lastX = xpos;
+		lastY = ypos;
+		firstMouse = false;
+	}
+
+	float xoffset = xpos - lastX;
+	float yoffset = lastY - ypos; // reversed since y-coordinates go from bottom to top
+	lastX = xpos;
+	lastY = ypos;
+
+	if (camera)
+	{
+		camera->processMouseMovement(xoffset, yoffset);
+	}
+}
+
+void window_size_callback(GLFWwindow* window, int width, int height)
+{
+	GLState::get().viewport(0, 0, width, height);
+	projection_matrix = glm::perspectiveFov(glm::radians(60.0f), float(width), float(height), 0.1f, 1000.0f);
+}
+
+int init()
+{
+	/* Initialize the library */
+	if (!glfwInit())
+		return -1;
+
+	/* Create a windowed mode window and its OpenGL context */
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+	window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Hello Modern GL!", nullptr, nullptr);
+
+	if (!window)
+	{
+		glfwTerminate();
+		return -1;
+	}
+
+	/* Make the window's context current */
+	glfwMakeContextCurrent(window);
+
+	glfwSetWindowSizeCallback(window, window_size_callback);
+
+	/* Initialize glad */
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	{
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		return -1;
+	}
+
+	/* Set the viewport */
+	glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
+	GLState::get().viewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+
+	GLState::get().enable(GL_DEPTH_TEST);
+
+	// mouse callback
+	glfwSetCursorPosCallback(window, mouse_callback);
+
+	glfwSetKeyCallback(window, key_callback);
+
+	// IMGUI
+	// ------------
+	IMGUI_CHECKVERSION();
+	ImGui::CreateContext();
+	ImGuiIO& io = ImGui::GetIO();
+	io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;     // Enable Keyboard Controls
+
+	// Setup Platform/Renderer backends
+	ImGui_ImplGlfw_InitForOpenGL(window, true);          // Second param install_callback=true will install GLFW callbacks and chain to existing ones.
+	ImGui_ImplOpenGL3_Init();
+
+	return true;
+}
+
+Mesh* createCube()
+{
+	// its own copy of the shared cube, with the CPU side vertices for bounds and raycasts
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	Primitives::geometry(Primitive::Cube, vertices, indices);
+	return new Mesh(vertices, indices);
+}
+
+int loadContent()
+{
+	camera = new Camera(glm::vec3(0.0f, 20.0f, 40.f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	shader = new Shader("ch09_02_instanced.vert", "ch09_02_instanced.frag");
+	shader->setUniform1i("diffuseMap", 0);
+
+	diffuse_texture = new Texture();
+	diffuse_texture->load("res/models/container_diffuse.png");
+
+	model = new Model("res/models/alliance.obj");
+	cube = createCube();
+	instances = new InstanceBuffer();
+	recorder = new CommandRecorder();
+
+	return true;
+}
+
+// a square grid of objects on the ground plane, stretched in height so the normals
+// go through a non-uniform scale
+void buildInstances(int object_type)
+{
+	const glm::vec3 size = object_type == OBJECT_MODEL ? model->bounds.max - model->bounds.min : glm::vec3(1.0f);
+	const float spacing = 1.5f * std::max(size.x, size.z);
+	const int side = int(std::ceil(std::sqrt(float(object_count))));
+
+	instances->clear();
+	instances->reserve(object_count);
+	object_phases.resize(object_count);
+	for (int i = 0; i < object_count; ++i)
+	{
+		const int x = i % side;
+		const int z = i / side;
+		const float height = 1.0f + 0.5f * std::sin(0.37f * x) * std::cos(0.23f * z);
+		object_phases[i] = 0.1f * (x + z);
+
+		const glm::vec3 position = glm::vec3(x - side * 0.5f, 0.0f, -z) * spacing;
+		instances->add(InstanceTransform(position, glm::angleAxis(object_phases[i], glm::vec3(0, 1, 0)), glm::vec3(1.0f, height, 1.0f)));
+	}
+
+	built_object_count = object_count;
+	built_object_type = object_type;
+}
+
+void render(float time)
+{
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	static bool animate = true;
+	static int draw_mode = DRAW_INSTANCED;
+	static int object_type = OBJECT_CUBE;
+	ImGui::SliderInt("objects", &object_count, 1, MAX_OBJECTS);
+	ImGui::Combo("draw", &draw_mode, "instanced\0one draw per object\0recorded per object\0");
+	ImGui::Combo("object", &object_type, "cube\0model\0");
+	ImGui::Checkbox("animate", &animate);
+
+	if (built_object_count != object_count || built_object_type != object_type)
+	{
+		buildInstances(object_type);
+	}
+
+	if (animate)
+	{
+		// only the rotation changes; the whole buffer is uploaded again by bind()
+		for (int i = 0; i < object_count; ++i)
+		{
+			InstanceTransform instance = instances->get(i);
+			const glm::quat rotation = glm::angleAxis(object_phases[i] + time * glm::radians(-90.0f), glm::vec3(0, 1, 0));
+			instance.rotation = glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w);
+			instances->set(i, instance);
+		}
+	}
+
+	shader->setUniformMatrix4fv("viewMatrix", camera->getViewMatrix());
+	shader->setUniformMatrix4fv("projectionMatrix", projection_matrix);
+	shader->setUniform3fv("cameraPos", camera->getCamPosition());
+	shader->setUniform4fv("light.position", glm::vec4(-0.2f, -1.0f, -0.3f, 0.0f));
+	shader->setUniform3fv("light.ambient", glm::vec3(1.0f));
+	shader->setUniform3fv("light.diffuse", glm::vec3(1.0f));
+	shader->setUniform3fv("light.specular", glm::vec3(1.0f));
+	shader->setUniform1i("firstInstance", 0);
+	shader->apply();
+
+	diffuse_texture->bind(0);
+
+	// CPU time of the submission only, the GPU works on it later
+	const auto submit_start = std::chrono::steady_clock::now();
+	instances->bind();
+
+	const std::size_t mesh_count = object_type == OBJECT_MODEL ? model->meshes.size() : 1;
+	std::size_t draw_calls = 0;
+	double record_ms = 0.0;
+	if (draw_mode == DRAW_RECORDED)
+	{
+		const Frustum frustum = Frustum::fromMatrix(projection_matrix * camera->getViewMatrix());
+		const Bounds& bounds = object_type == OBJECT_MODEL ? model->bounds : cube->bounds;
+		const glm::vec3 camera_position = camera->getCamPosition();
+		// shared by all draws, only the instance differs
+		const DrawObjectPacket packet{ shader, object_type == OBJECT_MODEL ? model->meshes.data() : cube,
+			static_cast<std::uint32_t>(mesh_count), 0 };
+
+		const auto record_start = std::chrono::steady_clock::now();
+		recorder->reset();
+		recorder->record(object_count, 1024, [&](CommandBuffer& commands, std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end; ++i)
+			{
+				const InstanceTransform& instance = instances->get(i);
+				const glm::quat rotation(instance.rotation.w, instance.rotation.x, instance.rotation.y, instance.rotation.z);
+				const glm::vec3 center = instance.position + rotation * (bounds.center * instance.scale);
+				const float radius = bounds.radius * std::max(instance.scale.x, std::max(instance.scale.y, instance.scale.z));
+				if (!frustum.intersectsSphere(center, radius))
+					continue;
+
+				SortKey key;
+				key.depth = RenderQueue::depth(glm::length(center - camera_position), 0.1f, 1000.0f);
+				DrawObjectPacket draw = packet;
+				draw.firstInstance = static_cast<GLint>(i);
+				commands.record(key.pack(), draw);
+			}
+		});
+		record_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - record_start).count();
+
+		Mesh::Arena::get().bind();
+		recorder->submit();
+		draw_calls = mesh_count * recorder->stats().packets;
+	}
+	else if (draw_mode == DRAW_INSTANCED)
+	{
+		if (object_type == OBJECT_MODEL)
+			model->DrawInstanced(instances->size());
+		else
+			cube->DrawInstanced(instances->size());
+		draw_calls = mesh_count;
+	}
+	else
+	{
+		// the old way: per object a uniform telling the shader which transform to use, and a draw per mesh
+		Mesh::Arena::get().bind();
+		for (int i = 0; i < object_count; ++i)
+		{
+			shader->setUniform1i("firstInstance", i);
+			if (object_type == OBJECT_MODEL)
+			{
+				for (const Mesh& mesh : model->meshes)
+					mesh.DrawRangeInstanced(1);
+			}
+			else
+			{
+				cube->DrawRangeInstanced(1);
+			}
+		}
+		draw_calls = mesh_count * object_count;
+	}
+
+	const double submit_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - submit_start).count();
+
+	ImGui::Text("objects: %d, GL draw calls: %d, submission: %.2f ms CPU", object_count, int(draw_calls), submit_ms);
+	if (draw_mode == DRAW_RECORDED)
+	{
+		const CommandRecorder::Stats& stats = recorder->stats();
+		ImGui::Text("recorded on %d of %d threads in %.2f ms: %d packets (%.1f KB), %d culled", int(stats.threads),
+			int(JobSystem::get().threadCount()), record_ms, int(stats.packets), stats.bytes / 1024.0, object_count - int(stats.packets));
+	}
+	ImGui::Text("frame: %.2f ms", 1000.0f / ImGui::GetIO().Framerate);
+}
+
+void update()
+{
+	float startTime = static_cast<float>(glfwGetTime());
+	float gameTime = 0.0f;
+	float frameStart = startTime;
+	/* Loop until the user closes the window */
+	while (!glfwWindowShouldClose(window))
+	{
+		ImGui_ImplOpenGL3_NewFrame();
+		ImGui_ImplGlfw_NewFrame();
+		ImGui::NewFrame();
+
+		float deltaTime = static_cast<float>(glfwGetTime()) - frameStart;
+		frameStart = static_cast<float>(glfwGetTime());
+		gameTime = frameStart - startTime;
+
+		processInput(window, deltaTime);
+
+		/* Render here */
+		render(gameTime);
+
+		ImGui::Render();
+		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+
+		/* Swap front and back buffers */
+		glfwSwapBuffers(window);
+
+		/* Poll for and process events */
+		glfwPollEvents();
+	}
+}
+
+int main(void)
+{
+	if (!init())
+		return -1;
+
+	if (!loadContent())
+		return -1;
+
+	update();
+
+	delete recorder;
+	delete instances;
+	delete model;
+	cube->release();
+	delete cube;
+	delete shader;
+	delete diffuse_texture;
+
+	glfwTerminate();
+
+	ImGui_ImplOpenGL3_Shutdown();
+	ImGui_ImplGlfw_Shutdown();
+	ImGui::DestroyContext();
+
+	return 0;
+}
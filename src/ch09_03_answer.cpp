@@ -0,0 +1,329 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include <iostream>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#define  GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "rendering/GLState.h"
+#include "rendering/Shader.h"
+#include "rendering/Texture.h"
+#include "rendering/StreamedModel.h"
+#include "rendering/DrawBucket.h"
+#include "rendering/Camera.h"
+
+#include "imgui/imgui.h"
+#include "imgui/imgui_impl_glfw.h"
+#include "imgui/imgui_impl_opengl3.h"
+
+#include <algorithm>
+#include <string>
+
+// Out-of-core streaming of a model: the model is cooked once into a file of spatial chunks with
+// a LOD chain each (res/cache/*.smesh), and only the chunks near the camera are paged into the
+// geometry arena, within a memory budget. Fly around and watch chunks switch levels and get
+// evicted; "color by level" tints each chunk by the level it is drawn at.
+//
+// Pass the model to stream on the command line, e.g. ch09_03_answer res/models/city.glb
+// (relative to the repository root); the default model is small, so shrink the budget to see
+// the streaming at work.
+
+GLFWwindow* window;
+const int WINDOW_WIDTH = 1920;
+const int WINDOW_HEIGHT = 1080;
+float lastX = WINDOW_WIDTH / 2.0;
+float lastY = WINDOW_HEIGHT / 2.0;
+bool firstMouse = true;
+bool cursor_enabled = true;
+
+StreamedModel* streamed = nullptr;
+Shader* shader = nullptr;
+Texture* diffuse_texture = nullptr;
+Camera* camera = nullptr;
+DrawBucket<DefaultLayout>* bucket = nullptr;
+GLuint materialBuffer = 0;
+
+std::string model_path = "res/models/alliance.obj";
+LodSelector lod_selector;
+float viewport_height = float(WINDOW_HEIGHT);
+
+// one object per level, so the level can pick the material
+std::size_t level_objects[LodBuilder::MAX_LODS];
+
+glm::mat4 projection_matrix = glm::perspectiveFov(glm::radians(60.0f), float(WINDOW_WIDTH), float(WINDOW_HEIGHT), 0.1f, 1000.0f);
+
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	if (key == GLFW_KEY_F1 && action == GLFW_PRESS)
+	{
+		if (cursor_enabled)
+		{
+			glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+		}
+		else
+		{
+			glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+		}
+		cursor_enabled = !cursor_enabled;
+	}
+}
+
+void processInput(GLFWwindow* window, float deltaTime)
+{
+	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+		glfwSetWindowShouldClose(window, true);
+
+	if (camera)
+	{
+		camera->processInput(window, deltaTime);
+	}
+}
+
+void mouse_callback(GLFWwindow* window, double xpos_in, double ypos_in)
+{
+	if (cursor_enabled) return;
+
+	float xpos = static_cast<float>(xpos_in);
+	float ypos = static_cast<float>(ypos_in);
+
+	if (firstMouse)
+	{
+		lastX = xpos;
+		lastY = ypos;
+		firstMouse = false;
+	}
+
+	float xoffset = xpos - lastX;
+	float yoffset = lastY - ypos; // reversed since y-coordinates go from bottom to top
+	lastX = xpos;
+	lastY = ypos;
+
+	if (camera)
+	{
+		camera->processMouseMovement(xoffset, yoffset);
+	}
+}
+
+void window_size_callback(GLFWwindow* window, int width, int height)
+{
+	GLState::get().viewport(0, 0, width, height);
+	projection_matrix = glm::perspectiveFov(glm::radians(60.0f), float(width), float(height), 0.1f, 1000.0f);
+	viewport_height = float(height);
+}
+
+int init()
+{
+	/* Initialize the library */
+	if (!glfwInit())
+		return -1;
+
+	/* Create a windowed mode window and its OpenGL context */
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+	window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Hello Modern GL!", nullptr, nullptr);
+
+	if (!window)
+	{
+		glfwTerminate();
+		return -1;
+	}
+
+	/* Make the window's context current */
+	glfwMakeContextCurrent(window);
+
+	glfwSetWindowSizeCallback(window, window_size_callback);
+
+	/* Initialize glad */
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	{
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		return -1;
+	}
+
+	/* Set the viewport */
+	glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
+	GLState::get().viewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+
+	GLState::get().enable(GL_DEPTH_TEST);
+
+	// mouse callback
+	glfwSetCursorPosCallback(window, mouse_callback);
+
+	glfwSetKeyCallback(window, key_callback);
+
+	// IMGUI
+	// ------------
+	IMGUI_CHECKVERSION();
+	ImGui::CreateContext();
+	ImGuiIO& io = ImGui::GetIO();
+	io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;     // Enable Keyboard Controls
+
+	// Setup Platform/Renderer backends
+	ImGui_ImplGlfw_InitForOpenGL(window, true);          // Second param install_callback=true will install GLFW callbacks and chain to existing ones.
+	ImGui_ImplOpenGL3_Init();
+
+	return true;
+}
+
+void loadMaterials()
+{
+	struct Material
+	{
+		glm::vec4 color;
+		glm::vec4 params;
+	};
+
+	// level 0 is left untinted
+	const Material materials[LodBuilder::MAX_LODS] = {
+		{ glm::vec4(1.0f, 1.0f, 1.0f, 1.0f), glm::vec4(32.0f) },
+		{ glm::vec4(0.4f, 1.0f, 0.4f, 1.0f), glm::vec4(32.0f) },
+		{ glm::vec4(0.4f, 0.6f, 1.0f, 1.0f), glm::vec4(32.0f) },
+		{ glm::vec4(1.0f, 1.0f, 0.3f, 1.0f), glm::vec4(32.0f) },
+		{ glm::vec4(1.0f, 0.4f, 0.3f, 1.0f), glm::vec4(32.0f) },
+	};
+
+	glGenBuffers(1, &materialBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, materialBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(materials), materials, GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+int loadContent()
+{
+	shader = new Shader("ch09_01_indirect.vert", "ch09_01_indirect.frag");
+	shader->setUniform1i("diffuseMap", 0);
+
+	diffuse_texture = new Texture();
+	diffuse_texture->load("res/models/container_diffuse.png");
+
+	loadMaterials();
+
+	// cooks the stream file on the first run; small chunks, so the default model gets a few
+	streamed = new StreamedModel(model_path, std::size_t(64) << 20, 4096);
+	if (!streamed->isOpen())
+		return false;
+
+	const Bounds& bounds = streamed->getBounds();
+	camera = new Camera(bounds.center + glm::vec3(0.0f, 0.5f, 1.5f) * bounds.radius, glm::vec3(0.0f, 1.0f, 0.0f));
+
+	bucket = new DrawBucket<DefaultLayout>();
+	for (unsigned int level = 0; level < LodBuilder::MAX_LODS; ++level)
+		level_objects[level] = bucket->addObject(glm::mat4(1.0f), level);
+
+	return true;
+}
+
+void render(float)
+{
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	static float budget_mb = 64.0f;
+	static bool color_by_level = true;
+	ImGui::SliderFloat("budget (MB)", &budget_mb, 0.1f, 1024.0f, "%.1f", ImGuiSliderFlags_Logarithmic);
+	ImGui::SliderFloat("LOD pixel error", &lod_selector.pixelError, 0.1f, 16.0f);
+	ImGui::Checkbox("color by level", &color_by_level);
+
+	streamed->setBudget(std::size_t(budget_mb * 1024.0f * 1024.0f));
+	lod_selector.setView(camera->getCamPosition(), projection_matrix, viewport_height);
+	streamed->update(lod_selector, glm::mat4(1.0f));
+
+	bucket->clearDraws();
+	for (std::size_t chunk = 0; chunk < streamed->chunkCount(); ++chunk)
+	{
+		const int level = streamed->drawnLevel(chunk);
+		if (level >= 0)
+			bucket->addDraw(streamed->drawnAllocation(chunk), level_objects[color_by_level ? level : 0]);
+	}
+
+	shader->setUniformMatrix4fv("viewMatrix", camera->getViewMatrix());
+	shader->setUniformMatrix4fv("projectionMatrix", projection_matrix);
+	shader->setUniform3fv("cameraPos", camera->getCamPosition());
+	shader->setUniform4fv("light.position", glm::vec4(-0.2f, -1.0f, -0.3f, 0.0f));
+	shader->setUniform3fv("light.ambient", glm::vec3(1.0f));
+	shader->setUniform3fv("light.diffuse", glm::vec3(1.0f));
+	shader->setUniform3fv("light.specular", glm::vec3(1.0f));
+	shader->apply();
+
+	diffuse_texture->bind(0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, indirect::MATERIAL_BUFFER_BINDING, materialBuffer);
+	bucket->submit();
+
+	const StreamedModel::Stats& stats = streamed->stats();
+	ImGui::Text("chunks: %d drawn, %d missing, %d total", int(stats.chunksDrawn), int(stats.chunksMissing), int(stats.chunks));
+	ImGui::Text("resident: %d pages, %.2f MB (wanted %.2f MB), %d pending",
+		int(stats.residentPages), stats.residentBytes / (1024.0 * 1024.0), stats.wantedBytes / (1024.0 * 1024.0), int(stats.pendingPages));
+	ImGui::Text("this frame: %d page-ins (max latency %.2f ms), %d evictions, upload %.2f ms",
+		int(stats.pageIns), stats.maxPageInMs, int(stats.evictions), stats.uploadMs);
+	ImGui::Text("page-in latency: %.2f ms average over %d, %.2f ms of it reading",
+		stats.averagePageInMs, int(stats.totalPageIns), stats.averageReadMs);
+	ImGui::Text("frame: %.2f ms", 1000.0f / ImGui::GetIO().Framerate);
+}
+
+void update()
+{
+	float startTime = static_cast<float>(glfwGetTime());
+	float gameTime = 0.0f;
+	float frameStart = startTime;
+	/* Loop until the user closes the window */
+	while (!glfwWindowShouldClose(window))
+	{
+		ImGui_ImplOpenGL3_NewFrame();
+		ImGui_ImplGlfw_NewFrame();
+		ImGui::NewFrame();
+
+		float deltaTime = static_cast<float>(glfwGetTime()) - frameStart;
+		frameStart = static_cast<float>(glfwGetTime());
+		gameTime = frameStart - startTime;
+
+		processInput(window, deltaTime);
+
+		/* Render here */
+		render(gameTime);
+
+		ImGui::Render();
+		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+
+		/* Swap front and back buffers */
+		glfwSwapBuffers(window);
+
+		/* Poll for and process events */
+		glfwPollEvents();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1)
+		model_path = argv[1];
+
+	if (!init())
+		return -1;
+
+	if (!loadContent())
+		return -1;
+
+	update();
+
+	delete bucket;
+	delete streamed;
+	delete shader;
+	delete diffuse_texture;
+	delete camera;
+	glDeleteBuffers(1, &materialBuffer);
+
+	glfwTerminate();
+
+	ImGui_ImplOpenGL3_Shutdown();
+	ImGui_ImplGlfw_Shutdown();
+	ImGui::DestroyContext();
+
+	return 0;
+}
@@ -0,0 +1,381 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include <iostream>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#define  GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "rendering/GLState.h"
+#include "rendering/Shader.h"
+#include "rendering/Texture.h"
+#include "rendering/Model.h"
+#include "rendering/Skinning.h"
+#include "rendering/Parallel.h"
+#include "rendering/Camera.h"
+
+#include "imgui/imgui.h"
+#include "imgui/imgui_impl_glfw.h"
+#include "imgui/imgui_impl_opengl3.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+
+// A crowd of up to 1000 skinned characters. Every frame each character samples its clip
+// (AnimationSampler, in parallel) and computes its skin matrices; then either CpuSkinner
+// skins all vertices on the worker threads and uploads them, or GpuSkinner does it in a
+// compute shader writing straight into the vertex buffer. Either way the whole crowd is one
+// glMultiDrawElementsBaseVertex.
+//
+// Pass an animated model on the command line, e.g. ch09_04_answer res/models/character.glb
+// (relative to the repository root); without one, a procedural swaying tube is used.
+
+GLFWwindow* window;
+const int WINDOW_WIDTH = 1920;
+const int WINDOW_HEIGHT = 1080;
+float lastX = WINDOW_WIDTH / 2.0;
+float lastY = WINDOW_HEIGHT / 2.0;
+bool firstMouse = true;
+bool cursor_enabled = true;
+
+SkinnedCharacter* character = nullptr;
+SkinnedBuffer* skinned_buffer = nullptr;
+GpuSkinner* gpu_skinner = nullptr;
+Shader* shader = nullptr;
+Texture* diffuse_texture = nullptr;
+Camera* camera = nullptr;
+
+std::string model_path;
+
+enum SkinningMode { SKIN_CPU = 0, SKIN_GPU };
+
+const int MAX_CHARACTERS = 1000;
+int character_count = MAX_CHARACTERS;
+
+// per character
+std::vector<AnimationSampler> samplers;
+std::vector<std::vector<JointPose>> poses;
+std::vector<glm::mat4> world_matrices;
+std::vector<float> time_offsets;
+// boneCount per character
+std::vector<glm::mat4> skin_matrices;
+std::vector<SkinnedVertex> cpu_vertices;
+
+glm::mat4 projection_matrix = glm::perspectiveFov(glm::radians(60.0f), float(WINDOW_WIDTH), float(WINDOW_HEIGHT), 0.1f, 1000.0f);
+
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	if (key == GLFW_KEY_F1 && action == GLFW_PRESS)
+	{
+		if (cursor_enabled)
+		{
+			glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+		}
+		else
+		{
+			glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+		}
+		cursor_enabled = !cursor_enabled;
+	}
+}
+
+void processInput(GLFWwindow* window, float deltaTime)
+{
+	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+		glfwSetWindowShouldClose(window, true);
+
+	if (camera)
+	{
+		camera->processInput(window, deltaTime);
+	}
+}
+
+void mouse_callback(GLFWwindow* window, double xpos_in, double ypos_in)
+{
+	if (cursor_enabled) return;
+
+	float xpos = static_cast<float>(xpos_in);
+	float ypos = static_cast<float>(ypos_in);
+
+	if (firstMouse)
+	{
+		lastX = xpos;
+		lastY = ypos;
+		firstMouse = false;
+	}
+
+	float xoffset = xpos - lastX;
+	float yoffset = lastY - ypos; // reversed since y-coordinates go from bottom to top
+	lastX = xpos;
+	lastY = ypos;
+
+	if (camera)
+	{
+		camera->processMouseMovement(xoffset, yoffset);
+	}
+}
+
+void window_size_callback(GLFWwindow* window, int width, int height)
+{
+	GLState::get().viewport(0, 0, width, height);
+	projection_matrix = glm::perspectiveFov(glm::radians(60.0f), float(width), float(height), 0.1f, 1000.0f);
+}
+
+int init()
+{
+	/* Initialize the library */
+	if (!glfwInit())
+		return -1;
+
+	/* Create a windowed mode window and its OpenGL context */
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+	window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Hello Modern GL!", nullptr, nullptr);
+
+	if (!window)
+	{
+		glfwTerminate();
+		return -1;
+	}
+
+	/* Make the window's context current */
+	glfwMakeContextCurrent(window);
+
+	glfwSetWindowSizeCallback(window, window_size_callback);
+
+	/* Initialize glad */
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	{
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		return -1;
+	}
+
+	/* Set the viewport */
+	glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
+	GLState::get().viewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+
+	GLState::get().enable(GL_DEPTH_TEST);
+
+	// mouse callback
+	glfwSetCursorPosCallback(window, mouse_callback);
+
+	glfwSetKeyCallback(window, key_callback);
+
+	// IMGUI
+	// ------------
+	IMGUI_CHECKVERSION();
+	ImGui::CreateContext();
+	ImGuiIO& io = ImGui::GetIO();
+	io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;     // Enable Keyboard Controls
+
+	// Setup Platform/Renderer backends
+	ImGui_ImplGlfw_InitForOpenGL(window, true);          // Second param install_callback=true will install GLFW callbacks and chain to existing ones.
+	ImGui_ImplOpenGL3_Init();
+
+	return true;
+}
+
+int loadContent()
+{
+	camera = new Camera(glm::vec3(0.0f, 8.0f, 30.f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	shader = new Shader("ch09_04_skinned.vert", "ch09_04_skinned.frag");
+	shader->setUniform1i("diffuseMap", 0);
+
+	diffuse_texture = new Texture();
+	diffuse_texture->load("res/models/container_diffuse.png");
+
+	// characters are scaled to about 2 units high, the size of the procedural one
+	float scale = 1.0f;
+	if (!model_path.empty())
+	{
+		BasicModel<SkinnedLayout> model(model_path);
+		if (model.meshes.empty() || model.skeleton.boneCount() == 0)
+		{
+			std::cout << "ERROR::CH09_04:: " << model_path << " has no skinned meshes" << std::endl;
+			return false;
+		}
+		character = new SkinnedCharacter(SkinnedCharacter::fromModel(model));
+		const float height = model.bounds.max.y - model.bounds.min.y;
+		scale = height > 0.0f ? 2.0f / height : 1.0f;
+	}
+	else
+	{
+		character = new SkinnedCharacter(SkinnedCharacter::procedural());
+	}
+
+	// a square grid, every character at its own point of the clip
+	const int side = int(std::ceil(std::sqrt(float(MAX_CHARACTERS))));
+	samplers.resize(MAX_CHARACTERS);
+	poses.resize(MAX_CHARACTERS);
+	world_matrices.resize(MAX_CHARACTERS);
+	time_offsets.resize(MAX_CHARACTERS);
+	for (int i = 0; i < MAX_CHARACTERS; ++i)
+	{
+		const int x = i % side;
+		const int z = i / side;
+		const glm::vec3 position = glm::vec3(x - side * 0.5f, 0.0f, -z) * 1.5f;
+		world_matrices[i] = glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(scale));
+		time_offsets[i] = 0.137f * i;
+	}
+
+	skinned_buffer = new SkinnedBuffer();
+	gpu_skinner = new GpuSkinner();
+	gpu_skinner->setSource(character->source);
+
+	return true;
+}
+
+// samples every character's clip and computes its skin matrices
+void animate(float time)
+{
+	const Skeleton& skeleton = character->skeleton;
+	const std::size_t bone_count = skeleton.boneCount();
+	skin_matrices.resize(character_count * bone_count);
+
+	parallelFor(character_count, 16, [&](std::size_t begin, std::size_t end)
+	{
+		std::vector<glm::mat4> globals;
+		for (std::size_t i = begin; i < end; ++i)
+		{
+			skeleton.bindPose(poses[i]);
+			if (!character->clips.empty())
+				samplers[i].sample(character->clips[0], time + time_offsets[i], poses[i]);
+			skeleton.computeSkinMatrices(poses[i], world_matrices[i], &skin_matrices[i * bone_count], globals);
+		}
+	});
+}
+
+void render(float time)
+{
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	static bool play = true;
+	static float animation_time = 0.0f;
+	static float last_time = time;
+	static int skinning_mode = SKIN_GPU;
+	ImGui::SliderInt("characters", &character_count, 1, MAX_CHARACTERS);
+	ImGui::Combo("skinning", &skinning_mode, "CPU\0GPU (compute)\0");
+	ImGui::Checkbox("play", &play);
+
+	if (play)
+		animation_time += time - last_time;
+	last_time = time;
+
+	const auto animate_start = std::chrono::steady_clock::now();
+	animate(animation_time);
+	const auto skin_start = std::chrono::steady_clock::now();
+
+	const std::size_t bone_count = character->skeleton.boneCount();
+	skinned_buffer->resize(character->source, character_count);
+	if (skinning_mode == SKIN_CPU)
+	{
+		cpu_vertices.resize(character_count * character->source.vertexCount());
+		CpuSkinner::skin(character->source, skin_matrices.data(), bone_count, character_count, cpu_vertices.data());
+		skinned_buffer->upload(cpu_vertices.data());
+	}
+	else
+	{
+		gpu_skinner->skin(skin_matrices.data(), bone_count, character_count, *skinned_buffer);
+	}
+	const auto skin_end = std::chrono::steady_clock::now();
+
+	shader->setUniformMatrix4fv("viewMatrix", camera->getViewMatrix());
+	shader->setUniformMatrix4fv("projectionMatrix", projection_matrix);
+	shader->setUniform3fv("cameraPos", camera->getCamPosition());
+	shader->setUniform4fv("light.position", glm::vec4(-0.2f, -1.0f, -0.3f, 0.0f));
+	shader->setUniform3fv("light.ambient", glm::vec3(1.0f));
+	shader->setUniform3fv("light.diffuse", glm::vec3(1.0f));
+	shader->setUniform3fv("light.specular", glm::vec3(1.0f));
+	shader->setUniform1i("vertexCount", static_cast<int>(character->source.vertexCount()));
+	shader->apply();
+
+	diffuse_texture->bind(0);
+	skinned_buffer->draw();
+
+	std::size_t cached = 0, searched = 0;
+	for (int i = 0; i < character_count; ++i)
+	{
+		cached += samplers[i].stats().cachedLookups;
+		searched += samplers[i].stats().searchedLookups;
+	}
+
+	const double animate_ms = std::chrono::duration<double, std::milli>(skin_start - animate_start).count();
+	const double skin_ms = std::chrono::duration<double, std::milli>(skin_end - skin_start).count();
+	ImGui::Text("%d characters, %d bones, %d vertices each", character_count, int(bone_count), int(character->source.vertexCount()));
+	ImGui::Text("animation: %.2f ms, skinning: %.2f ms CPU (%s, %u threads)", animate_ms, skin_ms,
+		skinning_mode == SKIN_CPU ? CpuSkinner::simdName() : "submission only", JobSystem::get().threadCount());
+	ImGui::Text("key lookups: %.1f%% from the cached key", 100.0 * cached / std::max<std::size_t>(cached + searched, 1));
+	ImGui::Text("frame: %.2f ms", 1000.0f / ImGui::GetIO().Framerate);
+}
+
+void update()
+{
+	float startTime = static_cast<float>(glfwGetTime());
+	float gameTime = 0.0f;
+	float frameStart = startTime;
+	/* Loop until the user closes the window */
+	while (!glfwWindowShouldClose(window))
+	{
+		ImGui_ImplOpenGL3_NewFrame();
+		ImGui_ImplGlfw_NewFrame();
+		ImGui::NewFrame();
+
+		float deltaTime = static_cast<float>(glfwGetTime()) - frameStart;
+		frameStart = static_cast<float>(glfwGetTime());
+		gameTime = frameStart - startTime;
+
+		processInput(window, deltaTime);
+
+		/* Render here */
+		render(gameTime);
+
+		ImGui::Render();
+		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+
+		/* Swap front and back buffers */
+		glfwSwapBuffers(window);
+
+		/* Poll for and process events */
+		glfwPollEvents();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1)
+		model_path = argv[1];
+
+	if (!init())
+		return -1;
+
+	if (!loadContent())
+		return -1;
+
+	update();
+
+	delete skinned_buffer;
+	delete gpu_skinner;
+	delete character;
+	delete shader;
+	delete diffuse_texture;
+	delete camera;
+
+	glfwTerminate();
+
+	ImGui_ImplOpenGL3_Shutdown();
+	ImGui_ImplGlfw_Shutdown();
+	ImGui::DestroyContext();
+
+	return 0;
+}
@@ -0,0 +1,396 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include <iostream>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#define  GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "rendering/GLState.h"
+#include "rendering/Shader.h"
+#include "rendering/Texture.h"
+#include "rendering/Primitives.h"
+#include "rendering/StaticBatch.h"
+#include "rendering/FrustumCuller.h"
+#include "rendering/Camera.h"
+#include "rendering/Light.h"
+
+#include "imgui/imgui.h"
+#include "imgui/imgui_impl_glfw.h"
+#include "imgui/imgui_impl_opengl3.h"
+
+#include <vector>
+
+// Static batching: a town of scenery that never moves (floor tiles, pillars, domes, spires)
+// either drawn one object at a time, each with its own matrix, or merged at load time by a
+// StaticBatcher into one range per grid cell and material. Both paths cull: the objects one
+// by one, the batches by the bounds of their cell. The bigger the cells, the fewer the draw
+// calls, and the more of the scenery outside the view is drawn along with the visible part.
+
+GLFWwindow* window;
+const int WINDOW_WIDTH = 1920;
+const int WINDOW_HEIGHT = 1080;
+float lastX = WINDOW_WIDTH / 2.0;
+float lastY = WINDOW_HEIGHT / 2.0;
+bool firstMouse = true;
+bool cursor_enabled = true;
+
+Shader* shader = nullptr;
+Texture* diffuse_texture = nullptr;
+Camera* camera = nullptr;
+
+StaticBatcher<DefaultLayout>* batcher = nullptr;
+
+struct SceneObject
+{
+	Primitive primitive;
+	glm::mat4 matrix;
+	glm::mat3 normalMatrix;
+	GLuint material;
+};
+
+std::vector<SceneObject> objects;
+
+FrustumCuller object_culler;
+BoundsBatch object_bounds;
+std::vector<unsigned char> object_visible;
+
+// rgb: tint, a: shininess
+const glm::vec4 materials[] = {
+	glm::vec4(0.9f, 0.9f, 0.85f, 16.0f),
+	glm::vec4(0.6f, 0.6f, 0.65f, 16.0f),
+	glm::vec4(1.0f, 0.5f, 0.4f, 8.0f),
+	glm::vec4(0.4f, 0.7f, 1.0f, 64.0f),
+	glm::vec4(0.6f, 1.0f, 0.5f, 32.0f),
+};
+
+const float TILE_SIZE = 4.0f;
+const int TILES = 40;               // per side, the town covers TILES * TILE_SIZE
+const int PILLAR_SPACING = 2;       // in tiles
+
+glm::mat4 projection_matrix = glm::perspectiveFov(glm::radians(60.0f), float(WINDOW_WIDTH), float(WINDOW_HEIGHT), 0.1f, 300.0f);
+
+float cell_size = 32.0f;
+float built_cell_size = -1.0f;
+
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	if (key == GLFW_KEY_F1 && action == GLFW_PRESS)
+	{
+		if (cursor_enabled)
+		{
+			glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+		}
+		else
+		{
+			glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+		}
+		cursor_enabled = !cursor_enabled;
+	}
+}
+
+void processInput(GLFWwindow* window, float deltaTime)
+{
+	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+		glfwSetWindowShouldClose(window, true);
+
+	if (camera)
+	{
+		camera->processInput(window, deltaTime);
+	}
+}
+
+void mouse_callback(GLFWwindow* window, double xpos_in, double ypos_in)
+{
+	if (cursor_enabled)
+		return;
+
+	float xpos = static_cast<float>(xpos_in);
+	float ypos = static_cast<float>(ypos_in);
+
+	if (firstMouse)
+	{
+		lastX = xpos;
+		lastY = ypos;
+		firstMouse = false;
+	}
+
+	float xoffset = xpos - lastX;
+	float yoffset = lastY - ypos; // reversed since y-coordinates go from bottom to top
+	lastX = xpos;
+	lastY = ypos;
+
+	if (camera)
+	{
+		camera->processMouseMovement(xoffset, yoffset);
+	}
+}
+
+void window_size_callback(GLFWwindow* window, int width, int height)
+{
+	GLState::get().viewport(0, 0, width, height);
+	projection_matrix = glm::perspectiveFov(glm::radians(60.0f), float(width), float(height), 0.1f, 300.0f);
+}
+
+int init()
+{
+	/* Initialize the library */
+	if (!glfwInit())
+		return -1;
+
+	/* Create a windowed mode window and its OpenGL context */
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+	window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Hello Modern GL!", nullptr, nullptr);
+
+	if (!window)
+	{
+		glfwTerminate();
+		return -1;
+	}
+
+	/* Make the window's context current */
+	glfwMakeContextCurrent(window);
+
+	glfwSetWindowSizeCallback(window, window_size_callback);
+
+	/* Initialize glad */
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	{
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		return -1;
+	}
+
+	/* Set the viewport */
+	glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
+	GLState::get().viewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+
+	GLState::get().enable(GL_DEPTH_TEST);
+	GLState::get().enable(GL_CULL_FACE);
+
+	// mouse callback
+	glfwSetCursorPosCallback(window, mouse_callback);
+
+	glfwSetKeyCallback(window, key_callback);
+
+	// IMGUI
+	// ------------
+	IMGUI_CHECKVERSION();
+	ImGui::CreateContext();
+	ImGuiIO& io = ImGui::GetIO();
+	io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;     // Enable Keyboard Controls
+
+	// Setup Platform/Renderer backends
+	ImGui_ImplGlfw_InitForOpenGL(window, true);          // Second param install_callback=true will install GLFW callbacks and chain to existing ones.
+	ImGui_ImplOpenGL3_Init();
+
+	return true;
+}
+
+void addObject(Primitive primitive, const glm::mat4& matrix, GLuint material)
+{
+	objects.push_back({ primitive, matrix, glm::transpose(glm::inverse(glm::mat3(matrix))), material });
+	object_bounds.add(Primitives::get().bounds(primitive).transformed(matrix));
+}
+
+// a checkerboard floor with a pillar every few tiles, topped by a dome or a spire
+void buildScene()
+{
+	const glm::mat4 I(1.0f);
+	const float half = 0.5f * TILES * TILE_SIZE;
+
+	for (int z = 0; z < TILES; ++z)
+	{
+		for (int x = 0; x < TILES; ++x)
+		{
+			const glm::vec3 center(x * TILE_SIZE - half, 0.0f, z * TILE_SIZE - half);
+			addObject(Primitive::Plane, glm::scale(glm::translate(I, center), glm::vec3(TILE_SIZE, 1.0f, TILE_SIZE)), GLuint((x + z) % 2));
+
+			if (x % PILLAR_SPACING != 0 || z % PILLAR_SPACING != 0)
+				continue;
+
+			const float height = 3.0f + float((x * 7 + z * 13) % 5);
+			addObject(Primitive::Cube, glm::scale(glm::translate(I, center + glm::vec3(0.0f, 0.5f * height, 0.0f)), glm::vec3(1.0f, height, 1.0f)), 2);
+
+			const glm::vec3 top = center + glm::vec3(0.0f, height + 0.75f, 0.0f);
+			if ((x + z) % (2 * PILLAR_SPACING) == 0)
+				addObject(Primitive::Sphere, glm::scale(glm::translate(I, top), glm::vec3(1.5f)), 3);
+			else
+				addObject(Primitive::Cone, glm::scale(glm::translate(I, top), glm::vec3(1.5f)), 4);
+		}
+	}
+}
+
+// merged once per cell size; the objects keep their own draws for the comparison
+void buildBatches()
+{
+	delete batcher;
+	batcher = new StaticBatcher<DefaultLayout>(cell_size);
+
+	std::vector<Vertex> vertices[std::size_t(Primitive::Count)];
+	std::vector<unsigned int> indices[std::size_t(Primitive::Count)];
+	for (std::size_t i = 0; i < std::size_t(Primitive::Count); ++i)
+		Primitives::geometry(Primitive(i), vertices[i], indices[i]);
+
+	for (const SceneObject& object : objects)
+	{
+		const std::size_t p = std::size_t(object.primitive);
+		batcher->add(vertices[p], indices[p], object.matrix, object.material);
+	}
+	batcher->build();
+
+	built_cell_size = cell_size;
+}
+
+int loadContent()
+{
+	camera = new Camera(glm::vec3(0.0f, 8.0f, 40.f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	shader = new Shader("ch09_05_static.vert", "ch09_05_static.frag");
+	shader->setUniform1i("diffuseMap", 0);
+
+	diffuse_texture = new Texture();
+	diffuse_texture->load("res/models/container_diffuse.png");
+
+	buildScene();
+
+	return true;
+}
+
+// one draw call, one matrix and one material per visible object
+std::size_t drawObjects()
+{
+	object_culler.resetStats();
+	object_culler.setFrustum(camera->getFrustum(projection_matrix));
+	object_culler.cullBoxes(object_bounds, object_visible);
+
+	GeometryArena<DefaultLayout>::get().bind();
+
+	std::size_t draw_calls = 0;
+	for (std::size_t i = 0; i < objects.size(); ++i)
+	{
+		if (!object_visible[i])
+			continue;
+
+		shader->setUniformMatrix4fv("modelMatrix", objects[i].matrix);
+		shader->setUniformMatrix3fv("normalMatrix", objects[i].normalMatrix);
+		shader->setUniform4fv("materialColor", materials[objects[i].material]);
+		Primitives::get().drawRange(objects[i].primitive);
+		++draw_calls;
+	}
+	return draw_calls;
+}
+
+// one draw call per visible cell and material
+std::size_t drawBatches()
+{
+	batcher->cull(camera->getFrustum(projection_matrix));
+
+	shader->setUniformMatrix4fv("modelMatrix", glm::mat4(1.0f));
+	shader->setUniformMatrix3fv("normalMatrix", glm::mat3(1.0f));
+	return batcher->draw([](GLuint material) {
+		shader->setUniform4fv("materialColor", materials[material]);
+	});
+}
+
+void render(float)
+{
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	static bool static_batching = true;
+	ImGui::Checkbox("static batching", &static_batching);
+	ImGui::SliderFloat("cell size", &cell_size, 8.0f, 160.0f);
+
+	if (built_cell_size != cell_size)
+	{
+		buildBatches();
+	}
+
+	shader->setUniformMatrix4fv("viewMatrix", camera->getViewMatrix());
+	shader->setUniformMatrix4fv("projectionMatrix", projection_matrix);
+	shader->setUniform3fv("cameraPos", camera->getCamPosition());
+	shader->setUniform4fv("light.position", glm::vec4(-0.2f, -1.0f, -0.3f, 0.0f));
+	shader->setUniform3fv("light.ambient", glm::vec3(1.0f));
+	shader->setUniform3fv("light.diffuse", glm::vec3(1.0f));
+	shader->setUniform3fv("light.specular", glm::vec3(1.0f));
+
+	shader->apply();
+	diffuse_texture->bind(0);
+
+	const std::size_t draw_calls = static_batching ? drawBatches() : drawObjects();
+
+	ImGui::Text("static objects: %d, batches: %d", int(objects.size()), int(batcher->getBatches().size()));
+	if (static_batching)
+	{
+		const FrustumCuller::Stats& stats = batcher->cullStats();
+		ImGui::Text("batches visible: %d, culled: %d", int(stats.visible), int(stats.culled));
+	}
+	else
+	{
+		const FrustumCuller::Stats& stats = object_culler.stats();
+		ImGui::Text("objects visible: %d, culled: %d", int(stats.visible), int(stats.culled));
+	}
+	ImGui::Text("GL draw calls: %d", int(draw_calls));
+}
+
+void update()
+{
+	float startTime = static_cast<float>(glfwGetTime());
+	float gameTime = 0.0f;
+	float frameStart = startTime;
+	/* Loop until the user closes the window */
+	while (!glfwWindowShouldClose(window))
+	{
+		ImGui_ImplOpenGL3_NewFrame();
+		ImGui_ImplGlfw_NewFrame();
+		ImGui::NewFrame();
+
+		float deltaTime = static_cast<float>(glfwGetTime()) - frameStart;
+		frameStart = static_cast<float>(glfwGetTime());
+		gameTime = frameStart - startTime;
+
+		processInput(window, deltaTime);
+
+		/* Render here */
+		render(gameTime);
+
+		ImGui::Render();
+		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+
+		/* Swap front and back buffers */
+		glfwSwapBuffers(window);
+
+		/* Poll for and process events */
+		glfwPollEvents();
+	}
+}
+
+int main(void)
+{
+	if (!init())
+		return -1;
+
+	if (!loadContent())
+		return -1;
+
+	update();
+
+	delete batcher;
+	delete shader;
+	delete diffuse_texture;
+
+	glfwTerminate();
+
+	ImGui_ImplOpenGL3_Shutdown();
+	ImGui_ImplGlfw_Shutdown();
+	ImGui::DestroyContext();
+
+	return 0;
+}
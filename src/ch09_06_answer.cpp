@@ -0,0 +1,403 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include <iostream>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#define  GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "rendering/GLState.h"
+#include "rendering/Shader.h"
+#include "rendering/Texture.h"
+#include "rendering/Model.h"
+#include "rendering/InstanceBuffer.h"
+#include "rendering/Impostor.h"
+#include "rendering/FrustumCuller.h"
+#include "rendering/Lod.h"
+#include "rendering/Camera.h"
+
+#include "imgui/imgui.h"
+#include "imgui/imgui_impl_glfw.h"
+#include "imgui/imgui_impl_opengl3.h"
+
+#include <cstdint>
+#include <vector>
+
+// Impostors: a field of models where every copy covering fewer pixels than a threshold is
+// drawn as a single camera-facing quad instead of the full mesh. The quads sample an atlas of
+// the model baked from octahedral view directions at load time (see Impostor.h), blending the
+// 4 views closest to the direction the copy is seen from. Both kinds are instanced, so the
+// frame takes one draw call per mesh for the close copies and one for all the impostors.
+
+GLFWwindow* window;
+const int WINDOW_WIDTH = 1920;
+const int WINDOW_HEIGHT = 1080;
+float lastX = WINDOW_WIDTH / 2.0;
+float lastY = WINDOW_HEIGHT / 2.0;
+bool firstMouse = true;
+bool cursor_enabled = true;
+
+Model* model = nullptr;
+Shader* shader = nullptr;
+Texture* diffuse_texture = nullptr;
+Camera* camera = nullptr;
+
+Impostor* impostor = nullptr;
+InstanceBuffer* model_instances = nullptr;
+InstanceBuffer* impostor_instances = nullptr;
+
+// every copy of the model, the draw lists are rebuilt from it every frame
+std::vector<InstanceTransform> objects;
+std::vector<unsigned char> object_is_impostor;
+BoundsBatch object_bounds;
+std::vector<unsigned char> object_visible;
+FrustumCuller object_culler;
+
+// the projected size of the bounding sphere picks between model and impostor, with the
+// selector's hysteresis around the threshold
+LodSelector lod_selector;
+float impostor_pixels = 96.0f;
+float viewport_height = float(WINDOW_HEIGHT);
+
+const int MAX_SIDE = 150;
+int side = 60;
+int built_side = -1;
+
+int frames_per_side = Impostor::DEFAULT_FRAMES;
+int frame_size = Impostor::DEFAULT_FRAME_SIZE;
+int baked_frames = -1;
+int baked_frame_size = -1;
+
+glm::mat4 projection_matrix = glm::perspectiveFov(glm::radians(60.0f), float(WINDOW_WIDTH), float(WINDOW_HEIGHT), 0.1f, 1000.0f);
+
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	if (key == GLFW_KEY_F1 && action == GLFW_PRESS)
+	{
+		if (cursor_enabled)
+		{
+			glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+		}
+		else
+		{
+			glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+		}
+		cursor_enabled = !cursor_enabled;
+	}
+}
+
+void processInput(GLFWwindow* window, float deltaTime)
+{
+	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+		glfwSetWindowShouldClose(window, true);
+
+	if (camera)
+	{
+		camera->processInput(window, deltaTime);
+	}
+}
+
+void mouse_callback(GLFWwindow* window, double xpos_in, double ypos_in)
+{
+	if (cursor_enabled) return;
+
+	float xpos = static_cast<float>(xpos_in);
+	float ypos = static_cast<float>(ypos_in);
+
+	if (firstMouse)
+	{
+		lastX = xpos;
+		lastY = ypos;
+		firstMouse = false;
+	}
+
+	float xoffset = xpos - lastX;
+	float yoffset = lastY - ypos; // reversed since y-coordinates go from bottom to top
+	lastX = xpos;
+	lastY = ypos;
+
+	if (camera)
+	{
+		camera->processMouseMovement(xoffset, yoffset);
+	}
+}
+
+void window_size_callback(GLFWwindow* window, int width, int height)
+{
+	GLState::get().viewport(0, 0, width, height);
+	projection_matrix = glm::perspectiveFov(glm::radians(60.0f), float(width), float(height), 0.1f, 1000.0f);
+	viewport_height = float(height);
+}
+
+int init()
+{
+	/* Initialize the library */
+	if (!glfwInit())
+		return -1;
+
+	/* Create a windowed mode window and its OpenGL context */
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+	window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Hello Modern GL!", nullptr, nullptr);
+
+	if (!window)
+	{
+		glfwTerminate();
+		return -1;
+	}
+
+	/* Make the window's context current */
+	glfwMakeContextCurrent(window);
+
+	glfwSetWindowSizeCallback(window, window_size_callback);
+
+	/* Initialize glad */
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	{
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		return -1;
+	}
+
+	/* Set the viewport */
+	glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
+	GLState::get().viewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+
+	GLState::get().enable(GL_DEPTH_TEST);
+
+	// mouse callback
+	glfwSetCursorPosCallback(window, mouse_callback);
+
+	glfwSetKeyCallback(window, key_callback);
+
+	// IMGUI
+	// ------------
+	IMGUI_CHECKVERSION();
+	ImGui::CreateContext();
+	ImGuiIO& io = ImGui::GetIO();
+	io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;     // Enable Keyboard Controls
+
+	// Setup Platform/Renderer backends
+	ImGui_ImplGlfw_InitForOpenGL(window, true);          // Second param install_callback=true will install GLFW callbacks and chain to existing ones.
+	ImGui_ImplOpenGL3_Init();
+
+	return true;
+}
+
+int loadContent()
+{
+	camera = new Camera(glm::vec3(0.0f, 10.0f, 30.f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	shader = new Shader("ch09_02_instanced.vert", "ch09_06_model.frag");
+	shader->setUniform1i("diffuseMap", 0);
+
+	diffuse_texture = new Texture();
+	diffuse_texture->load("res/models/container_diffuse.png");
+
+	model = new Model("res/models/alliance.obj");
+	impostor = new Impostor();
+	model_instances = new InstanceBuffer();
+	impostor_instances = new InstanceBuffer();
+
+	return true;
+}
+
+void bakeImpostor()
+{
+	impostor->bake(model->bounds, []() {
+		diffuse_texture->bind(0);
+		model->Draw();
+	}, frames_per_side, frame_size);
+
+	baked_frames = frames_per_side;
+	baked_frame_size = frame_size;
+}
+
+// a square field of copies, each turned and sized a little differently
+void buildObjects()
+{
+	const glm::vec3 size = model->bounds.max - model->bounds.min;
+	const float spacing = 1.5f * std::max(size.x, size.z);
+
+	objects.clear();
+	object_bounds.clear();
+	for (int z = 0; z < side; ++z)
+	{
+		for (int x = 0; x < side; ++x)
+		{
+			const glm::vec3 position = glm::vec3(x - side * 0.5f, 0.0f, -z) * spacing;
+			const glm::quat rotation = glm::angleAxis(0.7f * x + 1.3f * z, glm::vec3(0, 1, 0));
+			const float scale = 0.8f + 0.4f * float((x * 7 + z * 3) % 5) / 4.0f;
+			objects.push_back(InstanceTransform(position, rotation, glm::vec3(scale)));
+
+			const glm::mat4 m = glm::scale(glm::translate(glm::mat4(1.0f), position) * glm::mat4_cast(rotation), glm::vec3(scale));
+			object_bounds.add(model->bounds.transformed(m));
+		}
+	}
+	object_is_impostor.assign(objects.size(), 0);
+
+	built_side = side;
+}
+
+// splits the visible copies into the two instance lists
+void buildInstances(bool use_impostors)
+{
+	lod_selector.setView(camera->getCamPosition(), projection_matrix, viewport_height);
+
+	object_culler.resetStats();
+	object_culler.setFrustum(camera->getFrustum(projection_matrix));
+	object_culler.cullSpheres(object_bounds, object_visible);
+
+	model_instances->clear();
+	impostor_instances->clear();
+
+	const float diameter = 2.0f * model->bounds.radius;
+	for (std::size_t i = 0; i < objects.size(); ++i)
+	{
+		if (!object_visible[i])
+			continue;
+
+		if (use_impostors)
+		{
+			const glm::vec3 center(object_bounds.centerX[i], object_bounds.centerY[i], object_bounds.centerZ[i]);
+			const glm::vec3& scale = objects[i].scale;
+			const float pixels = lod_selector.projectedError(diameter, center, std::max(scale.x, std::max(scale.y, scale.z)));
+			if (object_is_impostor[i])
+				object_is_impostor[i] = pixels < impostor_pixels * (1.0f + lod_selector.hysteresis);
+			else
+				object_is_impostor[i] = pixels < impostor_pixels * (1.0f - lod_selector.hysteresis);
+		}
+		else
+		{
+			object_is_impostor[i] = 0;
+		}
+
+		(object_is_impostor[i] ? impostor_instances : model_instances)->add(objects[i]);
+	}
+}
+
+void setSceneUniforms(Shader& program)
+{
+	program.setUniformMatrix4fv("viewMatrix", camera->getViewMatrix());
+	program.setUniformMatrix4fv("projectionMatrix", projection_matrix);
+	program.setUniform3fv("cameraPos", camera->getCamPosition());
+	program.setUniform4fv("light.position", glm::vec4(-0.2f, -1.0f, -0.3f, 0.0f));
+	program.setUniform3fv("light.ambient", glm::vec3(1.0f));
+	program.setUniform3fv("light.diffuse", glm::vec3(1.0f));
+	program.setUniform3fv("light.specular", glm::vec3(1.0f));
+}
+
+void render(float)
+{
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	static bool use_impostors = true;
+	static bool show_atlas = false;
+	static int frame_size_choice = 1;
+	ImGui::SliderInt("field side", &side, 1, MAX_SIDE);
+	ImGui::Checkbox("impostors", &use_impostors);
+	ImGui::SliderFloat("impostor below (pixels)", &impostor_pixels, 8.0f, 512.0f);
+	ImGui::SliderFloat("hysteresis", &lod_selector.hysteresis, 0.0f, 0.9f);
+	ImGui::SliderInt("frames per side", &frames_per_side, 2, 16);
+	ImGui::Combo("frame size", &frame_size_choice, "64\0" "128\0" "256\0");
+	frame_size = 64 << frame_size_choice;
+	ImGui::Checkbox("show atlas", &show_atlas);
+
+	if (built_side != side)
+	{
+		buildObjects();
+	}
+	if (baked_frames != frames_per_side || baked_frame_size != frame_size)
+	{
+		bakeImpostor();
+	}
+
+	buildInstances(use_impostors);
+
+	setSceneUniforms(*shader);
+	shader->setUniform1i("firstInstance", 0);
+	shader->apply();
+	diffuse_texture->bind(0);
+
+	model_instances->bind();
+	model->DrawInstanced(model_instances->size());
+
+	setSceneUniforms(impostor->shader());
+	impostor_instances->bind();
+	impostor->draw(impostor_instances->size());
+
+	const std::size_t draw_calls = (model_instances->empty() ? 0 : model->meshes.size()) + (impostor_instances->empty() ? 0 : 1);
+	ImGui::Text("copies: %d, visible: %d, culled: %d", int(objects.size()), int(object_culler.stats().visible), int(object_culler.stats().culled));
+	ImGui::Text("models: %d, impostors: %d, GL draw calls: %d", int(model_instances->size()), int(impostor_instances->size()), int(draw_calls));
+	ImGui::Text("atlas: %dx%d frames of %d pixels", impostor->framesPerSide(), impostor->framesPerSide(), frame_size);
+	if (show_atlas)
+	{
+		ImGui::Image((ImTextureID)(intptr_t)impostor->albedoTexture(), ImVec2(256, 256), ImVec2(0, 1), ImVec2(1, 0));
+		ImGui::SameLine();
+		ImGui::Image((ImTextureID)(intptr_t)impostor->normalDepthTexture(), ImVec2(256, 256), ImVec2(0, 1), ImVec2(1, 0));
+	}
+}
+
+void update()
+{
+	float startTime = static_cast<float>(glfwGetTime());
+	float gameTime = 0.0f;
+	float frameStart = startTime;
+	/* Loop until the user closes the window */
+	while (!glfwWindowShouldClose(window))
+	{
+		ImGui_ImplOpenGL3_NewFrame();
+		ImGui_ImplGlfw_NewFrame();
+		ImGui::NewFrame();
+
+		float deltaTime = static_cast<float>(glfwGetTime()) - frameStart;
+		frameStart = static_cast<float>(glfwGetTime());
+		gameTime = frameStart - startTime;
+
+		processInput(window, deltaTime);
+
+		/* Render here */
+		render(gameTime);
+
+		ImGui::Render();
+		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+
+		/* Swap front and back buffers */
+		glfwSwapBuffers(window);
+
+		/* Poll for and process events */
+		glfwPollEvents();
+	}
+}
+
+int main(void)
+{
+	if (!init())
+		return -1;
+
+	if (!loadContent())
+		return -1;
+
+	update();
+
+	delete impostor;
+	delete model_instances;
+	delete impostor_instances;
+	delete model;
+	delete shader;
+	delete diffuse_texture;
+
+	glfwTerminate();
+
+	ImGui_ImplOpenGL3_Shutdown();
+	ImGui_ImplGlfw_Shutdown();
+	ImGui::DestroyContext();
+
+	return 0;
+}
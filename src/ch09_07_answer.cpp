@@ -0,0 +1,427 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include <iostream>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#define  GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "rendering/FrameHandoff.h"
+#include "rendering/GLState.h"
+#include "rendering/Shader.h"
+#include "rendering/Texture.h"
+#include "rendering/Primitives.h"
+#include "rendering/InstanceBuffer.h"
+#include "rendering/Camera.h"
+#include "rendering/RenderThread.h"
+
+#include "imgui/imgui.h"
+#include "imgui/imgui_impl_glfw.h"
+#include "imgui/imgui_impl_opengl3.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+// Render thread: a swarm of cubes chasing moving attractors, simulated one substep at a time
+// on the main thread. Serially, each frame simulates and then draws. Pipelined, a render
+// thread owns the GL context and draws frame N while the main thread already polls input,
+// runs ImGui and simulates frame N+1; the frames go from one to the other as snapshots in a
+// FrameHandoff. A frame then takes the longer of the two instead of their sum.
+
+GLFWwindow* window;
+const int WINDOW_WIDTH = 1920;
+const int WINDOW_HEIGHT = 1080;
+float lastX = WINDOW_WIDTH / 2.0;
+float lastY = WINDOW_HEIGHT / 2.0;
+bool firstMouse = true;
+bool cursor_enabled = true;
+
+// the size is only passed on with the frames; while pipelined the main thread can't call GL
+int framebuffer_width = WINDOW_WIDTH;
+int framebuffer_height = WINDOW_HEIGHT;
+
+Shader* shader = nullptr;
+Texture* diffuse_texture = nullptr;
+Camera* camera = nullptr;
+InstanceBuffer* instances = nullptr;    // render thread
+
+const int MAX_OBJECTS = 200000;
+int object_count = 50000;
+int substeps = 8;
+
+// simulation state, main thread
+std::vector<glm::vec3> positions;
+std::vector<glm::vec3> velocities;
+
+// everything the render thread needs of a frame; written by the main thread only
+struct FrameData
+{
+	glm::mat4 view = glm::mat4(1.0f);
+	glm::mat4 projection = glm::mat4(1.0f);
+	glm::vec3 cameraPosition = glm::vec3(0.0f);
+	int width = WINDOW_WIDTH;
+	int height = WINDOW_HEIGHT;
+	std::vector<InstanceTransform> instances;
+	ImDrawData ui;      // copies of ImGui's draw lists, which the next NewFrame reuses
+};
+
+FrameHandoff<FrameData> frames;
+RenderThread render_thread;
+std::atomic<double> render_ms{ 0.0 };
+
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	if (key == GLFW_KEY_F1 && action == GLFW_PRESS)
+	{
+		if (cursor_enabled)
+		{
+			glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+		}
+		else
+		{
+			glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+		}
+		cursor_enabled = !cursor_enabled;
+	}
+}
+
+void processInput(GLFWwindow* window, float deltaTime)
+{
+	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+		glfwSetWindowShouldClose(window, true);
+
+	if (camera)
+	{
+		camera->processInput(window, deltaTime);
+	}
+}
+
+void mouse_callback(GLFWwindow* window, double xpos_in, double ypos_in)
+{
+	if (cursor_enabled) return;
+
+	float xpos = static_cast<float>(xpos_in);
+	float ypos = static_cast<float>(ypos_in);
+
+	if (firstMouse)
+	{
+		lastX = xpos;
+		lastY = ypos;
+		firstMouse = false;
+	}
+
+	float xoffset = xpos - lastX;
+	float yoffset = lastY - ypos; // reversed since y-coordinates go from bottom to top
+	lastX = xpos;
+	lastY = ypos;
+
+	if (camera)
+	{
+		camera->processMouseMovement(xoffset, yoffset);
+	}
+}
+
+void window_size_callback(GLFWwindow* window, int width, int height)
+{
+	framebuffer_width = width;
+	framebuffer_height = height;
+}
+
+int init()
+{
+	/* Initialize the library */
+	if (!glfwInit())
+		return -1;
+
+	/* Create a windowed mode window and its OpenGL context */
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+	window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Hello Modern GL!", nullptr, nullptr);
+
+	if (!window)
+	{
+		glfwTerminate();
+		return -1;
+	}
+
+	/* Make the window's context current */
+	glfwMakeContextCurrent(window);
+
+	glfwSetWindowSizeCallback(window, window_size_callback);
+
+	/* Initialize glad */
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	{
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		return -1;
+	}
+
+	/* Set the viewport */
+	glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
+	GLState::get().viewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+
+	GLState::get().enable(GL_DEPTH_TEST);
+
+	// mouse callback
+	glfwSetCursorPosCallback(window, mouse_callback);
+
+	glfwSetKeyCallback(window, key_callback);
+
+	// IMGUI
+	// ------------
+	IMGUI_CHECKVERSION();
+	ImGui::CreateContext();
+	ImGuiIO& io = ImGui::GetIO();
+	io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;     // Enable Keyboard Controls
+
+	// Setup Platform/Renderer backends
+	ImGui_ImplGlfw_InitForOpenGL(window, true);          // Second param install_callback=true will install GLFW callbacks and chain to existing ones.
+	ImGui_ImplOpenGL3_Init();
+	// creates the font texture now, while the context is current here; the frames only
+	// draw with it afterwards, on whichever thread renders
+	ImGui_ImplOpenGL3_NewFrame();
+
+	return true;
+}
+
+int loadContent()
+{
+	camera = new Camera(glm::vec3(0.0f, 20.0f, 60.f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	shader = new Shader("ch09_02_instanced.vert", "ch09_02_instanced.frag");
+	shader->setUniform1i("diffuseMap", 0);
+	shader->setUniform1i("firstInstance", 0);
+	shader->setUniform4fv("light.position", glm::vec4(-0.2f, -1.0f, -0.3f, 0.0f));
+	shader->setUniform3fv("light.ambient", glm::vec3(1.0f));
+	shader->setUniform3fv("light.diffuse", glm::vec3(1.0f));
+	shader->setUniform3fv("light.specular", glm::vec3(1.0f));
+
+	diffuse_texture = new Texture();
+	diffuse_texture->load("res/models/container_diffuse.png");
+
+	instances = new InstanceBuffer();
+
+	return true;
+}
+
+// objects spread over a disc, at rest
+void resetSwarm()
+{
+	positions.resize(object_count);
+	velocities.assign(object_count, glm::vec3(0.0f));
+	for (int i = 0; i < object_count; ++i)
+	{
+		const float angle = 2.399963f * i;
+		const float radius = 40.0f * std::sqrt((i + 0.5f) / object_count);
+		positions[i] = glm::vec3(radius * std::cos(angle), 5.0f + 0.0001f * i, radius * std::sin(angle));
+	}
+}
+
+// every object is pulled towards one of four attractors moving on a circle, with some drag;
+// the work grows with the substeps, all on this thread
+void simulate(float time, float deltaTime)
+{
+	glm::vec3 attractors[4];
+	for (int a = 0; a < 4; ++a)
+	{
+		const float phase = time * 0.4f + 1.5707963f * a;
+		attractors[a] = glm::vec3(30.0f * std::cos(phase), 8.0f + 4.0f * std::sin(2.0f * phase), 30.0f * std::sin(phase));
+	}
+
+	const float step = std::min(deltaTime, 0.05f) / substeps;
+	for (int i = 0; i < object_count; ++i)
+	{
+		const glm::vec3 target = attractors[i & 3];
+		glm::vec3 position = positions[i];
+		glm::vec3 velocity = velocities[i];
+		for (int s = 0; s < substeps; ++s)
+		{
+			const glm::vec3 toTarget = target - position;
+			const float distance = std::max(glm::length(toTarget), 1.0f);
+			velocity += step * (toTarget * (40.0f / (distance * distance)) - 0.5f * velocity);
+			position += step * velocity;
+		}
+		positions[i] = position;
+		velocities[i] = velocity;
+	}
+}
+
+void clearDrawData(ImDrawData& data)
+{
+	for (ImDrawList* list : data.CmdLists)
+		IM_DELETE(list);
+	data.Clear();
+}
+
+// on the main thread only: ImGui's allocations aren't thread safe
+void copyDrawData(const ImDrawData& source, ImDrawData& target)
+{
+	clearDrawData(target);
+	target = source;
+	for (ImDrawList*& list : target.CmdLists)
+		list = list->CloneOutput();
+}
+
+void fillFrame(FrameData& frame)
+{
+	frame.view = camera->getViewMatrix();
+	frame.projection = glm::perspectiveFov(glm::radians(60.0f), float(framebuffer_width), float(std::max(framebuffer_height, 1)), 0.1f, 1000.0f);
+	frame.cameraPosition = camera->getCamPosition();
+	frame.width = framebuffer_width;
+	frame.height = framebuffer_height;
+
+	// the cubes face where they are going
+	frame.instances.resize(object_count);
+	for (int i = 0; i < object_count; ++i)
+	{
+		const glm::vec3& velocity = velocities[i];
+		const float yaw = std::atan2(velocity.x, velocity.z);
+		frame.instances[i] = InstanceTransform(positions[i], glm::angleAxis(yaw, glm::vec3(0, 1, 0)), glm::vec3(0.3f, 0.3f, 0.6f));
+	}
+
+	copyDrawData(*ImGui::GetDrawData(), frame.ui);
+}
+
+// on whichever thread owns the context
+void renderFrame(const FrameData& frame)
+{
+	const auto render_start = std::chrono::steady_clock::now();
+
+	GLState::get().viewport(0, 0, frame.width, frame.height);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	instances->assign(frame.instances.data(), frame.instances.size());
+	instances->bind();
+
+	shader->setUniformMatrix4fv("viewMatrix", frame.view);
+	shader->setUniformMatrix4fv("projectionMatrix", frame.projection);
+	shader->setUniform3fv("cameraPos", frame.cameraPosition);
+	shader->apply();
+	diffuse_texture->bind(0);
+	Primitives::get().drawInstanced(Primitive::Cube, instances->size());
+
+	ImGui_ImplOpenGL3_RenderDrawData(const_cast<ImDrawData*>(&frame.ui));
+
+	render_ms.store(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - render_start).count());
+	glfwSwapBuffers(window);
+}
+
+// the render thread's loop body: false once the handoff is closed
+bool renderNextFrame()
+{
+	const FrameData* frame = frames.beginRead();
+	if (frame == nullptr)
+		return false;
+
+	renderFrame(*frame);
+	frames.endRead();
+	return true;
+}
+
+void setPipelined(bool pipelined)
+{
+	if (pipelined == render_thread.running())
+		return;
+
+	if (pipelined)
+	{
+		render_thread.start(window, renderNextFrame);
+	}
+	else
+	{
+		frames.close();
+		render_thread.stop();
+		// a frame published but not drawn yet is dropped
+		frames.reset();
+	}
+}
+
+void update()
+{
+	float startTime = static_cast<float>(glfwGetTime());
+	float gameTime = 0.0f;
+	float frameStart = startTime;
+	/* Loop until the user closes the window */
+	while (!glfwWindowShouldClose(window))
+	{
+		ImGui_ImplGlfw_NewFrame();
+		ImGui::NewFrame();
+
+		float deltaTime = static_cast<float>(glfwGetTime()) - frameStart;
+		frameStart = static_cast<float>(glfwGetTime());
+		gameTime = frameStart - startTime;
+
+		processInput(window, deltaTime);
+
+		static bool pipelined = true;
+		ImGui::Checkbox("render thread", &pipelined);
+		ImGui::SliderInt("objects", &object_count, 1, MAX_OBJECTS);
+		ImGui::SliderInt("simulation substeps", &substeps, 1, 64);
+
+		if (int(positions.size()) != object_count)
+		{
+			resetSwarm();
+		}
+
+		const auto simulate_start = std::chrono::steady_clock::now();
+		simulate(gameTime, deltaTime);
+		const double simulate_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - simulate_start).count();
+
+		ImGui::Text("simulation: %.2f ms, rendering: %.2f ms CPU", simulate_ms, render_ms.load());
+		ImGui::Text("frame: %.2f ms", 1000.0f / ImGui::GetIO().Framerate);
+		ImGui::Text("waits, simulation for rendering: %d, rendering for simulation: %d",
+			int(frames.producerWaitCount()), int(frames.consumerWaitCount()));
+		ImGui::Render();
+
+		// before the frame is written, so it is read in the mode it was written in: leaving the
+		// pipelined mode starts the handoff over, and the frame is then the first one drawn here
+		setPipelined(pipelined);
+
+		// blocks while the render thread still draws the frame before the previous one
+		FrameData* frame = frames.beginWrite();
+		fillFrame(*frame);
+		frames.endWrite();
+
+		if (!render_thread.running())
+		{
+			renderNextFrame();
+		}
+
+		/* Poll for and process events */
+		glfwPollEvents();
+	}
+
+	setPipelined(false);
+}
+
+int main(void)
+{
+	if (!init())
+		return -1;
+
+	if (!loadContent())
+		return -1;
+
+	update();
+
+	delete instances;
+	delete shader;
+	delete diffuse_texture;
+
+	glfwTerminate();
+
+	ImGui_ImplOpenGL3_Shutdown();
+	ImGui_ImplGlfw_Shutdown();
+	ImGui::DestroyContext();
+
+	return 0;
+}
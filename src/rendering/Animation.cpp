@@ -0,0 +1,304 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include "Animation.h"
+
+#include <glm/gtc/type_ptr.hpp>
+#include <assimp/scene.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+    // forward steps tried from the last key before falling back to a binary search
+    const std::uint32_t MAX_CACHED_STEPS = 4;
+
+    glm::mat4 toGlm(const aiMatrix4x4& m)
+    {
+        // aiMatrix4x4 is row major
+        return glm::transpose(glm::make_mat4(&m.a1));
+    }
+
+    void addJoints(const aiNode* node, int parent, Skeleton& skeleton)
+    {
+        aiVector3D scaling, position;
+        aiQuaternion rotation;
+        node->mTransformation.Decompose(scaling, rotation, position);
+
+        Skeleton::Joint joint;
+        joint.name = node->mName.C_Str();
+        joint.parent = parent;
+        joint.bindPose.translation = glm::vec3(position.x, position.y, position.z);
+        joint.bindPose.rotation = glm::quat(rotation.w, rotation.x, rotation.y, rotation.z);
+        joint.bindPose.scale = glm::vec3(scaling.x, scaling.y, scaling.z);
+        skeleton.joints.push_back(joint);
+
+        const int index = static_cast<int>(skeleton.joints.size()) - 1;
+        for (unsigned int i = 0; i < node->mNumChildren; ++i)
+        {
+            addJoints(node->mChildren[i], index, skeleton);
+        }
+    }
+
+    glm::vec3 interpolate(const glm::vec3& a, const glm::vec3& b, float t) { return glm::mix(a, b, t); }
+    glm::quat interpolate(const glm::quat& a, const glm::quat& b, float t) { return glm::slerp(a, b, t); }
+}
+
+glm::mat4 JointPose::matrix() const
+{
+    const glm::mat3 r = glm::mat3_cast(rotation);
+    glm::mat4 m;
+    m[0] = glm::vec4(r[0] * scale.x, 0.0f);
+    m[1] = glm::vec4(r[1] * scale.y, 0.0f);
+    m[2] = glm::vec4(r[2] * scale.z, 0.0f);
+    m[3] = glm::vec4(translation, 1.0f);
+    return m;
+}
+
+void Skeleton::build(const aiScene* scene, Skeleton& skeleton)
+{
+    skeleton = Skeleton();
+    if (scene && scene->mRootNode)
+    {
+        addJoints(scene->mRootNode, -1, skeleton);
+    }
+}
+
+int Skeleton::findJoint(const std::string& name) const
+{
+    for (std::size_t i = 0; i < joints.size(); ++i)
+    {
+        if (joints[i].name == name)
+        {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+int Skeleton::addBone(int joint, const glm::mat4& inverseBindMatrix)
+{
+    auto it = std::find(boneJoints.begin(), boneJoints.end(), joint);
+    if (it != boneJoints.end())
+    {
+        return static_cast<int>(it - boneJoints.begin());
+    }
+    if (boneJoints.size() == MAX_BONES)
+    {
+        return -1;
+    }
+
+    boneJoints.push_back(joint);
+    inverseBindMatrices.push_back(inverseBindMatrix);
+    return static_cast<int>(boneJoints.size()) - 1;
+}
+
+void Skeleton::readBoneWeights(const aiMesh* mesh, const glm::mat4& meshTransform, const std::string& node,
+                               std::vector<glm::u8vec4>& indices, std::vector<glm::vec4>& weights)
+{
+    indices.assign(mesh->mNumVertices, glm::u8vec4(0));
+    weights.assign(mesh->mNumVertices, glm::vec4(0.0f));
+
+    // the vertices come with the node transform baked in, the offset matrices expect them without
+    const glm::mat4 meshInverse = glm::inverse(meshTransform);
+    bool paletteFull = false;
+
+    for (unsigned int b = 0; b < mesh->mNumBones; ++b)
+    {
+        const aiBone* bone = mesh->mBones[b];
+        const int joint = findJoint(bone->mName.C_Str());
+        const int index = joint < 0 ? -1 : addBone(joint, toGlm(bone->mOffsetMatrix) * meshInverse);
+        if (index < 0)
+        {
+            paletteFull |= joint >= 0;
+            continue;
+        }
+
+        for (unsigned int w = 0; w < bone->mNumWeights; ++w)
+        {
+            const aiVertexWeight& influence = bone->mWeights[w];
+            if (influence.mVertexId >= mesh->mNumVertices)
+                continue;
+
+            // keep the 4 strongest, replacing the weakest
+            glm::vec4& vertexWeights = weights[influence.mVertexId];
+            int weakest = 0;
+            for (int k = 1; k < 4; ++k)
+            {
+                if (vertexWeights[k] < vertexWeights[weakest])
+                    weakest = k;
+            }
+            if (influence.mWeight > vertexWeights[weakest])
+            {
+                vertexWeights[weakest] = influence.mWeight;
+                indices[influence.mVertexId][weakest] = static_cast<glm::u8>(index);
+            }
+        }
+    }
+
+    if (paletteFull)
+    {
+        std::cout << "ERROR::SKELETON:: more than " << MAX_BONES << " bones, the rest stay in bind pose" << std::endl;
+    }
+
+    // unweighted vertices (and meshes without bones) follow the node holding the mesh
+    int nodeBone = -1;
+    for (std::size_t i = 0; i < weights.size(); ++i)
+    {
+        const float sum = weights[i].x + weights[i].y + weights[i].z + weights[i].w;
+        if (sum > 0.0f)
+        {
+            weights[i] /= sum;
+            continue;
+        }
+
+        if (nodeBone < 0)
+        {
+            const int joint = findJoint(node);
+            nodeBone = joint < 0 ? 0 : std::max(addBone(joint, meshInverse), 0);
+        }
+        indices[i] = glm::u8vec4(static_cast<glm::u8>(nodeBone), 0, 0, 0);
+        weights[i] = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+    }
+}
+
+void Skeleton::bindPose(std::vector<JointPose>& pose) const
+{
+    pose.resize(joints.size());
+    for (std::size_t i = 0; i < joints.size(); ++i)
+    {
+        pose[i] = joints[i].bindPose;
+    }
+}
+
+void Skeleton::computeSkinMatrices(const std::vector<JointPose>& pose, const glm::mat4& world, glm::mat4* skin,
+                                   std::vector<glm::mat4>& globals) const
+{
+    globals.resize(joints.size());
+    for (std::size_t i = 0; i < joints.size(); ++i)
+    {
+        const int parent = joints[i].parent;
+        globals[i] = (parent < 0 ? world : globals[parent]) * pose[i].matrix();
+    }
+
+    for (std::size_t b = 0; b < boneJoints.size(); ++b)
+    {
+        skin[b] = globals[boneJoints[b]] * inverseBindMatrices[b];
+    }
+}
+
+void AnimationClip::read(const aiScene* scene, const Skeleton& skeleton, std::vector<AnimationClip>& clips)
+{
+    for (unsigned int a = 0; a < scene->mNumAnimations; ++a)
+    {
+        const aiAnimation* animation = scene->mAnimations[a];
+        const double ticksPerSecond = animation->mTicksPerSecond != 0.0 ? animation->mTicksPerSecond : 25.0;
+
+        AnimationClip clip;
+        clip.name = animation->mName.C_Str();
+        clip.duration = static_cast<float>(animation->mDuration / ticksPerSecond);
+
+        for (unsigned int c = 0; c < animation->mNumChannels; ++c)
+        {
+            const aiNodeAnim* source = animation->mChannels[c];
+
+            AnimationChannel channel;
+            channel.joint = skeleton.findJoint(source->mNodeName.C_Str());
+            if (channel.joint < 0)
+                continue;
+
+            for (unsigned int k = 0; k < source->mNumPositionKeys; ++k)
+            {
+                const aiVectorKey& key = source->mPositionKeys[k];
+                channel.positionTimes.push_back(static_cast<float>(key.mTime / ticksPerSecond));
+                channel.positions.push_back(glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z));
+            }
+            for (unsigned int k = 0; k < source->mNumRotationKeys; ++k)
+            {
+                const aiQuatKey& key = source->mRotationKeys[k];
+                channel.rotationTimes.push_back(static_cast<float>(key.mTime / ticksPerSecond));
+                channel.rotations.push_back(glm::quat(key.mValue.w, key.mValue.x, key.mValue.y, key.mValue.z));
+            }
+            for (unsigned int k = 0; k < source->mNumScalingKeys; ++k)
+            {
+                const aiVectorKey& key = source->mScalingKeys[k];
+                channel.scaleTimes.push_back(static_cast<float>(key.mTime / ticksPerSecond));
+                channel.scales.push_back(glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z));
+            }
+            clip.channels.push_back(std::move(channel));
+        }
+        clips.push_back(std::move(clip));
+    }
+}
+
+std::uint32_t AnimationSampler::findKey(const std::vector<float>& times, float time, std::uint32_t& cursor)
+{
+    const std::uint32_t count = static_cast<std::uint32_t>(times.size());
+    if (cursor < count && times[cursor] <= time)
+    {
+        for (std::uint32_t step = 0; step < MAX_CACHED_STEPS; ++step)
+        {
+            if (cursor + 1 >= count || times[cursor + 1] > time)
+            {
+                ++counters.cachedLookups;
+                return cursor;
+            }
+            ++cursor;
+        }
+    }
+    else if (time < times[0])
+    {
+        ++counters.cachedLookups;
+        cursor = 0;
+        return cursor;
+    }
+
+    ++counters.searchedLookups;
+    const auto next = std::upper_bound(times.begin(), times.end(), time);
+    cursor = static_cast<std::uint32_t>(std::max<std::ptrdiff_t>(next - times.begin() - 1, 0));
+    return cursor;
+}
+
+void AnimationSampler::sample(const AnimationClip& clip, float time, std::vector<JointPose>& pose)
+{
+    if (cachedClip != &clip || cursors.size() != clip.channels.size() * 3)
+    {
+        cachedClip = &clip;
+        cursors.assign(clip.channels.size() * 3, 0);
+    }
+
+    float t = clip.duration > 0.0f ? std::fmod(time, clip.duration) : 0.0f;
+    if (t < 0.0f)
+        t += clip.duration;
+
+    auto track = [&](const std::vector<float>& times, const auto& values, std::uint32_t& cursor, auto& out)
+    {
+        if (times.empty())
+            return;
+
+        const std::uint32_t key = findKey(times, t, cursor);
+        if (key + 1 >= times.size())
+        {
+            out = values[key];
+            return;
+        }
+        const float span = times[key + 1] - times[key];
+        const float alpha = span > 0.0f ? glm::clamp((t - times[key]) / span, 0.0f, 1.0f) : 0.0f;
+        out = interpolate(values[key], values[key + 1], alpha);
+    };
+
+    for (std::size_t c = 0; c < clip.channels.size(); ++c)
+    {
+        const AnimationChannel& channel = clip.channels[c];
+        if (channel.joint < 0 || std::size_t(channel.joint) >= pose.size())
+            continue;
+
+        JointPose& joint = pose[channel.joint];
+        track(channel.positionTimes, channel.positions, cursors[c * 3], joint.translation);
+        track(channel.rotationTimes, channel.rotations, cursors[c * 3 + 1], joint.rotation);
+        track(channel.scaleTimes, channel.scales, cursors[c * 3 + 2], joint.scale);
+    }
+}
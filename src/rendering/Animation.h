@@ -0,0 +1,125 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct aiMesh;
+struct aiScene;
+
+// Local transform of a joint relative to its parent
+struct JointPose
+{
+    glm::vec3 translation = glm::vec3(0.0f);
+    glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    glm::vec3 scale = glm::vec3(1.0f);
+
+    glm::mat4 matrix() const;
+};
+
+// The joint hierarchy of a model and its skin palette.
+//
+// Joints are the nodes of the imported scene, parents before children, so a pose can be
+// accumulated in one pass. Bones are the joints vertices are bound to: attr::BoneIndices
+// index the bones, each with the inverse of its joint's bind transform. Meshes without bones
+// get a bone for their node, so rigid parts follow their node's animation too.
+class Skeleton
+{
+public:
+    static constexpr std::size_t MAX_BONES = 256;   // attr::BoneIndices are 8 bit
+
+    struct Joint
+    {
+        std::string name;
+        int parent = -1;
+        JointPose bindPose;
+    };
+
+    std::vector<Joint> joints;
+    std::vector<int> boneJoints;                    // joint of every bone
+    std::vector<glm::mat4> inverseBindMatrices;     // per bone
+
+    // the joints of every node of the scene
+    static void build(const aiScene* scene, Skeleton& skeleton);
+
+    // -1 if there is no such joint
+    int findJoint(const std::string& name) const;
+
+    // the bone of the joint, added if it has none yet; -1 once the palette is full
+    int addBone(int joint, const glm::mat4& inverseBindMatrix);
+
+    // the up to 4 strongest influences of every vertex of the mesh, normalized. meshTransform
+    // is the node transform baked into the vertices, node the name of the node holding the mesh.
+    void readBoneWeights(const aiMesh* mesh, const glm::mat4& meshTransform, const std::string& node,
+                         std::vector<glm::u8vec4>& indices, std::vector<glm::vec4>& weights);
+
+    std::size_t boneCount() const { return boneJoints.size(); }
+
+    // the local bind transforms, for poses of joints without animation
+    void bindPose(std::vector<JointPose>& pose) const;
+
+    // skin[b] = world * global transform of the joint of bone b * inverse bind matrix of b.
+    // globals is scratch space, one matrix per joint.
+    void computeSkinMatrices(const std::vector<JointPose>& pose, const glm::mat4& world, glm::mat4* skin,
+                             std::vector<glm::mat4>& globals) const;
+};
+
+// Keys of one joint; times in seconds, each track sorted by time
+struct AnimationChannel
+{
+    int joint = -1;
+    std::vector<float> positionTimes;
+    std::vector<glm::vec3> positions;
+    std::vector<float> rotationTimes;
+    std::vector<glm::quat> rotations;
+    std::vector<float> scaleTimes;
+    std::vector<glm::vec3> scales;
+};
+
+struct AnimationClip
+{
+    std::string name;
+    float duration = 0.0f;  // seconds
+    std::vector<AnimationChannel> channels;
+
+    // the animations of the scene, channels bound to the joints of the skeleton
+    static void read(const aiScene* scene, const Skeleton& skeleton, std::vector<AnimationClip>& clips);
+};
+
+// Samples a clip into a local pose, looping.
+//
+// Playback mostly moves forward by a frame at a time, so every track remembers the key it
+// found last and the next sample searches forward from there: a step or two instead of a
+// binary search per track. Jumping back (looping, seeking) falls back to the binary search.
+// Keep one sampler per playing instance.
+class AnimationSampler
+{
+public:
+    struct Stats
+    {
+        std::size_t cachedLookups = 0;      // found within a few keys of the last one
+        std::size_t searchedLookups = 0;    // binary searches
+    };
+
+    // pose holds the pose to start from (usually the bind pose, see Skeleton::bindPose());
+    // the joints animated by the clip are overwritten
+    void sample(const AnimationClip& clip, float time, std::vector<JointPose>& pose);
+
+    const Stats& stats() const { return counters; }
+
+private:
+    const AnimationClip* cachedClip = nullptr;
+    std::vector<std::uint32_t> cursors;     // 3 per channel: position, rotation, scale key
+    Stats counters;
+
+    std::uint32_t findKey(const std::vector<float>& times, float time, std::uint32_t& cursor);
+};
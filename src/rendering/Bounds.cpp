@@ -0,0 +1,79 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include "Bounds.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+Bounds Bounds::fromPoints(const void* positions, std::size_t stride, std::size_t count)
+{
+    Bounds bounds;
+    if (count == 0)
+    {
+        return bounds;
+    }
+
+    const char* bytes = static_cast<const char*>(positions);
+    glm::vec3 min(FLT_MAX), max(-FLT_MAX);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        glm::vec3 p;
+        std::memcpy(&p, bytes + i * stride, sizeof(glm::vec3));
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+
+    bounds.min = min;
+    bounds.max = max;
+    bounds.center = 0.5f * (min + max);
+
+    // the box's half diagonal would do, but the points are usually a lot tighter
+    float radius2 = 0.0f;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        glm::vec3 p;
+        std::memcpy(&p, bytes + i * stride, sizeof(glm::vec3));
+        const glm::vec3 d = p - bounds.center;
+        radius2 = std::max(radius2, glm::dot(d, d));
+    }
+    bounds.radius = std::sqrt(radius2);
+
+    return bounds;
+}
+
+void Bounds::merge(const Bounds& other)
+{
+    const glm::vec3 mergedMin = glm::min(min, other.min);
+    const glm::vec3 mergedMax = glm::max(max, other.max);
+    const glm::vec3 mergedCenter = 0.5f * (mergedMin + mergedMax);
+
+    radius = std::max(glm::length(center - mergedCenter) + radius,
+                      glm::length(other.center - mergedCenter) + other.radius);
+    min = mergedMin;
+    max = mergedMax;
+    center = mergedCenter;
+}
+
+Bounds Bounds::transformed(const glm::mat4& m) const
+{
+    // Arvo: the new half extents are the old ones through the absolute of the rotation/scale part
+    const glm::mat3 linear(m);
+    const glm::mat3 absolute(glm::abs(linear[0]), glm::abs(linear[1]), glm::abs(linear[2]));
+
+    const glm::vec3 boxCenter = glm::vec3(m * glm::vec4(0.5f * (min + max), 1.0f));
+    const glm::vec3 boxExtents = absolute * extents();
+
+    const float scale = std::sqrt(std::max(glm::dot(linear[0], linear[0]),
+                                  std::max(glm::dot(linear[1], linear[1]), glm::dot(linear[2], linear[2]))));
+
+    Bounds result;
+    result.min = boxCenter - boxExtents;
+    result.max = boxCenter + boxExtents;
+    result.center = glm::vec3(m * glm::vec4(center, 1.0f));
+    result.radius = radius * scale;
+    return result;
+}
@@ -0,0 +1,30 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+// Axis aligned box plus a bounding sphere around its center. Meshes and models compute
+// theirs in object space at load time, transformed() moves them into world space.
+struct Bounds
+{
+    glm::vec3 min = glm::vec3(0.0f);
+    glm::vec3 max = glm::vec3(0.0f);
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+
+    // positions are read with the given byte stride, so interleaved vertices can be passed directly
+    static Bounds fromPoints(const void* positions, std::size_t stride, std::size_t count);
+
+    // box around both, with a sphere around the merged box's center enclosing both spheres
+    void merge(const Bounds& other);
+
+    // bounds of the transformed box, the sphere grows with the largest axis scale
+    Bounds transformed(const glm::mat4& m) const;
+
+    glm::vec3 extents() const { return 0.5f * (max - min); }
+};
@@ -0,0 +1,366 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include "Bvh.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    float surfaceArea(const glm::vec3& min, const glm::vec3& max)
+    {
+        const glm::vec3 e = glm::max(max - min, glm::vec3(0.0f));
+        return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+    }
+
+    struct Bin
+    {
+        glm::vec3 min = glm::vec3(FLT_MAX);
+        glm::vec3 max = glm::vec3(-FLT_MAX);
+        unsigned int count = 0;
+    };
+
+    const unsigned int INSIDE_BIT = 0x80000000u;
+}
+
+void Bvh::build(const std::vector<Bounds>& bounds)
+{
+    std::vector<glm::vec3> mins(bounds.size()), maxs(bounds.size());
+    for (std::size_t i = 0; i < bounds.size(); ++i)
+    {
+        mins[i] = bounds[i].min;
+        maxs[i] = bounds[i].max;
+    }
+    build(mins.data(), maxs.data(), bounds.size());
+}
+
+void Bvh::build(const glm::vec3* mins, const glm::vec3* maxs, std::size_t count)
+{
+    nodes.clear();
+    items.resize(count);
+    itemMin.assign(mins, mins + count);
+    itemMax.assign(maxs, maxs + count);
+    if (count == 0)
+    {
+        return;
+    }
+
+    for (unsigned int i = 0; i < count; ++i)
+        items[i] = i;
+
+    // a binary tree with at least one item per leaf has at most 2n - 1 nodes,
+    // reserving them keeps node references valid while subdividing
+    nodes.reserve(2 * count);
+
+    Node root;
+    root.first = 0;
+    root.count = static_cast<unsigned int>(count);
+    updateNodeBounds(root);
+    nodes.push_back(root);
+
+    subdivide(0, 0);
+}
+
+void Bvh::updateNodeBounds(Node& node) const
+{
+    node.min = glm::vec3(FLT_MAX);
+    node.max = glm::vec3(-FLT_MAX);
+    for (unsigned int i = 0; i < node.count; ++i)
+    {
+        const unsigned int item = items[node.first + i];
+        node.min = glm::min(node.min, itemMin[item]);
+        node.max = glm::max(node.max, itemMax[item]);
+    }
+}
+
+void Bvh::subdivide(unsigned int nodeIndex, unsigned int depth)
+{
+    const unsigned int first = nodes[nodeIndex].first;
+    const unsigned int count = nodes[nodeIndex].count;
+    if (count <= MAX_LEAF_ITEMS || depth >= MAX_DEPTH)
+    {
+        return;
+    }
+
+    auto center = [&](unsigned int item) { return 0.5f * (itemMin[item] + itemMax[item]); };
+
+    // split candidates are placed between the item centers, not the item boxes
+    glm::vec3 centerMin(FLT_MAX), centerMax(-FLT_MAX);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        const glm::vec3 c = center(items[first + i]);
+        centerMin = glm::min(centerMin, c);
+        centerMax = glm::max(centerMax, c);
+    }
+
+    float bestCost = FLT_MAX;
+    int bestAxis = -1;
+    unsigned int bestSplit = 0;
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const float extent = centerMax[axis] - centerMin[axis];
+        if (extent <= 0.0f)
+            continue;
+
+        const float scale = SAH_BINS / extent;
+        Bin bins[SAH_BINS];
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            const unsigned int item = items[first + i];
+            const unsigned int b = std::min(SAH_BINS - 1, static_cast<unsigned int>((center(item)[axis] - centerMin[axis]) * scale));
+            bins[b].count++;
+            bins[b].min = glm::min(bins[b].min, itemMin[item]);
+            bins[b].max = glm::max(bins[b].max, itemMax[item]);
+        }
+
+        // sweep from both sides, split k puts bins [0, k) left
+        float leftArea[SAH_BINS - 1];
+        unsigned int leftCount[SAH_BINS - 1];
+        glm::vec3 min(FLT_MAX), max(-FLT_MAX);
+        unsigned int sum = 0;
+        for (unsigned int k = 0; k < SAH_BINS - 1; ++k)
+        {
+            sum += bins[k].count;
+            min = glm::min(min, bins[k].min);
+            max = glm::max(max, bins[k].max);
+            leftCount[k] = sum;
+            leftArea[k] = surfaceArea(min, max);
+        }
+
+        min = glm::vec3(FLT_MAX);
+        max = glm::vec3(-FLT_MAX);
+        sum = 0;
+        for (unsigned int k = SAH_BINS - 1; k > 0; --k)
+        {
+            sum += bins[k].count;
+            min = glm::min(min, bins[k].min);
+            max = glm::max(max, bins[k].max);
+
+            const float cost = leftCount[k - 1] * leftArea[k - 1] + sum * surfaceArea(min, max);
+            if (leftCount[k - 1] > 0 && sum > 0 && cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = k;
+            }
+        }
+    }
+
+    unsigned int leftItems = 0;
+    if (bestAxis >= 0)
+    {
+        // splitting only pays off if it beats testing every item of the node
+        const float leafCost = count * surfaceArea(nodes[nodeIndex].min, nodes[nodeIndex].max);
+        if (bestCost >= leafCost && count <= 4 * MAX_LEAF_ITEMS)
+        {
+            return;
+        }
+
+        const float scale = SAH_BINS / (centerMax[bestAxis] - centerMin[bestAxis]);
+        unsigned int* begin = items.data() + first;
+        unsigned int* middle = std::partition(begin, begin + count, [&](unsigned int item) {
+            const unsigned int b = std::min(SAH_BINS - 1, static_cast<unsigned int>((center(item)[bestAxis] - centerMin[bestAxis]) * scale));
+            return b < bestSplit;
+        });
+        leftItems = static_cast<unsigned int>(middle - begin);
+    }
+    else
+    {
+        // all centers coincide, split in half so large leaves don't degrade queries
+        if (count <= 4 * MAX_LEAF_ITEMS)
+        {
+            return;
+        }
+        leftItems = count / 2;
+    }
+
+    const unsigned int left = static_cast<unsigned int>(nodes.size());
+    Node child;
+    child.first = first;
+    child.count = leftItems;
+    updateNodeBounds(child);
+    nodes.push_back(child);
+
+    child.first = first + leftItems;
+    child.count = count - leftItems;
+    updateNodeBounds(child);
+    nodes.push_back(child);
+
+    nodes[nodeIndex].first = left;
+    nodes[nodeIndex].count = 0;
+
+    subdivide(left, depth + 1);
+    subdivide(left + 1, depth + 1);
+}
+
+void Bvh::refit(const std::vector<Bounds>& bounds)
+{
+    for (std::size_t i = 0; i < bounds.size() && i < itemMin.size(); ++i)
+    {
+        itemMin[i] = bounds[i].min;
+        itemMax[i] = bounds[i].max;
+    }
+    refit(nullptr, nullptr);
+}
+
+void Bvh::refit(const glm::vec3* mins, const glm::vec3* maxs)
+{
+    if (mins && maxs)
+    {
+        std::copy(mins, mins + itemMin.size(), itemMin.begin());
+        std::copy(maxs, maxs + itemMax.size(), itemMax.begin());
+    }
+
+    // children are always stored after their parent
+    for (std::size_t i = nodes.size(); i-- > 0;)
+    {
+        Node& node = nodes[i];
+        if (node.isLeaf())
+        {
+            updateNodeBounds(node);
+        }
+        else
+        {
+            node.min = glm::min(nodes[node.first].min, nodes[node.first + 1].min);
+            node.max = glm::max(nodes[node.first].max, nodes[node.first + 1].max);
+        }
+    }
+}
+
+void Bvh::queryFrustum(const Frustum& frustum, std::vector<unsigned int>& result) const
+{
+    if (nodes.empty())
+    {
+        return;
+    }
+
+    unsigned int stack[STACK_SIZE];
+    unsigned int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0)
+    {
+        const unsigned int entry = stack[--stackSize];
+        const Node& node = nodes[entry & ~INSIDE_BIT];
+        bool inside = (entry & INSIDE_BIT) != 0;
+
+        if (!inside)
+        {
+            bool outside = false;
+            inside = true;
+            for (const glm::vec4& plane : frustum.planes)
+            {
+                const glm::vec3 n(plane);
+                const glm::vec3 furthest(n.x >= 0.0f ? node.max.x : node.min.x, n.y >= 0.0f ? node.max.y : node.min.y, n.z >= 0.0f ? node.max.z : node.min.z);
+                const glm::vec3 nearest(n.x >= 0.0f ? node.min.x : node.max.x, n.y >= 0.0f ? node.min.y : node.max.y, n.z >= 0.0f ? node.min.z : node.max.z);
+                if (glm::dot(n, furthest) + plane.w < 0.0f)
+                {
+                    outside = true;
+                    break;
+                }
+                if (glm::dot(n, nearest) + plane.w < 0.0f)
+                {
+                    inside = false;
+                }
+            }
+            if (outside)
+                continue;
+        }
+
+        if (node.isLeaf())
+        {
+            for (unsigned int i = 0; i < node.count; ++i)
+            {
+                const unsigned int item = items[node.first + i];
+                if (inside || frustum.intersectsAabb(itemMin[item], itemMax[item]))
+                    result.push_back(item);
+            }
+            continue;
+        }
+
+        const unsigned int flag = inside ? INSIDE_BIT : 0u;
+        stack[stackSize++] = node.first | flag;
+        stack[stackSize++] = (node.first + 1) | flag;
+    }
+}
+
+void Bvh::queryAabb(const glm::vec3& min, const glm::vec3& max, std::vector<unsigned int>& result) const
+{
+    if (nodes.empty())
+    {
+        return;
+    }
+
+    auto overlaps = [&](const glm::vec3& a, const glm::vec3& b) {
+        return a.x <= max.x && b.x >= min.x && a.y <= max.y && b.y >= min.y && a.z <= max.z && b.z >= min.z;
+    };
+
+    unsigned int stack[STACK_SIZE];
+    unsigned int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0)
+    {
+        const Node& node = nodes[stack[--stackSize]];
+        if (!overlaps(node.min, node.max))
+            continue;
+
+        if (node.isLeaf())
+        {
+            for (unsigned int i = 0; i < node.count; ++i)
+            {
+                const unsigned int item = items[node.first + i];
+                if (overlaps(itemMin[item], itemMax[item]))
+                    result.push_back(item);
+            }
+            continue;
+        }
+
+        stack[stackSize++] = node.first;
+        stack[stackSize++] = node.first + 1;
+    }
+}
+
+unsigned int Bvh::closestHit(const Ray& ray, float& t, float maxT) const
+{
+    const glm::vec3 invDirection = 1.0f / ray.direction;
+    return closestHit(ray, t, maxT, [&](unsigned int item, const Ray& r, float itemMaxT) {
+        return intersectAabb(r, invDirection, itemMin[item], itemMax[item], itemMaxT);
+    });
+}
+
+void TriangleBvh::build(const void* positions, std::size_t stride, std::size_t vertexCount,
+                        const unsigned int* indices, std::size_t indexCount)
+{
+    const char* bytes = static_cast<const char*>(positions);
+    const std::size_t triangles = indexCount / 3;
+
+    vertices.resize(triangles * 3);
+    std::vector<glm::vec3> mins(triangles), maxs(triangles);
+    for (std::size_t t = 0; t < triangles; ++t)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            const unsigned int index = indices[t * 3 + k];
+            glm::vec3 p(0.0f);
+            if (index < vertexCount)
+                std::memcpy(&p, bytes + index * stride, sizeof(glm::vec3));
+            vertices[t * 3 + k] = p;
+        }
+        mins[t] = glm::min(vertices[t * 3], glm::min(vertices[t * 3 + 1], vertices[t * 3 + 2]));
+        maxs[t] = glm::max(vertices[t * 3], glm::max(vertices[t * 3 + 1], vertices[t * 3 + 2]));
+    }
+
+    bvh.build(mins.data(), maxs.data(), triangles);
+    isBuilt = true;
+}
+
+unsigned int TriangleBvh::closestHit(const Ray& ray, float& t, float maxT) const
+{
+    return bvh.closestHit(ray, t, maxT, [&](unsigned int triangle, const Ray& r, float) {
+        return intersectTriangle(r, vertices[triangle * 3], vertices[triangle * 3 + 1], vertices[triangle * 3 + 2]);
+    });
+}
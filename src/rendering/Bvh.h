@@ -0,0 +1,160 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cfloat>
+#include <cstddef>
+#include <vector>
+
+#include "Bounds.h"
+#include "Frustum.h"
+#include "Ray.h"
+
+// Bounding volume hierarchy over a set of boxes (scene objects, triangles...), built with
+// the binned surface area heuristic. Items are referenced by their index in the array the
+// tree was built from.
+//
+// Moving items don't need a rebuild: refit() updates the node boxes bottom up with the new
+// item bounds, keeping the tree topology. Queries get slower as items drift away from where
+// they were at build time, so rebuild once in a while when things move a lot.
+class Bvh
+{
+public:
+    struct Node
+    {
+        glm::vec3 min;
+        unsigned int first;     // leaf: first entry in items, inner node: left child (right child is first + 1)
+        glm::vec3 max;
+        unsigned int count;     // items in a leaf, 0 for inner nodes
+
+        bool isLeaf() const { return count > 0; }
+    };
+
+    static constexpr unsigned int MAX_LEAF_ITEMS = 4;
+    static constexpr unsigned int SAH_BINS = 12;
+    // nodes at this depth stay leaves whatever their item count, so the traversal stacks
+    // can't overflow: a depth first walk keeps at most one sibling per level on its stack
+    static constexpr unsigned int MAX_DEPTH = 48;
+    static constexpr unsigned int STACK_SIZE = 64;
+    static_assert(MAX_DEPTH + 1 <= STACK_SIZE, "traversal stack too small for the deepest tree");
+
+    void build(const std::vector<Bounds>& bounds);
+    void build(const glm::vec3* mins, const glm::vec3* maxs, std::size_t count);
+
+    // bounds must be in the same order as at build time
+    void refit(const std::vector<Bounds>& bounds);
+    void refit(const glm::vec3* mins, const glm::vec3* maxs);
+
+    // appends the items whose box intersects the frustum. Subtrees fully inside are taken
+    // without testing their items.
+    void queryFrustum(const Frustum& frustum, std::vector<unsigned int>& result) const;
+
+    // appends the items whose box intersects the given box
+    void queryAabb(const glm::vec3& min, const glm::vec3& max, std::vector<unsigned int>& result) const;
+
+    // closest hit in [0, maxT). intersectItem(item, ray, maxT) returns the hit t of an item,
+    // or FLT_MAX on a miss. Returns the item, or ~0u if nothing was hit.
+    template <typename IntersectItem>
+    unsigned int closestHit(const Ray& ray, float& t, float maxT, IntersectItem intersectItem) const;
+
+    // closest hit against the item boxes themselves
+    unsigned int closestHit(const Ray& ray, float& t, float maxT = FLT_MAX) const;
+
+    bool empty() const { return nodes.empty(); }
+    std::size_t nodeCount() const { return nodes.size(); }
+    const std::vector<Node>& getNodes() const { return nodes; }
+    const std::vector<unsigned int>& getItems() const { return items; }
+
+private:
+    std::vector<Node> nodes;
+    std::vector<unsigned int> items;        // item indices, leaves reference ranges of it
+
+    // item boxes as of the last build/refit, indexed by item
+    std::vector<glm::vec3> itemMin, itemMax;
+
+    void subdivide(unsigned int nodeIndex, unsigned int depth);
+    void updateNodeBounds(Node& node) const;
+};
+
+template <typename IntersectItem>
+unsigned int Bvh::closestHit(const Ray& ray, float& t, float maxT, IntersectItem intersectItem) const
+{
+    unsigned int hitItem = ~0u;
+    t = maxT;
+    if (nodes.empty())
+    {
+        return hitItem;
+    }
+
+    const glm::vec3 invDirection = 1.0f / ray.direction;
+
+    unsigned int stack[STACK_SIZE];
+    unsigned int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0)
+    {
+        const Node& node = nodes[stack[--stackSize]];
+        if (intersectAabb(ray, invDirection, node.min, node.max, t) == FLT_MAX)
+        {
+            continue;
+        }
+
+        if (node.isLeaf())
+        {
+            for (unsigned int i = 0; i < node.count; ++i)
+            {
+                const unsigned int item = items[node.first + i];
+                const float itemT = intersectItem(item, ray, t);
+                if (itemT < t)
+                {
+                    t = itemT;
+                    hitItem = item;
+                }
+            }
+            continue;
+        }
+
+        // visit the nearer child first so the far one is more likely to be rejected
+        const Node& left = nodes[node.first];
+        const Node& right = nodes[node.first + 1];
+        const float leftT = intersectAabb(ray, invDirection, left.min, left.max, t);
+        const float rightT = intersectAabb(ray, invDirection, right.min, right.max, t);
+        if (leftT <= rightT)
+        {
+            if (rightT != FLT_MAX) stack[stackSize++] = node.first + 1;
+            if (leftT != FLT_MAX) stack[stackSize++] = node.first;
+        }
+        else
+        {
+            if (leftT != FLT_MAX) stack[stackSize++] = node.first;
+            stack[stackSize++] = node.first + 1;
+        }
+    }
+
+    return hitItem;
+}
+
+// BVH over the triangles of an indexed mesh, for ray casts against the actual geometry
+class TriangleBvh
+{
+public:
+    // positions are read with the given byte stride, indices is a triangle list
+    void build(const void* positions, std::size_t stride, std::size_t vertexCount,
+               const unsigned int* indices, std::size_t indexCount);
+
+    // closest hit in [0, maxT), returns the triangle index or ~0u
+    unsigned int closestHit(const Ray& ray, float& t, float maxT = FLT_MAX) const;
+
+    bool built() const { return isBuilt; }
+    std::size_t triangleCount() const { return vertices.size() / 3; }
+
+private:
+    Bvh bvh;
+    std::vector<glm::vec3> vertices;    // 3 per triangle
+    bool isBuilt = false;
+};
@@ -8,6 +8,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "Frustum.h"
+
 struct GLFWwindow;
 
 // Default camera values
@@ -55,6 +57,12 @@ public:
 		return glm::lookAt(Position, Position + Front, Up);
 	}
 
+	// world space view frustum for the given projection
+	Frustum getFrustum(const glm::mat4& projection)
+	{
+		return Frustum::fromMatrix(projection * getViewMatrix());
+	}
+
 	glm::vec3 getCamPosition();
 	void processInput(GLFWwindow* window, float deltaTime);
 	void processMouseMovement(float xoffset, float yoffset, GLboolean constrainPitch = true);
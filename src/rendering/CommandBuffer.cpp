@@ -0,0 +1,95 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include "CommandBuffer.h"
+
+#include <algorithm>
+
+unsigned char* CommandBuffer::allocate(std::size_t bytes)
+{
+    if (used + bytes > capacity)
+    {
+        // packets are trivially copyable, moving them is a memcpy
+        const std::size_t newCapacity = std::max<std::size_t>(std::max(2 * capacity, used + bytes), 64 * 1024);
+        std::unique_ptr<unsigned char[]> newStorage(new unsigned char[newCapacity]);
+        if (used > 0)
+        {
+            std::memcpy(newStorage.get(), storage.get(), used);
+        }
+        storage = std::move(newStorage);
+        capacity = newCapacity;
+    }
+
+    unsigned char* at = storage.get() + used;
+    used += bytes;
+    return at;
+}
+
+CommandRecorder::CommandRecorder(JobSystem& jobs)
+    : jobs(jobs), buffers(jobs.threadCount()), ownerThread(std::this_thread::get_id())
+{
+}
+
+void CommandRecorder::reset()
+{
+    forEachBuffer([](CommandBuffer& buffer) { buffer.clear(); });
+}
+
+CommandBuffer& CommandRecorder::foreignBuffer()
+{
+    const std::thread::id thread = std::this_thread::get_id();
+    std::lock_guard<std::mutex> lock(foreignMutex);
+    for (const auto& entry : foreignThreads)
+    {
+        if (entry.first == thread)
+        {
+            return *entry.second;
+        }
+    }
+
+    foreign.emplace_back();
+    foreignThreads.emplace_back(thread, &foreign.back());
+    return foreign.back();
+}
+
+void CommandRecorder::record(std::size_t count, std::size_t grainSize, const RecordFunction& fn)
+{
+    jobs.parallelFor(count, grainSize, [&](std::size_t begin, std::size_t end)
+    {
+        fn(local(), begin, end);
+    });
+}
+
+void CommandRecorder::submit()
+{
+    counters = Stats();
+    headers.clear();
+    queue.clear();
+
+    forEachBuffer([&](const CommandBuffer& buffer)
+    {
+        counters.packets += buffer.size();
+        counters.bytes += buffer.bytes();
+        counters.threads += buffer.empty() ? 0 : 1;
+    });
+    headers.reserve(counters.packets);
+    queue.reserve(counters.packets);
+
+    forEachBuffer([&](const CommandBuffer& buffer)
+    {
+        buffer.forEach([&](const CommandBuffer::Header& header)
+        {
+            queue.submit(header.key, static_cast<std::uint32_t>(headers.size()));
+            headers.push_back(&header);
+        });
+    });
+
+    // the radix sort is stable, so equal keys stay in buffer order
+    queue.sort();
+    for (const RenderQueue::Entry& entry : queue.getEntries())
+    {
+        const CommandBuffer::Header* header = headers[entry.payload];
+        header->execute(header->packet());
+    }
+}
@@ -0,0 +1,183 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Parallel.h"
+#include "RenderQueue.h"
+
+// Command packets of one thread, packed one after the other in a linear buffer that keeps its
+// memory from frame to frame. A packet is any trivially copyable struct with a static
+// execute(const Packet&) making its GL calls; it is copied in with a sort key (see SortKey)
+// and only executed later, on the GL thread, by CommandRecorder::submit().
+//
+//   struct DrawPacket
+//   {
+//       GLint firstInstance;
+//       static void execute(const DrawPacket& packet) { ... }
+//   };
+//   buffer.record(key, DrawPacket{ i });
+//
+// Not thread safe: one buffer per recording thread.
+class alignas(64) CommandBuffer
+{
+public:
+    using ExecuteFunction = void (*)(const void* packet);
+
+    static constexpr std::size_t ALIGNMENT = 16;
+
+    struct Header
+    {
+        std::uint64_t key;
+        ExecuteFunction execute;
+        std::uint32_t size;         // of the packet following the header, padded to ALIGNMENT
+
+        const void* packet() const { return reinterpret_cast<const unsigned char*>(this) + HEADER_SIZE; }
+    };
+
+    CommandBuffer() = default;
+    CommandBuffer(CommandBuffer&&) = default;
+    CommandBuffer& operator=(CommandBuffer&&) = default;
+
+    template <typename Packet>
+    void record(std::uint64_t key, const Packet& packet)
+    {
+        static_assert(std::is_trivially_copyable<Packet>::value, "packets are copied as bytes");
+        static_assert(alignof(Packet) <= ALIGNMENT, "packets are aligned to CommandBuffer::ALIGNMENT");
+
+        const std::size_t packetSize = padded(sizeof(Packet));
+        unsigned char* at = allocate(HEADER_SIZE + packetSize);
+
+        Header* header = new (at) Header;
+        header->key = key;
+        header->execute = [](const void* data) { Packet::execute(*static_cast<const Packet*>(data)); };
+        header->size = static_cast<std::uint32_t>(packetSize);
+        std::memcpy(at + HEADER_SIZE, &packet, sizeof(Packet));
+        ++packets;
+    }
+
+    // forgets the packets, keeps the memory
+    void clear() { used = 0; packets = 0; }
+
+    std::size_t size() const { return packets; }
+    std::size_t bytes() const { return used; }
+    bool empty() const { return packets == 0; }
+
+    // fn(const Header&) for every packet in recording order
+    template <typename Fn>
+    void forEach(Fn&& fn) const
+    {
+        for (std::size_t offset = 0; offset < used; )
+        {
+            const Header* header = reinterpret_cast<const Header*>(storage.get() + offset);
+            fn(*header);
+            offset += HEADER_SIZE + header->size;
+        }
+    }
+
+private:
+    static constexpr std::size_t padded(std::size_t size) { return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1); }
+    static constexpr std::size_t HEADER_SIZE = (sizeof(Header) + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+
+    std::unique_ptr<unsigned char[]> storage;   // new[] aligns to at least ALIGNMENT
+    std::size_t capacity = 0;
+    std::size_t used = 0;
+    std::size_t packets = 0;
+
+    unsigned char* allocate(std::size_t bytes);
+};
+
+// Records command packets on all threads of a JobSystem and submits them from the GL thread.
+// Every thread writes into its own CommandBuffer, so recording needs no locks; submit() merges
+// the buffers by sort key (a RenderQueue) and executes the packets in that order, which makes
+// the result independent of which thread recorded what.
+//
+//   recorder.reset();
+//   recorder.record(objectCount, 256, [&](CommandBuffer& commands, std::size_t begin, std::size_t end) {
+//       for (std::size_t i = begin; i < end; ++i)
+//           if (visible(i)) commands.record(key(i), DrawPacket{ ... });
+//   });
+//   recorder.submit();     // GL thread
+//
+// The workers of the pool use the buffer of their thread index. Buffer 0 belongs to the thread
+// that created the recorder, which takes part in record() as index 0. Any other thread (a worker
+// of another pool, a second thread calling record()) gets a buffer of its own on first use,
+// handed out under a lock.
+class CommandRecorder
+{
+public:
+    using RecordFunction = std::function<void(CommandBuffer& commands, std::size_t begin, std::size_t end)>;
+
+    struct Stats
+    {
+        std::size_t packets = 0;
+        std::size_t bytes = 0;
+        unsigned int threads = 0;   // that recorded at least one packet
+    };
+
+    explicit CommandRecorder(JobSystem& jobs = JobSystem::get());
+
+    // clears the buffers of all threads, for the next frame
+    void reset();
+
+    // the buffer of the calling thread, for recording outside of record()
+    CommandBuffer& local()
+    {
+        if (jobs.ownsCurrentThread())
+        {
+            return buffers[JobSystem::threadIndex()];
+        }
+        return std::this_thread::get_id() == ownerThread ? buffers[0] : foreignBuffer();
+    }
+
+    // fn on chunks of at most grainSize elements of [0, count), in parallel, each with the
+    // buffer of the thread running it
+    void record(std::size_t count, std::size_t grainSize, const RecordFunction& fn);
+
+    // executes the packets of all buffers in key order; equal keys keep the order of their
+    // buffer, buffers are taken by thread index, then those of other threads in order of first
+    // use. Call from the thread owning the GL context
+    void submit();
+
+    // of the last submit()
+    const Stats& stats() const { return counters; }
+
+private:
+    JobSystem& jobs;
+    std::vector<CommandBuffer> buffers;     // by JobSystem::threadIndex()
+    std::thread::id ownerThread;            // the one non-worker thread using buffers[0]
+
+    // buffers of the other threads; a deque so that handing out one keeps the others in place
+    std::mutex foreignMutex;
+    std::deque<CommandBuffer> foreign;
+    std::vector<std::pair<std::thread::id, CommandBuffer*>> foreignThreads;
+    std::vector<const CommandBuffer::Header*> headers;
+    RenderQueue queue;
+    Stats counters;
+
+    CommandBuffer& foreignBuffer();
+
+    template <typename Fn>
+    void forEachBuffer(Fn fn)
+    {
+        for (CommandBuffer& buffer : buffers)
+            fn(buffer);
+        for (CommandBuffer& buffer : foreign)
+            fn(buffer);
+    }
+};
@@ -0,0 +1,345 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "GeometryArena.h"
+#include "IndirectDraw.h"
+#include "Mesh.h"
+
+// Collects draws of meshes living in the geometry arena of one layout and submits them
+// with one glMultiDrawElementsIndirect per MAX_DRAWS_PER_CALL draws.
+//
+// Per-object data (model matrix, normal matrix, material index) goes into a shader storage
+// buffer indexed by the draw id, so the GL calls per frame don't depend on the number of
+// objects. Several draws may share an object (all meshes of a model, or all visible
+// meshlets of a mesh). Commands and object data are only re-uploaded when they changed;
+// objects changed in place upload just their ranges.
+//
+// Draws added by allocation keep it, and are resolved to offsets again when the arena moved
+// its ranges since (see GeometryArena::generation()). Commands added as they are can't be.
+//
+//   bucket.clear();
+//   bucket.addModel(*model, matrix, 0);
+//   shader->apply();
+//   bucket.submit();
+template <typename Layout>
+class DrawBucket
+{
+public:
+    using Arena = GeometryArena<Layout>;
+
+    // commands per glMultiDrawElementsIndirect, keeps each call's command range bounded
+    static constexpr std::size_t MAX_DRAWS_PER_CALL = 1 << 16;
+
+    DrawBucket() = default;
+    DrawBucket(const DrawBucket&) = delete;
+    DrawBucket& operator=(const DrawBucket&) = delete;
+
+    ~DrawBucket()
+    {
+        if (commandBuffer != 0)
+        {
+            glDeleteBuffers(1, &commandBuffer);
+            glDeleteBuffers(1, &objectBuffer);
+        }
+    }
+
+    void clear()
+    {
+        objects.clear();
+        changedObjects.clear();
+        objectsDirty = true;
+        clearDraws();
+    }
+
+    // drops the draw commands but keeps the objects, for command lists rebuilt every frame
+    void clearDraws()
+    {
+        commands.clear();
+        arenaDraws.clear();
+        commandsDirty = true;
+    }
+
+    // returns the object index, usable with setTransform() and addDraw()
+    std::size_t addObject(const glm::mat4& modelMatrix, GLuint materialIndex = 0)
+    {
+        assert(objects.size() < indirect::MAX_OBJECTS);
+
+        ObjectData object;
+        object.materialIndex = materialIndex;
+        objects.push_back(object);
+        objectsDirty = true;
+
+        const std::size_t index = objects.size() - 1;
+        setTransform(index, modelMatrix);
+        return index;
+    }
+
+    void addDraw(const typename Arena::Allocation& allocation, std::size_t objectIndex)
+    {
+        addDraw(allocation, 0, Arena::get().indexCount(allocation), objectIndex);
+    }
+
+    // one level of detail of a mesh
+    void addDraw(const BasicMesh<Layout>& mesh, std::size_t objectIndex, unsigned int level = 0)
+    {
+        const MeshLod lod = mesh.lod(level);
+        addDraw(mesh.allocation, lod.firstIndex, lod.indexCount, objectIndex);
+    }
+
+    // count indices starting first indices into the allocation
+    void addDraw(const typename Arena::Allocation& allocation, std::size_t first, std::size_t count, std::size_t objectIndex)
+    {
+        // the draws so far are resolved against the arena as it is now, like this one
+        resolve();
+        arenaDraws.push_back(ArenaDraw{ allocation, static_cast<GLuint>(first), commands.size() });
+
+        DrawElementsIndirectCommand command;
+        command.count = static_cast<GLuint>(count);
+        command.instanceCount = 1;
+        command.baseInstance = static_cast<GLuint>(objectIndex); // read back as the draw id
+        commands.push_back(command);
+        resolve(arenaDraws.back());
+        commandsDirty = true;
+    }
+
+    // for commands built elsewhere (e.g. MeshletCuller); baseInstance must be the object index.
+    // Their offsets are used as given, so they have to be rebuilt when the arena generation changes.
+    void addCommand(const DrawElementsIndirectCommand& command)
+    {
+        commands.push_back(command);
+        commandsDirty = true;
+    }
+
+    void addCommands(const std::vector<DrawElementsIndirectCommand>& list)
+    {
+        commands.insert(commands.end(), list.begin(), list.end());
+        commandsDirty = true;
+    }
+
+    // one object with one draw, returns the object index
+    std::size_t add(const typename Arena::Allocation& allocation, const glm::mat4& modelMatrix, GLuint materialIndex = 0)
+    {
+        const std::size_t object = addObject(modelMatrix, materialIndex);
+        addDraw(allocation, object);
+        return object;
+    }
+
+    // one object with a draw per mesh, returns the object index
+    template <typename ModelType>
+    std::size_t addModel(const ModelType& model, const glm::mat4& modelMatrix, GLuint materialIndex = 0, unsigned int level = 0)
+    {
+        const std::size_t object = addObject(modelMatrix, materialIndex);
+        addModelDraws(model, object, level);
+        return object;
+    }
+
+    // a draw per mesh of the model for an existing object
+    template <typename ModelType>
+    void addModelDraws(const ModelType& model, std::size_t objectIndex, unsigned int level = 0)
+    {
+        for (const auto& mesh : model.meshes)
+        {
+            addDraw(mesh, objectIndex, level);
+        }
+    }
+
+    void setTransform(std::size_t objectIndex, const glm::mat4& modelMatrix)
+    {
+        objects[objectIndex].modelMatrix = modelMatrix;
+        objects[objectIndex].normalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(modelMatrix))));
+        markChanged(objectIndex, objectIndex + 1);
+    }
+
+    // count consecutive objects starting at firstObject, e.g. a changed range of a SceneGraph
+    void setTransforms(std::size_t firstObject, const glm::mat4* modelMatrices, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            objects[firstObject + i].modelMatrix = modelMatrices[i];
+            objects[firstObject + i].normalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(modelMatrices[i]))));
+        }
+        markChanged(firstObject, firstObject + count);
+    }
+
+    void setMaterial(std::size_t objectIndex, GLuint materialIndex)
+    {
+        objects[objectIndex].materialIndex = materialIndex;
+        markChanged(objectIndex, objectIndex + 1);
+    }
+
+    // draws everything; expects the program reading ObjectData to be in use
+    void submit()
+    {
+        if (commands.empty())
+        {
+            return;
+        }
+
+        upload();
+
+        Arena::get().bind();
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, indirect::OBJECT_BUFFER_BINDING, objectBuffer);
+        // the draw id comes from baseInstance, so every chunk reads the right objects
+        for (std::size_t first = 0; first < commands.size(); first += MAX_DRAWS_PER_CALL)
+        {
+            const std::size_t count = std::min(MAX_DRAWS_PER_CALL, commands.size() - first);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(first * sizeof(DrawElementsIndirectCommand)),
+                                        static_cast<GLsizei>(count), 0);
+        }
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+
+    // uploads the objects and binds them, for passes that read them without submit() (GpuCuller)
+    void bindObjects()
+    {
+        upload();
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, indirect::OBJECT_BUFFER_BINDING, objectBuffer);
+    }
+
+    // with the offsets of the arena as it is now
+    const std::vector<DrawElementsIndirectCommand>& getCommands()
+    {
+        resolve();
+        return commands;
+    }
+
+    std::size_t objectCount() const { return objects.size(); }
+    std::size_t drawCount() const   { return commands.size(); }
+
+    // GL draw calls issued by submit(), for stats
+    std::size_t drawCalls() const { return (commands.size() + MAX_DRAWS_PER_CALL - 1) / MAX_DRAWS_PER_CALL; }
+
+private:
+    // objects changed since the last upload, as [begin, end) ranges
+    struct ObjectRange
+    {
+        std::size_t begin;
+        std::size_t end;
+    };
+
+    // a command added by allocation, resolved to arena offsets again when they moved
+    struct ArenaDraw
+    {
+        typename Arena::Allocation allocation;
+        GLuint first;           // indices into the allocation
+        std::size_t command;
+    };
+
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<ArenaDraw> arenaDraws;
+    std::uint64_t resolvedGeneration = 0;   // of the arena the offsets of arenaDraws were read from
+    std::vector<ObjectData> objects;
+    std::vector<ObjectRange> changedObjects;
+    bool commandsDirty = true;
+    bool objectsDirty = true;   // objects were added or removed, the buffer is re-created
+
+    GLuint commandBuffer = 0;
+    GLuint objectBuffer = 0;
+
+    void resolve(const ArenaDraw& draw)
+    {
+        const Arena& arena = Arena::get();
+        DrawElementsIndirectCommand& command = commands[draw.command];
+        command.firstIndex = static_cast<GLuint>(arena.firstIndex(draw.allocation) + draw.first);
+        command.baseVertex = arena.baseVertex(draw.allocation);
+    }
+
+    void resolve()
+    {
+        const std::uint64_t generation = Arena::get().generation();
+        if (generation == resolvedGeneration)
+        {
+            return;
+        }
+
+        for (const ArenaDraw& draw : arenaDraws)
+        {
+            resolve(draw);
+        }
+        commandsDirty = commandsDirty || !arenaDraws.empty();
+        resolvedGeneration = generation;
+    }
+
+    void markChanged(std::size_t begin, std::size_t end)
+    {
+        if (objectsDirty)
+        {
+            return;
+        }
+
+        // updates usually walk the objects in order, so most of them extend the last range
+        if (!changedObjects.empty() && begin >= changedObjects.back().begin && begin <= changedObjects.back().end)
+        {
+            changedObjects.back().end = std::max(changedObjects.back().end, end);
+        }
+        else
+        {
+            changedObjects.push_back(ObjectRange{ begin, end });
+        }
+    }
+
+    void upload()
+    {
+        if (commandBuffer == 0)
+        {
+            glGenBuffers(1, &commandBuffer);
+            glGenBuffers(1, &objectBuffer);
+        }
+
+        resolve();
+        if (commandsDirty)
+        {
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_DYNAMIC_DRAW);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+            commandsDirty = false;
+        }
+
+        // transforms usually change every frame while the commands don't, and often only
+        // for some of the objects: those ranges are written into the existing buffer
+        if (objectsDirty)
+        {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, objectBuffer);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, objects.size() * sizeof(ObjectData), objects.data(), GL_DYNAMIC_DRAW);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+            objectsDirty = false;
+        }
+        else if (!changedObjects.empty())
+        {
+            std::sort(changedObjects.begin(), changedObjects.end(), [](const ObjectRange& a, const ObjectRange& b) { return a.begin < b.begin; });
+
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, objectBuffer);
+            std::size_t begin = changedObjects[0].begin;
+            std::size_t end = changedObjects[0].end;
+            for (std::size_t i = 1; i <= changedObjects.size(); ++i)
+            {
+                if (i < changedObjects.size() && changedObjects[i].begin <= end)
+                {
+                    end = std::max(end, changedObjects[i].end);
+                    continue;
+                }
+
+                glBufferSubData(GL_SHADER_STORAGE_BUFFER, begin * sizeof(ObjectData), (end - begin) * sizeof(ObjectData), objects.data() + begin);
+                if (i < changedObjects.size())
+                {
+                    begin = changedObjects[i].begin;
+                    end = changedObjects[i].end;
+                }
+            }
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        }
+        changedObjects.clear();
+    }
+};
@@ -0,0 +1,106 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+// Two snapshots of whatever a frame needs to be drawn, passed from the thread that builds
+// them (simulation) to the one that draws them (see RenderThread), without locks. While the
+// consumer draws frame N from one slot the producer fills frame N+1 into the other, so the
+// producer is at most one frame ahead; a side that gets there first waits for the other.
+//
+//   producer                                consumer
+//   Frame* frame = handoff.beginWrite();    const Frame* frame = handoff.beginRead();
+//   ...fill it...                           ...draw it...
+//   handoff.endWrite();                     handoff.endRead();
+//
+// One producer and one consumer thread. Waiting yields the thread rather than sleeping: the
+// other side is never more than a frame away.
+template <typename Frame>
+class FrameHandoff
+{
+public:
+    FrameHandoff() = default;
+    FrameHandoff(const FrameHandoff&) = delete;
+    FrameHandoff& operator=(const FrameHandoff&) = delete;
+
+    // the slot of the next frame, once the consumer is done with the frame that used it
+    // before; nullptr after close()
+    Frame* beginWrite()
+    {
+        // the slot was last used by frame written - 2, which needs to be consumed
+        if (!waitFor(consumed, written >= 1 ? written - 1 : 0, producerWaits))
+            return nullptr;
+        return &slots[written % 2];
+    }
+
+    void endWrite()
+    {
+        ++written;
+        published.store(written, std::memory_order_release);
+    }
+
+    // the oldest frame not read yet, once published; nullptr after close() with nothing left
+    const Frame* beginRead()
+    {
+        if (!waitFor(published, read + 1, consumerWaits) && published.load(std::memory_order_acquire) <= read)
+            return nullptr;
+        return &slots[read % 2];
+    }
+
+    void endRead()
+    {
+        ++read;
+        consumed.store(read, std::memory_order_release);
+    }
+
+    // wakes up both sides for good
+    void close() { closed.store(true, std::memory_order_release); }
+    bool isClosed() const { return closed.load(std::memory_order_acquire); }
+
+    // starts over at frame 0; only while neither side is using the handoff
+    void reset()
+    {
+        written = read = 0;
+        published.store(0, std::memory_order_relaxed);
+        consumed.store(0, std::memory_order_relaxed);
+        closed.store(false, std::memory_order_release);
+    }
+
+    // frames the producer had to wait for the consumer (it is the bottleneck), and the other way around
+    std::uint64_t producerWaitCount() const { return producerWaits.load(std::memory_order_relaxed); }
+    std::uint64_t consumerWaitCount() const { return consumerWaits.load(std::memory_order_relaxed); }
+
+private:
+    Frame slots[2];
+
+    // frames completed by each side; each is only written by its own side
+    std::atomic<std::uint64_t> published{ 0 };
+    std::atomic<std::uint64_t> consumed{ 0 };
+    std::atomic<bool> closed{ false };
+    std::atomic<std::uint64_t> producerWaits{ 0 };
+    std::atomic<std::uint64_t> consumerWaits{ 0 };
+
+    std::uint64_t written = 0;      // producer only
+    std::uint64_t read = 0;         // consumer only
+
+    // false if closed before counter reached target
+    bool waitFor(const std::atomic<std::uint64_t>& counter, std::uint64_t target, std::atomic<std::uint64_t>& waits)
+    {
+        if (counter.load(std::memory_order_acquire) >= target)
+            return true;
+
+        waits.fetch_add(1, std::memory_order_relaxed);
+        while (counter.load(std::memory_order_acquire) < target)
+        {
+            if (closed.load(std::memory_order_acquire))
+                return false;
+            std::this_thread::yield();
+        }
+        return true;
+    }
+};
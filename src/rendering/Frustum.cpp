@@ -0,0 +1,84 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include "Frustum.h"
+
+#include <initializer_list>
+
+Frustum Frustum::fromMatrix(const glm::mat4& m)
+{
+    // rows of the matrix (glm is column major)
+    const glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    const glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    const glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    const glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    Frustum frustum;
+    frustum.planes[LEFT_PLANE]   = row3 + row0;
+    frustum.planes[RIGHT_PLANE]  = row3 - row0;
+    frustum.planes[BOTTOM_PLANE] = row3 + row1;
+    frustum.planes[TOP_PLANE]    = row3 - row1;
+    frustum.planes[NEAR_PLANE]   = row3 + row2;
+    frustum.planes[FAR_PLANE]    = row3 - row2;
+
+    for (glm::vec4& plane : frustum.planes)
+    {
+        plane /= glm::length(glm::vec3(plane));
+    }
+
+    return frustum;
+}
+
+bool Frustum::intersectsSphere(const glm::vec3& center, float radius) const
+{
+    for (const glm::vec4& plane : planes)
+    {
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+namespace
+{
+    glm::vec3 intersectPlanes(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c)
+    {
+        const glm::vec3 na(a), nb(b), nc(c);
+        const glm::vec3 bc = glm::cross(nb, nc);
+        return -(a.w * bc + b.w * glm::cross(nc, na) + c.w * glm::cross(na, nb)) / glm::dot(na, bc);
+    }
+}
+
+void Frustum::corners(glm::vec3 out[8]) const
+{
+    int i = 0;
+    for (Plane depth : { NEAR_PLANE, FAR_PLANE })
+    {
+        for (Plane vertical : { BOTTOM_PLANE, TOP_PLANE })
+        {
+            for (Plane horizontal : { LEFT_PLANE, RIGHT_PLANE })
+            {
+                out[i++] = intersectPlanes(planes[depth], planes[vertical], planes[horizontal]);
+            }
+        }
+    }
+}
+
+bool Frustum::intersectsAabb(const glm::vec3& min, const glm::vec3& max) const
+{
+    for (const glm::vec4& plane : planes)
+    {
+        // the corner furthest along the plane normal
+        const glm::vec3 p(plane.x >= 0.0f ? max.x : min.x,
+                          plane.y >= 0.0f ? max.y : min.y,
+                          plane.z >= 0.0f ? max.z : min.z);
+        if (glm::dot(glm::vec3(plane), p) + plane.w < 0.0f)
+        {
+            return false;
+        }
+    }
+    return true;
+}
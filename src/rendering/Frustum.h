@@ -0,0 +1,25 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+// View frustum as six inward facing planes (xyz: normal, w: distance), in the space the
+// matrix it was built from transforms out of (world space for projection * view).
+struct Frustum
+{
+    enum Plane { LEFT_PLANE = 0, RIGHT_PLANE, BOTTOM_PLANE, TOP_PLANE, NEAR_PLANE, FAR_PLANE, PLANE_COUNT };
+
+    glm::vec4 planes[PLANE_COUNT];
+
+    // Gribb/Hartmann plane extraction from a (projection * view [* model]) matrix
+    static Frustum fromMatrix(const glm::mat4& m);
+
+    bool intersectsSphere(const glm::vec3& center, float radius) const;
+    bool intersectsAabb(const glm::vec3& min, const glm::vec3& max) const;
+
+    // the 8 corners where near/far meet left/right and bottom/top, near ones first
+    void corners(glm::vec3 out[8]) const;
+};
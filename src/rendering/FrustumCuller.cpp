@@ -0,0 +1,262 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include "FrustumCuller.h"
+
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FRUSTUM_CULLER_AVX 1
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define FRUSTUM_CULLER_SSE 1
+#endif
+
+std::size_t BoundsBatch::add(const Bounds& worldBounds)
+{
+    centerX.push_back(0.0f); centerY.push_back(0.0f); centerZ.push_back(0.0f);
+    radius.push_back(0.0f);
+    extentX.push_back(0.0f); extentY.push_back(0.0f); extentZ.push_back(0.0f);
+
+    const std::size_t index = size() - 1;
+    set(index, worldBounds);
+    return index;
+}
+
+std::size_t BoundsBatch::addSphere(const glm::vec3& center, float r)
+{
+    Bounds bounds;
+    bounds.center = center;
+    bounds.radius = r;
+    bounds.min = center - glm::vec3(r);
+    bounds.max = center + glm::vec3(r);
+    return add(bounds);
+}
+
+void BoundsBatch::set(std::size_t index, const Bounds& worldBounds)
+{
+    // the sphere and the box are tested against their own centers
+    centerX[index] = worldBounds.center.x;
+    centerY[index] = worldBounds.center.y;
+    centerZ[index] = worldBounds.center.z;
+    radius[index] = worldBounds.radius;
+
+    const glm::vec3 boxCenter = 0.5f * (worldBounds.min + worldBounds.max);
+    const glm::vec3 extents = worldBounds.extents() + glm::abs(boxCenter - worldBounds.center);
+    extentX[index] = extents.x;
+    extentY[index] = extents.y;
+    extentZ[index] = extents.z;
+}
+
+void BoundsBatch::clear()
+{
+    centerX.clear(); centerY.clear(); centerZ.clear();
+    radius.clear();
+    extentX.clear(); extentY.clear(); extentZ.clear();
+}
+
+void BoundsBatch::reserve(std::size_t count)
+{
+    centerX.reserve(count); centerY.reserve(count); centerZ.reserve(count);
+    radius.reserve(count);
+    extentX.reserve(count); extentY.reserve(count); extentZ.reserve(count);
+}
+
+namespace
+{
+    // scalar tests for the entries left over after the SIMD loop
+
+    bool sphereVisible(const Frustum& frustum, const BoundsBatch& batch, std::size_t i)
+    {
+        const glm::vec3 center(batch.centerX[i], batch.centerY[i], batch.centerZ[i]);
+        return frustum.intersectsSphere(center, batch.radius[i]);
+    }
+
+    bool boxVisible(const Frustum& frustum, const BoundsBatch& batch, std::size_t i)
+    {
+        for (const glm::vec4& plane : frustum.planes)
+        {
+            const float distance = plane.x * batch.centerX[i] + plane.y * batch.centerY[i] + plane.z * batch.centerZ[i] + plane.w;
+            const float reach = std::fabs(plane.x) * batch.extentX[i] + std::fabs(plane.y) * batch.extentY[i] + std::fabs(plane.z) * batch.extentZ[i];
+            if (distance < -reach)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+std::size_t FrustumCuller::cullSpheres(const BoundsBatch& batch, std::vector<unsigned char>& visible)
+{
+    const std::size_t count = batch.size();
+    visible.resize(count);
+
+    std::size_t i = 0;
+    std::size_t visibleCount = 0;
+
+#if defined(FRUSTUM_CULLER_AVX)
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m256 cx = _mm256_loadu_ps(&batch.centerX[i]);
+        const __m256 cy = _mm256_loadu_ps(&batch.centerY[i]);
+        const __m256 cz = _mm256_loadu_ps(&batch.centerZ[i]);
+        const __m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&batch.radius[i]));
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (const glm::vec4& plane : frustum.planes)
+        {
+            __m256 distance = _mm256_add_ps(_mm256_mul_ps(cx, _mm256_set1_ps(plane.x)), _mm256_set1_ps(plane.w));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(cy, _mm256_set1_ps(plane.y)));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(cz, _mm256_set1_ps(plane.z)));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+        }
+
+        const int mask = _mm256_movemask_ps(inside);
+        for (int k = 0; k < 8; ++k)
+        {
+            visible[i + k] = (mask >> k) & 1;
+            visibleCount += visible[i + k];
+        }
+    }
+#elif defined(FRUSTUM_CULLER_SSE)
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128 cx = _mm_loadu_ps(&batch.centerX[i]);
+        const __m128 cy = _mm_loadu_ps(&batch.centerY[i]);
+        const __m128 cz = _mm_loadu_ps(&batch.centerZ[i]);
+        const __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&batch.radius[i]));
+
+        __m128 inside = _mm_cmpeq_ps(cx, cx);
+        for (const glm::vec4& plane : frustum.planes)
+        {
+            __m128 distance = _mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(plane.x)), _mm_set1_ps(plane.w));
+            distance = _mm_add_ps(distance, _mm_mul_ps(cy, _mm_set1_ps(plane.y)));
+            distance = _mm_add_ps(distance, _mm_mul_ps(cz, _mm_set1_ps(plane.z)));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+        }
+
+        const int mask = _mm_movemask_ps(inside);
+        for (int k = 0; k < 4; ++k)
+        {
+            visible[i + k] = (mask >> k) & 1;
+            visibleCount += visible[i + k];
+        }
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        visible[i] = sphereVisible(frustum, batch, i) ? 1 : 0;
+        visibleCount += visible[i];
+    }
+
+    accumulate(count, visibleCount);
+    return visibleCount;
+}
+
+std::size_t FrustumCuller::cullBoxes(const BoundsBatch& batch, std::vector<unsigned char>& visible)
+{
+    const std::size_t count = batch.size();
+    visible.resize(count);
+
+    std::size_t i = 0;
+    std::size_t visibleCount = 0;
+
+#if defined(FRUSTUM_CULLER_AVX)
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m256 cx = _mm256_loadu_ps(&batch.centerX[i]);
+        const __m256 cy = _mm256_loadu_ps(&batch.centerY[i]);
+        const __m256 cz = _mm256_loadu_ps(&batch.centerZ[i]);
+        const __m256 ex = _mm256_loadu_ps(&batch.extentX[i]);
+        const __m256 ey = _mm256_loadu_ps(&batch.extentY[i]);
+        const __m256 ez = _mm256_loadu_ps(&batch.extentZ[i]);
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (const glm::vec4& plane : frustum.planes)
+        {
+            __m256 distance = _mm256_add_ps(_mm256_mul_ps(cx, _mm256_set1_ps(plane.x)), _mm256_set1_ps(plane.w));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(cy, _mm256_set1_ps(plane.y)));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(cz, _mm256_set1_ps(plane.z)));
+
+            // the box reaches |n| . extents towards the plane
+            __m256 reach = _mm256_mul_ps(ex, _mm256_set1_ps(std::fabs(plane.x)));
+            reach = _mm256_add_ps(reach, _mm256_mul_ps(ey, _mm256_set1_ps(std::fabs(plane.y))));
+            reach = _mm256_add_ps(reach, _mm256_mul_ps(ez, _mm256_set1_ps(std::fabs(plane.z))));
+
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, _mm256_xor_ps(reach, signMask), _CMP_GE_OQ));
+        }
+
+        const int mask = _mm256_movemask_ps(inside);
+        for (int k = 0; k < 8; ++k)
+        {
+            visible[i + k] = (mask >> k) & 1;
+            visibleCount += visible[i + k];
+        }
+    }
+#elif defined(FRUSTUM_CULLER_SSE)
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128 cx = _mm_loadu_ps(&batch.centerX[i]);
+        const __m128 cy = _mm_loadu_ps(&batch.centerY[i]);
+        const __m128 cz = _mm_loadu_ps(&batch.centerZ[i]);
+        const __m128 ex = _mm_loadu_ps(&batch.extentX[i]);
+        const __m128 ey = _mm_loadu_ps(&batch.extentY[i]);
+        const __m128 ez = _mm_loadu_ps(&batch.extentZ[i]);
+
+        __m128 inside = _mm_cmpeq_ps(cx, cx);
+        for (const glm::vec4& plane : frustum.planes)
+        {
+            __m128 distance = _mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(plane.x)), _mm_set1_ps(plane.w));
+            distance = _mm_add_ps(distance, _mm_mul_ps(cy, _mm_set1_ps(plane.y)));
+            distance = _mm_add_ps(distance, _mm_mul_ps(cz, _mm_set1_ps(plane.z)));
+
+            // the box reaches |n| . extents towards the plane
+            __m128 reach = _mm_mul_ps(ex, _mm_set1_ps(std::fabs(plane.x)));
+            reach = _mm_add_ps(reach, _mm_mul_ps(ey, _mm_set1_ps(std::fabs(plane.y))));
+            reach = _mm_add_ps(reach, _mm_mul_ps(ez, _mm_set1_ps(std::fabs(plane.z))));
+
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_xor_ps(reach, signMask)));
+        }
+
+        const int mask = _mm_movemask_ps(inside);
+        for (int k = 0; k < 4; ++k)
+        {
+            visible[i + k] = (mask >> k) & 1;
+            visibleCount += visible[i + k];
+        }
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        visible[i] = boxVisible(frustum, batch, i) ? 1 : 0;
+        visibleCount += visible[i];
+    }
+
+    accumulate(count, visibleCount);
+    return visibleCount;
+}
+
+const char* FrustumCuller::simdName()
+{
+#if defined(FRUSTUM_CULLER_AVX)
+    return "AVX";
+#elif defined(FRUSTUM_CULLER_SSE)
+    return "SSE";
+#else
+    return "scalar";
+#endif
+}
+
+void FrustumCuller::accumulate(std::size_t tested, std::size_t visibleCount)
+{
+    counters.tested += tested;
+    counters.visible += visibleCount;
+    counters.culled += tested - visibleCount;
+}
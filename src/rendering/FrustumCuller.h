@@ -0,0 +1,67 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+#include "Bounds.h"
+#include "Frustum.h"
+
+// World space bounding spheres and boxes in structure-of-arrays form, so the culler can
+// test 4 (SSE) or 8 (AVX, when built with ENABLE_AVX) of them per instruction.
+struct BoundsBatch
+{
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> radius;
+    std::vector<float> extentX, extentY, extentZ;   // half size of the box around the center
+
+    // returns the index of the entry
+    std::size_t add(const Bounds& worldBounds);
+    std::size_t addSphere(const glm::vec3& center, float radius);
+
+    void set(std::size_t index, const Bounds& worldBounds);
+
+    void clear();
+    void reserve(std::size_t count);
+    std::size_t size() const { return centerX.size(); }
+};
+
+// Batch frustum culler. visible[i] is set to 1 for the entries intersecting the frustum and
+// 0 for the others; the counts are accumulated into stats() until resetStats(), typically
+// once per frame.
+class FrustumCuller
+{
+public:
+    struct Stats
+    {
+        std::size_t tested = 0;
+        std::size_t visible = 0;
+        std::size_t culled = 0;
+    };
+
+    void setFrustum(const Frustum& frustum) { this->frustum = frustum; }
+    const Frustum& getFrustum() const { return frustum; }
+
+    // sphere test, cheaper but looser than the box test. Returns the number of visible entries.
+    std::size_t cullSpheres(const BoundsBatch& batch, std::vector<unsigned char>& visible);
+
+    // box test, tighter for long thin objects
+    std::size_t cullBoxes(const BoundsBatch& batch, std::vector<unsigned char>& visible);
+
+    void resetStats() { counters = Stats(); }
+    const Stats& stats() const { return counters; }
+
+    // which instruction set the batch tests were compiled for
+    static const char* simdName();
+
+private:
+    Frustum frustum;
+    Stats counters;
+
+    void accumulate(std::size_t tested, std::size_t visible);
+};
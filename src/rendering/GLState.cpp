@@ -0,0 +1,271 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include "GLState.h"
+
+GLState& GLState::get()
+{
+    static GLState state;
+    return state;
+}
+
+void GLState::invalidate()
+{
+    program = UNKNOWN;
+    vertexArray = UNKNOWN;
+    activeUnit = UNKNOWN;
+    for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; ++unit)
+    {
+        for (unsigned int target = 0; target < TEXTURE_TARGETS; ++target)
+            textures[unit][target] = UNKNOWN;
+        samplers[unit] = UNKNOWN;
+    }
+    drawFramebuffer = UNKNOWN;
+    readFramebuffer = UNKNOWN;
+    viewportKnown = false;
+    for (unsigned int i = 0; i < CAPABILITIES; ++i)
+        capabilities[i] = -1;
+    blendSource = UNKNOWN;
+    blendDestination = UNKNOWN;
+    depthFunction = UNKNOWN;
+    depthWrites = UNKNOWN;
+    culledFace = UNKNOWN;
+}
+
+bool GLState::change(GLuint& current, GLuint value)
+{
+    if (current == value)
+    {
+        ++counters.elided;
+        return false;
+    }
+    current = value;
+    ++counters.issued;
+    return true;
+}
+
+int GLState::targetIndex(GLenum target)
+{
+    switch (target)
+    {
+    case GL_TEXTURE_2D:       return 0;
+    case GL_TEXTURE_CUBE_MAP: return 1;
+    case GL_TEXTURE_2D_ARRAY: return 2;
+    case GL_TEXTURE_3D:       return 3;
+    default:                  return -1;
+    }
+}
+
+int GLState::capabilityIndex(GLenum capability)
+{
+    switch (capability)
+    {
+    case GL_BLEND:        return 0;
+    case GL_DEPTH_TEST:   return 1;
+    case GL_CULL_FACE:    return 2;
+    case GL_SCISSOR_TEST: return 3;
+    case GL_STENCIL_TEST: return 4;
+    default:              return -1;
+    }
+}
+
+void GLState::useProgram(GLuint newProgram)
+{
+    if (change(program, newProgram))
+        glUseProgram(newProgram);
+}
+
+void GLState::bindVertexArray(GLuint newVertexArray)
+{
+    if (change(vertexArray, newVertexArray))
+        glBindVertexArray(newVertexArray);
+}
+
+void GLState::activeTexture(GLenum textureUnit)
+{
+    if (change(activeUnit, textureUnit - GL_TEXTURE0))
+        glActiveTexture(textureUnit);
+}
+
+void GLState::bindTexture(GLenum target, GLuint texture)
+{
+    const int index = targetIndex(target);
+    if (index < 0 || activeUnit >= MAX_TEXTURE_UNITS)
+    {
+        ++counters.issued;
+        glBindTexture(target, texture);
+        return;
+    }
+
+    if (change(textures[activeUnit][index], texture))
+        glBindTexture(target, texture);
+}
+
+void GLState::bindTextureUnit(unsigned int unit, GLenum target, GLuint texture)
+{
+    const int index = targetIndex(target);
+    if (index >= 0 && unit < MAX_TEXTURE_UNITS && textures[unit][index] == texture)
+    {
+        // already there, whichever unit is active
+        ++counters.elided;
+        return;
+    }
+
+    activeTexture(GL_TEXTURE0 + unit);
+    bindTexture(target, texture);
+}
+
+void GLState::bindSampler(unsigned int unit, GLuint sampler)
+{
+    if (unit >= MAX_TEXTURE_UNITS)
+    {
+        ++counters.issued;
+        glBindSampler(unit, sampler);
+        return;
+    }
+
+    if (change(samplers[unit], sampler))
+        glBindSampler(unit, sampler);
+}
+
+void GLState::bindFramebuffer(GLenum target, GLuint framebuffer)
+{
+    if (target == GL_FRAMEBUFFER)
+    {
+        if (drawFramebuffer == framebuffer && readFramebuffer == framebuffer)
+        {
+            ++counters.elided;
+            return;
+        }
+        drawFramebuffer = framebuffer;
+        readFramebuffer = framebuffer;
+        ++counters.issued;
+        glBindFramebuffer(target, framebuffer);
+    }
+    else if (change(target == GL_DRAW_FRAMEBUFFER ? drawFramebuffer : readFramebuffer, framebuffer))
+    {
+        glBindFramebuffer(target, framebuffer);
+    }
+}
+
+void GLState::viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    if (viewportKnown && viewportRect[0] == x && viewportRect[1] == y && viewportRect[2] == width && viewportRect[3] == height)
+    {
+        ++counters.elided;
+        return;
+    }
+
+    viewportRect[0] = x;
+    viewportRect[1] = y;
+    viewportRect[2] = width;
+    viewportRect[3] = height;
+    viewportKnown = true;
+    ++counters.issued;
+    glViewport(x, y, width, height);
+}
+
+void GLState::enable(GLenum capability)
+{
+    const int index = capabilityIndex(capability);
+    if (index >= 0 && capabilities[index] == 1)
+    {
+        ++counters.elided;
+        return;
+    }
+
+    if (index >= 0)
+        capabilities[index] = 1;
+    ++counters.issued;
+    glEnable(capability);
+}
+
+void GLState::disable(GLenum capability)
+{
+    const int index = capabilityIndex(capability);
+    if (index >= 0 && capabilities[index] == 0)
+    {
+        ++counters.elided;
+        return;
+    }
+
+    if (index >= 0)
+        capabilities[index] = 0;
+    ++counters.issued;
+    glDisable(capability);
+}
+
+void GLState::blendFunc(GLenum source, GLenum destination)
+{
+    if (blendSource == source && blendDestination == destination)
+    {
+        ++counters.elided;
+        return;
+    }
+
+    blendSource = source;
+    blendDestination = destination;
+    ++counters.issued;
+    glBlendFunc(source, destination);
+}
+
+void GLState::depthFunc(GLenum function)
+{
+    if (change(depthFunction, function))
+        glDepthFunc(function);
+}
+
+void GLState::depthMask(GLboolean mask)
+{
+    if (change(depthWrites, mask ? 1u : 0u))
+        glDepthMask(mask);
+}
+
+void GLState::cullFace(GLenum mode)
+{
+    if (change(culledFace, mode))
+        glCullFace(mode);
+}
+
+void GLState::forgetProgram(GLuint deleted)
+{
+    if (program == deleted)
+        program = UNKNOWN;
+}
+
+void GLState::forgetVertexArray(GLuint deleted)
+{
+    if (vertexArray == deleted)
+        vertexArray = UNKNOWN;
+}
+
+void GLState::forgetTexture(GLuint deleted)
+{
+    // GL unbinds a deleted texture from every unit
+    for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; ++unit)
+    {
+        for (unsigned int target = 0; target < TEXTURE_TARGETS; ++target)
+        {
+            if (textures[unit][target] == deleted)
+                textures[unit][target] = UNKNOWN;
+        }
+    }
+}
+
+void GLState::forgetSampler(GLuint deleted)
+{
+    for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; ++unit)
+    {
+        if (samplers[unit] == deleted)
+            samplers[unit] = UNKNOWN;
+    }
+}
+
+void GLState::forgetFramebuffer(GLuint deleted)
+{
+    if (drawFramebuffer == deleted)
+        drawFramebuffer = UNKNOWN;
+    if (readFramebuffer == deleted)
+        readFramebuffer = UNKNOWN;
+}
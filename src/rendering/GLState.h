@@ -0,0 +1,104 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+// Shadow copy of the GL state the renderer keeps switching: program, vertex array, textures
+// and samplers per unit, framebuffers, viewport, and the blend / depth / cull state. Every
+// setter compares with the shadow copy and only calls GL when the value changes; the calls
+// issued and skipped are counted until the next beginFrame().
+//
+// The setters mirror the GL calls they stand for, so glBindVertexArray(vao) becomes
+// GLState::get().bindVertexArray(vao). The shadow copy is only right as long as the state
+// isn't changed behind its back: code calling GL directly for one of these has to go through
+// here too, or call invalidate() after. Deleted objects have to be forgotten, as GL reuses
+// their names (Shader, Texture and the rendering classes do this themselves).
+// Everything starts out unknown, so the first call of each setter always reaches GL.
+class GLState
+{
+public:
+    static constexpr unsigned int MAX_TEXTURE_UNITS = 16;
+
+    struct Stats
+    {
+        std::size_t issued = 0;     // calls that reached GL
+        std::size_t elided = 0;     // calls skipped, the state was already set
+    };
+
+    // the state of the current context; single threaded, like the context
+    static GLState& get();
+
+    // resets the counters
+    void beginFrame() { counters = Stats(); }
+    const Stats& stats() const { return counters; }
+
+    // forgets everything, for after code that changed the state directly
+    void invalidate();
+
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vertexArray);
+
+    // unit is 0-based (GL_TEXTURE0 + unit); unit-less overloads act on the active unit
+    void activeTexture(GLenum textureUnit);
+    void bindTexture(GLenum target, GLuint texture);
+    void bindTextureUnit(unsigned int unit, GLenum target, GLuint texture);
+    void bindSampler(unsigned int unit, GLuint sampler);
+
+    // GL_FRAMEBUFFER binds both the draw and the read framebuffer
+    void bindFramebuffer(GLenum target, GLuint framebuffer);
+    void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+    // capabilities other than blend, depth test, cull face, scissor and stencil test go straight to GL
+    void enable(GLenum capability);
+    void disable(GLenum capability);
+    void setEnabled(GLenum capability, bool enabled) { enabled ? enable(capability) : disable(capability); }
+    void blendFunc(GLenum source, GLenum destination);
+    void depthFunc(GLenum function);
+    void depthMask(GLboolean mask);
+    void cullFace(GLenum mode);
+
+    // called when the objects are deleted
+    void forgetProgram(GLuint program);
+    void forgetVertexArray(GLuint vertexArray);
+    void forgetTexture(GLuint texture);
+    void forgetSampler(GLuint sampler);
+    void forgetFramebuffer(GLuint framebuffer);
+
+private:
+    static constexpr GLuint UNKNOWN = ~0u;
+    static constexpr unsigned int TEXTURE_TARGETS = 4;  // 2D, cube map, 2D array, 3D
+    static constexpr unsigned int CAPABILITIES = 5;     // blend, depth test, cull face, scissor test, stencil test
+
+    GLuint program = UNKNOWN;
+    GLuint vertexArray = UNKNOWN;
+    GLuint activeUnit = UNKNOWN;
+    GLuint textures[MAX_TEXTURE_UNITS][TEXTURE_TARGETS];
+    GLuint samplers[MAX_TEXTURE_UNITS];
+    GLuint drawFramebuffer = UNKNOWN;
+    GLuint readFramebuffer = UNKNOWN;
+    GLint viewportRect[4];
+    bool viewportKnown = false;
+    signed char capabilities[CAPABILITIES];     // -1 unknown, 0 disabled, 1 enabled
+    GLenum blendSource = UNKNOWN;
+    GLenum blendDestination = UNKNOWN;
+    GLenum depthFunction = UNKNOWN;
+    GLuint depthWrites = UNKNOWN;
+    GLenum culledFace = UNKNOWN;
+
+    Stats counters;
+
+    GLState() { invalidate(); }
+    GLState(const GLState&) = delete;
+    GLState& operator=(const GLState&) = delete;
+
+    // true, and counted as issued, when current differs from value; current is updated
+    bool change(GLuint& current, GLuint value);
+
+    static int targetIndex(GLenum target);
+    static int capabilityIndex(GLenum capability);
+};
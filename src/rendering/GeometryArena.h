@@ -0,0 +1,265 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "GLState.h"
+#include "IndirectDraw.h"
+#include "RangeAllocator.h"
+
+// One large vertex buffer and one large index buffer per VertexLayout, shared by every
+// mesh of that layout. Meshes own ranges of the two buffers and are drawn with
+// glDrawElementsBaseVertex from the single VAO of the arena, so drawing any number of
+// meshes of the same layout only needs one VAO bind.
+//
+// Index values stay relative to the mesh's first vertex, which means vertex ranges can be
+// moved around (growth, defragmentation) without touching the index data.
+template <typename Layout>
+class GeometryArena
+{
+public:
+    using Vertex = typename Layout::Vertex;
+
+    struct Allocation
+    {
+        RangeAllocator::Handle vertices = RangeAllocator::InvalidHandle;
+        RangeAllocator::Handle indices = RangeAllocator::InvalidHandle;
+
+        bool valid() const { return vertices != RangeAllocator::InvalidHandle; }
+    };
+
+    static GeometryArena& get()
+    {
+        static GeometryArena arena;
+        return arena;
+    }
+
+    Allocation upload(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+    {
+        return upload(vertices.data(), vertices.size(), indices.data(), indices.size());
+    }
+
+    // for data that doesn't live in vectors, e.g. pages of a streamed mesh
+    Allocation upload(const Vertex* vertices, std::size_t vertexCount, const unsigned int* indices, std::size_t indexCount)
+    {
+        Allocation allocation;
+        if (vertexCount == 0 || indexCount == 0)
+        {
+            return allocation;
+        }
+
+        if (VAO == 0)
+        {
+            createBuffers(std::max<std::size_t>(INITIAL_VERTICES, vertexCount),
+                          std::max<std::size_t>(INITIAL_INDICES, indexCount));
+        }
+
+        allocation.vertices = allocateRange(vertexRanges, VBO, sizeof(Vertex), vertexCount);
+        allocation.indices  = allocateRange(indexRanges, EBO, sizeof(unsigned int), indexCount);
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, vertexRanges.offset(allocation.vertices) * sizeof(Vertex), vertexCount * sizeof(Vertex), vertices);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, indexRanges.offset(allocation.indices) * sizeof(unsigned int), indexCount * sizeof(unsigned int), indices);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        return allocation;
+    }
+
+    void release(Allocation& allocation)
+    {
+        if (!allocation.valid())
+        {
+            return;
+        }
+
+        vertexRanges.free(allocation.vertices);
+        indexRanges.free(allocation.indices);
+        allocation = Allocation();
+    }
+
+    void bind() const
+    {
+        GLState::get().bindVertexArray(VAO);
+    }
+
+    // expects the arena to be bound
+    void draw(const Allocation& allocation, GLenum mode = GL_TRIANGLES) const
+    {
+        drawRange(allocation, 0, indexCount(allocation), mode);
+    }
+
+    // draws count indices starting first indices into the allocation (e.g. one LOD of a mesh)
+    void drawRange(const Allocation& allocation, std::size_t first, std::size_t count, GLenum mode = GL_TRIANGLES) const
+    {
+        glDrawElementsBaseVertex(mode,
+                                 static_cast<GLsizei>(count),
+                                 GL_UNSIGNED_INT,
+                                 (void*)((firstIndex(allocation) + first) * sizeof(unsigned int)),
+                                 baseVertex(allocation));
+    }
+
+    // the same range instanceCount times, for shaders reading per-instance data (see InstanceBuffer).
+    // instanceCount is bounded by indirect::MAX_OBJECTS, the size of the draw id attribute of the VAO
+    void drawRangeInstanced(const Allocation& allocation, std::size_t first, std::size_t count, std::size_t instanceCount, GLenum mode = GL_TRIANGLES) const
+    {
+        assert(instanceCount <= indirect::MAX_OBJECTS);
+        glDrawElementsInstancedBaseVertex(mode,
+                                          static_cast<GLsizei>(count),
+                                          GL_UNSIGNED_INT,
+                                          (void*)((firstIndex(allocation) + first) * sizeof(unsigned int)),
+                                          static_cast<GLsizei>(instanceCount),
+                                          baseVertex(allocation));
+    }
+
+    GLint baseVertex(const Allocation& allocation) const      { return static_cast<GLint>(vertexRanges.offset(allocation.vertices)); }
+    std::size_t firstIndex(const Allocation& allocation) const { return indexRanges.offset(allocation.indices); }
+    std::size_t indexCount(const Allocation& allocation) const { return indexRanges.size(allocation.indices); }
+    std::size_t vertexCount(const Allocation& allocation) const { return vertexRanges.size(allocation.vertices); }
+
+    // compacts both buffers so all free space ends up at the back
+    void defragment()
+    {
+        compact(vertexRanges, VBO, sizeof(Vertex));
+        compact(indexRanges, EBO, sizeof(unsigned int));
+    }
+
+    // changes whenever existing ranges are moved (defragmentation, also by upload() running out of
+    // space), so offsets read from the arena before are stale. Growing alone keeps the offsets.
+    std::uint64_t generation() const { return rangeGeneration; }
+
+    GLuint vertexArray() const   { return VAO; }
+    GLuint vertexBuffer() const  { return VBO; }
+    GLuint indexBuffer() const   { return EBO; }
+
+    const RangeAllocator& vertexAllocator() const { return vertexRanges; }
+    const RangeAllocator& indexAllocator() const  { return indexRanges; }
+
+private:
+    static constexpr std::size_t INITIAL_VERTICES = 1 << 16;
+    static constexpr std::size_t INITIAL_INDICES  = 3 << 16;
+
+    GLuint VAO = 0, VBO = 0, EBO = 0;
+    RangeAllocator vertexRanges;
+    RangeAllocator indexRanges;
+    std::uint64_t rangeGeneration = 0;
+
+    GeometryArena() = default;
+    GeometryArena(const GeometryArena&) = delete;
+    GeometryArena& operator=(const GeometryArena&) = delete;
+
+    void createBuffers(std::size_t vertexCapacity, std::size_t indexCapacity)
+    {
+        VBO = createBuffer(vertexCapacity * sizeof(Vertex));
+        EBO = createBuffer(indexCapacity * sizeof(unsigned int));
+        vertexRanges.grow(vertexCapacity);
+        indexRanges.grow(indexCapacity);
+
+        glGenVertexArrays(1, &VAO);
+        attachBuffers();
+    }
+
+    static GLuint createBuffer(std::size_t bytes)
+    {
+        GLuint buffer;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, bytes, nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        return buffer;
+    }
+
+    void attachBuffers()
+    {
+        GLState::get().bindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        Layout::setup();
+        // lets multi-draw-indirect submissions find their per-draw data (see DrawBucket)
+        indirect::setupDrawIdAttribute();
+        GLState::get().bindVertexArray(0);
+    }
+
+    // allocates count elements, defragmenting or growing the buffer when needed
+    RangeAllocator::Handle allocateRange(RangeAllocator& ranges, GLuint& buffer, std::size_t elementSize, std::size_t count)
+    {
+        RangeAllocator::Handle handle = ranges.allocate(count);
+        if (handle != RangeAllocator::InvalidHandle)
+        {
+            return handle;
+        }
+
+        // enough space in total, just not in one piece
+        if (ranges.capacity() - ranges.used() >= count)
+        {
+            compact(ranges, buffer, elementSize);
+            handle = ranges.allocate(count);
+            if (handle != RangeAllocator::InvalidHandle)
+            {
+                return handle;
+            }
+        }
+
+        std::size_t newCapacity = ranges.capacity() * 2;
+        while (newCapacity - ranges.used() < count)
+        {
+            newCapacity *= 2;
+        }
+
+        GLuint grown = createBuffer(newCapacity * elementSize);
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, ranges.capacity() * elementSize);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glDeleteBuffers(1, &buffer);
+
+        buffer = grown;
+        ranges.grow(newCapacity);
+        attachBuffers();
+
+        return ranges.allocate(count);
+    }
+
+    // copies every live range to its compacted offset in a fresh buffer; glCopyBufferSubData
+    // can't be used in place since source and destination of a move may overlap
+    void compact(RangeAllocator& ranges, GLuint& buffer, std::size_t elementSize)
+    {
+        std::vector<RangeAllocator::Move> moves = ranges.defragment();
+        if (moves.empty())
+        {
+            return;
+        }
+        ++rangeGeneration;
+
+        GLuint packed = createBuffer(ranges.capacity() * elementSize);
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, packed);
+
+        // the ranges before the first move kept their place
+        if (moves.front().dstOffset > 0)
+        {
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, moves.front().dstOffset * elementSize);
+        }
+        for (const RangeAllocator::Move& move : moves)
+        {
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                                move.srcOffset * elementSize, move.dstOffset * elementSize, move.size * elementSize);
+        }
+
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glDeleteBuffers(1, &buffer);
+
+        buffer = packed;
+        attachBuffers();
+    }
+};
@@ -0,0 +1,502 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include "GlbFile.h"
+
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+
+#include "Json.h"
+#include "MeshoptDecoder.h"
+#include "Parallel.h"
+
+namespace
+{
+    const std::uint32_t GLB_MAGIC = 0x46546C67;     // "glTF"
+    const std::uint32_t CHUNK_JSON = 0x4E4F534A;    // "JSON"
+    const std::uint32_t CHUNK_BIN = 0x004E4942;     // "BIN\0"
+
+    const char* const MESHOPT = "EXT_meshopt_compression";
+
+    std::uint32_t readU32(const char* p)
+    {
+        std::uint32_t value;
+        std::memcpy(&value, p, 4);
+        return value;
+    }
+
+    std::size_t componentSize(unsigned int componentType)
+    {
+        switch (componentType)
+        {
+        case GL_BYTE:
+        case GL_UNSIGNED_BYTE: return 1;
+        case GL_SHORT:
+        case GL_UNSIGNED_SHORT: return 2;
+        case GL_UNSIGNED_INT:
+        case GL_FLOAT: return 4;
+        default: return 0;
+        }
+    }
+
+    unsigned int componentCount(const std::string& type)
+    {
+        if (type == "SCALAR") return 1;
+        if (type == "VEC2") return 2;
+        if (type == "VEC3") return 3;
+        if (type == "VEC4") return 4;
+        if (type == "MAT2") return 4;
+        if (type == "MAT3") return 9;
+        if (type == "MAT4") return 16;
+        return 0;
+    }
+
+    template <typename T>
+    T load(const unsigned char* p)
+    {
+        T value;
+        std::memcpy(&value, p, sizeof(T));
+        return value;
+    }
+
+    glm::mat4 localTransform(const JsonValue& node)
+    {
+        const JsonValue& matrix = node["matrix"];
+        if (matrix.size() == 16)
+        {
+            // column major, like glm
+            glm::mat4 m;
+            for (int i = 0; i < 16; ++i)
+                glm::value_ptr(m)[i] = static_cast<float>(matrix[i].asNumber());
+            return m;
+        }
+
+        const JsonValue& t = node["translation"];
+        const JsonValue& r = node["rotation"];
+        const JsonValue& s = node["scale"];
+        const glm::vec3 translation(t[0].asNumber(), t[1].asNumber(), t[2].asNumber());
+        const glm::quat rotation(static_cast<float>(r[3].asNumber(1.0)), static_cast<float>(r[0].asNumber()),
+                                 static_cast<float>(r[1].asNumber()), static_cast<float>(r[2].asNumber()));
+        const glm::vec3 scale(s[0].asNumber(1.0), s[1].asNumber(1.0), s[2].asNumber(1.0));
+
+        return glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
+    }
+}
+
+bool GlbAccessor::isFloat() const
+{
+    return componentType == GL_FLOAT;
+}
+
+glm::vec4 GlbAccessor::get(std::size_t i) const
+{
+    glm::vec4 value(0.0f, 0.0f, 0.0f, 1.0f);
+    const unsigned char* element = data + i * stride;
+    for (unsigned int k = 0; k < components && k < 4; ++k)
+    {
+        float v = 0.0f;
+        switch (componentType)
+        {
+        case GL_FLOAT:          v = load<float>(element + k * 4); break;
+        case GL_BYTE:           v = load<std::int8_t>(element + k);  v = normalized ? std::max(v / 127.0f, -1.0f) : v; break;
+        case GL_UNSIGNED_BYTE:  v = load<std::uint8_t>(element + k); v = normalized ? v / 255.0f : v; break;
+        case GL_SHORT:          v = load<std::int16_t>(element + k * 2);  v = normalized ? std::max(v / 32767.0f, -1.0f) : v; break;
+        case GL_UNSIGNED_SHORT: v = load<std::uint16_t>(element + k * 2); v = normalized ? v / 65535.0f : v; break;
+        case GL_UNSIGNED_INT:   v = static_cast<float>(load<std::uint32_t>(element + k * 4)); break;
+        }
+        value[k] = v;
+    }
+    return value;
+}
+
+unsigned int GlbAccessor::getIndex(std::size_t i) const
+{
+    const unsigned char* element = data + i * stride;
+    switch (componentType)
+    {
+    case GL_UNSIGNED_BYTE:  return load<std::uint8_t>(element);
+    case GL_UNSIGNED_SHORT: return load<std::uint16_t>(element);
+    case GL_UNSIGNED_INT:   return load<std::uint32_t>(element);
+    default:                return 0;
+    }
+}
+
+void GlbAccessor::copyFloats(unsigned char* out, std::size_t outStride, unsigned int wanted) const
+{
+    if (isFloat() && components >= wanted)
+    {
+        const std::size_t bytes = wanted * sizeof(float);
+        if (stride == bytes && outStride == bytes)
+        {
+            std::memcpy(out, data, count * bytes);
+            return;
+        }
+        for (std::size_t i = 0; i < count; ++i)
+            std::memcpy(out + i * outStride, data + i * stride, bytes);
+        return;
+    }
+
+    // quantized or fewer components
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const glm::vec4 value = get(i);
+        float floats[4] = { value.x, value.y, value.z, value.w };
+        for (unsigned int k = components; k < 4; ++k)
+            floats[k] = 0.0f;
+        std::memcpy(out + i * outStride, floats, wanted * sizeof(float));
+    }
+}
+
+const GlbAccessor* GlbPrimitive::attribute(const std::string& semantic) const
+{
+    const auto it = attributes.find(semantic);
+    return it != attributes.end() ? &it->second : nullptr;
+}
+
+void GlbPrimitive::copy(const std::string& semantic, unsigned char* first, std::size_t stride, unsigned int components, const float* fallback) const
+{
+    const GlbAccessor* accessor = attribute(semantic);
+    if (accessor)
+    {
+        accessor->copyFloats(first, stride, components);
+        return;
+    }
+
+    for (std::size_t i = 0; i < vertexCount; ++i)
+        std::memcpy(first + i * stride, fallback, components * sizeof(float));
+}
+
+void GlbPrimitive::readIndices(std::vector<unsigned int>& out) const
+{
+    if (!indices.valid())
+    {
+        out.resize(vertexCount);
+        for (std::size_t i = 0; i < vertexCount; ++i)
+            out[i] = static_cast<unsigned int>(i);
+        return;
+    }
+
+    out.resize(indices.count);
+    if (indices.componentType == GL_UNSIGNED_INT && indices.stride == 4)
+    {
+        std::memcpy(out.data(), indices.data, indices.count * 4);
+    }
+    else
+    {
+        for (std::size_t i = 0; i < indices.count; ++i)
+            out[i] = indices.getIndex(i);
+    }
+
+    // whole triangles, and no index reading past the vertices
+    out.resize(out.size() / 3 * 3);
+    for (unsigned int& index : out)
+    {
+        if (index >= vertexCount)
+            index = 0;
+    }
+}
+
+bool GlbFile::open(const std::string& path)
+{
+    primitives.clear();
+    externalBuffers.clear();
+    decoded.clear();
+    views.clear();
+    accessors.clear();
+
+    if (!file.open(path))
+    {
+        std::cout << "ERROR::GLB:: could not open " << path << std::endl;
+        return false;
+    }
+
+    // 12 byte header, then the JSON chunk and an optional BIN chunk
+    const char* bytes = file.data();
+    const std::size_t size = file.size();
+    if (size < 20 || readU32(bytes) != GLB_MAGIC || readU32(bytes + 4) != 2 || readU32(bytes + 8) > size)
+    {
+        std::cout << "ERROR::GLB:: not a glTF 2.0 binary file " << path << std::endl;
+        return false;
+    }
+
+    const std::size_t length = readU32(bytes + 8);
+    const char* jsonData = nullptr;
+    std::size_t jsonLength = 0;
+    const unsigned char* binData = nullptr;
+    std::size_t binLength = 0;
+
+    for (std::size_t offset = 12; offset + 8 <= length;)
+    {
+        const std::size_t chunkLength = readU32(bytes + offset);
+        const std::uint32_t chunkType = readU32(bytes + offset + 4);
+        if (offset + 8 + chunkLength > length)
+            break;
+
+        if (chunkType == CHUNK_JSON && !jsonData)
+        {
+            jsonData = bytes + offset + 8;
+            jsonLength = chunkLength;
+        }
+        else if (chunkType == CHUNK_BIN && !binData)
+        {
+            binData = reinterpret_cast<const unsigned char*>(bytes + offset + 8);
+            binLength = chunkLength;
+        }
+        offset += 8 + ((chunkLength + 3) & ~std::size_t(3));
+    }
+
+    JsonValue json;
+    std::string error;
+    if (!jsonData || !JsonValue::parse(jsonData, jsonLength, json, &error))
+    {
+        std::cout << "ERROR::GLB:: bad JSON chunk in " << path << ": " << error << std::endl;
+        return false;
+    }
+
+    const JsonValue& required = json["extensionsRequired"];
+    for (std::size_t i = 0; i < required.size(); ++i)
+    {
+        const std::string& extension = required[i].asString();
+        if (extension != MESHOPT && extension != "KHR_mesh_quantization")
+        {
+            std::cout << "ERROR::GLB:: " << path << " requires unsupported extension " << extension << std::endl;
+            return false;
+        }
+    }
+
+    // buffers: the BIN chunk, files next to the glb, or nothing (meshopt fallback buffers)
+    struct Buffer
+    {
+        const unsigned char* data = nullptr;
+        std::size_t length = 0;
+    };
+    const std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+    std::vector<Buffer> buffers(json["buffers"].size());
+    for (std::size_t i = 0; i < buffers.size(); ++i)
+    {
+        const JsonValue& buffer = json["buffers"][i];
+        const std::string& uri = buffer["uri"].asString();
+        if (!buffer.has("uri"))
+        {
+            if (i == 0 && binData)
+                buffers[i] = { binData, binLength };
+        }
+        else if (uri.compare(0, 5, "data:") != 0)
+        {
+            externalBuffers.push_back(std::make_unique<MappedFile>(directory + uri));
+            const MappedFile& external = *externalBuffers.back();
+            if (external.isOpen())
+                buffers[i] = { reinterpret_cast<const unsigned char*>(external.data()), external.size() };
+        }
+
+        const std::size_t declared = static_cast<std::size_t>(buffer["byteLength"].asNumber());
+        buffers[i].length = std::min(buffers[i].length, declared);
+    }
+
+    auto range = [&](const JsonValue& source, std::size_t& length) -> const unsigned char* {
+        const std::size_t index = static_cast<std::size_t>(source["buffer"].asInt(-1));
+        const std::size_t offset = static_cast<std::size_t>(source["byteOffset"].asNumber());
+        length = static_cast<std::size_t>(source["byteLength"].asNumber());
+        if (index >= buffers.size() || !buffers[index].data || offset > buffers[index].length || length > buffers[index].length - offset)
+            return nullptr;
+        return buffers[index].data + offset;
+    };
+
+    // buffer views, compressed ones are decoded into memory of their own
+    const JsonValue& bufferViews = json["bufferViews"];
+    views.resize(bufferViews.size());
+    std::vector<std::size_t> compressed;
+    for (std::size_t i = 0; i < views.size(); ++i)
+    {
+        const JsonValue& view = bufferViews[i];
+        views[i].stride = static_cast<std::size_t>(view["byteStride"].asNumber());
+        if (view["extensions"].has(MESHOPT))
+        {
+            compressed.push_back(i);
+            continue;
+        }
+        views[i].data = range(view, views[i].length);
+    }
+
+    decoded.resize(compressed.size());
+    std::vector<unsigned char> decodedOk(compressed.size(), 0);
+    parallelFor(compressed.size(), 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t k = begin; k < end; ++k)
+        {
+            const JsonValue& extension = bufferViews[compressed[k]]["extensions"][MESHOPT];
+            std::size_t sourceLength;
+            const unsigned char* source = range(extension, sourceLength);
+            const std::size_t count = static_cast<std::size_t>(extension["count"].asNumber());
+            const std::size_t stride = static_cast<std::size_t>(extension["byteStride"].asNumber());
+            const std::string& mode = extension["mode"].asString();
+            const std::string& filter = extension["filter"].asString();
+            if (!source || stride == 0)
+                continue;
+
+            std::vector<unsigned char>& out = decoded[k];
+            out.resize(count * stride);
+
+            bool ok = false;
+            if (mode == "ATTRIBUTES")
+                ok = MeshoptDecoder::decodeVertexBuffer(out.data(), count, stride, source, sourceLength);
+            else if (mode == "TRIANGLES")
+                ok = MeshoptDecoder::decodeIndexBuffer(out.data(), count, stride, source, sourceLength);
+            else if (mode == "INDICES")
+                ok = MeshoptDecoder::decodeIndexSequence(out.data(), count, stride, source, sourceLength);
+
+            if (ok && filter == "OCTAHEDRAL")
+                MeshoptDecoder::filterOctahedral(out.data(), count, stride);
+            else if (ok && filter == "QUATERNION")
+                MeshoptDecoder::filterQuaternion(out.data(), count, stride);
+            else if (ok && filter == "EXPONENTIAL")
+                MeshoptDecoder::filterExponential(out.data(), count, stride);
+
+            decodedOk[k] = ok;
+        }
+    });
+
+    for (std::size_t k = 0; k < compressed.size(); ++k)
+    {
+        if (!decodedOk[k])
+        {
+            std::cout << "ERROR::GLB:: could not decode compressed buffer view " << compressed[k] << " of " << path << std::endl;
+            return false;
+        }
+        View& view = views[compressed[k]];
+        view.data = decoded[k].data();
+        view.length = decoded[k].size();
+    }
+
+    // accessors, checked against their view once so reads need no bounds checks
+    const JsonValue& accessorsJson = json["accessors"];
+    accessors.resize(accessorsJson.size());
+    for (std::size_t i = 0; i < accessors.size(); ++i)
+    {
+        const JsonValue& source = accessorsJson[i];
+        GlbAccessor& accessor = accessors[i];
+        accessor.componentType = static_cast<unsigned int>(source["componentType"].asInt());
+        accessor.components = componentCount(source["type"].asString());
+        accessor.normalized = source["normalized"].asBool();
+        accessor.count = static_cast<std::size_t>(source["count"].asNumber());
+
+        const std::size_t viewIndex = static_cast<std::size_t>(source["bufferView"].asInt(-1));
+        const std::size_t elementSize = componentSize(accessor.componentType) * accessor.components;
+        if (viewIndex >= views.size() || !views[viewIndex].data || elementSize == 0 || accessor.count == 0)
+            continue;
+
+        const View& view = views[viewIndex];
+        const std::size_t offset = static_cast<std::size_t>(source["byteOffset"].asNumber());
+        accessor.stride = view.stride ? view.stride : elementSize;
+        const std::size_t last = offset + accessor.stride * (accessor.count - 1) + elementSize;
+        if (last <= view.length)
+            accessor.data = view.data + offset;
+    }
+
+    // walk the node hierarchy of the default scene
+    const JsonValue& nodes = json["nodes"];
+    std::vector<std::size_t> roots;
+    const JsonValue& scene = json["scenes"][static_cast<std::size_t>(json["scene"].asInt(0))];
+    if (scene.isObject())
+    {
+        for (std::size_t i = 0; i < scene["nodes"].size(); ++i)
+            roots.push_back(static_cast<std::size_t>(scene["nodes"][i].asInt()));
+    }
+    else
+    {
+        // no scene: every node that nobody has as a child
+        std::vector<unsigned char> isChild(nodes.size(), 0);
+        for (std::size_t i = 0; i < nodes.size(); ++i)
+        {
+            const JsonValue& children = nodes[i]["children"];
+            for (std::size_t c = 0; c < children.size(); ++c)
+            {
+                const std::size_t child = static_cast<std::size_t>(children[c].asInt());
+                if (child < isChild.size())
+                    isChild[child] = 1;
+            }
+        }
+        for (std::size_t i = 0; i < nodes.size(); ++i)
+        {
+            if (!isChild[i])
+                roots.push_back(i);
+        }
+    }
+
+    struct Pending
+    {
+        std::size_t node;
+        glm::mat4 parent;
+        std::size_t depth;
+    };
+    std::vector<Pending> stack;
+    for (auto it = roots.rbegin(); it != roots.rend(); ++it)
+        stack.push_back({ *it, glm::mat4(1.0f), 0 });
+
+    const JsonValue& meshes = json["meshes"];
+    while (!stack.empty())
+    {
+        const Pending pending = stack.back();
+        stack.pop_back();
+        // malformed files may have cycles
+        if (pending.node >= nodes.size() || pending.depth > nodes.size())
+            continue;
+
+        const JsonValue& node = nodes[pending.node];
+        const glm::mat4 world = pending.parent * localTransform(node);
+
+        const JsonValue& mesh = meshes[static_cast<std::size_t>(node["mesh"].asInt(-1))];
+        const JsonValue& meshPrimitives = mesh["primitives"];
+        for (std::size_t p = 0; p < meshPrimitives.size(); ++p)
+        {
+            const JsonValue& source = meshPrimitives[p];
+            // triangles only
+            if (source["mode"].asInt(4) != 4)
+                continue;
+
+            GlbPrimitive primitive;
+            primitive.name = mesh["name"].asString();
+            primitive.transform = world;
+
+            for (const auto& member : source["attributes"].members())
+            {
+                const std::size_t index = static_cast<std::size_t>(member.second.asInt(-1));
+                if (index < accessors.size() && accessors[index].valid())
+                    primitive.attributes[member.first] = accessors[index];
+            }
+
+            const GlbAccessor* position = primitive.attribute("POSITION");
+            if (!position)
+                continue;
+            primitive.vertexCount = position->count;
+
+            // every attribute needs an entry per vertex
+            for (auto it = primitive.attributes.begin(); it != primitive.attributes.end();)
+                it = it->second.count < primitive.vertexCount ? primitive.attributes.erase(it) : std::next(it);
+
+            const std::size_t indices = static_cast<std::size_t>(source["indices"].asInt(-1));
+            if (indices < accessors.size())
+            {
+                if (!accessors[indices].valid())
+                    continue;
+                primitive.indices = accessors[indices];
+            }
+
+            primitives.push_back(std::move(primitive));
+        }
+
+        const JsonValue& children = node["children"];
+        for (std::size_t c = children.size(); c-- > 0;)
+            stack.push_back({ static_cast<std::size_t>(children[c].asInt()), world, pending.depth + 1 });
+    }
+
+    return true;
+}
@@ -0,0 +1,83 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+// Typed, strided view of a glTF accessor. data points straight into the mapped file
+// (or into a decoded EXT_meshopt_compression buffer view), nothing is copied.
+struct GlbAccessor
+{
+    const unsigned char* data = nullptr;
+    std::size_t count = 0;
+    std::size_t stride = 0;             // bytes between elements
+    unsigned int componentType = 0;     // GL_FLOAT, GL_UNSIGNED_SHORT... (glTF uses the GL enums)
+    unsigned int components = 0;        // 1 for SCALAR up to 4 for VEC4, 16 for MAT4
+    bool normalized = false;
+
+    bool valid() const { return data != nullptr; }
+    bool isFloat() const;
+
+    // element i as floats, (0, 0, 0, 1) where the accessor has fewer components
+    glm::vec4 get(std::size_t i) const;
+    unsigned int getIndex(std::size_t i) const;
+
+    // writes the first `components` floats of every element, outStride bytes apart.
+    // Float data is copied as is, without going through get().
+    void copyFloats(unsigned char* out, std::size_t outStride, unsigned int components) const;
+};
+
+// A triangle primitive of a mesh, placed by a node. A mesh used by several nodes shows up once per node.
+struct GlbPrimitive
+{
+    std::string name;                   // of the mesh
+    glm::mat4 transform;                // world matrix of the node
+    std::size_t vertexCount = 0;
+    std::map<std::string, GlbAccessor> attributes;   // POSITION, NORMAL, TEXCOORD_0...
+    GlbAccessor indices;                // invalid for non-indexed primitives
+
+    const GlbAccessor* attribute(const std::string& semantic) const;
+
+    // copies one attribute into the vertices, filling in fallback where the primitive doesn't have it
+    void copy(const std::string& semantic, unsigned char* first, std::size_t stride, unsigned int components, const float* fallback) const;
+
+    void readIndices(std::vector<unsigned int>& out) const;
+};
+
+// Binary glTF 2.0 (.glb). The file stays memory mapped for the lifetime of the object and
+// accessors point into it. Buffer views compressed with EXT_meshopt_compression are decoded
+// in parallel on open, KHR_mesh_quantization data is read through GlbAccessor::get.
+class GlbFile
+{
+public:
+    std::vector<GlbPrimitive> primitives;
+
+    // returns false if the file is not a glb this loader can read
+    bool open(const std::string& path);
+
+    std::size_t fileSize() const { return file.size(); }
+
+private:
+    struct View
+    {
+        const unsigned char* data = nullptr;
+        std::size_t length = 0;
+        std::size_t stride = 0;
+    };
+
+    MappedFile file;
+    std::vector<std::unique_ptr<MappedFile>> externalBuffers;
+    std::vector<std::vector<unsigned char>> decoded;
+    std::vector<View> views;
+    std::vector<GlbAccessor> accessors;
+};
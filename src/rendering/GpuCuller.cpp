@@ -0,0 +1,231 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include "GpuCuller.h"
+
+#include <algorithm>
+
+#include "GLState.h"
+#include "HiZPyramid.h"
+#include "Shader.h"
+
+namespace
+{
+    const GLuint GROUP_SIZE = 64;   // local size of gpu_cull.comp
+
+    // std430 layout of DrawBounds in gpu_cull.comp
+    struct DrawBounds
+    {
+        glm::vec4 center;
+        glm::vec4 extents;
+    };
+
+    // Counters in gpu_cull.comp
+    const int COUNTER_COUNT = 3;
+}
+
+GpuCuller::~GpuCuller()
+{
+    if (drawBuffer != 0)
+    {
+        glDeleteBuffers(1, &drawBuffer);
+        glDeleteBuffers(1, &boundsBuffer);
+        glDeleteBuffers(1, &visibleBuffer);
+        glDeleteBuffers(1, &counterBuffer);
+        glDeleteBuffers(READBACK_FRAMES, readbackBuffers);
+    }
+    for (GLsync fence : readbackFences)
+    {
+        if (fence != nullptr)
+        {
+            glDeleteSync(fence);
+        }
+    }
+    delete cullShader;
+}
+
+bool GpuCuller::hasIndirectCount()
+{
+    return GLAD_GL_VERSION_4_6 && glMultiDrawElementsIndirectCount != nullptr;
+}
+
+void GpuCuller::createBuffers()
+{
+    glGenBuffers(1, &drawBuffer);
+    glGenBuffers(1, &boundsBuffer);
+    glGenBuffers(1, &visibleBuffer);
+    glGenBuffers(1, &counterBuffer);
+    glGenBuffers(READBACK_FRAMES, readbackBuffers);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, COUNTER_COUNT * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+    for (GLuint readback : readbackBuffers)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, readback);
+        glBufferData(GL_COPY_WRITE_BUFFER, COUNTER_COUNT * sizeof(GLuint), nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void GpuCuller::setDraws(const std::vector<DrawElementsIndirectCommand>& commands, const std::vector<Bounds>& localBounds)
+{
+    if (drawBuffer == 0)
+    {
+        createBuffers();
+    }
+
+    count = std::min(commands.size(), localBounds.size());
+
+    std::vector<DrawBounds> boxes(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        boxes[i].center = glm::vec4(0.5f * (localBounds[i].min + localBounds[i].max), 0.0f);
+        boxes[i].extents = glm::vec4(localBounds[i].extents(), 0.0f);
+    }
+
+    // the list only changes with the scene, the buffers grow to the largest one seen
+    const bool grow = count > capacity;
+    if (grow)
+    {
+        capacity = count;
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawBuffer);
+    if (grow)
+        glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(DrawElementsIndirectCommand), nullptr, GL_STATIC_DRAW);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, count * sizeof(DrawElementsIndirectCommand), commands.data());
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, boundsBuffer);
+    if (grow)
+        glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(DrawBounds), nullptr, GL_STATIC_DRAW);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, count * sizeof(DrawBounds), boxes.data());
+
+    if (grow)
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, visibleBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(DrawElementsIndirectCommand), nullptr, GL_DYNAMIC_COPY);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void GpuCuller::pollReadbacks()
+{
+    // the oldest pending copy first, which is the slot cull() writes next; a fence that hasn't
+    // signalled yet is left for a later frame
+    for (int i = 0; i < READBACK_FRAMES; ++i)
+    {
+        const int slot = (readbackIndex + i) % READBACK_FRAMES;
+        if (readbackFences[slot] == nullptr)
+        {
+            continue;
+        }
+
+        const GLenum status = glClientWaitSync(readbackFences[slot], 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        {
+            continue;
+        }
+        glDeleteSync(readbackFences[slot]);
+        readbackFences[slot] = nullptr;
+
+        GLuint counters[COUNTER_COUNT];
+        glBindBuffer(GL_COPY_READ_BUFFER, readbackBuffers[slot]);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(counters), counters);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+        lastStats.total = readbackTotals[slot];
+        lastStats.visible = counters[0];
+        lastStats.frustumCulled = counters[1];
+        lastStats.occlusionCulled = counters[2];
+    }
+}
+
+void GpuCuller::cull(const Frustum& frustum, const HiZPyramid* hiZ)
+{
+    if (drawBuffer == 0)
+    {
+        createBuffers();
+    }
+    if (cullShader == nullptr)
+    {
+        cullShader = new Shader("gpu_cull.comp");
+        cullShader->setUniform1i("hiZ", 0);
+    }
+
+    pollReadbacks();
+
+    const GLuint zero = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    if (count > 0)
+    {
+        cullShader->setUniform1ui("drawCount", static_cast<unsigned int>(count));
+        cullShader->setUniform4fv("frustumPlanes", Frustum::PLANE_COUNT, frustum.planes);
+        cullShader->setUniform1i("compact", hasIndirectCount());
+
+        const bool occlusion = hiZ != nullptr && hiZ->valid();
+        cullShader->setUniform1i("occlusionCulling", occlusion);
+        if (occlusion)
+        {
+            GLState::get().bindTextureUnit(0, GL_TEXTURE_2D, hiZ->texture());
+            cullShader->setUniform1i("hiZLevels", hiZ->levelCount());
+            cullShader->setUniformMatrix4fv("hiZViewProjection", hiZ->getViewProjection());
+            cullShader->setUniform2fv("depthSize", glm::vec2(hiZ->depthSize()));
+        }
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_BINDING, drawBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BOUNDS_BINDING, boundsBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VISIBLE_BINDING, visibleBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COUNTER_BINDING, counterBuffer);
+
+        cullShader->apply();
+        glDispatchCompute((static_cast<GLuint>(count) + GROUP_SIZE - 1) / GROUP_SIZE, 1, 1);
+        // the results are read as draw commands, as the draw count parameter and by the copy below
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+        if (occlusion)
+        {
+            GLState::get().bindTextureUnit(0, GL_TEXTURE_2D, 0);
+        }
+    }
+
+    // a frame whose slot is still in flight skips its readback rather than waiting for it
+    if (readbackFences[readbackIndex] == nullptr)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, counterBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, readbackBuffers[readbackIndex]);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, COUNTER_COUNT * sizeof(GLuint));
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+        readbackFences[readbackIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        readbackTotals[readbackIndex] = count;
+        readbackIndex = (readbackIndex + 1) % READBACK_FRAMES;
+    }
+}
+
+void GpuCuller::draw() const
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, visibleBuffer);
+    if (hasIndirectCount())
+    {
+        // the visible count is the first counter
+        glBindBuffer(GL_PARAMETER_BUFFER, counterBuffer);
+        glMultiDrawElementsIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)0, 0, static_cast<GLsizei>(count), 0);
+        glBindBuffer(GL_PARAMETER_BUFFER, 0);
+    }
+    else
+    {
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)0, static_cast<GLsizei>(count), 0);
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
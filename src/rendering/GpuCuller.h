@@ -0,0 +1,96 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+#include "Bounds.h"
+#include "Frustum.h"
+#include "IndirectDraw.h"
+
+class HiZPyramid;
+class Shader;
+
+// Culls a multi-draw-indirect list on the GPU (gpu_cull.comp): each draw's object space box is
+// transformed by its object's model matrix, tested against the frustum and, when a pyramid is
+// given, against the Hi-Z pyramid of the previous frame. Survivors are appended to a command
+// buffer with atomics and drawn with glMultiDrawElementsIndirectCount, so the CPU never sees
+// which draws are visible.
+//
+// Without GL 4.6 every draw keeps its slot and the culled ones get an instanceCount of 0,
+// drawn with a plain glMultiDrawElementsIndirect over the whole list.
+//
+// The visible counts are copied into a small ring of buffers and read back once their fence has
+// signalled, a frame or more later, so stats() never stalls the pipeline.
+//
+//   culler.setDraws(bucket.getCommands(), localBounds);
+//   bucket.bindObjects();
+//   culler.cull(frustum, hiZ.valid() ? &hiZ : nullptr);
+//   shader->apply();
+//   arena.bind();
+//   culler.draw();
+class GpuCuller
+{
+public:
+    // shader storage bindings, after those of IndirectDraw.h and InstanceBuffer.h
+    static constexpr GLuint DRAW_BINDING = 3;
+    static constexpr GLuint BOUNDS_BINDING = 4;
+    static constexpr GLuint VISIBLE_BINDING = 5;
+    static constexpr GLuint COUNTER_BINDING = 6;
+
+    struct Stats
+    {
+        std::size_t total = 0;
+        std::size_t frustumCulled = 0;
+        std::size_t occlusionCulled = 0;
+        std::size_t visible = 0;
+    };
+
+    GpuCuller() = default;
+    GpuCuller(const GpuCuller&) = delete;
+    GpuCuller& operator=(const GpuCuller&) = delete;
+    ~GpuCuller();
+
+    // the draw list to cull every frame; localBounds[i] is the object space box of commands[i],
+    // whose baseInstance is the object index of the ObjectData bound at OBJECT_BUFFER_BINDING
+    void setDraws(const std::vector<DrawElementsIndirectCommand>& commands, const std::vector<Bounds>& localBounds);
+
+    // expects the ObjectData buffer to be bound (DrawBucket::bindObjects()). hiZ may be null,
+    // only the frustum is tested then.
+    void cull(const Frustum& frustum, const HiZPyramid* hiZ);
+
+    // draws the survivors of the last cull(); expects the arena and the program to be bound
+    void draw() const;
+
+    // of a previous frame, see above
+    const Stats& stats() const { return lastStats; }
+    std::size_t drawCount() const { return count; }
+
+    static bool hasIndirectCount();
+
+private:
+    static constexpr int READBACK_FRAMES = 3;
+
+    Shader* cullShader = nullptr;
+    GLuint drawBuffer = 0;
+    GLuint boundsBuffer = 0;
+    GLuint visibleBuffer = 0;
+    GLuint counterBuffer = 0;
+    std::size_t count = 0;
+    std::size_t capacity = 0;
+
+    GLuint readbackBuffers[READBACK_FRAMES] = {};
+    GLsync readbackFences[READBACK_FRAMES] = {};
+    std::size_t readbackTotals[READBACK_FRAMES] = {};
+    int readbackIndex = 0;
+    Stats lastStats;
+
+    void createBuffers();
+    void pollReadbacks();
+};
@@ -0,0 +1,110 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include "HiZPyramid.h"
+
+#include <algorithm>
+
+#include "GLState.h"
+#include "Shader.h"
+
+namespace
+{
+    const GLuint GROUP_SIZE = 8;    // local size of hiz_reduce.comp
+}
+
+HiZPyramid::~HiZPyramid()
+{
+    if (pyramid != 0)
+    {
+        GLState::get().forgetTexture(pyramid);
+        GLState::get().forgetTexture(depthCopy);
+        glDeleteTextures(1, &pyramid);
+        glDeleteTextures(1, &depthCopy);
+    }
+    delete reduceShader;
+}
+
+void HiZPyramid::resize(int newWidth, int newHeight)
+{
+    if (pyramid != 0)
+    {
+        GLState::get().forgetTexture(pyramid);
+        GLState::get().forgetTexture(depthCopy);
+        glDeleteTextures(1, &pyramid);
+        glDeleteTextures(1, &depthCopy);
+    }
+
+    width = newWidth;
+    height = newHeight;
+
+    glGenTextures(1, &depthCopy);
+    GLState::get().bindTexture(GL_TEXTURE_2D, depthCopy);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    // halving down to 1x1, starting at half the depth buffer size
+    const int levelWidth = std::max(1, width / 2);
+    const int levelHeight = std::max(1, height / 2);
+    levels = 1;
+    for (int size = std::max(levelWidth, levelHeight); size > 1; size /= 2)
+        ++levels;
+
+    glGenTextures(1, &pyramid);
+    GLState::get().bindTexture(GL_TEXTURE_2D, pyramid);
+    glTexStorage2D(GL_TEXTURE_2D, levels, GL_R32F, levelWidth, levelHeight);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    GLState::get().bindTexture(GL_TEXTURE_2D, 0);
+
+    built = false;
+}
+
+void HiZPyramid::buildFromFramebuffer(int newWidth, int newHeight, const glm::mat4& newViewProjection)
+{
+    if (newWidth <= 0 || newHeight <= 0)
+    {
+        return;
+    }
+
+    if (reduceShader == nullptr)
+    {
+        reduceShader = new Shader("hiz_reduce.comp");
+        reduceShader->setUniform1i("source", 0);
+    }
+    if (newWidth != width || newHeight != height || pyramid == 0)
+    {
+        resize(newWidth, newHeight);
+    }
+
+    // depth textures take their data from the depth buffer of the read framebuffer
+    GLState::get().bindTexture(GL_TEXTURE_2D, depthCopy);
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+
+    reduceShader->apply();
+    GLState::get().activeTexture(GL_TEXTURE0);
+
+    int levelWidth = std::max(1, width / 2);
+    int levelHeight = std::max(1, height / 2);
+    for (int level = 0; level < levels; ++level)
+    {
+        // level 0 reads the depth copy, the others the level above them
+        GLState::get().bindTexture(GL_TEXTURE_2D, level == 0 ? depthCopy : pyramid);
+        reduceShader->setUniform1i("sourceLevel", level == 0 ? 0 : level - 1);
+        glBindImageTexture(0, pyramid, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+        glDispatchCompute((levelWidth + GROUP_SIZE - 1) / GROUP_SIZE, (levelHeight + GROUP_SIZE - 1) / GROUP_SIZE, 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+        levelWidth = std::max(1, levelWidth / 2);
+        levelHeight = std::max(1, levelHeight / 2);
+    }
+
+    glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    GLState::get().bindTexture(GL_TEXTURE_2D, 0);
+
+    viewProjection = newViewProjection;
+    built = true;
+}
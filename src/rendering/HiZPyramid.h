@@ -0,0 +1,49 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+class Shader;
+
+// Hierarchical depth buffer for occlusion culling: an R32F mip chain where every texel holds the
+// farthest depth of the depth buffer pixels under it, reduced by a compute shader (hiz_reduce.comp).
+//
+// Level 0 is half the depth buffer resolution. Odd sizes fold their last row / column into the
+// last texel of the next level, so depth buffer pixel p lies in texel min(p >> (level + 1), size - 1)
+// of every level and a lookup never misses a pixel.
+class HiZPyramid
+{
+public:
+    HiZPyramid() = default;
+    HiZPyramid(const HiZPyramid&) = delete;
+    HiZPyramid& operator=(const HiZPyramid&) = delete;
+    ~HiZPyramid();
+
+    // copies the depth buffer of the bound read framebuffer (the default one works too) and
+    // reduces it. viewProjection is the matrix that depth was rendered with, kept for the lookups.
+    void buildFromFramebuffer(int width, int height, const glm::mat4& viewProjection);
+
+    GLuint texture() const { return pyramid; }
+    int levelCount() const { return levels; }
+    // of the depth buffer it was built from
+    glm::ivec2 depthSize() const { return glm::ivec2(width, height); }
+    const glm::mat4& getViewProjection() const { return viewProjection; }
+
+    bool valid() const { return pyramid != 0 && built; }
+
+private:
+    Shader* reduceShader = nullptr;
+    GLuint depthCopy = 0;
+    GLuint pyramid = 0;
+    int width = 0;
+    int height = 0;
+    int levels = 0;
+    bool built = false;
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+
+    void resize(int newWidth, int newHeight);
+};
@@ -0,0 +1,225 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include "Impostor.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "GLState.h"
+#include "Shader.h"
+
+namespace
+{
+    float signNotZero(float value)
+    {
+        return value >= 0.0f ? 1.0f : -1.0f;
+    }
+
+    // lookAt needs an up vector that isn't the view direction
+    glm::vec3 frameUp(const glm::vec3& direction)
+    {
+        return std::abs(direction.y) > 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    }
+
+    GLuint createAtlas(int size, int levels)
+    {
+        GLuint texture;
+        glGenTextures(1, &texture);
+        GLState::get().bindTexture(GL_TEXTURE_2D, texture);
+        glTexStorage2D(GL_TEXTURE_2D, levels, GL_RGBA8, size, size);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+        return texture;
+    }
+}
+
+Impostor::~Impostor()
+{
+    release();
+    if (VAO != 0)
+    {
+        GLState::get().forgetVertexArray(VAO);
+        glDeleteVertexArrays(1, &VAO);
+    }
+    delete drawShader;
+}
+
+void Impostor::release()
+{
+    if (albedoAtlas != 0)
+    {
+        GLState::get().forgetTexture(albedoAtlas);
+        GLState::get().forgetTexture(normalDepthAtlas);
+        glDeleteTextures(1, &albedoAtlas);
+        glDeleteTextures(1, &normalDepthAtlas);
+        albedoAtlas = 0;
+        normalDepthAtlas = 0;
+    }
+}
+
+glm::vec2 Impostor::octahedral(const glm::vec3& direction)
+{
+    const glm::vec3 d = direction / (std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z));
+    glm::vec2 p(d.x, d.z);
+    if (d.y < 0.0f)
+    {
+        p = glm::vec2((1.0f - std::abs(d.z)) * signNotZero(d.x), (1.0f - std::abs(d.x)) * signNotZero(d.z));
+    }
+    return p;
+}
+
+glm::vec3 Impostor::frameDirection(int x, int y, int framesPerSide)
+{
+    const glm::vec2 e = (glm::vec2(float(x), float(y)) + 0.5f) / float(framesPerSide) * 2.0f - 1.0f;
+    glm::vec3 v(e.x, 1.0f - std::abs(e.x) - std::abs(e.y), e.y);
+    if (v.y < 0.0f)
+    {
+        v.x = (1.0f - std::abs(e.y)) * signNotZero(e.x);
+        v.z = (1.0f - std::abs(e.x)) * signNotZero(e.y);
+    }
+    return glm::normalize(v);
+}
+
+void Impostor::bake(const Bounds& modelBounds, const std::function<void()>& drawModel, int framesPerSide, int newFrameSize)
+{
+    release();
+
+    bounds = modelBounds;
+    frames = std::max(framesPerSide, 2);
+    frameSize = std::max(newFrameSize, 8);
+    const int size = frames * frameSize;
+
+    // mips down to 8 texels per frame; below that the frames bleed into each other
+    int levels = 1;
+    for (int texels = frameSize; texels > 8; texels /= 2)
+        ++levels;
+
+    albedoAtlas = createAtlas(size, levels);
+    normalDepthAtlas = createAtlas(size, levels);
+
+    GLuint depthBuffer;
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size, size);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    GLint previousFramebuffer = 0;
+    GLint previousViewport[4];
+    GLfloat previousClearColor[4];
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, previousClearColor);
+    const GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    const GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+
+    GLState& state = GLState::get();
+    GLuint framebuffer;
+    glGenFramebuffers(1, &framebuffer);
+    state.bindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, albedoAtlas, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, normalDepthAtlas, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    const GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, drawBuffers);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "ERROR::IMPOSTOR::FRAMEBUFFER_INCOMPLETE" << std::endl;
+    }
+    else
+    {
+        // the empty background is 0 in both atlases, see the premultiplication in Impostor.h
+        state.enable(GL_DEPTH_TEST);
+        state.disable(GL_CULL_FACE);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        state.viewport(0, 0, size, size);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        Shader bakeShader("impostor_bake.vert", "impostor_bake.frag");
+        bakeShader.setUniform1i("diffuseMap", 0);
+        bakeShader.setUniform3fv("boundsCenter", bounds.center);
+        bakeShader.setUniform1f("boundsRadius", bounds.radius);
+        bakeShader.apply();
+
+        // orthographic, the bounding sphere touching the frame; the eye sits outside of it
+        const float radius = std::max(bounds.radius, 1e-4f);
+        const glm::mat4 projection = glm::ortho(-radius, radius, -radius, radius, radius, 3.0f * radius);
+
+        for (int y = 0; y < frames; ++y)
+        {
+            for (int x = 0; x < frames; ++x)
+            {
+                const glm::vec3 direction = frameDirection(x, y, frames);
+                const glm::mat4 view = glm::lookAt(bounds.center + 2.0f * radius * direction, bounds.center, frameUp(direction));
+
+                state.viewport(x * frameSize, y * frameSize, frameSize, frameSize);
+                bakeShader.setUniformMatrix4fv("viewProjection", projection * view);
+                bakeShader.setUniform3fv("viewDirection", direction);
+                drawModel();
+            }
+        }
+
+        state.bindTexture(GL_TEXTURE_2D, albedoAtlas);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        state.bindTexture(GL_TEXTURE_2D, normalDepthAtlas);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        state.bindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    state.bindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+    state.forgetFramebuffer(framebuffer);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &depthBuffer);
+
+    state.viewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+    glClearColor(previousClearColor[0], previousClearColor[1], previousClearColor[2], previousClearColor[3]);
+    state.setEnabled(GL_DEPTH_TEST, depthTest == GL_TRUE);
+    state.setEnabled(GL_CULL_FACE, cullFace == GL_TRUE);
+}
+
+Shader& Impostor::shader()
+{
+    if (drawShader == nullptr)
+    {
+        drawShader = new Shader("impostor.vert", "impostor.frag");
+        drawShader->setUniform1i("albedoAtlas", 0);
+        drawShader->setUniform1i("normalDepthAtlas", 1);
+    }
+    return *drawShader;
+}
+
+void Impostor::draw(std::size_t instanceCount, std::size_t firstInstance)
+{
+    if (!baked() || instanceCount == 0)
+    {
+        return;
+    }
+
+    if (VAO == 0)
+    {
+        glGenVertexArrays(1, &VAO);
+    }
+
+    Shader& program = shader();
+    program.setUniform3fv("boundsCenter", bounds.center);
+    program.setUniform1f("boundsRadius", bounds.radius);
+    program.setUniform1i("frames", frames);
+    program.setUniform1f("frameEdge", 0.5f / frameSize);
+    program.setUniform1i("firstInstance", static_cast<int>(firstInstance));
+    program.apply();
+
+    GLState& state = GLState::get();
+    state.bindTextureUnit(0, GL_TEXTURE_2D, albedoAtlas);
+    state.bindTextureUnit(1, GL_TEXTURE_2D, normalDepthAtlas);
+
+    state.bindVertexArray(VAO);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(instanceCount));
+}
@@ -0,0 +1,83 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <functional>
+
+#include "Bounds.h"
+
+class Shader;
+
+// Octahedral impostor of a model: the model rendered from framesPerSide^2 directions spread
+// over the sphere by an octahedral mapping (+y at the center of the grid, -y at its corners),
+// each view orthographic and framing the bounding sphere, into two atlases:
+//   albedo       rgb: color, a: coverage
+//   normalDepth  rgb: object space normal * 0.5 + 0.5, a: depth across the sphere, 0 in front
+// Both are stored premultiplied by the coverage so their mips can be averaged with the empty
+// background, and are divided by it when read.
+//
+// At runtime an impostor is a single camera-facing quad per instance (impostor.vert) around
+// the bounding sphere. It blends the 4 frames closest to the view direction, each sampled
+// where the view ray crosses that frame's plane, and writes the baked depth so impostors
+// intersect the scene like the model would. Instances come from the bound InstanceBuffer;
+// the frames are drawn uniformly scaled, sized by the largest scale component.
+//
+//   impostor.bake(model->bounds, [&]() { diffuse_texture->bind(0); model->Draw(); });
+//   ...
+//   impostor.shader().setUniformMatrix4fv("viewMatrix", view);  // and the other scene uniforms
+//   far_instances->bind();
+//   impostor.draw(far_instances->size());
+class Impostor
+{
+public:
+    static constexpr int DEFAULT_FRAMES = 8;
+    static constexpr int DEFAULT_FRAME_SIZE = 128;
+
+    Impostor() = default;
+    Impostor(const Impostor&) = delete;
+    Impostor& operator=(const Impostor&) = delete;
+    ~Impostor();
+
+    // drawModel draws the model in object space with the bake program in use (the diffuse
+    // texture goes to unit 0). The framebuffer, viewport and depth state are restored after.
+    void bake(const Bounds& bounds, const std::function<void()>& drawModel,
+              int framesPerSide = DEFAULT_FRAMES, int frameSize = DEFAULT_FRAME_SIZE);
+
+    // the program drawing the impostors, for the scene uniforms: viewMatrix, projectionMatrix,
+    // cameraPos and light (see impostor.frag)
+    Shader& shader();
+
+    // instanceCount impostors placed by the bound InstanceBuffer, starting at firstInstance
+    void draw(std::size_t instanceCount, std::size_t firstInstance = 0);
+
+    bool baked() const { return albedoAtlas != 0; }
+    GLuint albedoTexture() const { return albedoAtlas; }
+    GLuint normalDepthTexture() const { return normalDepthAtlas; }
+    int framesPerSide() const { return frames; }
+    int atlasSize() const { return frames * frameSize; }
+
+    // object space bounds the frames were framed around
+    const Bounds& getBounds() const { return bounds; }
+
+    // direction of frame (x, y) of the grid, and the grid position of a direction; both sides
+    // match octahedral() / frameDirection() in impostor.vert
+    static glm::vec3 frameDirection(int x, int y, int framesPerSide);
+    static glm::vec2 octahedral(const glm::vec3& direction);
+
+private:
+    Shader* drawShader = nullptr;
+    GLuint albedoAtlas = 0;
+    GLuint normalDepthAtlas = 0;
+    GLuint VAO = 0;             // empty, the quad comes from gl_VertexID
+    Bounds bounds;
+    int frames = 0;
+    int frameSize = 0;
+
+    void release();
+};
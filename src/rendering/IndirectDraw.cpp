@@ -0,0 +1,38 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include "IndirectDraw.h"
+
+#include <numeric>
+#include <vector>
+
+static_assert(sizeof(DrawElementsIndirectCommand) == 5 * sizeof(GLuint), "indirect command must be tightly packed");
+static_assert(sizeof(ObjectData) % 16 == 0, "ObjectData must match its std430 layout");
+
+namespace
+{
+    GLuint drawIdBuffer = 0;
+}
+
+void indirect::setupDrawIdAttribute()
+{
+    if (drawIdBuffer == 0)
+    {
+        std::vector<GLuint> ids(MAX_OBJECTS);
+        std::iota(ids.begin(), ids.end(), 0u);
+
+        glGenBuffers(1, &drawIdBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, drawIdBuffer);
+        glBufferData(GL_ARRAY_BUFFER, ids.size() * sizeof(GLuint), ids.data(), GL_STATIC_DRAW);
+    }
+    else
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, drawIdBuffer);
+    }
+
+    glEnableVertexAttribArray(DRAW_ID_LOCATION);
+    glVertexAttribIPointer(DRAW_ID_LOCATION, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+    // one value per instance, offset by baseInstance
+    glVertexAttribDivisor(DRAW_ID_LOCATION, 1);
+}
@@ -0,0 +1,46 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Shared pieces of the multi-draw-indirect path (see DrawBucket.h).
+
+// layout mandated by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint  baseVertex;
+    GLuint baseInstance;
+};
+
+// per-object data, read in the vertex shader as objects[drawId] (std430, see ch09_01_indirect.vert)
+struct ObjectData
+{
+    glm::mat4 modelMatrix;
+    glm::mat4 normalMatrix; // mat3 padded to a mat4 to keep the std430 layout trivial
+    GLuint materialIndex;
+    GLuint padding[3];
+};
+
+namespace indirect
+{
+    // vertex attribute carrying the index of the draw inside a multi-draw
+    const GLuint DRAW_ID_LOCATION = 15;
+    // shader storage binding of the ObjectData array
+    const GLuint OBJECT_BUFFER_BINDING = 0;
+    // shader storage binding of the material array
+    const GLuint MATERIAL_BUFFER_BINDING = 1;
+    // objects addressable by one submission, bounded by the size of the draw id buffer
+    const GLuint MAX_OBJECTS = 1 << 18;
+
+    // GL 4.3 has no gl_DrawID, so every draw gets baseInstance = its object index and the shader
+    // reads it back through an instanced attribute sourced from a buffer holding 0, 1, 2, ...
+    // Sets that attribute up on the currently bound VAO.
+    void setupDrawIdAttribute();
+}
@@ -0,0 +1,66 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include "InstanceBuffer.h"
+
+#include <algorithm>
+
+static_assert(sizeof(InstanceTransform) == 48, "InstanceTransform must match its std430 layout");
+
+InstanceBuffer::~InstanceBuffer()
+{
+    if (buffer != 0)
+    {
+        glDeleteBuffers(1, &buffer);
+    }
+}
+
+void InstanceBuffer::clear()
+{
+    instances.clear();
+    dirty = true;
+}
+
+std::size_t InstanceBuffer::add(const InstanceTransform& instance)
+{
+    instances.push_back(instance);
+    dirty = true;
+    return instances.size() - 1;
+}
+
+void InstanceBuffer::set(std::size_t index, const InstanceTransform& instance)
+{
+    instances[index] = instance;
+    dirty = true;
+}
+
+void InstanceBuffer::assign(const InstanceTransform* first, std::size_t count)
+{
+    instances.assign(first, first + count);
+    dirty = true;
+}
+
+void InstanceBuffer::bind()
+{
+    if (buffer == 0)
+    {
+        glGenBuffers(1, &buffer);
+    }
+
+    if (dirty && !instances.empty())
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        // grow by doubling, instance counts that change every frame (culling) then settle
+        if (instances.size() > capacity)
+        {
+            capacity = std::max(instances.size(), 2 * capacity);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(InstanceTransform), nullptr, GL_DYNAMIC_DRAW);
+        }
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, instances.size() * sizeof(InstanceTransform), instances.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+    dirty = false;
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING, buffer);
+}
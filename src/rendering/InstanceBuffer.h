@@ -0,0 +1,76 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstddef>
+#include <vector>
+
+// per-instance transform, read in the vertex shader as instances[gl_InstanceID]
+// (std430, see ch09_02_instanced.vert). The shader builds the model and normal matrices from it,
+// so an instance is 48 bytes instead of two matrices.
+struct InstanceTransform
+{
+    glm::vec3 position;
+    float padding0 = 0.0f;
+    glm::vec4 rotation;     // unit quaternion as x, y, z, w
+    glm::vec3 scale;
+    float padding1 = 0.0f;
+
+    InstanceTransform() = default;
+    InstanceTransform(const glm::vec3& position, const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+                      const glm::vec3& scale = glm::vec3(1.0f))
+        : position(position), rotation(rotation.x, rotation.y, rotation.z, rotation.w), scale(scale)
+    {
+    }
+};
+
+// Shader storage buffer of InstanceTransforms for instanced draws (Model::DrawInstanced,
+// Mesh::DrawInstanced, glDrawArraysInstanced for plain VAOs): one draw call for any number
+// of copies, instead of a draw and a set of uniform uploads per copy.
+// The CPU copy is uploaded by bind() when it changed; the buffer only grows.
+//
+//   instances.clear();
+//   instances.add(InstanceTransform(position, rotation));
+//   instances.bind();
+//   shader->apply();
+//   model->DrawInstanced(instances.size());
+class InstanceBuffer
+{
+public:
+    // shader storage binding of the instance array (after those of IndirectDraw.h)
+    static constexpr GLuint BINDING = 2;
+
+    InstanceBuffer() = default;
+    InstanceBuffer(const InstanceBuffer&) = delete;
+    InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+    ~InstanceBuffer();
+
+    void clear();
+    void reserve(std::size_t count) { instances.reserve(count); }
+
+    // returns the instance index
+    std::size_t add(const InstanceTransform& instance);
+    void set(std::size_t index, const InstanceTransform& instance);
+    // replaces all instances, e.g. with a snapshot made on another thread
+    void assign(const InstanceTransform* first, std::size_t count);
+    const InstanceTransform& get(std::size_t index) const { return instances[index]; }
+
+    // uploads the instances if they changed and binds the buffer to BINDING
+    void bind();
+
+    std::size_t size() const { return instances.size(); }
+    bool empty() const { return instances.empty(); }
+
+private:
+    std::vector<InstanceTransform> instances;
+    bool dirty = true;
+
+    GLuint buffer = 0;
+    std::size_t capacity = 0;   // in instances
+};
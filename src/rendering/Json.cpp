@@ -0,0 +1,318 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include "Json.h"
+
+#include <cstdlib>
+#include <cstring>
+
+// recursive descent over the text, building JsonValues in place
+class JsonParser
+{
+public:
+    JsonParser(const char* text, std::size_t length) : p(text), begin(text), end(text + length) {}
+
+    bool parseDocument(JsonValue& value, std::string* error)
+    {
+        const bool ok = parseValue(value, 0) && (skipSpace(), p == end);
+        if (!ok && error)
+        {
+            *error = (message ? message : "unexpected trailing characters") + std::string(" at offset ") + std::to_string(p - begin);
+        }
+        return ok;
+    }
+
+private:
+    // deeper documents are rejected rather than overflowing the stack
+    static constexpr int MAX_DEPTH = 128;
+
+    const char* p;
+    const char* begin;
+    const char* end;
+    const char* message = nullptr;
+
+    bool fail(const char* what)
+    {
+        message = what;
+        return false;
+    }
+
+    void skipSpace()
+    {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+            ++p;
+    }
+
+    bool consume(const char* word)
+    {
+        const std::size_t length = std::strlen(word);
+        if (std::size_t(end - p) < length || std::memcmp(p, word, length) != 0)
+        {
+            return false;
+        }
+        p += length;
+        return true;
+    }
+
+    bool parseValue(JsonValue& value, int depth)
+    {
+        if (depth > MAX_DEPTH)
+        {
+            return fail("nested too deeply");
+        }
+
+        skipSpace();
+        if (p == end)
+        {
+            return fail("unexpected end");
+        }
+
+        switch (*p)
+        {
+        case '{': return parseObject(value, depth);
+        case '[': return parseArray(value, depth);
+        case '"': value.kind = JsonValue::Type::String; return parseString(value.text);
+        case 't': value.kind = JsonValue::Type::Bool; value.boolean = true; return consume("true") || fail("bad literal");
+        case 'f': value.kind = JsonValue::Type::Bool; value.boolean = false; return consume("false") || fail("bad literal");
+        case 'n': value.kind = JsonValue::Type::Null; return consume("null") || fail("bad literal");
+        default: return parseNumber(value);
+        }
+    }
+
+    bool parseNumber(JsonValue& value)
+    {
+        // strtod needs a terminated string, numbers are short
+        char buffer[64];
+        std::size_t length = 0;
+        while (p + length < end && length + 1 < sizeof(buffer) && std::strchr("+-0123456789.eE", p[length]))
+            ++length;
+        std::memcpy(buffer, p, length);
+        buffer[length] = '\0';
+
+        char* numberEnd = nullptr;
+        value.number = std::strtod(buffer, &numberEnd);
+        if (numberEnd == buffer)
+        {
+            return fail("bad value");
+        }
+
+        value.kind = JsonValue::Type::Number;
+        p += numberEnd - buffer;
+        return true;
+    }
+
+    static void appendUtf8(std::string& out, unsigned int c)
+    {
+        if (c < 0x80)
+        {
+            out += char(c);
+        }
+        else if (c < 0x800)
+        {
+            out += char(0xC0 | (c >> 6));
+            out += char(0x80 | (c & 0x3F));
+        }
+        else if (c < 0x10000)
+        {
+            out += char(0xE0 | (c >> 12));
+            out += char(0x80 | ((c >> 6) & 0x3F));
+            out += char(0x80 | (c & 0x3F));
+        }
+        else
+        {
+            out += char(0xF0 | (c >> 18));
+            out += char(0x80 | ((c >> 12) & 0x3F));
+            out += char(0x80 | ((c >> 6) & 0x3F));
+            out += char(0x80 | (c & 0x3F));
+        }
+    }
+
+    bool parseHex4(unsigned int& c)
+    {
+        if (end - p < 4)
+        {
+            return false;
+        }
+
+        c = 0;
+        for (int i = 0; i < 4; ++i, ++p)
+        {
+            const char h = *p;
+            c <<= 4;
+            if (h >= '0' && h <= '9') c |= h - '0';
+            else if (h >= 'a' && h <= 'f') c |= h - 'a' + 10;
+            else if (h >= 'A' && h <= 'F') c |= h - 'A' + 10;
+            else return false;
+        }
+        return true;
+    }
+
+    bool parseString(std::string& out)
+    {
+        ++p; // opening quote
+        out.clear();
+        while (p < end && *p != '"')
+        {
+            if (*p != '\\')
+            {
+                out += *p++;
+                continue;
+            }
+
+            if (++p == end)
+                break;
+
+            const char escaped = *p++;
+            switch (escaped)
+            {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u':
+            {
+                unsigned int c;
+                if (!parseHex4(c))
+                    return fail("bad \\u escape");
+
+                // surrogate pair
+                unsigned int low;
+                if (c >= 0xD800 && c < 0xDC00 && consume("\\u") && parseHex4(low) && low >= 0xDC00 && low < 0xE000)
+                    c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                appendUtf8(out, c);
+                break;
+            }
+            default:
+                return fail("bad escape");
+            }
+        }
+
+        if (p == end)
+        {
+            return fail("unterminated string");
+        }
+        ++p; // closing quote
+        return true;
+    }
+
+    bool parseArray(JsonValue& value, int depth)
+    {
+        value.kind = JsonValue::Type::Array;
+        ++p;
+        skipSpace();
+        if (p < end && *p == ']')
+        {
+            ++p;
+            return true;
+        }
+
+        while (true)
+        {
+            value.array.emplace_back();
+            if (!parseValue(value.array.back(), depth + 1))
+                return false;
+
+            skipSpace();
+            if (p < end && *p == ',')
+            {
+                ++p;
+                continue;
+            }
+            if (p < end && *p == ']')
+            {
+                ++p;
+                return true;
+            }
+            return fail("expected , or ]");
+        }
+    }
+
+    bool parseObject(JsonValue& value, int depth)
+    {
+        value.kind = JsonValue::Type::Object;
+        ++p;
+        skipSpace();
+        if (p < end && *p == '}')
+        {
+            ++p;
+            return true;
+        }
+
+        while (true)
+        {
+            skipSpace();
+            std::string key;
+            if (p == end || *p != '"' || !parseString(key))
+                return fail("expected a key");
+
+            skipSpace();
+            if (p == end || *p != ':')
+                return fail("expected :");
+            ++p;
+
+            if (!parseValue(value.object[key], depth + 1))
+                return false;
+
+            skipSpace();
+            if (p < end && *p == ',')
+            {
+                ++p;
+                continue;
+            }
+            if (p < end && *p == '}')
+            {
+                ++p;
+                return true;
+            }
+            return fail("expected , or }");
+        }
+    }
+};
+
+bool JsonValue::parse(const char* text, std::size_t length, JsonValue& value, std::string* error)
+{
+    value = JsonValue();
+    JsonParser parser(text, length);
+    return parser.parseDocument(value, error);
+}
+
+const JsonValue& JsonValue::empty()
+{
+    static const JsonValue null;
+    return null;
+}
+
+std::size_t JsonValue::size() const
+{
+    if (kind == Type::Array)
+        return array.size();
+    if (kind == Type::Object)
+        return object.size();
+    return 0;
+}
+
+bool JsonValue::has(const std::string& key) const
+{
+    return kind == Type::Object && object.count(key) != 0;
+}
+
+const JsonValue& JsonValue::operator[](std::size_t index) const
+{
+    return kind == Type::Array && index < array.size() ? array[index] : empty();
+}
+
+const JsonValue& JsonValue::operator[](const std::string& key) const
+{
+    if (kind != Type::Object)
+    {
+        return empty();
+    }
+
+    const auto it = object.find(key);
+    return it != object.end() ? it->second : empty();
+}
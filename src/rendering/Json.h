@@ -0,0 +1,55 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+// Minimal JSON document, enough for glTF headers. Values are a tree of tagged nodes,
+// lookups of missing keys / indices return a shared null value so chains like
+// json["meshes"][0]["primitives"] never fail.
+class JsonValue
+{
+public:
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    // parses a whole document; on failure returns false and describes the problem in error
+    static bool parse(const char* text, std::size_t length, JsonValue& value, std::string* error = nullptr);
+
+    Type type() const { return kind; }
+    bool isNull() const { return kind == Type::Null; }
+    bool isNumber() const { return kind == Type::Number; }
+    bool isString() const { return kind == Type::String; }
+    bool isArray() const { return kind == Type::Array; }
+    bool isObject() const { return kind == Type::Object; }
+
+    bool asBool(bool fallback = false) const { return kind == Type::Bool ? boolean : fallback; }
+    double asNumber(double fallback = 0.0) const { return kind == Type::Number ? number : fallback; }
+    int asInt(int fallback = 0) const { return kind == Type::Number ? static_cast<int>(number) : fallback; }
+    const std::string& asString() const { return kind == Type::String ? text : empty().text; }
+
+    // array elements / object members, 0 for anything else
+    std::size_t size() const;
+    bool has(const std::string& key) const;
+
+    const JsonValue& operator[](std::size_t index) const;
+    const JsonValue& operator[](const std::string& key) const;
+
+    const std::map<std::string, JsonValue>& members() const { return object; }
+
+private:
+    Type kind = Type::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string text;
+    std::vector<JsonValue> array;
+    std::map<std::string, JsonValue> object;
+
+    static const JsonValue& empty();
+
+    friend class JsonParser;
+};
@@ -0,0 +1,482 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include "Lod.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <utility>
+
+namespace
+{
+    const double BORDER_WEIGHT = 10.0;
+
+    // symmetric 4x4 matrix of the sum of squared distances to a set of planes, upper triangle
+    struct Quadric
+    {
+        double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+        double a11 = 0, a12 = 0, a13 = 0;
+        double a22 = 0, a23 = 0;
+        double a33 = 0;
+        double weight = 0;
+
+        void addPlane(const glm::dvec3& n, double d, double w)
+        {
+            a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z; a03 += w * n.x * d;
+            a11 += w * n.y * n.y; a12 += w * n.y * n.z; a13 += w * n.y * d;
+            a22 += w * n.z * n.z; a23 += w * n.z * d;
+            a33 += w * d * d;
+            weight += w;
+        }
+
+        Quadric& operator+=(const Quadric& q)
+        {
+            a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+            a11 += q.a11; a12 += q.a12; a13 += q.a13;
+            a22 += q.a22; a23 += q.a23;
+            a33 += q.a33;
+            weight += q.weight;
+            return *this;
+        }
+
+        // weighted mean squared distance of p to the planes
+        double error(const glm::vec3& p) const
+        {
+            const double x = p.x, y = p.y, z = p.z;
+            const double e = x * (a00 * x + 2 * a01 * y + 2 * a02 * z + 2 * a03)
+                           + y * (a11 * y + 2 * a12 * z + 2 * a13)
+                           + z * (a22 * z + 2 * a23)
+                           + a33;
+            return weight > 0 ? std::max(e, 0.0) / weight : 0.0;
+        }
+    };
+
+    struct Collapse
+    {
+        double cost;
+        unsigned int from, to;      // positions
+
+        bool operator>(const Collapse& other) const { return cost > other.cost; }
+    };
+
+    // Collapses run on unique positions; the vertices sharing a position ("wedges", split by
+    // normal or uv seams) are remapped together.
+    class Simplifier
+    {
+    public:
+        Simplifier(const void* positions, std::size_t stride, std::size_t vertexCount, const std::vector<unsigned int>& indices, std::size_t indexCount)
+        {
+            remapPositions(positions, stride, vertexCount);
+
+            for (std::size_t i = 0; i + 2 < indexCount; i += 3)
+            {
+                const unsigned int a = indices[i], b = indices[i + 1], c = indices[i + 2];
+                if (wedgePosition[a] == wedgePosition[b] || wedgePosition[b] == wedgePosition[c] || wedgePosition[c] == wedgePosition[a])
+                {
+                    continue;   // degenerate, dropped from the coarser levels
+                }
+                triangles.push_back(a);
+                triangles.push_back(b);
+                triangles.push_back(c);
+            }
+
+            const std::size_t triangleCount = triangles.size() / 3;
+            alive.assign(triangleCount, 1);
+            liveTriangles = triangleCount;
+            positionTriangles.resize(points.size());
+            for (unsigned int t = 0; t < triangleCount; ++t)
+            {
+                for (int k = 0; k < 3; ++k)
+                    positionTriangles[wedgePosition[triangles[t * 3 + k]]].push_back(t);
+            }
+
+            removed.assign(points.size(), 0);
+            border.assign(points.size(), 0);
+            quadrics.resize(points.size());
+            computeQuadrics();
+        }
+
+        std::size_t triangleCount() const { return liveTriangles; }
+        double maxError() const { return std::sqrt(maxCost); }
+
+        // collapses edges until at most targetTriangles are left, returns false once nothing can collapse anymore
+        bool simplify(std::size_t targetTriangles)
+        {
+            while (liveTriangles > targetTriangles)
+            {
+                if (queue.empty())
+                {
+                    return false;
+                }
+
+                const Collapse top = queue.top();
+                queue.pop();
+                if (removed[top.from] || removed[top.to])
+                {
+                    continue;
+                }
+
+                // quadrics change as neighbours collapse, re-queue outdated costs
+                const double cost = collapseCost(top.from, top.to);
+                if (cost > top.cost * (1.0 + 1e-6) + 1e-12)
+                {
+                    queue.push({ cost, top.from, top.to });
+                    continue;
+                }
+
+                if (!canCollapse(top.from, top.to))
+                {
+                    continue;
+                }
+
+                collapse(top.from, top.to);
+                maxCost = std::max(maxCost, cost);
+            }
+            return true;
+        }
+
+        void appendTriangles(std::vector<unsigned int>& out) const
+        {
+            for (std::size_t t = 0; t < alive.size(); ++t)
+            {
+                if (alive[t])
+                    out.insert(out.end(), &triangles[t * 3], &triangles[t * 3] + 3);
+            }
+        }
+
+    private:
+        std::vector<glm::vec3> points;                  // unique positions
+        std::vector<unsigned int> wedgePosition;        // vertex -> position
+        std::vector<unsigned int> triangles;            // vertex indices, 3 per triangle
+        std::vector<char> alive;
+        std::size_t liveTriangles = 0;
+        std::vector<std::vector<unsigned int>> positionTriangles;
+        std::vector<char> removed;
+        std::vector<char> border;
+        std::vector<Quadric> quadrics;
+        std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+        double maxCost = 0.0;
+
+        // scratch for canCollapse()/collapse(): vertex of 'from' -> vertex of 'to'
+        std::vector<std::pair<unsigned int, unsigned int>> wedgeMap;
+
+        void remapPositions(const void* positions, std::size_t stride, std::size_t vertexCount)
+        {
+            std::vector<glm::vec3> read(vertexCount);
+            for (std::size_t i = 0; i < vertexCount; ++i)
+            {
+                std::memcpy(&read[i], static_cast<const char*>(positions) + i * stride, sizeof(glm::vec3));
+            }
+
+            std::vector<unsigned int> order(vertexCount);
+            for (unsigned int i = 0; i < vertexCount; ++i)
+                order[i] = i;
+            std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+                const glm::vec3& p = read[a];
+                const glm::vec3& q = read[b];
+                return p.x != q.x ? p.x < q.x : p.y != q.y ? p.y < q.y : p.z < q.z;
+            });
+
+            wedgePosition.resize(vertexCount);
+            for (std::size_t i = 0; i < vertexCount; ++i)
+            {
+                if (i == 0 || read[order[i]] != read[order[i - 1]])
+                    points.push_back(read[order[i]]);
+                wedgePosition[order[i]] = static_cast<unsigned int>(points.size() - 1);
+            }
+        }
+
+        unsigned int positionOf(unsigned int triangle, int corner) const
+        {
+            return wedgePosition[triangles[triangle * 3 + corner]];
+        }
+
+        bool hasPosition(unsigned int triangle, unsigned int position) const
+        {
+            return positionOf(triangle, 0) == position || positionOf(triangle, 1) == position || positionOf(triangle, 2) == position;
+        }
+
+        void computeQuadrics()
+        {
+            // edges as (min position, max position) to find the open borders
+            std::vector<std::pair<std::uint64_t, unsigned int>> edges;
+            edges.reserve(triangles.size());
+
+            for (unsigned int t = 0; t < alive.size(); ++t)
+            {
+                const glm::dvec3 a = points[positionOf(t, 0)];
+                const glm::dvec3 b = points[positionOf(t, 1)];
+                const glm::dvec3 c = points[positionOf(t, 2)];
+                const glm::dvec3 n = glm::cross(b - a, c - a);
+                const double length = glm::length(n);
+                if (length > 0.0)
+                {
+                    Quadric q;
+                    q.addPlane(n / length, -glm::dot(n / length, a), 0.5 * length);
+                    for (int k = 0; k < 3; ++k)
+                        quadrics[positionOf(t, k)] += q;
+                }
+
+                for (int k = 0; k < 3; ++k)
+                {
+                    const std::uint64_t p0 = positionOf(t, k), p1 = positionOf(t, (k + 1) % 3);
+                    edges.push_back({ std::min(p0, p1) << 32 | std::max(p0, p1), t });
+                }
+            }
+
+            std::sort(edges.begin(), edges.end());
+            for (std::size_t i = 0; i < edges.size();)
+            {
+                std::size_t j = i;
+                while (j < edges.size() && edges[j].first == edges[i].first)
+                    ++j;
+
+                const unsigned int p0 = static_cast<unsigned int>(edges[i].first >> 32);
+                const unsigned int p1 = static_cast<unsigned int>(edges[i].first & 0xffffffffu);
+                if (j - i == 1)
+                {
+                    // keep the border in place with a plane through the edge, perpendicular to the triangle
+                    border[p0] = border[p1] = 1;
+
+                    const unsigned int t = edges[i].second;
+                    const glm::dvec3 a = points[positionOf(t, 0)];
+                    const glm::dvec3 n = glm::cross(glm::dvec3(points[positionOf(t, 1)]) - a, glm::dvec3(points[positionOf(t, 2)]) - a);
+                    const glm::dvec3 e = glm::dvec3(points[p1]) - glm::dvec3(points[p0]);
+                    const glm::dvec3 side = glm::cross(e, n);
+                    const double length = glm::length(side);
+                    if (length > 0.0)
+                    {
+                        Quadric q;
+                        q.addPlane(side / length, -glm::dot(side / length, glm::dvec3(points[p0])), BORDER_WEIGHT * glm::dot(e, e));
+                        quadrics[p0] += q;
+                        quadrics[p1] += q;
+                    }
+                }
+
+                queue.push({ collapseCost(p0, p1), p0, p1 });
+                queue.push({ collapseCost(p1, p0), p1, p0 });
+                i = j;
+            }
+        }
+
+        double collapseCost(unsigned int from, unsigned int to) const
+        {
+            Quadric q = quadrics[from];
+            q += quadrics[to];
+            return q.error(points[to]);
+        }
+
+        bool canCollapse(unsigned int from, unsigned int to)
+        {
+            wedgeMap.clear();
+            std::size_t shared = 0;
+
+            // every vertex of 'from' needs a vertex of 'to' with the same attributes to move
+            // to, i.e. one that shares a triangle with it
+            for (unsigned int t : positionTriangles[from])
+            {
+                if (!alive[t] || !hasPosition(t, to))
+                    continue;
+                ++shared;
+
+                unsigned int fromVertex = 0, toVertex = 0;
+                for (int k = 0; k < 3; ++k)
+                {
+                    const unsigned int vertex = triangles[t * 3 + k];
+                    if (wedgePosition[vertex] == from) fromVertex = vertex;
+                    if (wedgePosition[vertex] == to) toVertex = vertex;
+                }
+                const auto it = std::find_if(wedgeMap.begin(), wedgeMap.end(), [&](const std::pair<unsigned int, unsigned int>& m) { return m.first == fromVertex; });
+                if (it == wedgeMap.end())
+                    wedgeMap.push_back({ fromVertex, toVertex });
+            }
+
+            if (shared == 0)
+            {
+                return false;   // not connected anymore
+            }
+            if (border[from] && (!border[to] || shared != 1))
+            {
+                return false;   // border vertices only slide along the border
+            }
+
+            for (unsigned int t : positionTriangles[from])
+            {
+                if (!alive[t] || hasPosition(t, to))
+                    continue;
+
+                glm::vec3 p[3], q[3];
+                for (int k = 0; k < 3; ++k)
+                {
+                    const unsigned int vertex = triangles[t * 3 + k];
+                    const auto it = std::find_if(wedgeMap.begin(), wedgeMap.end(), [&](const std::pair<unsigned int, unsigned int>& m) { return m.first == vertex; });
+                    if (wedgePosition[vertex] == from && it == wedgeMap.end())
+                    {
+                        return false;   // would tear a seam
+                    }
+                    p[k] = points[wedgePosition[vertex]];
+                    q[k] = wedgePosition[vertex] == from ? points[to] : p[k];
+                }
+
+                // don't flip triangles
+                const glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                const glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+                if (glm::dot(before, after) <= 0.0f)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // expects canCollapse(from, to) to have filled wedgeMap
+        void collapse(unsigned int from, unsigned int to)
+        {
+            removed[from] = 1;
+            quadrics[to] += quadrics[from];
+
+            for (unsigned int t : positionTriangles[from])
+            {
+                if (!alive[t])
+                    continue;
+
+                if (hasPosition(t, to))
+                {
+                    alive[t] = 0;
+                    --liveTriangles;
+                    continue;
+                }
+
+                for (int k = 0; k < 3; ++k)
+                {
+                    unsigned int& vertex = triangles[t * 3 + k];
+                    if (wedgePosition[vertex] == from)
+                    {
+                        for (const auto& m : wedgeMap)
+                        {
+                            if (m.first == vertex)
+                                vertex = m.second;
+                        }
+                    }
+                }
+                positionTriangles[to].push_back(t);
+            }
+            positionTriangles[from].clear();
+
+            // drop the dead triangles and queue the edges around the merged vertex
+            std::vector<unsigned int>& around = positionTriangles[to];
+            around.erase(std::remove_if(around.begin(), around.end(), [&](unsigned int t) { return !alive[t]; }), around.end());
+            for (unsigned int t : around)
+            {
+                for (int k = 0; k < 3; ++k)
+                {
+                    const unsigned int neighbour = positionOf(t, k);
+                    if (neighbour == to)
+                        continue;
+                    queue.push({ collapseCost(neighbour, to), neighbour, to });
+                    queue.push({ collapseCost(to, neighbour), to, neighbour });
+                }
+            }
+        }
+    };
+}
+
+std::vector<MeshLod> LodBuilder::build(const void* positions, std::size_t positionStride, std::size_t vertexCount,
+                                       std::vector<unsigned int>& indices)
+{
+    std::vector<MeshLod> lods;
+
+    const std::size_t indexCount = indices.size();
+    lods.push_back({ 0, static_cast<unsigned int>(indexCount), 0.0f });
+    if (indexCount / 3 < 2 * MIN_TRIANGLES)
+    {
+        return lods;
+    }
+
+    // one simplification run, snapshotted at every level
+    Simplifier simplifier(positions, positionStride, vertexCount, indices, indexCount);
+    std::size_t previous = indexCount / 3;
+
+    while (lods.size() < MAX_LODS)
+    {
+        const std::size_t target = static_cast<std::size_t>(previous * REDUCTION);
+        if (target < MIN_TRIANGLES)
+        {
+            break;
+        }
+
+        const bool reached = simplifier.simplify(target);
+        const std::size_t triangles = simplifier.triangleCount();
+        if (triangles > previous * 0.9f)
+        {
+            break;  // seams and borders keep it from getting any simpler
+        }
+
+        MeshLod lod;
+        lod.firstIndex = static_cast<unsigned int>(indices.size());
+        simplifier.appendTriangles(indices);
+        lod.indexCount = static_cast<unsigned int>(indices.size()) - lod.firstIndex;
+        lod.error = static_cast<float>(simplifier.maxError());
+        lods.push_back(lod);
+
+        previous = triangles;
+        if (!reached)
+        {
+            break;
+        }
+    }
+
+    return lods;
+}
+
+void LodSelector::setView(const glm::vec3& cameraPosition, const glm::mat4& projection, float viewportHeight)
+{
+    this->cameraPosition = cameraPosition;
+    // projection[1][1] = 1 / tan(fovy / 2)
+    pixelsPerUnit = projection[1][1] * viewportHeight * 0.5f;
+}
+
+float LodSelector::projectedError(float error, const glm::vec3& center, float scale) const
+{
+    const float distance = std::max(glm::length(center - cameraPosition), 1e-3f);
+    return error * scale * pixelsPerUnit / distance;
+}
+
+unsigned int LodSelector::select(const std::vector<float>& errors, const glm::vec3& center, float scale,
+                                 unsigned int current, LodPass pass) const
+{
+    if (errors.empty())
+    {
+        return 0;
+    }
+
+    const float threshold = pixelError * (pass == LodPass::SHADOW ? shadowBias : 1.0f);
+    const float distance = std::max(glm::length(center - cameraPosition), 1e-3f);
+    const float toPixels = scale * pixelsPerUnit / distance;
+
+    // coarsest level within the given error
+    auto coarsest = [&](float limit) {
+        unsigned int level = 0;
+        while (level + 1 < errors.size() && errors[level + 1] * toPixels <= limit)
+            ++level;
+        return level;
+    };
+
+    current = std::min(current, static_cast<unsigned int>(errors.size() - 1));
+
+    const unsigned int coarser = coarsest(threshold * (1.0f - hysteresis));
+    if (coarser > current)
+    {
+        return coarser;
+    }
+    if (errors[current] * toPixels > threshold * (1.0f + hysteresis))
+    {
+        return coarsest(threshold);
+    }
+    return current;
+}
@@ -0,0 +1,73 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+// One level of detail of a mesh: a range of the mesh's index buffer. All levels share the
+// vertices of the full detail mesh, level 0 being the original triangles.
+struct MeshLod
+{
+    unsigned int firstIndex;    // relative to the mesh's first index
+    unsigned int indexCount;
+    float error;                // object space deviation from level 0 (0 for level 0)
+};
+
+// Builds LOD chains with quadric error edge collapses (Garland & Heckbert). Vertices only
+// ever collapse onto a neighbouring vertex, so no vertices are added and every level can
+// index into the same vertex buffer. UV/normal seams only collapse along the seam and open
+// borders only along the border, so attributes don't tear and outlines are kept.
+class LodBuilder
+{
+public:
+    static constexpr unsigned int MAX_LODS = 5;             // including level 0
+    static constexpr unsigned int MIN_TRIANGLES = 32;       // don't go below this
+    static constexpr float REDUCTION = 0.5f;                // triangles kept per level
+
+    // indices[0, indices.size()) becomes level 0, the coarser levels are appended to indices.
+    // positions are read with the given byte stride.
+    static std::vector<MeshLod> build(const void* positions, std::size_t positionStride, std::size_t vertexCount,
+                                      std::vector<unsigned int>& indices);
+};
+
+enum class LodPass
+{
+    MAIN,
+    SHADOW,
+};
+
+// Picks a level per object from the projected (screen space) error of the levels.
+//
+// An object switches to a coarser level once that level's error drops below
+// (1 - hysteresis) * pixelError, and back to a finer one only once the current level's error
+// exceeds (1 + hysteresis) * pixelError, so objects near a threshold don't flicker between
+// levels. Shadow passes accept shadowBias times more error, since shadow casters are seen
+// blurred through the shadow map filter; keep a separate current level per pass.
+class LodSelector
+{
+public:
+    float pixelError = 1.0f;
+    float hysteresis = 0.25f;
+    float shadowBias = 4.0f;
+
+    // projection is the main camera's, shadow passes select from the main camera too
+    void setView(const glm::vec3& cameraPosition, const glm::mat4& projection, float viewportHeight);
+
+    // pixels covered by an object space error at the given world space position and scale
+    float projectedError(float error, const glm::vec3& center, float scale) const;
+
+    // errors[k]: object space error of level k, non decreasing
+    unsigned int select(const std::vector<float>& errors, const glm::vec3& center, float scale,
+                        unsigned int current, LodPass pass = LodPass::MAIN) const;
+
+    const glm::vec3& getCameraPosition() const { return cameraPosition; }
+
+private:
+    glm::vec3 cameraPosition = glm::vec3(0.0f);
+    float pixelsPerUnit = 1.0f;     // at distance 1
+};
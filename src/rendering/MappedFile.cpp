@@ -0,0 +1,127 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path)
+{
+    close();
+
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        file = nullptr;
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize))
+    {
+        close();
+        return false;
+    }
+
+    length = static_cast<std::size_t>(fileSize.QuadPart);
+    opened = true;
+    if (length == 0)
+    {
+        // nothing to map
+        return true;
+    }
+
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping)
+        bytes = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+
+    if (!bytes)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (bytes)
+        UnmapViewOfFile(bytes);
+    if (mapping)
+        CloseHandle(mapping);
+    if (file)
+        CloseHandle(file);
+
+    bytes = nullptr;
+    mapping = nullptr;
+    file = nullptr;
+    length = 0;
+    opened = false;
+}
+
+#else
+
+bool MappedFile::open(const std::string& path)
+{
+    close();
+
+    descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0)
+    {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(descriptor, &info) != 0)
+    {
+        close();
+        return false;
+    }
+
+    length = static_cast<std::size_t>(info.st_size);
+    opened = true;
+    if (length == 0)
+    {
+        // mmap refuses zero length mappings
+        return true;
+    }
+
+    void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    if (mapped == MAP_FAILED)
+    {
+        close();
+        return false;
+    }
+
+    // files are mapped to be parsed right away, start reading all of it in
+    madvise(mapped, length, MADV_WILLNEED);
+    bytes = static_cast<const char*>(mapped);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (bytes)
+        munmap(const_cast<char*>(bytes), length);
+    if (descriptor >= 0)
+        ::close(descriptor);
+
+    bytes = nullptr;
+    descriptor = -1;
+    length = 0;
+    opened = false;
+}
+
+#endif
@@ -8,82 +8,125 @@
 
 #include <glad/glad.h> // holds all OpenGL type declarations
 #include <glm/glm.hpp>
+#include <utility>
 #include <vector>
 
-struct Vertex
-{
-    // position
-    glm::vec3 Position;
-    // normal
-    glm::vec3 Normal;
-    // texCoords
-    glm::vec2 TexCoords;
-};
+#include "Bounds.h"
+#include "Bvh.h"
+#include "GeometryArena.h"
+#include "Lod.h"
+#include "Meshlet.h"
+#include "VertexLayout.h"
 
-class Mesh
+// a mesh whose vertex format is described by a VertexLayout (see VertexLayout.h)
+template <typename Layout>
+class BasicMesh
 {
 public:
+    using Vertex = typename Layout::Vertex;
+
+    using Arena = GeometryArena<Layout>;
+
     /*  Mesh Data  */
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
-    unsigned int VAO;
+    // clusters of the index buffer, empty unless the mesh was cooked (see Model)
+    std::vector<Meshlet> meshlets;
+    // levels of detail as ranges of indices, empty if the mesh only has its full detail
+    std::vector<MeshLod> lods;
+    // object space bounds of the vertices
+    Bounds bounds;
+    // range of the shared vertex/index buffers of this layout
+    typename Arena::Allocation allocation;
 
     /*  Functions  */
     // constructor
-    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices)
+    BasicMesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Meshlet> meshlets = {}, std::vector<MeshLod> lods = {})
     {
-        this->vertices = vertices;
-        this->indices = indices;
+        this->vertices = std::move(vertices);
+        this->indices = std::move(indices);
+        this->meshlets = std::move(meshlets);
+        this->lods = std::move(lods);
 
-        // now that we have all the required data, set the vertex buffers and its attribute pointers.
+        // now that we have all the required data, copy it into the geometry arena.
         setupMesh();
     }
 
     // render the mesh
-    void Draw()
+    void Draw(unsigned int level = 0) const
+    {
+        Arena::get().bind();
+        DrawRange(level);
+    }
+
+    // render the mesh, expecting the arena VAO to be bound already (see Arena::bind())
+    void DrawRange(unsigned int level = 0) const
+    {
+        const MeshLod range = lod(level);
+        Arena::get().drawRange(allocation, range.firstIndex, range.indexCount);
+    }
+
+    // render instanceCount copies, placed by the bound InstanceBuffer
+    void DrawInstanced(std::size_t instanceCount, unsigned int level = 0) const
+    {
+        Arena::get().bind();
+        DrawRangeInstanced(instanceCount, level);
+    }
+
+    void DrawRangeInstanced(std::size_t instanceCount, unsigned int level = 0) const
     {
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+        const MeshLod range = lod(level);
+        Arena::get().drawRangeInstanced(allocation, range.firstIndex, range.indexCount, instanceCount);
+    }
+
+    // closest hit of an object space ray with the full detail triangles.
+    // The triangle BVH is built on the first call.
+    bool raycast(const Ray& ray, float& t, float maxT = FLT_MAX) const
+    {
+        if (!triangles.built() && !vertices.empty())
+        {
+            const MeshLod range = lod(0);
+            triangles.build(&vertices[0].Position, sizeof(Vertex), vertices.size(), indices.data() + range.firstIndex, range.indexCount);
+        }
+        return triangles.closestHit(ray, t, maxT) != ~0u;
+    }
+
+    unsigned int lodCount() const { return lods.empty() ? 1 : static_cast<unsigned int>(lods.size()); }
+
+    // the given level, or the coarsest one if there are fewer levels
+    MeshLod lod(unsigned int level) const
+    {
+        if (lods.empty())
+        {
+            return MeshLod{ 0, static_cast<unsigned int>(indices.size()), 0.0f };
+        }
+        return lods[level < lods.size() ? level : lods.size() - 1];
+    }
+
+    // gives the buffer ranges back to the arena. Meshes are copied around by value,
+    // so this is left to the owner (e.g. Model) instead of the destructor.
+    void release()
+    {
+        Arena::get().release(allocation);
     }
 
 private:
-    /*  Render data  */
-    unsigned int VBO, EBO;
+    mutable TriangleBvh triangles;
 
     /*  Functions    */
-    // initializes all the buffer objects/arrays
+    // uploads vertices and indices into the arena of this layout
     void setupMesh()
     {
-        // create buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-
-        glBindVertexArray(VAO);
-        // load data into vertex buffers
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
         // A great thing about structs is that their memory layout is sequential for all its items.
         // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
         // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-        // set the vertex attribute pointers
-        // vertex Positions
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        // vertex texture coords
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-
-        glBindVertexArray(0);
+        allocation = Arena::get().upload(vertices, indices);
+
+        if (!vertices.empty())
+            bounds = Bounds::fromPoints(&vertices[0].Position, sizeof(Vertex), vertices.size());
     }
 };
+
+using Vertex = DefaultLayout::Vertex;
+using Mesh = BasicMesh<DefaultLayout>;
 #endif
\ No newline at end of file
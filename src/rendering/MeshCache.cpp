@@ -0,0 +1,196 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include "MeshCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <helpers/RootDir.h>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    const char MAGIC[4] = { 'C', 'M', 'S', 'H' };
+
+    template <typename T>
+    void write(std::ofstream& out, const T& value)
+    {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    void writeArray(std::ofstream& out, const std::vector<T>& values)
+    {
+        if (!values.empty())
+            out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+
+    template <typename T>
+    bool read(std::ifstream& in, T& value)
+    {
+        return bool(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+    }
+
+    template <typename T>
+    bool readArray(std::ifstream& in, std::vector<T>& values, std::size_t count)
+    {
+        values.resize(count);
+        return count == 0 || bool(in.read(reinterpret_cast<char*>(values.data()), count * sizeof(T)));
+    }
+
+    // whether every index names one of the vertices, and the meshlets and levels stay in the indices
+    bool validMesh(const CookedMesh& mesh, std::uint32_t vertexCount)
+    {
+        for (unsigned int index : mesh.indices)
+        {
+            if (index >= vertexCount)
+                return false;
+        }
+
+        const std::uint64_t indexCount = mesh.indices.size();
+        for (const Meshlet& meshlet : mesh.meshlets)
+        {
+            if (std::uint64_t(meshlet.firstIndex) + meshlet.indexCount > indexCount)
+                return false;
+        }
+        for (const MeshLod& lod : mesh.lods)
+        {
+            if (std::uint64_t(lod.firstIndex) + lod.indexCount > indexCount)
+                return false;
+        }
+        return true;
+    }
+}
+
+std::string MeshCache::cachePath(const std::string& sourcePath, std::uint32_t layoutSignature)
+{
+    std::string name = sourcePath;
+    for (char& c : name)
+    {
+        if (c == '/' || c == '\\' || c == ':')
+            c = '_';
+    }
+
+    char signature[16];
+    snprintf(signature, sizeof(signature), "%08x", layoutSignature);
+
+    return std::string(ROOT_DIR) + "res/cache/" + name + "." + signature + ".cmesh";
+}
+
+bool MeshCache::load(const std::string& sourcePath, std::uint32_t layoutSignature, std::uint32_t vertexStride,
+                     std::vector<CookedMesh>& meshes)
+{
+    const std::string path = cachePath(sourcePath, layoutSignature);
+
+    std::error_code error;
+    const fs::file_time_type cacheTime = fs::last_write_time(path, error);
+    if (error)
+    {
+        return false;
+    }
+    const fs::file_time_type sourceTime = fs::last_write_time(ROOT_DIR + sourcePath, error);
+    if (!error && sourceTime > cacheTime)
+    {
+        return false;
+    }
+
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+        return false;
+    }
+
+    char magic[4];
+    std::uint32_t version, signature, stride, meshCount;
+    if (!in.read(magic, 4) || std::memcmp(magic, MAGIC, 4) != 0 ||
+        !read(in, version) || version != VERSION ||
+        !read(in, signature) || signature != layoutSignature ||
+        !read(in, stride) || stride != vertexStride ||
+        !read(in, meshCount))
+    {
+        return false;
+    }
+
+    // counts are checked against what is left of the file before anything is allocated from them
+    const std::streamoff headerEnd = in.tellg();
+    in.seekg(0, std::ios::end);
+    std::uint64_t remaining = std::uint64_t(in.tellg() - headerEnd);
+    in.seekg(headerEnd);
+
+    const std::uint64_t meshHeaderBytes = 4 * sizeof(std::uint32_t);
+    if (meshCount * meshHeaderBytes > remaining)
+    {
+        fprintf(stderr, "Corrupt mesh cache %s\n", path.c_str());
+        return false;
+    }
+
+    std::vector<CookedMesh> loaded(meshCount);
+    for (CookedMesh& mesh : loaded)
+    {
+        std::uint32_t vertexCount, indexCount, meshletCount, lodCount;
+        if (!read(in, vertexCount) || !read(in, indexCount) || !read(in, meshletCount) || !read(in, lodCount))
+        {
+            fprintf(stderr, "Corrupt mesh cache %s\n", path.c_str());
+            return false;
+        }
+
+        // the counts are 32 bits, so none of the products overflow
+        const std::uint64_t bytes = std::uint64_t(vertexCount) * vertexStride + std::uint64_t(indexCount) * sizeof(unsigned int) +
+                                    std::uint64_t(meshletCount) * sizeof(Meshlet) + std::uint64_t(lodCount) * sizeof(MeshLod);
+        remaining -= meshHeaderBytes;
+        if (bytes > remaining ||
+            !readArray(in, mesh.vertexData, std::size_t(vertexCount) * vertexStride) ||
+            !readArray(in, mesh.indices, indexCount) ||
+            !readArray(in, mesh.meshlets, meshletCount) ||
+            !readArray(in, mesh.lods, lodCount) ||
+            !validMesh(mesh, vertexCount))
+        {
+            fprintf(stderr, "Corrupt mesh cache %s\n", path.c_str());
+            return false;
+        }
+        remaining -= bytes;
+    }
+
+    meshes.swap(loaded);
+    return true;
+}
+
+bool MeshCache::save(const std::string& sourcePath, std::uint32_t layoutSignature, std::uint32_t vertexStride,
+                     const std::vector<CookedMesh>& meshes)
+{
+    const std::string path = cachePath(sourcePath, layoutSignature);
+
+    std::error_code error;
+    fs::create_directories(fs::path(path).parent_path(), error);
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        fprintf(stderr, "Could not write mesh cache %s\n", path.c_str());
+        return false;
+    }
+
+    out.write(MAGIC, 4);
+    write(out, VERSION);
+    write(out, layoutSignature);
+    write(out, vertexStride);
+    write(out, static_cast<std::uint32_t>(meshes.size()));
+
+    for (const CookedMesh& mesh : meshes)
+    {
+        write(out, static_cast<std::uint32_t>(mesh.vertexData.size() / vertexStride));
+        write(out, static_cast<std::uint32_t>(mesh.indices.size()));
+        write(out, static_cast<std::uint32_t>(mesh.meshlets.size()));
+        write(out, static_cast<std::uint32_t>(mesh.lods.size()));
+        writeArray(out, mesh.vertexData);
+        writeArray(out, mesh.indices);
+        writeArray(out, mesh.meshlets);
+        writeArray(out, mesh.lods);
+    }
+
+    return bool(out);
+}
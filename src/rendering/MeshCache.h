@@ -0,0 +1,44 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Lod.h"
+#include "Meshlet.h"
+
+// Mesh data after import and processing, independent of the vertex type.
+struct CookedMesh
+{
+    std::vector<unsigned char> vertexData;  // interleaved vertices, vertexStride bytes each
+    std::vector<unsigned int> indices;      // level 0 in meshlet order, followed by the coarser levels
+    std::vector<Meshlet> meshlets;          // of level 0
+    std::vector<MeshLod> lods;
+};
+
+// Binary cache of cooked meshes under res/cache/, so that models only go through the
+// importer, the meshlet builder and the LOD builder once. A cache file is keyed by the source path and the
+// vertex layout signature, and is ignored once the source file is newer than it.
+//
+// File layout (little endian, no padding):
+//   char[4] "CMSH", u32 version, u32 layout signature, u32 vertex stride, u32 mesh count
+//   per mesh: u32 vertex count, u32 index count, u32 meshlet count, u32 lod count,
+//             vertex data, indices, meshlets, lods
+class MeshCache
+{
+public:
+    static constexpr std::uint32_t VERSION = 4;
+
+    static std::string cachePath(const std::string& sourcePath, std::uint32_t layoutSignature);
+
+    // returns false if there is no up to date cache for this source and layout
+    static bool load(const std::string& sourcePath, std::uint32_t layoutSignature, std::uint32_t vertexStride,
+                     std::vector<CookedMesh>& meshes);
+
+    static bool save(const std::string& sourcePath, std::uint32_t layoutSignature, std::uint32_t vertexStride,
+                     const std::vector<CookedMesh>& meshes);
+};
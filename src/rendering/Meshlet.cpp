@@ -0,0 +1,279 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include "Meshlet.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    glm::vec3 readPosition(const void* positions, std::size_t stride, unsigned int vertex)
+    {
+        glm::vec3 p;
+        std::memcpy(&p, static_cast<const char*>(positions) + vertex * stride, sizeof(glm::vec3));
+        return p;
+    }
+
+    void computeBounds(Meshlet& meshlet, const std::vector<unsigned int>& indices,
+                       const void* positions, std::size_t stride)
+    {
+        const unsigned int* tri = &indices[meshlet.firstIndex];
+        const unsigned int triangleCount = meshlet.indexCount / 3;
+
+        // sphere around the center of the bounding box
+        glm::vec3 min(FLT_MAX), max(-FLT_MAX);
+        for (unsigned int i = 0; i < meshlet.indexCount; ++i)
+        {
+            const glm::vec3 p = readPosition(positions, stride, tri[i]);
+            min = glm::min(min, p);
+            max = glm::max(max, p);
+        }
+        meshlet.center = 0.5f * (min + max);
+        meshlet.radius = 0.0f;
+        for (unsigned int i = 0; i < meshlet.indexCount; ++i)
+        {
+            meshlet.radius = std::max(meshlet.radius, glm::length(readPosition(positions, stride, tri[i]) - meshlet.center));
+        }
+
+        // normal cone around the average triangle normal
+        std::vector<glm::vec3> normals;
+        normals.reserve(triangleCount);
+        glm::vec3 axis(0.0f);
+        for (unsigned int t = 0; t < triangleCount; ++t)
+        {
+            const glm::vec3 a = readPosition(positions, stride, tri[t * 3 + 0]);
+            const glm::vec3 b = readPosition(positions, stride, tri[t * 3 + 1]);
+            const glm::vec3 c = readPosition(positions, stride, tri[t * 3 + 2]);
+            const glm::vec3 n = glm::cross(b - a, c - a);
+            const float length = glm::length(n);
+            if (length > 0.0f)
+            {
+                normals.push_back(n / length);
+                axis += n / length;
+            }
+        }
+
+        meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+        meshlet.coneCutoff = 1.0f;
+
+        const float axisLength = glm::length(axis);
+        if (normals.empty() || axisLength < 1e-6f)
+        {
+            return;
+        }
+        axis /= axisLength;
+
+        float minDot = 1.0f;
+        for (const glm::vec3& n : normals)
+        {
+            minDot = std::min(minDot, glm::dot(axis, n));
+        }
+
+        meshlet.coneAxis = axis;
+        // a cone wider than a hemisphere can never be entirely backfacing
+        meshlet.coneCutoff = minDot <= 0.0f ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+    }
+}
+
+std::vector<Meshlet> MeshletBuilder::build(const void* positions, std::size_t positionStride, std::size_t vertexCount,
+                                           std::vector<unsigned int>& indices)
+{
+    std::vector<Meshlet> meshlets;
+    const std::size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+    {
+        return meshlets;
+    }
+
+    // vertex -> triangles adjacency, compressed rows
+    std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+    for (unsigned int index : indices)
+    {
+        adjacencyOffsets[index + 1]++;
+    }
+    for (std::size_t v = 0; v < vertexCount; ++v)
+    {
+        adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+    }
+    std::vector<unsigned int> adjacency(indices.size());
+    {
+        std::vector<unsigned int> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (std::size_t i = 0; i < indices.size(); ++i)
+        {
+            adjacency[cursor[indices[i]]++] = static_cast<unsigned int>(i / 3);
+        }
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<bool> inMeshlet(vertexCount, false);
+    std::vector<unsigned int> meshletVertices;
+    std::vector<unsigned int> meshletTriangles;
+
+    std::vector<unsigned int> reordered;
+    reordered.reserve(indices.size());
+
+    auto newVertexCount = [&](std::size_t t)
+    {
+        return unsigned(!inMeshlet[indices[t * 3 + 0]]) + unsigned(!inMeshlet[indices[t * 3 + 1]]) + unsigned(!inMeshlet[indices[t * 3 + 2]]);
+    };
+
+    auto finishMeshlet = [&]()
+    {
+        Meshlet meshlet;
+        meshlet.firstIndex = static_cast<unsigned int>(reordered.size());
+        meshlet.indexCount = static_cast<unsigned int>(meshletTriangles.size() * 3);
+        meshlet.vertexCount = static_cast<unsigned int>(meshletVertices.size());
+        for (unsigned int t : meshletTriangles)
+        {
+            reordered.insert(reordered.end(), indices.begin() + t * 3, indices.begin() + t * 3 + 3);
+        }
+        meshlets.push_back(meshlet);
+
+        for (unsigned int v : meshletVertices)
+        {
+            inMeshlet[v] = false;
+        }
+        meshletVertices.clear();
+        meshletTriangles.clear();
+    };
+
+    std::size_t nextSeed = 0;
+    while (true)
+    {
+        // grow the meshlet with the neighbouring triangle that adds the fewest new vertices
+        std::size_t best = triangleCount;
+        unsigned int bestNew = 4;
+        for (unsigned int v : meshletVertices)
+        {
+            for (unsigned int a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1] && bestNew > 0; ++a)
+            {
+                const unsigned int t = adjacency[a];
+                if (emitted[t])
+                    continue;
+
+                const unsigned int added = newVertexCount(t);
+                if (added < bestNew)
+                {
+                    best = t;
+                    bestNew = added;
+                }
+            }
+        }
+
+        // nothing connected left, continue with the next unused triangle in input order
+        if (best == triangleCount)
+        {
+            while (nextSeed < triangleCount && emitted[nextSeed])
+                ++nextSeed;
+            if (nextSeed == triangleCount)
+                break;
+
+            best = nextSeed;
+            bestNew = newVertexCount(best);
+        }
+
+        if (meshletVertices.size() + bestNew > MAX_VERTICES || meshletTriangles.size() + 1 > MAX_TRIANGLES)
+        {
+            finishMeshlet();
+            continue;
+        }
+
+        emitted[best] = true;
+        meshletTriangles.push_back(static_cast<unsigned int>(best));
+        for (int k = 0; k < 3; ++k)
+        {
+            const unsigned int v = indices[best * 3 + k];
+            if (!inMeshlet[v])
+            {
+                inMeshlet[v] = true;
+                meshletVertices.push_back(v);
+            }
+        }
+    }
+
+    if (!meshletTriangles.empty())
+    {
+        finishMeshlet();
+    }
+
+    indices.swap(reordered);
+
+    for (Meshlet& meshlet : meshlets)
+    {
+        computeBounds(meshlet, indices, positions, positionStride);
+    }
+
+    return meshlets;
+}
+
+void MeshletCuller::cull(const std::vector<Meshlet>& meshlets, const Params& params, std::vector<DrawElementsIndirectCommand>& commands)
+{
+    if (meshlets.empty())
+    {
+        return;
+    }
+
+    const glm::mat3 rotationScale(params.modelMatrix);
+    const float maxScale = std::sqrt(std::max(glm::dot(rotationScale[0], rotationScale[0]),
+                                     std::max(glm::dot(rotationScale[1], rotationScale[1]),
+                                              glm::dot(rotationScale[2], rotationScale[2]))));
+
+    // each chunk writes its survivors into its own list, concatenated in order afterwards
+    const std::size_t grainSize = 256;
+    const std::size_t chunkCount = (meshlets.size() + grainSize - 1) / grainSize;
+    std::vector<std::vector<DrawElementsIndirectCommand>> chunkCommands(chunkCount);
+    std::vector<Stats> chunkStats(chunkCount);
+
+    parallelFor(meshlets.size(), grainSize, [&](std::size_t begin, std::size_t end)
+    {
+        const std::size_t chunk = begin / grainSize;
+        std::vector<DrawElementsIndirectCommand>& out = chunkCommands[chunk];
+        Stats& stats = chunkStats[chunk];
+
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            const Meshlet& meshlet = meshlets[i];
+            const glm::vec3 center = glm::vec3(params.modelMatrix * glm::vec4(meshlet.center, 1.0f));
+            const float radius = meshlet.radius * maxScale;
+
+            if (frustumCulling && !params.frustum.intersectsSphere(center, radius))
+            {
+                stats.frustumCulled++;
+                continue;
+            }
+
+            if (backfaceCulling && meshlet.coneCutoff < 1.0f)
+            {
+                const glm::vec3 axis = glm::normalize(rotationScale * meshlet.coneAxis);
+                const glm::vec3 toCluster = center - params.cameraPosition;
+                if (glm::dot(toCluster, axis) >= meshlet.coneCutoff * glm::length(toCluster) + radius)
+                {
+                    stats.backfaceCulled++;
+                    continue;
+                }
+            }
+
+            DrawElementsIndirectCommand command;
+            command.count = meshlet.indexCount;
+            command.instanceCount = 1;
+            command.firstIndex = params.firstIndex + meshlet.firstIndex;
+            command.baseVertex = params.baseVertex;
+            command.baseInstance = params.objectIndex;
+            out.push_back(command);
+        }
+    });
+
+    counters.total += meshlets.size();
+    for (std::size_t chunk = 0; chunk < chunkCount; ++chunk)
+    {
+        commands.insert(commands.end(), chunkCommands[chunk].begin(), chunkCommands[chunk].end());
+        counters.frustumCulled += chunkStats[chunk].frustumCulled;
+        counters.backfaceCulled += chunkStats[chunk].backfaceCulled;
+        counters.visible += chunkCommands[chunk].size();
+    }
+}
@@ -0,0 +1,80 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+#include "Frustum.h"
+#include "IndirectDraw.h"
+
+// A cluster of neighbouring triangles. The triangles of a meshlet are contiguous in the
+// (reordered) index buffer of its mesh, so a meshlet can be drawn as one indirect command.
+struct Meshlet
+{
+    unsigned int firstIndex;    // relative to the mesh's first index
+    unsigned int indexCount;
+    unsigned int vertexCount;   // unique vertices referenced by the meshlet
+
+    // bounding sphere
+    glm::vec3 center;
+    float radius;
+
+    // normal cone: every triangle normal is within acos(sqrt(1 - coneCutoff^2)) of coneAxis.
+    // coneCutoff >= 1 disables the backface test for this meshlet.
+    glm::vec3 coneAxis;
+    float coneCutoff;
+};
+
+class MeshletBuilder
+{
+public:
+    static constexpr unsigned int MAX_VERTICES = 64;
+    static constexpr unsigned int MAX_TRIANGLES = 124;
+
+    // Splits an indexed triangle list into meshlets. positions are read with the given byte
+    // stride (so interleaved vertices can be passed directly). indices is reordered in place
+    // so that the triangles of every meshlet end up contiguous.
+    static std::vector<Meshlet> build(const void* positions, std::size_t positionStride, std::size_t vertexCount,
+                                      std::vector<unsigned int>& indices);
+};
+
+// Rejects meshlets outside the view frustum or facing away from the camera, spread over
+// the job system, and emits one indirect draw command per surviving meshlet.
+class MeshletCuller
+{
+public:
+    struct Stats
+    {
+        std::size_t total = 0;
+        std::size_t frustumCulled = 0;
+        std::size_t backfaceCulled = 0;
+        std::size_t visible = 0;
+    };
+
+    struct Params
+    {
+        glm::mat4 modelMatrix;
+        Frustum frustum;            // world space
+        glm::vec3 cameraPosition;   // world space
+        unsigned int firstIndex;    // of the mesh in its geometry arena
+        int baseVertex;
+        unsigned int objectIndex;   // becomes the draw id (baseInstance)
+    };
+
+    // appends the visible meshlets to commands and accumulates the counters into stats()
+    void cull(const std::vector<Meshlet>& meshlets, const Params& params, std::vector<DrawElementsIndirectCommand>& commands);
+
+    void resetStats() { counters = Stats(); }
+    const Stats& stats() const { return counters; }
+
+    bool frustumCulling = true;
+    bool backfaceCulling = true;
+
+private:
+    Stats counters;
+};
@@ -0,0 +1,484 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include "MeshoptDecoder.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+    const unsigned char VERTEX_HEADER = 0xa0;
+    const unsigned char INDEX_HEADER = 0xe0;
+    const unsigned char SEQUENCE_HEADER = 0xd0;
+
+    // vertex codec: every byte of the vertex is a separate stream, delta coded per block of
+    // vertices and bit packed in groups of 16
+    const std::size_t BYTE_GROUP_SIZE = 16;
+    const std::size_t BYTE_GROUP_DECODE_LIMIT = 24;
+    const std::size_t VERTEX_BLOCK_SIZE_BYTES = 8192;
+    const std::size_t VERTEX_BLOCK_MAX_SIZE = 256;
+    const std::size_t TAIL_MAX_SIZE = 32;
+
+    std::size_t vertexBlockSize(std::size_t stride)
+    {
+        std::size_t result = VERTEX_BLOCK_SIZE_BYTES / stride;
+        result &= ~(BYTE_GROUP_SIZE - 1);
+        return result < VERTEX_BLOCK_MAX_SIZE ? result : VERTEX_BLOCK_MAX_SIZE;
+    }
+
+    inline unsigned char unzigzag8(unsigned char v)
+    {
+        return static_cast<unsigned char>(-(v & 1) ^ (v >> 1));
+    }
+
+    // 16 values of 0, 2, 4 or 8 bits. A value with all bits set is an escape, its byte
+    // follows after the packed bits.
+    const unsigned char* decodeBytesGroup(const unsigned char* data, unsigned char* buffer, int bitsLog2)
+    {
+        switch (bitsLog2)
+        {
+        case 0:
+            std::memset(buffer, 0, BYTE_GROUP_SIZE);
+            return data;
+        case 3:
+            std::memcpy(buffer, data, BYTE_GROUP_SIZE);
+            return data + BYTE_GROUP_SIZE;
+        default:
+        {
+            const int bits = 1 << bitsLog2;
+            const unsigned int escape = (1u << bits) - 1;
+            const unsigned char* extra = data + bits * 2;   // 16 values * bits / 8
+
+            for (std::size_t i = 0; i < BYTE_GROUP_SIZE; i += 8 / bits)
+            {
+                unsigned int byte = *data++;
+                for (int k = 0; k < 8 / bits; ++k)
+                {
+                    const unsigned int value = (byte >> (8 - bits)) & escape;
+                    byte <<= bits;
+                    buffer[i + k] = value == escape ? *extra++ : static_cast<unsigned char>(value);
+                }
+            }
+            return extra;
+        }
+        }
+    }
+
+    const unsigned char* decodeBytes(const unsigned char* data, const unsigned char* end, unsigned char* buffer, std::size_t size)
+    {
+        // 2 bits per group select its width
+        const unsigned char* header = data;
+        const std::size_t headerSize = (size / BYTE_GROUP_SIZE + 3) / 4;
+        if (std::size_t(end - data) < headerSize)
+        {
+            return nullptr;
+        }
+        data += headerSize;
+
+        for (std::size_t i = 0; i < size; i += BYTE_GROUP_SIZE)
+        {
+            // a group never reads more than this, which keeps the group decoder free of checks
+            if (std::size_t(end - data) < BYTE_GROUP_DECODE_LIMIT)
+                return nullptr;
+
+            const std::size_t group = i / BYTE_GROUP_SIZE;
+            const int bitsLog2 = (header[group / 4] >> ((group % 4) * 2)) & 3;
+            data = decodeBytesGroup(data, buffer + i, bitsLog2);
+        }
+        return data;
+    }
+
+    const unsigned char* decodeVertexBlock(const unsigned char* data, const unsigned char* end, unsigned char* vertices,
+                                           std::size_t count, std::size_t stride, unsigned char* lastVertex)
+    {
+        unsigned char buffer[VERTEX_BLOCK_MAX_SIZE];
+        unsigned char transposed[VERTEX_BLOCK_SIZE_BYTES];
+        const std::size_t alignedCount = (count + BYTE_GROUP_SIZE - 1) & ~(BYTE_GROUP_SIZE - 1);
+
+        for (std::size_t k = 0; k < stride; ++k)
+        {
+            data = decodeBytes(data, end, buffer, alignedCount);
+            if (!data)
+                return nullptr;
+
+            unsigned char previous = lastVertex[k];
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const unsigned char value = static_cast<unsigned char>(unzigzag8(buffer[i]) + previous);
+                transposed[i * stride + k] = value;
+                previous = value;
+            }
+        }
+
+        std::memcpy(vertices, transposed, count * stride);
+        std::memcpy(lastVertex, &transposed[stride * (count - 1)], stride);
+        return data;
+    }
+
+    inline unsigned int decodeVByte(const unsigned char*& data)
+    {
+        const unsigned char lead = *data++;
+        if (lead < 128)
+        {
+            return lead;
+        }
+
+        // up to 4 more bytes, so malformed input can't run away
+        unsigned int result = lead & 127;
+        unsigned int shift = 7;
+        for (int i = 0; i < 4; ++i)
+        {
+            const unsigned char group = *data++;
+            result |= unsigned(group & 127) << shift;
+            shift += 7;
+            if (group < 128)
+                break;
+        }
+        return result;
+    }
+
+    inline unsigned int decodeIndex(const unsigned char*& data, unsigned int last)
+    {
+        const unsigned int v = decodeVByte(data);
+        const unsigned int delta = (v >> 1) ^ (0u - (v & 1));
+        return last + delta;
+    }
+
+    inline void writeIndex(void* destination, std::size_t i, std::size_t indexSize, unsigned int value)
+    {
+        if (indexSize == 2)
+            static_cast<std::uint16_t*>(destination)[i] = static_cast<std::uint16_t>(value);
+        else
+            static_cast<std::uint32_t*>(destination)[i] = value;
+    }
+
+    inline void writeTriangle(void* destination, std::size_t i, std::size_t indexSize, unsigned int a, unsigned int b, unsigned int c)
+    {
+        writeIndex(destination, i + 0, indexSize, a);
+        writeIndex(destination, i + 1, indexSize, b);
+        writeIndex(destination, i + 2, indexSize, c);
+    }
+
+    // the 16 most recent edges / vertices, exactly as the encoder keeps them
+    struct Fifos
+    {
+        unsigned int edges[16][2];
+        unsigned int vertices[16];
+        std::size_t edgeOffset = 0;
+        std::size_t vertexOffset = 0;
+
+        Fifos()
+        {
+            std::memset(edges, -1, sizeof(edges));
+            std::memset(vertices, -1, sizeof(vertices));
+        }
+
+        void pushEdge(unsigned int a, unsigned int b)
+        {
+            edges[edgeOffset][0] = a;
+            edges[edgeOffset][1] = b;
+            edgeOffset = (edgeOffset + 1) & 15;
+        }
+
+        void pushVertex(unsigned int v, bool condition = true)
+        {
+            vertices[vertexOffset] = v;
+            vertexOffset = (vertexOffset + condition) & 15;
+        }
+    };
+
+    inline short roundToShort(float v)
+    {
+        return static_cast<short>(int(v + (v >= 0.0f ? 0.5f : -0.5f)));
+    }
+
+    template <typename T>
+    void octahedral(unsigned char* data, std::size_t count, std::size_t stride)
+    {
+        const float maximum = float((1 << (sizeof(T) * 8 - 1)) - 1);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            T v[4];
+            std::memcpy(v, data + i * stride, sizeof(v));
+
+            // z is stored as the sum of |x| + |y| + z at full scale
+            float x = float(v[0]);
+            float y = float(v[1]);
+            const float z = float(v[2]) - std::fabs(x) - std::fabs(y);
+
+            // unfold the lower hemisphere
+            const float t = z >= 0.0f ? 0.0f : z;
+            x += x >= 0.0f ? t : -t;
+            y += y >= 0.0f ? t : -t;
+
+            const float scale = maximum / std::sqrt(x * x + y * y + z * z);
+            v[0] = T(int(x * scale + (x >= 0.0f ? 0.5f : -0.5f)));
+            v[1] = T(int(y * scale + (y >= 0.0f ? 0.5f : -0.5f)));
+            v[2] = T(int(z * scale + (z >= 0.0f ? 0.5f : -0.5f)));
+            std::memcpy(data + i * stride, v, sizeof(v));
+        }
+    }
+}
+
+bool MeshoptDecoder::decodeVertexBuffer(void* destination, std::size_t count, std::size_t stride,
+                                        const unsigned char* buffer, std::size_t size)
+{
+    if (stride == 0 || stride > 256 || stride % 4 != 0)
+    {
+        return false;
+    }
+
+    const unsigned char* data = buffer;
+    const unsigned char* end = buffer + size;
+    if (size < 1 + stride || (*data & 0xf0) != VERTEX_HEADER || (*data & 0x0f) > 0)
+    {
+        return false;
+    }
+    ++data;
+
+    // the tail holds the first vertex, deltas of the first block are against it
+    unsigned char lastVertex[256];
+    std::memcpy(lastVertex, end - stride, stride);
+
+    unsigned char* vertices = static_cast<unsigned char*>(destination);
+    const std::size_t blockSize = vertexBlockSize(stride);
+    for (std::size_t offset = 0; offset < count; offset += blockSize)
+    {
+        const std::size_t block = offset + blockSize < count ? blockSize : count - offset;
+        data = decodeVertexBlock(data, end, vertices + offset * stride, block, stride, lastVertex);
+        if (!data)
+            return false;
+    }
+
+    const std::size_t tailSize = stride < TAIL_MAX_SIZE ? TAIL_MAX_SIZE : stride;
+    return std::size_t(end - data) == tailSize;
+}
+
+bool MeshoptDecoder::decodeIndexBuffer(void* destination, std::size_t count, std::size_t indexSize,
+                                       const unsigned char* buffer, std::size_t size)
+{
+    if (count % 3 != 0 || (indexSize != 2 && indexSize != 4))
+    {
+        return false;
+    }
+
+    // header, at least a byte per triangle and the 16 byte table of common codes
+    if (size < 1 + count / 3 + 16 || (buffer[0] & 0xf0) != INDEX_HEADER)
+    {
+        return false;
+    }
+    const int version = buffer[0] & 0x0f;
+    if (version > 1)
+    {
+        return false;
+    }
+
+    Fifos fifo;
+    unsigned int next = 0;
+    unsigned int last = 0;
+    // version 1 uses codes 13 and 14 for last -/+ 1
+    const int fifoCodes = version >= 1 ? 13 : 15;
+
+    const unsigned char* code = buffer + 1;
+    const unsigned char* data = code + count / 3;
+    const unsigned char* safeEnd = buffer + size - 16;
+    const unsigned char* codeTable = safeEnd;
+
+    for (std::size_t i = 0; i < count; i += 3)
+    {
+        // a triangle reads at most 16 bytes, which the code table at the end covers
+        if (data > safeEnd)
+            return false;
+
+        const unsigned char codeTriangle = *code++;
+        if (codeTriangle < 0xf0)
+        {
+            // an edge from the fifo and a third vertex
+            const std::size_t edge = (fifo.edgeOffset - 1 - (codeTriangle >> 4)) & 15;
+            const unsigned int a = fifo.edges[edge][0];
+            const unsigned int b = fifo.edges[edge][1];
+            const int fec = codeTriangle & 15;
+
+            if (fec < fifoCodes)
+            {
+                const unsigned int cached = fifo.vertices[(fifo.vertexOffset - 1 - fec) & 15];
+                const unsigned int c = fec == 0 ? next : cached;
+                next += fec == 0;
+
+                writeTriangle(destination, i, indexSize, a, b, c);
+                fifo.pushVertex(c, fec == 0);
+                fifo.pushEdge(c, b);
+                fifo.pushEdge(a, c);
+            }
+            else
+            {
+                // 13 / 14 decode to -1 / +1, 15 is an explicit delta
+                const unsigned int c = fec != 15 ? last + (fec - (fec ^ 3)) : decodeIndex(data, last);
+                last = c;
+
+                writeTriangle(destination, i, indexSize, a, b, c);
+                fifo.pushVertex(c);
+                fifo.pushEdge(c, b);
+                fifo.pushEdge(a, c);
+            }
+        }
+        else if (codeTriangle < 0xfe)
+        {
+            // three vertices, with the common fifo combinations in the table
+            const unsigned char codeAux = codeTable[codeTriangle & 15];
+            const int feb = codeAux >> 4;
+            const int fec = codeAux & 15;
+
+            const unsigned int a = next++;
+
+            const unsigned int cachedB = fifo.vertices[(fifo.vertexOffset - feb) & 15];
+            const unsigned int b = feb == 0 ? next : cachedB;
+            next += feb == 0;
+
+            const unsigned int cachedC = fifo.vertices[(fifo.vertexOffset - fec) & 15];
+            const unsigned int c = fec == 0 ? next : cachedC;
+            next += fec == 0;
+
+            writeTriangle(destination, i, indexSize, a, b, c);
+            fifo.pushVertex(a);
+            fifo.pushVertex(b, feb == 0);
+            fifo.pushVertex(c, fec == 0);
+            fifo.pushEdge(b, a);
+            fifo.pushEdge(c, b);
+            fifo.pushEdge(a, c);
+        }
+        else
+        {
+            // same with the codes in a separate byte, 15 means an explicit index
+            const unsigned char codeAux = *data++;
+            const int fea = codeTriangle == 0xfe ? 0 : 15;
+            const int feb = codeAux >> 4;
+            const int fec = codeAux & 15;
+
+            if (codeAux == 0)
+                next = 0;
+
+            unsigned int a = fea == 0 ? next++ : 0;
+            unsigned int b = feb == 0 ? next++ : fifo.vertices[(fifo.vertexOffset - feb) & 15];
+            unsigned int c = fec == 0 ? next++ : fifo.vertices[(fifo.vertexOffset - fec) & 15];
+
+            if (fea == 15)
+                last = a = decodeIndex(data, last);
+            if (feb == 15)
+                last = b = decodeIndex(data, last);
+            if (fec == 15)
+                last = c = decodeIndex(data, last);
+
+            writeTriangle(destination, i, indexSize, a, b, c);
+            fifo.pushVertex(a);
+            fifo.pushVertex(b, feb == 0 || feb == 15);
+            fifo.pushVertex(c, fec == 0 || fec == 15);
+            fifo.pushEdge(b, a);
+            fifo.pushEdge(c, b);
+            fifo.pushEdge(a, c);
+        }
+    }
+
+    // all data consumed, up to the code table
+    return data == safeEnd;
+}
+
+bool MeshoptDecoder::decodeIndexSequence(void* destination, std::size_t count, std::size_t indexSize,
+                                         const unsigned char* buffer, std::size_t size)
+{
+    if (indexSize != 2 && indexSize != 4)
+    {
+        return false;
+    }
+
+    // header, at least a byte per index and a 4 byte tail
+    if (size < 1 + count + 4 || (buffer[0] & 0xf0) != SEQUENCE_HEADER || (buffer[0] & 0x0f) > 1)
+    {
+        return false;
+    }
+
+    const unsigned char* data = buffer + 1;
+    const unsigned char* safeEnd = buffer + size - 4;
+
+    // deltas alternate between two baselines, the low bit picks one
+    unsigned int last[2] = { 0, 0 };
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        // an index reads at most 5 bytes, covered by the tail
+        if (data >= safeEnd)
+            return false;
+
+        unsigned int v = decodeVByte(data);
+        const unsigned int baseline = v & 1;
+        v >>= 1;
+
+        const unsigned int delta = (v >> 1) ^ (0u - (v & 1));
+        const unsigned int index = last[baseline] + delta;
+        last[baseline] = index;
+
+        writeIndex(destination, i, indexSize, index);
+    }
+
+    return data == safeEnd;
+}
+
+void MeshoptDecoder::filterOctahedral(void* data, std::size_t count, std::size_t stride)
+{
+    if (stride == 4)
+        octahedral<std::int8_t>(static_cast<unsigned char*>(data), count, stride);
+    else if (stride == 8)
+        octahedral<std::int16_t>(static_cast<unsigned char*>(data), count, stride);
+}
+
+void MeshoptDecoder::filterQuaternion(void* data, std::size_t count, std::size_t stride)
+{
+    if (stride != 8)
+    {
+        return;
+    }
+
+    const float scale = 1.0f / std::sqrt(2.0f);
+    unsigned char* bytes = static_cast<unsigned char*>(data);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        std::int16_t q[4];
+        std::memcpy(q, bytes + i * stride, sizeof(q));
+
+        // the last component holds the scale in its high bits and the index of the
+        // dropped (largest) component in its 2 low bits
+        const float s = scale / float(q[3] | 3);
+        const float x = float(q[0]) * s;
+        const float y = float(q[1]) * s;
+        const float z = float(q[2]) * s;
+        const float ww = 1.0f - x * x - y * y - z * z;
+        const float w = std::sqrt(ww >= 0.0f ? ww : 0.0f);
+
+        const int largest = q[3] & 3;
+        std::int16_t out[4];
+        out[(largest + 1) & 3] = roundToShort(x * 32767.0f);
+        out[(largest + 2) & 3] = roundToShort(y * 32767.0f);
+        out[(largest + 3) & 3] = roundToShort(z * 32767.0f);
+        out[(largest + 0) & 3] = static_cast<std::int16_t>(int(w * 32767.0f + 0.5f));
+        std::memcpy(bytes + i * stride, out, sizeof(out));
+    }
+}
+
+void MeshoptDecoder::filterExponential(void* data, std::size_t count, std::size_t stride)
+{
+    // every 32 bit value is a signed 8 bit exponent over a signed 24 bit mantissa
+    unsigned char* bytes = static_cast<unsigned char*>(data);
+    const std::size_t values = count * (stride / 4);
+    for (std::size_t i = 0; i < values; ++i)
+    {
+        std::int32_t v;
+        std::memcpy(&v, bytes + i * 4, 4);
+
+        const int exponent = v >> 24;
+        const int mantissa = static_cast<std::int32_t>(static_cast<std::uint32_t>(v) << 8) >> 8;
+        const float f = std::ldexp(float(mantissa), exponent);
+        std::memcpy(bytes + i * 4, &f, 4);
+    }
+}
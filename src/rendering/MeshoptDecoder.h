@@ -0,0 +1,33 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <cstddef>
+
+// Decoders for the buffer view compression of the glTF EXT_meshopt_compression extension
+// (the meshoptimizer vertex / index codecs and filters), so compressed .glb files load
+// without linking meshoptimizer. Decoding only; the data is produced by gltfpack & co.
+//
+// The decode functions return false on malformed input, the output is undefined then.
+class MeshoptDecoder
+{
+public:
+    // mode ATTRIBUTES: count elements of stride bytes (stride % 4 == 0, at most 256)
+    static bool decodeVertexBuffer(void* destination, std::size_t count, std::size_t stride,
+                                   const unsigned char* buffer, std::size_t size);
+
+    // mode TRIANGLES: count indices of 2 or 4 bytes, count % 3 == 0
+    static bool decodeIndexBuffer(void* destination, std::size_t count, std::size_t indexSize,
+                                  const unsigned char* buffer, std::size_t size);
+
+    // mode INDICES: count indices of 2 or 4 bytes
+    static bool decodeIndexSequence(void* destination, std::size_t count, std::size_t indexSize,
+                                    const unsigned char* buffer, std::size_t size);
+
+    // filters, applied in place after decoding an ATTRIBUTES view
+    static void filterOctahedral(void* data, std::size_t count, std::size_t stride);   // stride 4 or 8
+    static void filterQuaternion(void* data, std::size_t count, std::size_t stride);   // stride 8
+    static void filterExponential(void* data, std::size_t count, std::size_t stride);  // stride % 4 == 0
+};
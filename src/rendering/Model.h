@@ -10,114 +10,324 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 #include <string>
 #include <iostream>
 #include <map>
 #include <vector>
 
+#include "Animation.h"
+#include "Lod.h"
 #include "Mesh.h"
+#include "GlbFile.h"
+#include "MeshCache.h"
+#include "Meshlet.h"
+#include "ObjLoader.h"
 #include "helpers/RootDir.h"
 
-class Model
+// a model loaded through Assimp, or through ObjLoader / GlbFile for .obj / .glb files.
+// Only the attributes declared by Layout are imported and uploaded.
+// Imported meshes are split into meshlets, get a LOD chain and are cooked into res/cache/,
+// later loads skip the importers.
+// Layouts with attr::BoneIndices and attr::BoneWeights also import the skeleton and the animations; those always go
+// through Assimp, since neither the cache nor GlbFile store skins.
+template <typename Layout>
+class BasicModel
 {
 public:
+    using MeshType = BasicMesh<Layout>;
+    using Vertex = typename Layout::Vertex;
+
     /*  Model Data */
-    std::vector<Mesh> meshes;
+    std::vector<MeshType> meshes;
     std::string directory;
+    // lodErrors[k]: largest object space error of level k over all meshes, for LodSelector
+    std::vector<float> lodErrors;
+    // object space bounds of all meshes
+    Bounds bounds;
+    // of skinned layouts, see Animation.h
+    Skeleton skeleton;
+    std::vector<AnimationClip> animations;
+
+    static constexpr bool skinned = Layout::template has<attr::BoneIndices> && Layout::template has<attr::BoneWeights>;
 
     /*  Functions   */
     // constructor, expects a filepath to a 3D model.
-    Model(std::string const &path)
+    BasicModel(std::string const &path)
     {
         loadModel(path);
     }
 
-    // draws the model, and thus all its meshes
-    void Draw()
+    BasicModel(const BasicModel&) = delete;
+    BasicModel& operator=(const BasicModel&) = delete;
+
+    ~BasicModel()
     {
         for (unsigned int i = 0; i < meshes.size(); i++)
-            meshes[i].Draw();
+            meshes[i].release();
     }
 
-private:
-    /*  Functions   */
-    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-    void loadModel(std::string const &path)
+    // draws the model, and thus all its meshes. All meshes live in the same arena,
+    // so the VAO is bound once for the whole model.
+    void Draw(unsigned int level = 0) const
+    {
+        MeshType::Arena::get().bind();
+        DrawRanges(level);
+    }
+
+    // draws all meshes, expecting the arena VAO of the layout to be bound already.
+    // Scenes drawing several models of one layout can bind the arena once per frame.
+    void DrawRanges(unsigned int level = 0) const
+    {
+        for (unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].DrawRange(level);
+    }
+
+    // draws instanceCount copies of the model with one draw call per mesh, placed by the
+    // per-instance transforms of the bound InstanceBuffer
+    void DrawInstanced(std::size_t instanceCount, unsigned int level = 0) const
+    {
+        MeshType::Arena::get().bind();
+        for (unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].DrawRangeInstanced(instanceCount, level);
+    }
+
+    // closest hit of an object space ray with any of the meshes
+    bool raycast(const Ray& ray, float& t, float maxT = FLT_MAX) const
+    {
+        t = maxT;
+        bool hit = false;
+        for (unsigned int i = 0; i < meshes.size(); i++)
+        {
+            float meshT;
+            if (meshes[i].raycast(ray, meshT, t))
+            {
+                t = meshT;
+                hit = true;
+            }
+        }
+        return hit;
+    }
+
+    unsigned int lodCount() const { return static_cast<unsigned int>(lodErrors.size()); }
+
+    // appends an indirect command for every meshlet of every mesh that survives culling.
+    // firstIndex/baseVertex of params are filled in per mesh.
+    void cullMeshlets(MeshletCuller& culler, MeshletCuller::Params params, std::vector<DrawElementsIndirectCommand>& commands) const
+    {
+        const typename MeshType::Arena& arena = MeshType::Arena::get();
+        for (unsigned int i = 0; i < meshes.size(); i++)
+        {
+            params.firstIndex = static_cast<unsigned int>(arena.firstIndex(meshes[i].allocation));
+            params.baseVertex = arena.baseVertex(meshes[i].allocation);
+            culler.cull(meshes[i].meshlets, params, commands);
+        }
+    }
+
+    // imports a model into cooked meshes without uploading anything, through the mesh cache
+    // when it is up to date. Returns false if the file can't be imported.
+    // skeleton and animations are only filled for skinned layouts, and may be null.
+    static bool import(std::string const &path, std::vector<CookedMesh>& cooked,
+                       Skeleton* skeleton = nullptr, std::vector<AnimationClip>* animations = nullptr)
     {
-        // read file via ASSIMP
+        if (!skinned && MeshCache::load(path, Layout::signature, Layout::stride, cooked))
+            return true;
+
+        // OBJ and binary glTF files have their own loaders, Assimp stays as the fallback
+        if (!skinned &&
+            ((hasExtension(path, "obj") && loadObj(path, cooked)) ||
+             (hasExtension(path, "glb") && loadGlb(path, cooked))))
+        {
+            MeshCache::save(path, Layout::signature, Layout::stride, cooked);
+            return true;
+        }
+
+        // read file via ASSIMP, only running the post-process steps the layout's attributes need
         Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(ROOT_DIR + path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+        const aiScene* scene = importer.ReadFile(ROOT_DIR + path, Layout::importFlags);
         // check for errors
         if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
         {
             std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
-            return;
+            return false;
+        }
+
+        // the joints first, the meshes bind their vertices to them
+        Skeleton sceneSkeleton;
+        if (skinned)
+            Skeleton::build(scene, sceneSkeleton);
+
+        // process ASSIMP's root node recursively
+        processNode(scene->mRootNode, scene, glm::mat4(1.0f), cooked, sceneSkeleton);
+
+        if (skinned)
+        {
+            if (animations)
+                AnimationClip::read(scene, sceneSkeleton, *animations);
+            if (skeleton)
+                *skeleton = std::move(sceneSkeleton);
+        }
+        else
+        {
+            MeshCache::save(path, Layout::signature, Layout::stride, cooked);
         }
+        return true;
+    }
+
+private:
+    /*  Functions   */
+    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
+    void loadModel(std::string const &path)
+    {
         // retrieve the directory path of the filepath
         directory = path.substr(0, path.find_last_of('/'));
 
-        // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+        std::vector<CookedMesh> cooked;
+        if (import(path, cooked, &skeleton, &animations))
+            createMeshes(cooked);
+    }
+
+    static bool hasExtension(const std::string& path, const std::string& wanted)
+    {
+        const std::size_t dot = path.find_last_of('.');
+        if (dot == std::string::npos)
+            return false;
+
+        std::string extension = path.substr(dot + 1);
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+        return extension == wanted;
+    }
+
+    static bool loadObj(std::string const &path, std::vector<CookedMesh>& cooked)
+    {
+        std::vector<ObjMesh> objMeshes;
+        if (!ObjLoader::load(ROOT_DIR + path, objMeshes, Layout::objFlags))
+            return false;
+
+        for (const ObjMesh& mesh : objMeshes)
+        {
+            std::vector<Vertex> vertices(mesh.positions.size());
+            for (unsigned int i = 0; i < vertices.size(); i++)
+                Layout::read(vertices[i], mesh, i);
+
+            std::vector<unsigned int> indices = mesh.indices;
+            cooked.push_back(cook(vertices, indices));
+        }
+        return true;
+    }
+
+    static bool loadGlb(std::string const &path, std::vector<CookedMesh>& cooked)
+    {
+        GlbFile glb;
+        if (!glb.open(ROOT_DIR + path))
+            return false;
+
+        // vertices are one copy out of the mapped file when it is interleaved like the layout,
+        // node transforms are baked in since all meshes of a model are drawn with the one model
+        // matrix. They are not uploaded from the file directly: meshlets, LODs, bounds, raycasts
+        // and the mesh cache all need them on the CPU, and the cooked indices are reordered.
+        for (const GlbPrimitive& primitive : glb.primitives)
+        {
+            std::vector<Vertex> vertices(primitive.vertexCount);
+            Layout::read(vertices.data(), primitive);
+            Layout::transform(vertices.data(), vertices.size(), primitive.transform);
+
+            std::vector<unsigned int> indices;
+            primitive.readIndices(indices);
+            if (!indices.empty())
+                cooked.push_back(cook(vertices, indices));
+        }
+        return true;
+    }
+
+    void createMeshes(const std::vector<CookedMesh>& cooked)
+    {
+        meshes.reserve(cooked.size());
+        for (const CookedMesh& mesh : cooked)
+        {
+            const Vertex* first = reinterpret_cast<const Vertex*>(mesh.vertexData.data());
+            std::vector<Vertex> vertices(first, first + mesh.vertexData.size() / sizeof(Vertex));
+            meshes.push_back(MeshType(std::move(vertices), mesh.indices, mesh.meshlets, mesh.lods));
+        }
+
+        for (unsigned int i = 0; i < meshes.size(); i++)
+        {
+            if (i == 0)
+                bounds = meshes[i].bounds;
+            else
+                bounds.merge(meshes[i].bounds);
+        }
+
+        lodErrors.assign(1, 0.0f);
+        for (const MeshType& mesh : meshes)
+        {
+            if (mesh.lodCount() > lodErrors.size())
+                lodErrors.resize(mesh.lodCount(), 0.0f);
+        }
+        for (unsigned int level = 1; level < lodErrors.size(); ++level)
+        {
+            // meshes with fewer levels keep drawing their coarsest one
+            for (const MeshType& mesh : meshes)
+                lodErrors[level] = std::max(lodErrors[level], mesh.lod(level).error);
+        }
     }
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode *node, const aiScene *scene)
+    // parentTransform is the world matrix of the parent node; like for glb files the node transforms
+    // are baked into the vertices, since all meshes of a model are drawn with the one model matrix.
+    static void processNode(aiNode *node, const aiScene *scene, const glm::mat4& parentTransform, std::vector<CookedMesh>& cooked,
+                            Skeleton& skeleton)
     {
+        // aiMatrix4x4 is row major
+        const glm::mat4 transform = parentTransform * glm::transpose(glm::make_mat4(&node->mTransformation.a1));
+
         // process each mesh located at the current node
         for (unsigned int i = 0; i < node->mNumMeshes; i++)
         {
             // the node object only contains indices to index the actual objects in the scene. 
             // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
             aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            cooked.push_back(processMesh(mesh, scene, transform, node->mName.C_Str(), skeleton));
         }
         // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
         for (unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            processNode(node->mChildren[i], scene);
+            processNode(node->mChildren[i], scene, transform, cooked, skeleton);
         }
 
     }
 
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    static CookedMesh processMesh(aiMesh *mesh, const aiScene *scene, const glm::mat4& transform, const std::string& node, Skeleton& skeleton)
     {
         // data to fill
         std::vector<Vertex> vertices;
         std::vector<unsigned int> indices;
+        indices.reserve(mesh->mNumFaces * 3);
 
         // Walk through each of the mesh's vertices
+        vertices.resize(mesh->mNumVertices);
         for (unsigned int i = 0; i < mesh->mNumVertices; i++)
         {
-            Vertex vertex;
-            glm::vec3 vector; // we declare a placeholder vector since assimp uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
-                              // positions
-            vector.x = mesh->mVertices[i].x;
-            vector.y = mesh->mVertices[i].y;
-            vector.z = mesh->mVertices[i].z;
-            vertex.Position = vector;
-            // normals
-            vector.x = mesh->mNormals[i].x;
-            vector.y = mesh->mNormals[i].y;
-            vector.z = mesh->mNormals[i].z;
-            vertex.Normal = vector;
-            // texture coordinates
-            if (mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
+            Layout::read(vertices[i], mesh, i);
+        }
+        Layout::transform(vertices.data(), vertices.size(), transform);
+        if constexpr (skinned)
+        {
+            std::vector<glm::u8vec4> boneIndices;
+            std::vector<glm::vec4> boneWeights;
+            skeleton.readBoneWeights(mesh, transform, node, boneIndices, boneWeights);
+            for (unsigned int i = 0; i < mesh->mNumVertices; i++)
             {
-                glm::vec2 vec;
-                // a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't 
-                // use models where a vertex can have multiple texture coordinates so we always take the first set (0).
-                vec.x = mesh->mTextureCoords[0][i].x;
-                vec.y = mesh->mTextureCoords[0][i].y;
-                vertex.TexCoords = vec;
+                vertices[i].BoneIndices = boneIndices[i];
+                vertices[i].BoneWeights = boneWeights[i];
             }
-            else
-                vertex.TexCoords = glm::vec2(0.0f, 0.0f);
-
-            vertices.push_back(vertex);
         }
         // now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
         for (unsigned int i = 0; i < mesh->mNumFaces; i++)
@@ -128,9 +338,25 @@ private:
                 indices.push_back(face.mIndices[j]);
         }
 
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices);
+        return cook(vertices, indices);
+    }
+
+    // meshlets, LOD chain and the raw vertex bytes of an imported mesh
+    static CookedMesh cook(const std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+    {
+        CookedMesh cooked;
+        // cluster the triangles, this reorders the indices meshlet by meshlet
+        cooked.meshlets = MeshletBuilder::build(vertices.data(), sizeof(Vertex), vertices.size(), indices);
+        // then append the coarser levels, the meshlets stay on level 0
+        cooked.lods = LodBuilder::build(vertices.data(), sizeof(Vertex), vertices.size(), indices);
+        cooked.indices = indices;
+        cooked.vertexData.resize(vertices.size() * sizeof(Vertex));
+        std::memcpy(cooked.vertexData.data(), vertices.data(), cooked.vertexData.size());
+
+        return cooked;
     }
 };
 
+using Model = BasicModel<DefaultLayout>;
+
 #endif
\ No newline at end of file
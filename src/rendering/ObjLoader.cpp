@@ -0,0 +1,577 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include "ObjLoader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+#include "MappedFile.h"
+#include "Parallel.h"
+
+namespace
+{
+    // index of an absent vt / vn, or of one that is out of range
+    const int MISSING = -1;
+    const unsigned int EMPTY_SLOT = ~0u;
+
+    // exactly representable in a double
+    const double POWERS_OF_TEN[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    inline bool isDigit(char c)
+    {
+        return static_cast<unsigned char>(c - '0') < 10;
+    }
+
+    inline bool isBlank(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    inline const char* skipBlanks(const char* p, const char* end)
+    {
+        while (p < end && isBlank(*p))
+            ++p;
+        return p;
+    }
+
+    // returns p if there is no integer at p
+    const char* parseInt(const char* p, const char* end, int& value)
+    {
+        const char* start = p;
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+        {
+            negative = *p == '-';
+            ++p;
+        }
+
+        const char* digits = p;
+        long long result = 0;
+        while (p < end && isDigit(*p))
+        {
+            result = std::min(result * 10 + (*p - '0'), 1ll << 31);
+            ++p;
+        }
+        if (p == digits)
+        {
+            return start;
+        }
+
+        value = static_cast<int>(negative ? -result : std::min(result, (1ll << 31) - 1));
+        return p;
+    }
+
+    // a face corner as written in the file, 0 for an absent index
+    struct RawCorner
+    {
+        int index[3] = { 0, 0, 0 };
+    };
+
+    // a new mesh starts at this entry of the chunk's corners. Unnamed ones (usemtl) keep the current object name.
+    struct GroupStart
+    {
+        std::size_t corner;
+        std::string name;
+        bool named;
+    };
+
+    // what one thread gets out of its slice of the file
+    struct Chunk
+    {
+        const char* begin = nullptr;
+        const char* end = nullptr;
+
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec2> texCoords;
+        std::vector<glm::vec3> normals;
+
+        // v, vt, vn of every triangle corner, 0 based. Absolute indices are final already,
+        // the entries listed in relative came from negative indices and are still local to the chunk.
+        std::vector<int> corners;
+        std::vector<std::size_t> relative;
+        std::vector<GroupStart> groups;
+
+        void addCorner(const RawCorner& raw)
+        {
+            const std::size_t counts[3] = { positions.size(), texCoords.size(), normals.size() };
+            for (int k = 0; k < 3; ++k)
+            {
+                const int index = raw.index[k];
+                if (index > 0)
+                {
+                    corners.push_back(index - 1);
+                }
+                else if (index < 0)
+                {
+                    // relative to the end of the list so far, which may lie in an earlier chunk
+                    relative.push_back(corners.size());
+                    corners.push_back(static_cast<int>(counts[k]) + index);
+                }
+                else
+                {
+                    corners.push_back(MISSING);
+                }
+            }
+        }
+
+        void parseFace(const char* p, const char* end)
+        {
+            RawCorner first, previous, current;
+            int count = 0;
+            while (true)
+            {
+                p = skipBlanks(p, end);
+                const char* next = parseInt(p, end, current.index[0]);
+                if (next == p)
+                    break;
+                p = next;
+
+                current.index[1] = current.index[2] = 0;
+                if (p < end && *p == '/')
+                {
+                    ++p;
+                    if (p < end && *p != '/')
+                        p = parseInt(p, end, current.index[1]);
+                    if (p < end && *p == '/')
+                        p = parseInt(p + 1, end, current.index[2]);
+                }
+
+                // fan triangulation
+                if (count == 0)
+                {
+                    first = current;
+                }
+                else if (count >= 2)
+                {
+                    addCorner(first);
+                    addCorner(previous);
+                    addCorner(current);
+                }
+                previous = current;
+                ++count;
+            }
+        }
+
+        template <int N>
+        void parseVector(const char* p, const char* end, float (&out)[N])
+        {
+            for (int k = 0; k < N; ++k)
+            {
+                out[k] = 0.0f;
+                p = ObjLoader::parseFloat(skipBlanks(p, end), end, out[k]);
+            }
+        }
+
+        void startGroup(const char* p, const char* end, bool named)
+        {
+            p = skipBlanks(p, end);
+            while (end > p && isBlank(end[-1]))
+                --end;
+            groups.push_back({ corners.size(), named ? std::string(p, end) : std::string(), named });
+        }
+
+        void parseLine(const char* p, const char* end)
+        {
+            p = skipBlanks(p, end);
+            if (end - p < 2)
+            {
+                return;
+            }
+
+            if (p[0] == 'v')
+            {
+                float values[3];
+                if (isBlank(p[1]))
+                {
+                    parseVector(p + 2, end, values);
+                    positions.emplace_back(values[0], values[1], values[2]);
+                }
+                else if (p[1] == 't' && end - p > 2 && isBlank(p[2]))
+                {
+                    parseVector(p + 3, end, values);
+                    texCoords.emplace_back(values[0], values[1]);
+                }
+                else if (p[1] == 'n' && end - p > 2 && isBlank(p[2]))
+                {
+                    parseVector(p + 3, end, values);
+                    normals.emplace_back(values[0], values[1], values[2]);
+                }
+            }
+            else if (p[0] == 'f' && isBlank(p[1]))
+            {
+                parseFace(p + 2, end);
+            }
+            else if ((p[0] == 'o' || p[0] == 'g') && isBlank(p[1]))
+            {
+                startGroup(p + 2, end, true);
+            }
+            else if (end - p > 6 && std::memcmp(p, "usemtl", 6) == 0 && isBlank(p[6]))
+            {
+                startGroup(p + 7, end, false);
+            }
+        }
+
+        void parse()
+        {
+            const char* p = begin;
+            while (p < end)
+            {
+                const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+                if (!lineEnd)
+                    lineEnd = end;
+                parseLine(p, lineEnd);
+                p = lineEnd + 1;
+            }
+        }
+    };
+
+    struct MeshRange
+    {
+        std::size_t begin;  // entries of the corner list, 3 per corner
+        std::size_t end;
+        std::string name;
+    };
+
+    inline std::uint32_t hashCorner(const int* corner)
+    {
+        std::uint32_t h = std::uint32_t(corner[0]) * 0x9E3779B1u;
+        h ^= (h >> 15) ^ (std::uint32_t(corner[1]) * 0x85EBCA77u);
+        h ^= (h >> 13) ^ (std::uint32_t(corner[2]) * 0xC2B2AE3Du);
+        return h ^ (h >> 16);
+    }
+
+    void generateNormals(ObjMesh& mesh, const std::vector<int>& sourcePosition, const std::vector<unsigned char>& missing)
+    {
+        // area weighted face normals, summed over every vertex sharing a position of the file
+        std::unordered_map<int, glm::vec3> sums;
+        for (std::size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+        {
+            const unsigned int a = mesh.indices[i], b = mesh.indices[i + 1], c = mesh.indices[i + 2];
+            const glm::vec3 n = glm::cross(mesh.positions[b] - mesh.positions[a], mesh.positions[c] - mesh.positions[a]);
+            for (unsigned int vertex : { a, b, c })
+            {
+                if (missing[vertex])
+                    sums[sourcePosition[vertex]] += n;
+            }
+        }
+
+        for (std::size_t vertex = 0; vertex < mesh.positions.size(); ++vertex)
+        {
+            if (!missing[vertex])
+                continue;
+
+            const glm::vec3 sum = sums[sourcePosition[vertex]];
+            const float length = glm::length(sum);
+            mesh.normals[vertex] = length > 0.0f ? sum / length : glm::vec3(0.0f, 1.0f, 0.0f);
+        }
+    }
+
+    void generateTangents(ObjMesh& mesh)
+    {
+        mesh.tangents.assign(mesh.positions.size(), glm::vec3(0.0f));
+        mesh.bitangents.assign(mesh.positions.size(), glm::vec3(0.0f));
+
+        for (std::size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+        {
+            const unsigned int a = mesh.indices[i], b = mesh.indices[i + 1], c = mesh.indices[i + 2];
+            const glm::vec3 e1 = mesh.positions[b] - mesh.positions[a];
+            const glm::vec3 e2 = mesh.positions[c] - mesh.positions[a];
+            const glm::vec2 d1 = mesh.texCoords[b] - mesh.texCoords[a];
+            const glm::vec2 d2 = mesh.texCoords[c] - mesh.texCoords[a];
+
+            const float det = d1.x * d2.y - d2.x * d1.y;
+            if (std::fabs(det) < 1e-12f)
+                continue;
+
+            const float r = 1.0f / det;
+            const glm::vec3 tangent = (e1 * d2.y - e2 * d1.y) * r;
+            const glm::vec3 bitangent = (e2 * d1.x - e1 * d2.x) * r;
+            for (unsigned int vertex : { a, b, c })
+            {
+                mesh.tangents[vertex] += tangent;
+                mesh.bitangents[vertex] += bitangent;
+            }
+        }
+
+        // Gram-Schmidt against the normal
+        for (std::size_t vertex = 0; vertex < mesh.positions.size(); ++vertex)
+        {
+            const glm::vec3 n = mesh.normals[vertex];
+            glm::vec3 t = mesh.tangents[vertex] - n * glm::dot(n, mesh.tangents[vertex]);
+            glm::vec3 b = mesh.bitangents[vertex] - n * glm::dot(n, mesh.bitangents[vertex]);
+
+            const float tLength = glm::length(t);
+            t = tLength > 0.0f ? t / tLength : glm::vec3(1.0f, 0.0f, 0.0f);
+            const float bLength = glm::length(b);
+            b = bLength > 0.0f ? b / bLength : glm::cross(n, t);
+
+            mesh.tangents[vertex] = t;
+            mesh.bitangents[vertex] = b;
+        }
+    }
+
+    // one mesh out of the corners [range.begin, range.end): every distinct v/vt/vn becomes one vertex
+    void buildMesh(const MeshRange& range, const std::vector<int>& corners, const std::vector<glm::vec3>& positions,
+                   const std::vector<glm::vec2>& texCoords, const std::vector<glm::vec3>& normals,
+                   unsigned int flags, ObjMesh& mesh)
+    {
+        mesh.name = range.name;
+
+        const std::size_t cornerCount = (range.end - range.begin) / 3;
+        std::size_t capacity = 16;
+        while (capacity < 2 * cornerCount)
+            capacity <<= 1;
+        const std::uint32_t mask = static_cast<std::uint32_t>(capacity - 1);
+
+        // open addressing, slots hold vertex indices, keys of a vertex are in vertexKeys
+        std::vector<unsigned int> slots(capacity, EMPTY_SLOT);
+        std::vector<int> vertexKeys;
+        std::vector<int> sourcePosition;
+        std::vector<unsigned char> missingNormal;
+        bool anyMissing = false;
+
+        vertexKeys.reserve(cornerCount * 3);
+        mesh.indices.reserve(cornerCount);
+
+        auto vertexOf = [&](const int* corner) -> unsigned int {
+            std::uint32_t slot = hashCorner(corner) & mask;
+            while (slots[slot] != EMPTY_SLOT)
+            {
+                const int* key = &vertexKeys[std::size_t(slots[slot]) * 3];
+                if (key[0] == corner[0] && key[1] == corner[1] && key[2] == corner[2])
+                    return slots[slot];
+                slot = (slot + 1) & mask;
+            }
+
+            const unsigned int vertex = static_cast<unsigned int>(mesh.positions.size());
+            slots[slot] = vertex;
+            vertexKeys.insert(vertexKeys.end(), corner, corner + 3);
+            sourcePosition.push_back(corner[0]);
+
+            mesh.positions.push_back(positions[corner[0]]);
+            glm::vec2 uv = corner[1] != MISSING ? texCoords[corner[1]] : glm::vec2(0.0f);
+            if ((flags & ObjLoader::FLIP_UVS) && corner[1] != MISSING)
+                uv.y = 1.0f - uv.y;
+            mesh.texCoords.push_back(uv);
+            mesh.normals.push_back(corner[2] != MISSING ? normals[corner[2]] : glm::vec3(0.0f));
+            missingNormal.push_back(corner[2] == MISSING);
+            anyMissing |= corner[2] == MISSING;
+            return vertex;
+        };
+
+        for (std::size_t i = range.begin; i + 9 <= range.end; i += 9)
+        {
+            int triangle[9];
+            bool valid = true;
+            for (int k = 0; k < 9; ++k)
+            {
+                triangle[k] = corners[i + k];
+                const std::size_t count = k % 3 == 0 ? positions.size() : k % 3 == 1 ? texCoords.size() : normals.size();
+                if (triangle[k] < 0 || std::size_t(triangle[k]) >= count)
+                    triangle[k] = MISSING;
+                valid &= k % 3 != 0 || triangle[k] != MISSING;
+            }
+            if (!valid)
+                continue;
+
+            for (int k = 0; k < 3; ++k)
+                mesh.indices.push_back(vertexOf(triangle + k * 3));
+        }
+
+        if (anyMissing)
+            generateNormals(mesh, sourcePosition, missingNormal);
+        if (flags & ObjLoader::TANGENTS)
+            generateTangents(mesh);
+    }
+}
+
+const char* ObjLoader::parseFloat(const char* p, const char* end, float& value)
+{
+    // no locale, no allocation: accumulate up to 19 significant digits in an integer
+    // and scale once by an exact power of ten
+    const char* start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        negative = *p == '-';
+        ++p;
+    }
+
+    std::uint64_t mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+    bool any = false;
+
+    for (; p < end && isDigit(*p); ++p, any = true)
+    {
+        if (digits < 19)
+        {
+            mantissa = mantissa * 10 + (*p - '0');
+            digits += mantissa != 0;
+        }
+        else
+        {
+            ++exponent;
+        }
+    }
+    if (p < end && *p == '.')
+    {
+        for (++p; p < end && isDigit(*p); ++p, any = true)
+        {
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += mantissa != 0;
+                --exponent;
+            }
+        }
+    }
+    if (!any)
+    {
+        return start;
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        int e = 0;
+        const char* next = parseInt(p + 1, end, e);
+        if (next != p + 1)
+        {
+            exponent += std::max(-400, std::min(e, 400));
+            p = next;
+        }
+    }
+
+    double result = static_cast<double>(mantissa);
+    if (mantissa != 0 && exponent != 0)
+    {
+        if (exponent > 0)
+            result = exponent <= 22 ? result * POWERS_OF_TEN[exponent] : result * std::pow(10.0, exponent);
+        else
+            result = exponent >= -22 ? result / POWERS_OF_TEN[-exponent] : result * std::pow(10.0, exponent);
+    }
+
+    value = static_cast<float>(negative ? -result : result);
+    return p;
+}
+
+bool ObjLoader::load(const std::string& path, std::vector<ObjMesh>& meshes, unsigned int flags)
+{
+    MappedFile file;
+    if (!file.open(path))
+    {
+        std::cout << "ERROR::OBJ:: could not open " << path << std::endl;
+        return false;
+    }
+
+    // line aligned chunks
+    const char* data = file.data();
+    const std::size_t size = file.size();
+    JobSystem& jobs = JobSystem::get();
+    const std::size_t chunkCount = std::max<std::size_t>(1, std::min(size / MIN_CHUNK_SIZE, jobs.threadCount() * CHUNKS_PER_THREAD));
+
+    std::vector<Chunk> chunks(chunkCount);
+    std::size_t offset = 0;
+    for (std::size_t k = 0; k < chunkCount; ++k)
+    {
+        std::size_t split = k + 1 == chunkCount ? size : std::max(offset, size * (k + 1) / chunkCount);
+        if (split < size)
+        {
+            const void* newline = std::memchr(data + split, '\n', size - split);
+            split = newline ? static_cast<const char*>(newline) - data + 1 : size;
+        }
+        chunks[k].begin = data + offset;
+        chunks[k].end = data + split;
+        offset = split;
+    }
+
+    jobs.parallelFor(chunkCount, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t k = begin; k < end; ++k)
+            chunks[k].parse();
+    });
+
+    // where every chunk's data goes in the concatenated lists
+    std::vector<std::size_t> positionBase(chunkCount), texCoordBase(chunkCount), normalBase(chunkCount), cornerBase(chunkCount);
+    std::size_t positionCount = 0, texCoordCount = 0, normalCount = 0, cornerCount = 0;
+    for (std::size_t k = 0; k < chunkCount; ++k)
+    {
+        positionBase[k] = positionCount;
+        texCoordBase[k] = texCoordCount;
+        normalBase[k] = normalCount;
+        cornerBase[k] = cornerCount;
+        positionCount += chunks[k].positions.size();
+        texCoordCount += chunks[k].texCoords.size();
+        normalCount += chunks[k].normals.size();
+        cornerCount += chunks[k].corners.size();
+    }
+
+    std::vector<glm::vec3> positions(positionCount), normals(normalCount);
+    std::vector<glm::vec2> texCoords(texCoordCount);
+    std::vector<int> corners(cornerCount);
+
+    jobs.parallelFor(chunkCount, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t k = begin; k < end; ++k)
+        {
+            Chunk& chunk = chunks[k];
+            std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + positionBase[k]);
+            std::copy(chunk.texCoords.begin(), chunk.texCoords.end(), texCoords.begin() + texCoordBase[k]);
+            std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + normalBase[k]);
+
+            const std::size_t bases[3] = { positionBase[k], texCoordBase[k], normalBase[k] };
+            for (std::size_t entry : chunk.relative)
+            {
+                const long long index = chunk.corners[entry] + static_cast<long long>(bases[entry % 3]);
+                chunk.corners[entry] = index >= 0 && index <= INT32_MAX ? static_cast<int>(index) : MISSING;
+            }
+            std::copy(chunk.corners.begin(), chunk.corners.end(), corners.begin() + cornerBase[k]);
+
+            chunk.positions = std::vector<glm::vec3>();
+            chunk.texCoords = std::vector<glm::vec2>();
+            chunk.normals = std::vector<glm::vec3>();
+            chunk.corners = std::vector<int>();
+        }
+    });
+
+    // meshes may span chunks
+    std::vector<MeshRange> ranges;
+    MeshRange current = { 0, 0, std::string() };
+    std::string objectName;
+    for (std::size_t k = 0; k < chunkCount; ++k)
+    {
+        for (const GroupStart& group : chunks[k].groups)
+        {
+            const std::size_t at = cornerBase[k] + group.corner;
+            current.end = at;
+            if (current.end > current.begin)
+                ranges.push_back(current);
+
+            if (group.named)
+                objectName = group.name;
+            current = { at, at, objectName };
+        }
+    }
+    current.end = cornerCount;
+    if (current.end > current.begin)
+        ranges.push_back(current);
+
+    std::vector<ObjMesh> built(ranges.size());
+    jobs.parallelFor(ranges.size(), 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i)
+            buildMesh(ranges[i], corners, positions, texCoords, normals, flags, built[i]);
+    });
+
+    // groups without a single valid triangle
+    built.erase(std::remove_if(built.begin(), built.end(), [](const ObjMesh& mesh) { return mesh.indices.empty(); }), built.end());
+
+    meshes.swap(built);
+    return true;
+}
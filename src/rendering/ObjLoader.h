@@ -0,0 +1,51 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// One mesh of an OBJ file. Every distinct v/vt/vn triplet of the faces is one vertex,
+// all attribute arrays have one entry per vertex.
+struct ObjMesh
+{
+    std::string name;
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;     // smooth normals are generated where the file has none
+    std::vector<glm::vec2> texCoords;   // (0, 0) where missing
+    std::vector<glm::vec3> tangents;    // only filled with ObjLoader::TANGENTS
+    std::vector<glm::vec3> bitangents;
+    std::vector<unsigned int> indices;  // triangles
+};
+
+// Wavefront OBJ reader that bypasses Assimp. The file is memory mapped and cut into
+// line-aligned chunks that are parsed in parallel on the job system. The chunks are then
+// stitched together and the index triplets of every mesh are deduplicated with a hash table.
+//
+// Supported: v, vt, vn, f (polygons are fan triangulated, negative indices allowed),
+// o / g / usemtl start a new mesh. Everything else (materials, smoothing groups, lines) is skipped.
+class ObjLoader
+{
+public:
+    // files are cut into about this many chunks per thread, so uneven chunks even out
+    static constexpr std::size_t CHUNKS_PER_THREAD = 4;
+    static constexpr std::size_t MIN_CHUNK_SIZE = 64 * 1024;
+
+    // mirror the Assimp post-process steps of the same name
+    enum Flags : unsigned int
+    {
+        FLIP_UVS = 1 << 0,  // v = 1 - v
+        TANGENTS = 1 << 1,  // tangent frame from the (flipped) uvs
+    };
+
+    // returns false if the file cannot be read
+    static bool load(const std::string& path, std::vector<ObjMesh>& meshes, unsigned int flags = 0);
+
+    // parses a decimal float ("-1.5e3") at p, returns the end of the number or p if there is none
+    static const char* parseFloat(const char* p, const char* end, float& value);
+};
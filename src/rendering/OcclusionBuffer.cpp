@@ -0,0 +1,524 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include "OcclusionBuffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+#include "Parallel.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define OCCLUSION_BUFFER_AVX 1
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define OCCLUSION_BUFFER_SSE 1
+#endif
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const int TILE_SIZE = OcclusionBuffer::TILE_WIDTH * OcclusionBuffer::TILE_HEIGHT;
+
+    // triangles are clipped to twice the screen size, which keeps the edge functions of
+    // triangles reaching far off screen in a range floats handle exactly enough
+    const float GUARD_BAND = 2.0f;
+
+    // boxes tested per job; a test is a few tiles at most
+    const std::size_t TEST_GRAIN = 256;
+
+    double millisecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // bits of the frustum planes the vertex lies outside of
+    int outcode(const glm::vec4& v)
+    {
+        int code = 0;
+        if (v.x < -v.w) code |= 1;
+        if (v.x > v.w) code |= 2;
+        if (v.y < -v.w) code |= 4;
+        if (v.y > v.w) code |= 8;
+        if (v.z < -v.w) code |= 16;
+        if (v.z > v.w) code |= 32;
+        return code;
+    }
+}
+
+OcclusionBuffer::OcclusionBuffer(int width, int height)
+{
+    resize(width, height);
+}
+
+void OcclusionBuffer::resize(int newWidth, int newHeight)
+{
+    tilesX = std::max(1, (newWidth + TILE_WIDTH - 1) / TILE_WIDTH);
+    tilesY = std::max(1, (newHeight + TILE_HEIGHT - 1) / TILE_HEIGHT);
+    width = tilesX * TILE_WIDTH;
+    height = tilesY * TILE_HEIGHT;
+
+    depth.assign(std::size_t(tilesX) * tilesY * TILE_SIZE, 1.0f);
+    tileMaxDepth.assign(std::size_t(tilesX) * tilesY, 1.0f);
+    tileRowTriangles.resize(tilesY);
+}
+
+void OcclusionBuffer::begin(const glm::mat4& matrix)
+{
+    viewProjection = matrix;
+    triangles.clear();
+}
+
+void OcclusionBuffer::addOccluder(const void* positions, std::size_t stride, std::size_t vertexCount,
+                                  const unsigned int* indices, std::size_t indexCount, const glm::mat4& modelMatrix)
+{
+    const Clock::time_point start = Clock::now();
+
+    const glm::mat4 matrix = viewProjection * modelMatrix;
+    const unsigned char* bytes = static_cast<const unsigned char*>(positions);
+
+    clipPositions.resize(vertexCount);
+    for (std::size_t i = 0; i < vertexCount; ++i)
+    {
+        glm::vec3 position;
+        std::memcpy(&position, bytes + i * stride, sizeof(position));
+        clipPositions[i] = matrix * glm::vec4(position, 1.0f);
+    }
+
+    for (std::size_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        addClipTriangle(clipPositions[indices[i]], clipPositions[indices[i + 1]], clipPositions[indices[i + 2]]);
+    }
+
+    counters.occluderTriangles += indexCount / 3;
+    counters.setupMs += millisecondsSince(start);
+}
+
+void OcclusionBuffer::addBoxOccluder(const Bounds& localBounds, const glm::mat4& modelMatrix)
+{
+    static const unsigned int boxIndices[36] = {
+        0, 1, 3, 0, 3, 2,   // -x
+        4, 6, 7, 4, 7, 5,   // +x
+        0, 4, 5, 0, 5, 1,   // -y
+        2, 3, 7, 2, 7, 6,   // +y
+        0, 2, 6, 0, 6, 4,   // -z
+        1, 5, 7, 1, 7, 3,   // +z
+    };
+
+    glm::vec3 corners[8];
+    for (int i = 0; i < 8; ++i)
+    {
+        corners[i] = glm::vec3((i & 4) ? localBounds.max.x : localBounds.min.x,
+                               (i & 2) ? localBounds.max.y : localBounds.min.y,
+                               (i & 1) ? localBounds.max.z : localBounds.min.z);
+    }
+    addOccluder(corners, sizeof(glm::vec3), 8, boxIndices, 36, modelMatrix);
+}
+
+void OcclusionBuffer::addClipTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c)
+{
+    // all three vertices outside the same plane
+    if ((outcode(a) & outcode(b) & outcode(c)) != 0)
+    {
+        return;
+    }
+
+    // Sutherland-Hodgman against the near plane and the guard band; each plane adds at most
+    // one vertex to the convex polygon
+    static const glm::vec4 clipPlanes[] = {
+        glm::vec4(0.0f, 0.0f, 1.0f, 1.0f),
+        glm::vec4(-1.0f, 0.0f, 0.0f, GUARD_BAND),
+        glm::vec4(1.0f, 0.0f, 0.0f, GUARD_BAND),
+        glm::vec4(0.0f, -1.0f, 0.0f, GUARD_BAND),
+        glm::vec4(0.0f, 1.0f, 0.0f, GUARD_BAND),
+    };
+    const int MAX_VERTICES = 3 + sizeof(clipPlanes) / sizeof(clipPlanes[0]);
+
+    glm::vec4 polygon[MAX_VERTICES] = { a, b, c };
+    int count = 3;
+    for (const glm::vec4& plane : clipPlanes)
+    {
+        bool allInside = true;
+        for (int i = 0; i < count && allInside; ++i)
+        {
+            allInside = glm::dot(plane, polygon[i]) >= 0.0f;
+        }
+        if (allInside)
+        {
+            continue;
+        }
+
+        glm::vec4 clipped[MAX_VERTICES];
+        int clippedCount = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            const glm::vec4& current = polygon[i];
+            const glm::vec4& next = polygon[(i + 1) % count];
+            const float dCurrent = glm::dot(plane, current);
+            const float dNext = glm::dot(plane, next);
+
+            if (dCurrent >= 0.0f)
+            {
+                clipped[clippedCount++] = current;
+            }
+            if ((dCurrent >= 0.0f) != (dNext >= 0.0f))
+            {
+                clipped[clippedCount++] = current + (dCurrent / (dCurrent - dNext)) * (next - current);
+            }
+        }
+
+        count = clippedCount;
+        std::copy(clipped, clipped + count, polygon);
+        if (count < 3)
+        {
+            return;
+        }
+    }
+
+    // pixel coordinates and [0, 1] depth
+    glm::vec3 screen[MAX_VERTICES];
+    for (int i = 0; i < count; ++i)
+    {
+        const glm::vec3 ndc = glm::vec3(polygon[i]) / polygon[i].w;
+        screen[i] = glm::vec3((ndc.x * 0.5f + 0.5f) * width, (ndc.y * 0.5f + 0.5f) * height, ndc.z * 0.5f + 0.5f);
+    }
+    for (int i = 1; i + 1 < count; ++i)
+    {
+        setupTriangle(screen[0], screen[i], screen[i + 1]);
+    }
+}
+
+void OcclusionBuffer::setupTriangle(glm::vec3 a, glm::vec3 b, glm::vec3 c)
+{
+    // occluders are drawn from both sides, so planes and open meshes work too
+    float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    if (area < 0.0f)
+    {
+        std::swap(b, c);
+        area = -area;
+    }
+    if (area < 1e-4f)
+    {
+        return;
+    }
+
+    Triangle triangle;
+    triangle.minX = std::max(0, int(std::floor(std::min(a.x, std::min(b.x, c.x)))));
+    triangle.minY = std::max(0, int(std::floor(std::min(a.y, std::min(b.y, c.y)))));
+    triangle.maxX = std::min(width - 1, int(std::ceil(std::max(a.x, std::max(b.x, c.x)))));
+    triangle.maxY = std::min(height - 1, int(std::ceil(std::max(a.y, std::max(b.y, c.y)))));
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+    {
+        return;
+    }
+
+    // edge e runs between the two vertices other than e, positive on the side of vertex e
+    const glm::vec3 vertices[3] = { a, b, c };
+    for (int e = 0; e < 3; ++e)
+    {
+        const glm::vec3& p = vertices[(e + 1) % 3];
+        const glm::vec3& q = vertices[(e + 2) % 3];
+        triangle.edgeA[e] = p.y - q.y;
+        triangle.edgeB[e] = q.x - p.x;
+        triangle.edgeC[e] = -(triangle.edgeA[e] * p.x + triangle.edgeB[e] * p.y);
+    }
+
+    // the edge functions divided by the area are the barycentric coordinates
+    const float inverseArea = 1.0f / area;
+    triangle.depthA = (triangle.edgeA[0] * a.z + triangle.edgeA[1] * b.z + triangle.edgeA[2] * c.z) * inverseArea;
+    triangle.depthB = (triangle.edgeB[0] * a.z + triangle.edgeB[1] * b.z + triangle.edgeB[2] * c.z) * inverseArea;
+    triangle.depthC = (triangle.edgeC[0] * a.z + triangle.edgeC[1] * b.z + triangle.edgeC[2] * c.z) * inverseArea;
+
+    triangles.push_back(triangle);
+    ++counters.rasterizedTriangles;
+}
+
+void OcclusionBuffer::rasterize()
+{
+    const Clock::time_point start = Clock::now();
+
+    for (std::vector<std::uint32_t>& row : tileRowTriangles)
+    {
+        row.clear();
+    }
+    for (std::size_t i = 0; i < triangles.size(); ++i)
+    {
+        for (int tileY = triangles[i].minY / TILE_HEIGHT; tileY <= triangles[i].maxY / TILE_HEIGHT; ++tileY)
+        {
+            tileRowTriangles[tileY].push_back(static_cast<std::uint32_t>(i));
+        }
+    }
+
+    // tile rows don't share pixels, so they are drawn without any synchronization
+    parallelFor(std::size_t(tilesY), 1, [this](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t tileY = begin; tileY < end; ++tileY)
+        {
+            rasterizeTileRow(int(tileY));
+        }
+    });
+
+    counters.rasterMs += millisecondsSince(start);
+}
+
+void OcclusionBuffer::rasterizeTileRow(int tileY)
+{
+    float* rowDepth = &depth[std::size_t(tileY) * tilesX * TILE_SIZE];
+    std::fill(rowDepth, rowDepth + std::size_t(tilesX) * TILE_SIZE, 1.0f);
+
+    const float rowMinY = tileY * TILE_HEIGHT + 0.5f;
+    const float rowMaxY = rowMinY + (TILE_HEIGHT - 1);
+
+    for (std::uint32_t index : tileRowTriangles[tileY])
+    {
+        const Triangle& t = triangles[index];
+
+        for (int tileX = t.minX / TILE_WIDTH; tileX <= t.maxX / TILE_WIDTH; ++tileX)
+        {
+            // pixel centers
+            const float tileMinX = tileX * TILE_WIDTH + 0.5f;
+            const float tileMaxX = tileMinX + (TILE_WIDTH - 1);
+
+            // skip tiles completely outside of an edge
+            bool outside = false;
+            for (int e = 0; e < 3 && !outside; ++e)
+            {
+                const float x = t.edgeA[e] > 0.0f ? tileMaxX : tileMinX;
+                const float y = t.edgeB[e] > 0.0f ? rowMaxY : rowMinY;
+                outside = t.edgeA[e] * x + t.edgeB[e] * y + t.edgeC[e] < 0.0f;
+            }
+            if (outside)
+            {
+                continue;
+            }
+
+            float* tileDepth = rowDepth + tileX * TILE_SIZE;
+            for (int row = 0; row < TILE_HEIGHT; ++row)
+            {
+                const float y = rowMinY + row;
+                float* rowPixels = tileDepth + row * TILE_WIDTH;
+
+#if defined(OCCLUSION_BUFFER_AVX)
+                const __m256 x = _mm256_add_ps(_mm256_set1_ps(tileMinX), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7));
+                __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+                for (int e = 0; e < 3; ++e)
+                {
+                    const __m256 edge = _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(t.edgeA[e])), _mm256_set1_ps(t.edgeB[e] * y + t.edgeC[e]));
+                    inside = _mm256_and_ps(inside, _mm256_cmp_ps(edge, _mm256_setzero_ps(), _CMP_GE_OQ));
+                }
+                const __m256 z = _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(t.depthA)), _mm256_set1_ps(t.depthB * y + t.depthC));
+                const __m256 current = _mm256_loadu_ps(rowPixels);
+                _mm256_storeu_ps(rowPixels, _mm256_blendv_ps(current, _mm256_min_ps(current, z), inside));
+#elif defined(OCCLUSION_BUFFER_SSE)
+                for (int half = 0; half < TILE_WIDTH; half += 4)
+                {
+                    const __m128 x = _mm_add_ps(_mm_set1_ps(tileMinX + half), _mm_setr_ps(0, 1, 2, 3));
+                    __m128 inside = _mm_cmpeq_ps(x, x);
+                    for (int e = 0; e < 3; ++e)
+                    {
+                        const __m128 edge = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(t.edgeA[e])), _mm_set1_ps(t.edgeB[e] * y + t.edgeC[e]));
+                        inside = _mm_and_ps(inside, _mm_cmpge_ps(edge, _mm_setzero_ps()));
+                    }
+                    const __m128 z = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(t.depthA)), _mm_set1_ps(t.depthB * y + t.depthC));
+                    const __m128 current = _mm_loadu_ps(rowPixels + half);
+                    const __m128 nearer = _mm_min_ps(current, z);
+                    _mm_storeu_ps(rowPixels + half, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, current)));
+                }
+#else
+                for (int column = 0; column < TILE_WIDTH; ++column)
+                {
+                    const float x = tileMinX + column;
+                    if (t.edgeA[0] * x + t.edgeB[0] * y + t.edgeC[0] >= 0.0f &&
+                        t.edgeA[1] * x + t.edgeB[1] * y + t.edgeC[1] >= 0.0f &&
+                        t.edgeA[2] * x + t.edgeB[2] * y + t.edgeC[2] >= 0.0f)
+                    {
+                        rowPixels[column] = std::min(rowPixels[column], t.depthA * x + t.depthB * y + t.depthC);
+                    }
+                }
+#endif
+            }
+        }
+    }
+
+    for (int tileX = 0; tileX < tilesX; ++tileX)
+    {
+        const float* tileDepth = rowDepth + tileX * TILE_SIZE;
+        tileMaxDepth[std::size_t(tileY) * tilesX + tileX] = *std::max_element(tileDepth, tileDepth + TILE_SIZE);
+    }
+}
+
+bool OcclusionBuffer::boxVisible(const glm::vec3& center, const glm::vec3& extents) const
+{
+    // screen rectangle and nearest depth of the corners
+    float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+    float nearest = FLT_MAX;
+    // corners as the projected center plus or minus the projected axes, 4 transforms instead of 8
+    const glm::vec4 clipCenter = viewProjection * glm::vec4(center, 1.0f);
+    const glm::vec4 axisX = viewProjection[0] * extents.x;
+    const glm::vec4 axisY = viewProjection[1] * extents.y;
+    const glm::vec4 axisZ = viewProjection[2] * extents.z;
+    for (int i = 0; i < 8; ++i)
+    {
+        const glm::vec4 clip = clipCenter + ((i & 1) ? axisX : -axisX) + ((i & 2) ? axisY : -axisY) + ((i & 4) ? axisZ : -axisZ);
+        // reaching in front of the near plane, the box can't be projected
+        if (clip.w <= 0.0f || clip.z < -clip.w)
+        {
+            return true;
+        }
+
+        const float inverseW = 1.0f / clip.w;
+        const float x = (clip.x * inverseW * 0.5f + 0.5f) * width;
+        const float y = (clip.y * inverseW * 0.5f + 0.5f) * height;
+        minX = std::min(minX, x);
+        minY = std::min(minY, y);
+        maxX = std::max(maxX, x);
+        maxY = std::max(maxY, y);
+        nearest = std::min(nearest, clip.z * inverseW * 0.5f + 0.5f);
+    }
+
+    // every pixel the rectangle touches
+    const int x0 = std::max(0, int(std::floor(std::max(minX, -1.0f))));
+    const int y0 = std::max(0, int(std::floor(std::max(minY, -1.0f))));
+    const int x1 = std::min(width - 1, int(std::floor(std::min(maxX, float(width)))));
+    const int y1 = std::min(height - 1, int(std::floor(std::min(maxY, float(height)))));
+    // off screen, that's for the frustum test to decide
+    if (x0 > x1 || y0 > y1)
+    {
+        return true;
+    }
+
+    for (int tileY = y0 / TILE_HEIGHT; tileY <= y1 / TILE_HEIGHT; ++tileY)
+    {
+        for (int tileX = x0 / TILE_WIDTH; tileX <= x1 / TILE_WIDTH; ++tileX)
+        {
+            const std::size_t tile = std::size_t(tileY) * tilesX + tileX;
+            // behind everything drawn into the tile
+            if (nearest > tileMaxDepth[tile])
+            {
+                continue;
+            }
+
+            const int pixelX = tileX * TILE_WIDTH;
+            const int pixelY = tileY * TILE_HEIGHT;
+            // the farthest pixel of the tile is in front of the box, and inside the rectangle
+            if (x0 <= pixelX && pixelX + TILE_WIDTH - 1 <= x1 && y0 <= pixelY && pixelY + TILE_HEIGHT - 1 <= y1)
+            {
+                return true;
+            }
+
+            // the pixels of a tile the rectangle only partly covers
+            const int firstRow = std::max(y0, pixelY) - pixelY;
+            const int lastRow = std::min(y1, pixelY + TILE_HEIGHT - 1) - pixelY;
+            const int firstColumn = std::max(x0, pixelX) - pixelX;
+            const int lastColumn = std::min(x1, pixelX + TILE_WIDTH - 1) - pixelX;
+            const float* tileDepth = &depth[tile * TILE_SIZE];
+
+#if defined(OCCLUSION_BUFFER_AVX)
+            const __m256 lane = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+            const __m256 columns = _mm256_and_ps(_mm256_cmp_ps(lane, _mm256_set1_ps(float(firstColumn)), _CMP_GE_OQ),
+                                                 _mm256_cmp_ps(lane, _mm256_set1_ps(float(lastColumn)), _CMP_LE_OQ));
+            const __m256 boxDepth = _mm256_set1_ps(nearest);
+            for (int row = firstRow; row <= lastRow; ++row)
+            {
+                const __m256 pixels = _mm256_loadu_ps(tileDepth + row * TILE_WIDTH);
+                if (_mm256_movemask_ps(_mm256_and_ps(columns, _mm256_cmp_ps(boxDepth, pixels, _CMP_LE_OQ))) != 0)
+                {
+                    return true;
+                }
+            }
+#elif defined(OCCLUSION_BUFFER_SSE)
+            const __m128 boxDepth = _mm_set1_ps(nearest);
+            for (int half = 0; half < TILE_WIDTH; half += 4)
+            {
+                const __m128 lane = _mm_setr_ps(float(half), float(half + 1), float(half + 2), float(half + 3));
+                const __m128 columns = _mm_and_ps(_mm_cmpge_ps(lane, _mm_set1_ps(float(firstColumn))),
+                                                  _mm_cmple_ps(lane, _mm_set1_ps(float(lastColumn))));
+                for (int row = firstRow; row <= lastRow; ++row)
+                {
+                    const __m128 pixels = _mm_loadu_ps(tileDepth + row * TILE_WIDTH + half);
+                    if (_mm_movemask_ps(_mm_and_ps(columns, _mm_cmple_ps(boxDepth, pixels))) != 0)
+                    {
+                        return true;
+                    }
+                }
+            }
+#else
+            for (int row = firstRow; row <= lastRow; ++row)
+            {
+                for (int column = firstColumn; column <= lastColumn; ++column)
+                {
+                    if (nearest <= tileDepth[row * TILE_WIDTH + column])
+                    {
+                        return true;
+                    }
+                }
+            }
+#endif
+        }
+    }
+    return false;
+}
+
+std::size_t OcclusionBuffer::cullBoxes(const BoundsBatch& batch, std::vector<unsigned char>& visible)
+{
+    const Clock::time_point start = Clock::now();
+
+    const std::size_t count = batch.size();
+    visible.resize(count, 1);
+
+    std::atomic<std::size_t> tested(0);
+    std::atomic<std::size_t> occluded(0);
+    parallelFor(count, TEST_GRAIN, [&](std::size_t begin, std::size_t end)
+    {
+        std::size_t chunkTested = 0;
+        std::size_t chunkOccluded = 0;
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            if (!visible[i])
+            {
+                continue;
+            }
+
+            ++chunkTested;
+            const glm::vec3 center(batch.centerX[i], batch.centerY[i], batch.centerZ[i]);
+            const glm::vec3 extents(batch.extentX[i], batch.extentY[i], batch.extentZ[i]);
+            if (!boxVisible(center, extents))
+            {
+                visible[i] = 0;
+                ++chunkOccluded;
+            }
+        }
+        tested += chunkTested;
+        occluded += chunkOccluded;
+    });
+
+    counters.tested += tested;
+    counters.occluded += occluded;
+    counters.testMs += millisecondsSince(start);
+    return occluded;
+}
+
+float OcclusionBuffer::depthAt(int x, int y) const
+{
+    const std::size_t tile = std::size_t(y / TILE_HEIGHT) * tilesX + x / TILE_WIDTH;
+    return depth[tile * TILE_SIZE + (y % TILE_HEIGHT) * TILE_WIDTH + x % TILE_WIDTH];
+}
+
+const char* OcclusionBuffer::simdName()
+{
+#if defined(OCCLUSION_BUFFER_AVX)
+    return "AVX";
+#elif defined(OCCLUSION_BUFFER_SSE)
+    return "SSE";
+#else
+    return "scalar";
+#endif
+}
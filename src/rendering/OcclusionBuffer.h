@@ -0,0 +1,113 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Bounds.h"
+#include "FrustumCuller.h"
+
+// Software occlusion culling on the CPU: a few large occluders (floors, walls, big models) are
+// rasterized into a small depth buffer, and the boxes of everything else are tested against it.
+// Unlike GPU queries or the Hi-Z pyramid of GpuCuller the result is available in the same frame,
+// without reading anything back.
+//
+// The buffer is split into tiles of TILE_WIDTH x TILE_HEIGHT pixels, stored one after the other,
+// so a tile row is one AVX register (two SSE ones) and triangles are rasterized into it with
+// masked min writes. Every tile also keeps its farthest depth: most box tests end there, without
+// looking at single pixels. Rasterization runs in parallel over tile rows, the box tests over
+// the boxes (see Parallel.h).
+//
+//   occlusion.begin(projection * view);
+//   occlusion.addOccluder(&mesh.vertices[0].Position, sizeof(Vertex), mesh.vertices.size(),
+//                         mesh.indices.data(), mesh.indices.size(), modelMatrix);
+//   occlusion.rasterize();
+//   occlusion.cullBoxes(bounds, visible);   // after the frustum culler filled visible
+class OcclusionBuffer
+{
+public:
+    static constexpr int TILE_WIDTH = 8;
+    static constexpr int TILE_HEIGHT = 4;
+
+    struct Stats
+    {
+        std::size_t occluderTriangles = 0;      // passed to addOccluder()
+        std::size_t rasterizedTriangles = 0;    // after clipping and dropping off-screen ones
+        std::size_t tested = 0;
+        std::size_t occluded = 0;
+
+        // CPU time of the stages
+        double setupMs = 0.0;       // transforming, clipping and setting up the occluders
+        double rasterMs = 0.0;
+        double testMs = 0.0;
+    };
+
+    // the size is rounded up to whole tiles; a few hundred pixels across are plenty
+    explicit OcclusionBuffer(int width = 256, int height = 128);
+
+    void resize(int width, int height);
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+    // starts a frame, dropping the occluders of the last one
+    void begin(const glm::mat4& viewProjection);
+
+    // positions are read with the given byte stride, so mesh vertices can be passed directly
+    void addOccluder(const void* positions, std::size_t stride, std::size_t vertexCount,
+                     const unsigned int* indices, std::size_t indexCount, const glm::mat4& modelMatrix);
+
+    // the 12 triangles of a box, e.g. a large cube or a wall
+    void addBoxOccluder(const Bounds& localBounds, const glm::mat4& modelMatrix);
+
+    // draws the occluders added since begin() into the depth buffer
+    void rasterize();
+
+    // clears visible[i] for the entries whose box is hidden behind the occluders. Entries that
+    // are 0 already (frustum culled) are skipped. Returns the number of entries it cleared.
+    std::size_t cullBoxes(const BoundsBatch& batch, std::vector<unsigned char>& visible);
+
+    // world space box given by its center and half size
+    bool boxVisible(const glm::vec3& center, const glm::vec3& extents) const;
+
+    // depth of a pixel in [0, 1], 1 where no occluder was drawn; (0, 0) is the bottom left
+    float depthAt(int x, int y) const;
+
+    void resetStats() { counters = Stats(); }
+    const Stats& stats() const { return counters; }
+
+    // which instruction set the rasterizer and the tests were compiled for
+    static const char* simdName();
+
+private:
+    // edge functions and depth as planes a * x + b * y + c in pixel coordinates
+    struct Triangle
+    {
+        float edgeA[3], edgeB[3], edgeC[3];
+        float depthA, depthB, depthC;
+        int minX, minY, maxX, maxY;     // pixels, inclusive
+    };
+
+    int width = 0;
+    int height = 0;
+    int tilesX = 0;
+    int tilesY = 0;
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+
+    std::vector<float> depth;           // tile after tile, TILE_WIDTH * TILE_HEIGHT pixels each
+    std::vector<float> tileMaxDepth;
+    std::vector<Triangle> triangles;
+    std::vector<std::vector<std::uint32_t>> tileRowTriangles;
+    std::vector<glm::vec4> clipPositions;
+
+    Stats counters;
+
+    void addClipTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+    void setupTriangle(glm::vec3 a, glm::vec3 b, glm::vec3 c);
+    void rasterizeTileRow(int tileY);
+};
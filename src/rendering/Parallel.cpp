@@ -0,0 +1,129 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include "Parallel.h"
+
+#include <algorithm>
+
+namespace
+{
+    thread_local unsigned int currentThreadIndex = 0;
+    thread_local const JobSystem* currentOwner = nullptr;
+}
+
+JobSystem& JobSystem::get()
+{
+    static JobSystem jobs(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return jobs;
+}
+
+JobSystem::JobSystem(unsigned int workerCount)
+{
+    for (unsigned int i = 0; i < workerCount; ++i)
+    {
+        workers.emplace_back(&JobSystem::workerLoop, this, i + 1);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wakeWorkers.notify_all();
+
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void JobSystem::parallelFor(std::size_t count, std::size_t grainSize, const RangeFunction& fn)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    grainSize = std::max<std::size_t>(1, grainSize);
+    const std::size_t chunkCount = (count + grainSize - 1) / grainSize;
+
+    // not worth waking anybody up
+    if (chunkCount == 1 || workers.empty())
+    {
+        fn(0, count);
+        return;
+    }
+
+    // one batch in flight at a time; nested parallelFor calls from inside fn run serially
+    std::unique_lock<std::mutex> submitLock(submitMutex, std::try_to_lock);
+    if (!submitLock.owns_lock())
+    {
+        fn(0, count);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    batch.fn = &fn;
+    batch.count = count;
+    batch.grainSize = grainSize;
+    batch.nextChunk = 0;
+    batch.chunkCount = chunkCount;
+    batch.finishedChunks = 0;
+    hasBatch = true;
+    wakeWorkers.notify_all();
+
+    runChunks(lock);
+
+    batchDone.wait(lock, [this] { return batch.finishedChunks == batch.chunkCount; });
+    hasBatch = false;
+}
+
+unsigned int JobSystem::threadIndex()
+{
+    return currentThreadIndex;
+}
+
+bool JobSystem::ownsCurrentThread() const
+{
+    return currentOwner == this;
+}
+
+void JobSystem::workerLoop(unsigned int index)
+{
+    currentThreadIndex = index;
+    currentOwner = this;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        wakeWorkers.wait(lock, [this] { return quit || (hasBatch && batch.nextChunk < batch.chunkCount); });
+        if (quit)
+        {
+            return;
+        }
+
+        runChunks(lock);
+    }
+}
+
+void JobSystem::runChunks(std::unique_lock<std::mutex>& lock)
+{
+    while (hasBatch && batch.nextChunk < batch.chunkCount)
+    {
+        const std::size_t chunk = batch.nextChunk++;
+        const std::size_t begin = chunk * batch.grainSize;
+        const std::size_t end = std::min(batch.count, begin + batch.grainSize);
+        const RangeFunction& fn = *batch.fn;
+
+        lock.unlock();
+        fn(begin, end);
+        lock.lock();
+
+        if (++batch.finishedChunks == batch.chunkCount)
+        {
+            batchDone.notify_all();
+        }
+    }
+}
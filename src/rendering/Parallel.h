@@ -0,0 +1,75 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A small pool of worker threads for data-parallel CPU work (culling, mesh processing...).
+// The calling thread takes part in the work, so parallelFor also works with zero workers.
+class JobSystem
+{
+public:
+    using RangeFunction = std::function<void(std::size_t begin, std::size_t end)>;
+
+    // shared pool with one worker per additional hardware thread
+    static JobSystem& get();
+
+    explicit JobSystem(unsigned int workerCount);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // calls fn on [begin, end) chunks of at most grainSize elements covering [0, count),
+    // and returns once all of them are done. Chunks run concurrently, in no particular order.
+    void parallelFor(std::size_t count, std::size_t grainSize, const RangeFunction& fn);
+
+    // number of threads working on a parallelFor, including the caller
+    unsigned int threadCount() const { return static_cast<unsigned int>(workers.size()) + 1; }
+
+    // in [0, threadCount()): 1 and up on the workers, 0 on any other thread. Lets work running in
+    // a parallelFor pick per-thread storage without locking (see CommandRecorder). The index is
+    // shared by all pools and by all threads outside of them, check ownsCurrentThread() first.
+    static unsigned int threadIndex();
+
+    // whether the calling thread is one of the workers of this pool
+    bool ownsCurrentThread() const;
+
+private:
+    struct Batch
+    {
+        const RangeFunction* fn = nullptr;
+        std::size_t count = 0;
+        std::size_t grainSize = 1;
+        std::size_t nextChunk = 0;
+        std::size_t chunkCount = 0;
+        std::size_t finishedChunks = 0;
+    };
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wakeWorkers;
+    std::condition_variable batchDone;
+    std::mutex submitMutex;
+
+    Batch batch;
+    bool hasBatch = false;
+    bool quit = false;
+
+    void workerLoop(unsigned int index);
+    // runs chunks of the current batch until none are left; expects the lock to be held
+    void runChunks(std::unique_lock<std::mutex>& lock);
+};
+
+// shorthand for JobSystem::get().parallelFor
+inline void parallelFor(std::size_t count, std::size_t grainSize, const JobSystem::RangeFunction& fn)
+{
+    JobSystem::get().parallelFor(count, grainSize, fn);
+}
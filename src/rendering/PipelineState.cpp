@@ -0,0 +1,107 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include "PipelineState.h"
+
+#include <memory>
+#include <unordered_map>
+
+#include "GLState.h"
+#include "Shader.h"
+
+namespace
+{
+    // FNV-1a, field by field so padding doesn't take part
+    struct Fnv
+    {
+        std::uint32_t value = 2166136261u;
+
+        void add(std::uint64_t field)
+        {
+            for (int byte = 0; byte < 8; ++byte)
+            {
+                value ^= static_cast<std::uint32_t>((field >> (8 * byte)) & 0xFF);
+                value *= 16777619u;
+            }
+        }
+    };
+
+    struct DescHash
+    {
+        std::size_t operator()(const PipelineDesc& desc) const { return desc.hash(); }
+    };
+
+    std::unordered_map<PipelineDesc, std::unique_ptr<PipelineState>, DescHash>& pipelines()
+    {
+        static std::unordered_map<PipelineDesc, std::unique_ptr<PipelineState>, DescHash> created;
+        return created;
+    }
+}
+
+bool PipelineDesc::operator==(const PipelineDesc& other) const
+{
+    return shader == other.shader
+        && vertexArray == other.vertexArray
+        && blend.enabled == other.blend.enabled
+        && blend.source == other.blend.source
+        && blend.destination == other.blend.destination
+        && depth.test == other.depth.test
+        && depth.write == other.depth.write
+        && depth.function == other.depth.function
+        && raster.cull == other.raster.cull
+        && raster.cullFace == other.raster.cullFace;
+}
+
+std::uint32_t PipelineDesc::hash() const
+{
+    Fnv fnv;
+    fnv.add(reinterpret_cast<std::uintptr_t>(shader));
+    fnv.add(vertexArray);
+    fnv.add(blend.enabled);
+    fnv.add(blend.source);
+    fnv.add(blend.destination);
+    fnv.add(depth.test);
+    fnv.add(depth.write);
+    fnv.add(depth.function);
+    fnv.add(raster.cull);
+    fnv.add(raster.cullFace);
+    return fnv.value;
+}
+
+const PipelineState* PipelineState::create(const PipelineDesc& desc)
+{
+    std::unique_ptr<PipelineState>& pipeline = pipelines()[desc];
+    if (!pipeline)
+    {
+        pipeline.reset(new PipelineState(desc, desc.hash()));
+    }
+    return pipeline.get();
+}
+
+std::size_t PipelineState::count()
+{
+    return pipelines().size();
+}
+
+void PipelineState::bind() const
+{
+    GLState& state = GLState::get();
+
+    if (desc.shader != nullptr)
+        desc.shader->apply();
+    if (desc.vertexArray != 0)
+        state.bindVertexArray(desc.vertexArray);
+
+    // the functions are set even with their capability disabled, so what a pipeline leaves
+    // behind doesn't depend on the one bound before it (the depth mask also affects clears)
+    state.setEnabled(GL_BLEND, desc.blend.enabled);
+    state.blendFunc(desc.blend.source, desc.blend.destination);
+
+    state.setEnabled(GL_DEPTH_TEST, desc.depth.test);
+    state.depthMask(desc.depth.write ? GL_TRUE : GL_FALSE);
+    state.depthFunc(desc.depth.function);
+
+    state.setEnabled(GL_CULL_FACE, desc.raster.cull);
+    state.cullFace(desc.raster.cullFace);
+}
@@ -0,0 +1,89 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+
+class Shader;
+
+struct BlendState
+{
+    bool enabled = false;
+    GLenum source = GL_ONE;
+    GLenum destination = GL_ZERO;
+
+    static BlendState alpha() { return BlendState{ true, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA }; }
+    static BlendState additive() { return BlendState{ true, GL_ONE, GL_ONE }; }
+};
+
+struct DepthState
+{
+    bool test = true;
+    bool write = true;
+    GLenum function = GL_LESS;
+};
+
+struct RasterState
+{
+    bool cull = false;
+    GLenum cullFace = GL_BACK;
+};
+
+// Everything a draw expects to be set besides its buffers, textures and uniforms.
+// vertexArray stands for the vertex layout; with the arenas that is one VAO per layout,
+// GeometryArena<Layout>::get().vertexArray(). 0 leaves the bound VAO alone, for draws that
+// bind their own.
+struct PipelineDesc
+{
+    Shader* shader = nullptr;
+    GLuint vertexArray = 0;
+    BlendState blend;
+    DepthState depth;
+    RasterState raster;
+
+    bool operator==(const PipelineDesc& other) const;
+    bool operator!=(const PipelineDesc& other) const { return !(*this == other); }
+
+    std::uint32_t hash() const;
+};
+
+// An immutable bundle of program, vertex layout, blend, depth and raster state. Pipelines
+// are created once, usually at load time, and deduplicated by their description: creating
+// the same description twice gives the same pipeline, so comparing pipelines is comparing
+// pointers. They live until the end of the program and don't own the shader or VAO.
+//
+// bind() sets the whole description through GLState, which skips what is already set, so
+// switching pipelines only costs the calls for the state that differs between them.
+//
+//   static const PipelineState* opaque = PipelineState::create(desc);
+//   opaque->bind();
+class PipelineState
+{
+public:
+    static const PipelineState* create(const PipelineDesc& desc);
+
+    // pipelines created so far, after deduplication
+    static std::size_t count();
+
+    void bind() const;
+
+    const PipelineDesc& description() const { return desc; }
+    std::uint32_t hash() const { return hashValue; }
+
+    PipelineState(const PipelineState&) = delete;
+    PipelineState& operator=(const PipelineState&) = delete;
+
+private:
+    const PipelineDesc desc;
+    const std::uint32_t hashValue;
+
+    PipelineState(const PipelineDesc& desc, std::uint32_t hashValue)
+        : desc(desc), hashValue(hashValue)
+    {
+    }
+};
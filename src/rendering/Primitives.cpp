@@ -0,0 +1,265 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include "Primitives.h"
+
+namespace
+{
+    struct PrimitiveVertex
+    {
+        float position[3];
+        float normal[3];
+        float texCoords[2];
+    };
+
+    template <std::size_t V, std::size_t I>
+    struct Table
+    {
+        PrimitiveVertex vertices[V];
+        unsigned int indices[I];
+    };
+
+    constexpr double PI = 3.14159265358979323846;
+
+    // std::sin and std::cos aren't constexpr; a Taylor series on [-pi, pi] is exact to float precision
+    constexpr double sine(double x)
+    {
+        x -= 2.0 * PI * static_cast<long long>(x / (2.0 * PI));
+        if (x > PI)
+            x -= 2.0 * PI;
+        else if (x < -PI)
+            x += 2.0 * PI;
+
+        double term = x;
+        double sum = x;
+        for (int n = 1; n < 12; ++n)
+        {
+            term *= -x * x / ((2 * n) * (2 * n + 1));
+            sum += term;
+        }
+        return sum;
+    }
+
+    constexpr double cosine(double x) { return sine(x + 0.5 * PI); }
+
+    constexpr double squareRoot(double x)
+    {
+        double root = x > 1.0 ? x : 1.0;
+        for (int i = 0; i < 32; ++i)
+            root = 0.5 * (root + x / root);
+        return root;
+    }
+
+    constexpr PrimitiveVertex vertex(double px, double py, double pz, double nx, double ny, double nz, double u, double v)
+    {
+        return PrimitiveVertex{ { float(px), float(py), float(pz) }, { float(nx), float(ny), float(nz) }, { float(u), float(v) } };
+    }
+
+    constexpr Table<24, 36> makeCube()
+    {
+        Table<24, 36> table{};
+        const double normals[6][3] = { { 0, 0, -1 }, { 0, 0, 1 }, { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 } };
+        const double uvs[4][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+        const unsigned int face[6] = { 0, 1, 2, 2, 3, 0 };
+
+        for (unsigned int f = 0; f < 6; ++f)
+        {
+            // two axes spanning the face, with u x v = n so the quads wind counter clockwise
+            const double* n = normals[f];
+            const double u[3] = { n[1], n[2], n[0] };
+            const double v[3] = { n[1] * u[2] - n[2] * u[1], n[2] * u[0] - n[0] * u[2], n[0] * u[1] - n[1] * u[0] };
+
+            for (unsigned int k = 0; k < 4; ++k)
+            {
+                const double a = uvs[k][0] - 0.5;
+                const double b = uvs[k][1] - 0.5;
+                table.vertices[f * 4 + k] = vertex(0.5 * n[0] + a * u[0] + b * v[0],
+                                                   0.5 * n[1] + a * u[1] + b * v[1],
+                                                   0.5 * n[2] + a * u[2] + b * v[2],
+                                                   n[0], n[1], n[2], uvs[k][0], uvs[k][1]);
+            }
+            for (unsigned int i = 0; i < 6; ++i)
+                table.indices[f * 6 + i] = f * 4 + face[i];
+        }
+        return table;
+    }
+
+    constexpr Table<4, 6> makeRectangle(bool screenQuad)
+    {
+        Table<4, 6> table{};
+        const double uvs[4][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+        for (unsigned int k = 0; k < 4; ++k)
+        {
+            const double u = uvs[k][0];
+            const double v = uvs[k][1];
+            table.vertices[k] = screenQuad ? vertex(2.0 * u - 1.0, 2.0 * v - 1.0, 0.0, 0.0, 0.0, 1.0, u, v)
+                                           : vertex(u - 0.5, 0.0, 0.5 - v, 0.0, 1.0, 0.0, u, v);
+        }
+        const unsigned int face[6] = { 0, 1, 2, 2, 3, 0 };
+        for (unsigned int i = 0; i < 6; ++i)
+            table.indices[i] = face[i];
+        return table;
+    }
+
+    const unsigned int SPHERE_STACKS = 16;
+    const unsigned int SPHERE_SLICES = 32;
+    // the stacks at the poles are a single triangle per slice
+    using SphereTable = Table<(SPHERE_STACKS + 1) * (SPHERE_SLICES + 1), (SPHERE_STACKS - 1) * SPHERE_SLICES * 6>;
+
+    constexpr SphereTable makeSphere()
+    {
+        SphereTable table{};
+        for (unsigned int i = 0; i <= SPHERE_STACKS; ++i)
+        {
+            const double theta = PI * i / SPHERE_STACKS;
+            for (unsigned int j = 0; j <= SPHERE_SLICES; ++j)
+            {
+                const double phi = 2.0 * PI * j / SPHERE_SLICES;
+                const double x = sine(theta) * cosine(phi);
+                const double y = cosine(theta);
+                const double z = sine(theta) * sine(phi);
+                table.vertices[i * (SPHERE_SLICES + 1) + j] =
+                    vertex(0.5 * x, 0.5 * y, 0.5 * z, x, y, z, double(j) / SPHERE_SLICES, 1.0 - double(i) / SPHERE_STACKS);
+            }
+        }
+
+        unsigned int k = 0;
+        for (unsigned int i = 0; i < SPHERE_STACKS; ++i)
+        {
+            for (unsigned int j = 0; j < SPHERE_SLICES; ++j)
+            {
+                const unsigned int a = i * (SPHERE_SLICES + 1) + j;
+                const unsigned int b = a + SPHERE_SLICES + 1;
+                if (i != 0)
+                {
+                    table.indices[k++] = a;
+                    table.indices[k++] = a + 1;
+                    table.indices[k++] = b;
+                }
+                if (i != SPHERE_STACKS - 1)
+                {
+                    table.indices[k++] = a + 1;
+                    table.indices[k++] = b + 1;
+                    table.indices[k++] = b;
+                }
+            }
+        }
+        return table;
+    }
+
+    const unsigned int CONE_SLICES = 32;
+    // side: a base ring and an apex per slice (each with the normal of its slice), cap: a center and a ring
+    using ConeTable = Table<(CONE_SLICES + 1) + CONE_SLICES + 1 + (CONE_SLICES + 1), CONE_SLICES * 6>;
+
+    constexpr ConeTable makeCone()
+    {
+        ConeTable table{};
+        const unsigned int apex = CONE_SLICES + 1;
+        const unsigned int center = apex + CONE_SLICES;
+        const unsigned int cap = center + 1;
+
+        // radius 0.5 over a height of 1
+        const double slant = squareRoot(1.0 + 0.25);
+        for (unsigned int j = 0; j <= CONE_SLICES; ++j)
+        {
+            const double phi = 2.0 * PI * j / CONE_SLICES;
+            const double c = cosine(phi);
+            const double s = sine(phi);
+            table.vertices[j] = vertex(0.5 * c, -0.5, 0.5 * s, c / slant, 0.5 / slant, s / slant, double(j) / CONE_SLICES, 0.0);
+            table.vertices[cap + j] = vertex(0.5 * c, -0.5, 0.5 * s, 0.0, -1.0, 0.0, 0.5 + 0.5 * c, 0.5 + 0.5 * s);
+            if (j < CONE_SLICES)
+            {
+                const double mid = 2.0 * PI * (j + 0.5) / CONE_SLICES;
+                table.vertices[apex + j] = vertex(0.0, 0.5, 0.0, cosine(mid) / slant, 0.5 / slant, sine(mid) / slant,
+                                                  (j + 0.5) / CONE_SLICES, 1.0);
+            }
+        }
+        table.vertices[center] = vertex(0.0, -0.5, 0.0, 0.0, -1.0, 0.0, 0.5, 0.5);
+
+        unsigned int k = 0;
+        for (unsigned int j = 0; j < CONE_SLICES; ++j)
+        {
+            table.indices[k++] = j;
+            table.indices[k++] = apex + j;
+            table.indices[k++] = j + 1;
+
+            table.indices[k++] = center;
+            table.indices[k++] = cap + j;
+            table.indices[k++] = cap + j + 1;
+        }
+        return table;
+    }
+
+    constexpr auto CUBE = makeCube();
+    constexpr auto PLANE = makeRectangle(false);
+    constexpr auto QUAD = makeRectangle(true);
+    constexpr auto SPHERE = makeSphere();
+    constexpr auto CONE = makeCone();
+
+    template <std::size_t V, std::size_t I>
+    void copyTable(const Table<V, I>& table, std::vector<Primitives::Vertex>& vertices, std::vector<unsigned int>& indices)
+    {
+        vertices.resize(V);
+        for (std::size_t i = 0; i < V; ++i)
+        {
+            const PrimitiveVertex& source = table.vertices[i];
+            vertices[i].Position = glm::vec3(source.position[0], source.position[1], source.position[2]);
+            vertices[i].Normal = glm::vec3(source.normal[0], source.normal[1], source.normal[2]);
+            vertices[i].TexCoords = glm::vec2(source.texCoords[0], source.texCoords[1]);
+        }
+        indices.assign(table.indices, table.indices + I);
+    }
+}
+
+Primitives& Primitives::get()
+{
+    static Primitives primitives;
+    return primitives;
+}
+
+Primitives::Primitives()
+{
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    for (std::size_t i = 0; i < std::size_t(Primitive::Count); ++i)
+    {
+        geometry(Primitive(i), vertices, indices);
+        allocations[i] = Arena::get().upload(vertices, indices);
+        primitiveBounds[i] = Bounds::fromPoints(&vertices[0].Position, sizeof(Vertex), vertices.size());
+    }
+}
+
+void Primitives::draw(Primitive primitive) const
+{
+    Arena::get().bind();
+    drawRange(primitive);
+}
+
+void Primitives::drawRange(Primitive primitive) const
+{
+    Arena::get().draw(allocation(primitive));
+}
+
+void Primitives::drawInstanced(Primitive primitive, std::size_t instanceCount) const
+{
+    const Arena& arena = Arena::get();
+    arena.bind();
+    arena.drawRangeInstanced(allocation(primitive), 0, arena.indexCount(allocation(primitive)), instanceCount);
+}
+
+void Primitives::geometry(Primitive primitive, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+    switch (primitive)
+    {
+    case Primitive::Cube:   copyTable(CUBE, vertices, indices); break;
+    case Primitive::Plane:  copyTable(PLANE, vertices, indices); break;
+    case Primitive::Quad:   copyTable(QUAD, vertices, indices); break;
+    case Primitive::Sphere: copyTable(SPHERE, vertices, indices); break;
+    case Primitive::Cone:   copyTable(CONE, vertices, indices); break;
+    default:
+        vertices.clear();
+        indices.clear();
+        break;
+    }
+}
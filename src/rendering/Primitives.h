@@ -0,0 +1,67 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Bounds.h"
+#include "GeometryArena.h"
+#include "VertexLayout.h"
+
+// The shapes the chapters keep drawing, indexed. Their vertices are generated at compile time
+// (constexpr tables in Primitives.cpp), all unit sized and centered on the origin:
+//   Cube    24 vertices, [-0.5, 0.5] on every axis, a face per uv square
+//   Plane   on y = 0, [-0.5, 0.5] in x and z, facing +y
+//   Quad    on z = 0, [-1, 1] in x and y, facing +z: covers the screen without any transform
+//   Sphere  radius 0.5, uv mapped by longitude / latitude
+//   Cone    apex at y = 0.5, base of radius 0.5 at y = -0.5, capped
+enum class Primitive
+{
+    Cube = 0,
+    Plane,
+    Quad,
+    Sphere,
+    Cone,
+    Count
+};
+
+// Uploads every primitive once into the geometry arena of DefaultLayout (the one Mesh and
+// Model use), so drawing one is a range of the arena VAO instead of a VAO per chapter.
+// The allocations are stable handles: they stay valid when the arena grows or compacts.
+class Primitives
+{
+public:
+    using Arena = GeometryArena<DefaultLayout>;
+    using Vertex = DefaultLayout::Vertex;
+
+    // uploads all primitives on the first call; needs a current GL context
+    static Primitives& get();
+
+    const Arena::Allocation& allocation(Primitive primitive) const { return allocations[index(primitive)]; }
+    const Bounds& bounds(Primitive primitive) const { return primitiveBounds[index(primitive)]; }
+
+    // binds the arena VAO
+    void draw(Primitive primitive) const;
+
+    // expects the arena VAO to be bound (see Arena::bind())
+    void drawRange(Primitive primitive) const;
+
+    // instanceCount copies, placed by the bound InstanceBuffer
+    void drawInstanced(Primitive primitive, std::size_t instanceCount) const;
+
+    // a copy of the tables, for meshes that need their own (raycasts, draw buckets...)
+    static void geometry(Primitive primitive, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+private:
+    Arena::Allocation allocations[std::size_t(Primitive::Count)];
+    Bounds primitiveBounds[std::size_t(Primitive::Count)];
+
+    Primitives();
+    Primitives(const Primitives&) = delete;
+    Primitives& operator=(const Primitives&) = delete;
+
+    static std::size_t index(Primitive primitive) { return static_cast<std::size_t>(primitive); }
+};
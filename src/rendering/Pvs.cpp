@@ -0,0 +1,402 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include "Pvs.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <random>
+
+#include "Bvh.h"
+#include "Parallel.h"
+#include "Ray.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    const char MAGIC[4] = { 'P', 'V', 'S', 'B' };
+
+    template <typename T>
+    void write(std::ofstream& out, const T& value)
+    {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    bool read(std::ifstream& in, T& value)
+    {
+        return bool(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+    }
+
+    template <typename T>
+    bool readArray(std::ifstream& in, std::vector<T>& values, std::size_t count)
+    {
+        values.resize(count);
+        return count == 0 || bool(in.read(reinterpret_cast<char*>(values.data()), count * sizeof(T)));
+    }
+
+    // FNV-1a
+    void hash(std::uint32_t& h, const void* bytes, std::size_t size)
+    {
+        const unsigned char* p = static_cast<const unsigned char*>(bytes);
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            h = (h ^ p[i]) * 16777619u;
+        }
+    }
+
+    void hashBounds(std::uint32_t& h, const std::vector<Bounds>& bounds)
+    {
+        for (const Bounds& b : bounds)
+        {
+            hash(h, &b.min, sizeof(b.min));
+            hash(h, &b.max, sizeof(b.max));
+        }
+    }
+
+    glm::vec3 corner(const glm::vec3& min, const glm::vec3& max, int i)
+    {
+        return glm::vec3((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z);
+    }
+
+    // the corners and the center of the box, then random points inside it
+    void samplePoints(const glm::vec3& min, const glm::vec3& max, int count, std::mt19937& rng, std::vector<glm::vec3>& points)
+    {
+        points.clear();
+        for (int i = 0; i < 8; ++i)
+        {
+            points.push_back(corner(min, max, i));
+        }
+        points.push_back(0.5f * (min + max));
+
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        while (int(points.size()) < count)
+        {
+            points.push_back(min + (max - min) * glm::vec3(unit(rng), unit(rng), unit(rng)));
+        }
+    }
+
+    bool inside(const glm::vec3& p, const Bounds& box)
+    {
+        return glm::all(glm::greaterThanEqual(p, box.min)) && glm::all(glm::lessThanEqual(p, box.max));
+    }
+
+    // zero bytes become a zero followed by the run length
+    void compress(const std::vector<unsigned char>& bits, std::vector<unsigned char>& out)
+    {
+        for (std::size_t i = 0; i < bits.size(); ++i)
+        {
+            if (bits[i] != 0)
+            {
+                out.push_back(bits[i]);
+                continue;
+            }
+
+            unsigned char run = 0;
+            while (i < bits.size() && bits[i] == 0 && run < 255)
+            {
+                ++run;
+                ++i;
+            }
+            --i;
+            out.push_back(0);
+            out.push_back(run);
+        }
+    }
+
+    // whether the offsets split sets into well formed compressed sets: starting at 0, never
+    // going back, ending at its end, and no cell ending on a zero that is missing its run length
+    bool validSets(const std::vector<std::uint32_t>& offsets, const std::vector<unsigned char>& sets)
+    {
+        if (offsets.empty() || offsets.front() != 0 || offsets.back() != sets.size())
+        {
+            return false;
+        }
+
+        for (std::size_t cell = 0; cell + 1 < offsets.size(); ++cell)
+        {
+            if (offsets[cell] > offsets[cell + 1] || offsets[cell + 1] > sets.size())
+            {
+                return false;
+            }
+
+            for (std::uint32_t i = offsets[cell]; i < offsets[cell + 1]; ++i)
+            {
+                if (sets[i] == 0 && ++i == offsets[cell + 1])
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+}
+
+void Pvs::bake(const Bounds& region, const std::vector<Bounds>& occluders, const std::vector<Bounds>& objectBounds,
+               const PvsBakeSettings& settings)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    origin = region.min;
+    cellSize = settings.cellSize;
+    cells = glm::max(glm::ivec3(glm::ceil((region.max - region.min) / cellSize)), glm::ivec3(1));
+    objects = objectBounds.size();
+    currentCell = -1;
+
+    Bvh occluderBvh;
+    if (!occluders.empty())
+    {
+        occluderBvh.build(occluders);
+    }
+
+    const std::size_t cellTotal = std::size_t(cells.x) * cells.y * cells.z;
+    const std::size_t setSize = (objects + 7) / 8;
+    std::vector<std::vector<unsigned char>> compressed(cellTotal);
+
+    parallelFor(cellTotal, 4, [&](std::size_t begin, std::size_t end)
+    {
+        std::vector<glm::vec3> cellPoints;
+        std::vector<glm::vec3> objectPoints;
+        std::vector<unsigned char> bits(setSize);
+
+        for (std::size_t cell = begin; cell < end; ++cell)
+        {
+            const glm::ivec3 coordinate(int(cell % cells.x), int(cell / cells.x % cells.y), int(cell / (std::size_t(cells.x) * cells.y)));
+            const glm::vec3 cellMin = origin + glm::vec3(coordinate) * cellSize;
+
+            // seeded by the cell, so a bake gives the same sets every time
+            std::mt19937 rng(static_cast<unsigned int>(cell) * 2654435761u + 1u);
+            samplePoints(cellMin, cellMin + glm::vec3(cellSize), settings.samplesPerCell, rng, cellPoints);
+
+            // points inside an occluder see nothing but the occluder
+            cellPoints.erase(std::remove_if(cellPoints.begin(), cellPoints.end(), [&](const glm::vec3& p)
+            {
+                return std::any_of(occluders.begin(), occluders.end(), [&](const Bounds& o) { return inside(p, o); });
+            }), cellPoints.end());
+
+            std::fill(bits.begin(), bits.end(), 0);
+            for (std::size_t object = 0; object < objects; ++object)
+            {
+                const Bounds& box = objectBounds[object];
+                // everything counts as visible from a cell that is solid all over
+                bool visible = cellPoints.empty();
+
+                samplePoints(box.min, box.max, settings.raysPerObject, rng, objectPoints);
+                for (std::size_t i = 0; i < cellPoints.size() && !visible; ++i)
+                {
+                    if (inside(cellPoints[i], box))
+                    {
+                        visible = true;
+                        break;
+                    }
+
+                    for (std::size_t j = 0; j < objectPoints.size() && !visible; ++j)
+                    {
+                        Ray ray;
+                        ray.origin = cellPoints[i];
+                        ray.direction = objectPoints[j] - cellPoints[i];
+
+                        // up to just before the ray enters the object's box; the object may be
+                        // an occluder itself, so it can't block its own rays
+                        const float enter = intersectAabb(ray, 1.0f / ray.direction, box.min, box.max, 1.0f);
+                        float t;
+                        visible = occluderBvh.empty() || occluderBvh.closestHit(ray, t, enter * 0.999f) == ~0u;
+                    }
+                }
+
+                if (visible)
+                {
+                    bits[object >> 3] |= static_cast<unsigned char>(1u << (object & 7));
+                }
+            }
+            compress(bits, compressed[cell]);
+        }
+    });
+
+    cellOffsets.assign(1, 0);
+    data.clear();
+    for (const std::vector<unsigned char>& set : compressed)
+    {
+        data.insert(data.end(), set.begin(), set.end());
+        cellOffsets.push_back(static_cast<std::uint32_t>(data.size()));
+    }
+
+    bakeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::uint32_t Pvs::signature(const Bounds& region, const std::vector<Bounds>& occluders, const std::vector<Bounds>& objectBounds,
+                             const PvsBakeSettings& settings)
+{
+    std::uint32_t h = 2166136261u;
+    hash(h, &VERSION, sizeof(VERSION));
+    hashBounds(h, std::vector<Bounds>{ region });
+    hashBounds(h, occluders);
+    hashBounds(h, objectBounds);
+    hash(h, &settings.cellSize, sizeof(settings.cellSize));
+    hash(h, &settings.samplesPerCell, sizeof(settings.samplesPerCell));
+    hash(h, &settings.raysPerObject, sizeof(settings.raysPerObject));
+    return h;
+}
+
+bool Pvs::load(const std::string& path, std::uint32_t expectedSignature, std::size_t expectedObjects)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+        return false;
+    }
+
+    char magic[4];
+    std::uint32_t version, inputSignature, objectCount, dataSize;
+    glm::vec3 loadedOrigin;
+    float loadedCellSize;
+    glm::ivec3 loadedCells;
+    if (!in.read(magic, 4) || std::memcmp(magic, MAGIC, 4) != 0 ||
+        !read(in, version) || version != VERSION ||
+        !read(in, inputSignature) || inputSignature != expectedSignature ||
+        !read(in, loadedOrigin) || !read(in, loadedCellSize) || !read(in, loadedCells) ||
+        !read(in, objectCount) || objectCount != expectedObjects || !read(in, dataSize))
+    {
+        return false;
+    }
+
+    // the grid has to be what the rest of the file holds sets for, before anything is allocated
+    // from it; cells are indexed with ints (see cellAt)
+    const std::streamoff headerEnd = in.tellg();
+    in.seekg(0, std::ios::end);
+    const std::uint64_t remaining = std::uint64_t(in.tellg() - headerEnd);
+    in.seekg(headerEnd);
+
+    const std::uint64_t maxCells = std::uint64_t(std::numeric_limits<int>::max());
+    bool validGrid = glm::all(glm::greaterThan(loadedCells, glm::ivec3(0))) &&
+                     std::isfinite(loadedCellSize) && loadedCellSize > 0.0f;
+    std::uint64_t cellTotal = 0;
+    if (validGrid)
+    {
+        // each factor is below 2^31, so no product overflows before it is checked
+        cellTotal = std::uint64_t(loadedCells.x) * std::uint64_t(loadedCells.y);
+        if (cellTotal <= maxCells)
+            cellTotal *= std::uint64_t(loadedCells.z);
+        validGrid = cellTotal <= maxCells;
+    }
+    if (!validGrid || (cellTotal + 1) * sizeof(std::uint32_t) + dataSize != remaining)
+    {
+        fprintf(stderr, "Corrupt PVS file %s\n", path.c_str());
+        return false;
+    }
+
+    std::vector<std::uint32_t> offsets;
+    std::vector<unsigned char> sets;
+    if (!readArray(in, offsets, std::size_t(cellTotal) + 1) || !readArray(in, sets, dataSize) || !validSets(offsets, sets))
+    {
+        fprintf(stderr, "Corrupt PVS file %s\n", path.c_str());
+        return false;
+    }
+
+    origin = loadedOrigin;
+    cellSize = loadedCellSize;
+    cells = loadedCells;
+    objects = objectCount;
+    cellOffsets.swap(offsets);
+    data.swap(sets);
+    currentCell = -1;
+    return true;
+}
+
+bool Pvs::save(const std::string& path, std::uint32_t inputSignature) const
+{
+    std::error_code error;
+    fs::create_directories(fs::path(path).parent_path(), error);
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        fprintf(stderr, "Could not write PVS file %s\n", path.c_str());
+        return false;
+    }
+
+    out.write(MAGIC, 4);
+    write(out, VERSION);
+    write(out, inputSignature);
+    write(out, origin);
+    write(out, cellSize);
+    write(out, cells);
+    write(out, static_cast<std::uint32_t>(objects));
+    write(out, static_cast<std::uint32_t>(data.size()));
+    out.write(reinterpret_cast<const char*>(cellOffsets.data()), cellOffsets.size() * sizeof(std::uint32_t));
+    if (!data.empty())
+        out.write(reinterpret_cast<const char*>(data.data()), data.size());
+    return bool(out);
+}
+
+int Pvs::cellAt(const glm::vec3& position) const
+{
+    if (empty())
+    {
+        return -1;
+    }
+
+    const glm::ivec3 coordinate(glm::floor((position - origin) / cellSize));
+    if (glm::any(glm::lessThan(coordinate, glm::ivec3(0))) || glm::any(glm::greaterThanEqual(coordinate, cells)))
+    {
+        return -1;
+    }
+    return (coordinate.z * cells.y + coordinate.y) * cells.x + coordinate.x;
+}
+
+void Pvs::setViewpoint(const glm::vec3& position)
+{
+    const int cell = cellAt(position);
+    if (cell != currentCell)
+    {
+        currentCell = cell;
+        if (cell >= 0)
+        {
+            decompressBits(cell, currentSet);
+        }
+    }
+}
+
+void Pvs::decompressBits(int cell, std::vector<unsigned char>& bits) const
+{
+    bits.assign((objects + 7) / 8, 0);
+
+    std::size_t out = 0;
+    for (std::uint32_t i = cellOffsets[cell]; i < cellOffsets[cell + 1] && out < bits.size(); ++i)
+    {
+        if (data[i] != 0)
+        {
+            bits[out++] = data[i];
+        }
+        else
+        {
+            // the zeros are there already
+            out += data[++i];
+        }
+    }
+}
+
+void Pvs::decompress(int cell, std::vector<unsigned char>& visible) const
+{
+    if (cell < 0 || empty())
+    {
+        visible.assign(objects, 1);
+        return;
+    }
+
+    std::vector<unsigned char> bits;
+    decompressBits(cell, bits);
+    visible.resize(objects);
+    for (std::size_t i = 0; i < objects; ++i)
+    {
+        visible[i] = (bits[i >> 3] >> (i & 7)) & 1;
+    }
+}
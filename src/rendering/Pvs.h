@@ -0,0 +1,104 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Bounds.h"
+
+// sampling density of Pvs::bake()
+struct PvsBakeSettings
+{
+    float cellSize = 2.0f;
+    int samplesPerCell = 16;    // at least the 8 corners and the center of the cell
+    int raysPerObject = 16;     // at least the 8 corners and the center of the box
+};
+
+// Potentially visible sets for static scenes: the space the camera moves in is divided into
+// cells, and for every cell the set of objects that can be seen from anywhere in it is baked
+// once. At runtime the set of the camera's cell rejects everything else with a bit lookup,
+// before any frustum test.
+//
+// Baking casts rays between sample points of each cell (its corners, center and random points)
+// and points on each object's box, against a BVH of the occluder boxes, in parallel over the
+// cells. It is sampled, so a tiny gap between occluders can be missed; occluders should be the
+// solid insides of things (e.g. the box a rotating cube never leaves) rather than their bounds.
+//
+// Every set is a bit per object, compressed by replacing runs of zero bytes with a zero and the
+// run length. Outside of the baked region everything counts as visible.
+//
+//   if (!pvs.load(path, signature, objects.size()))
+//   {
+//       pvs.bake(region, occluders, objects, settings);
+//       pvs.save(path, signature);
+//   }
+//   pvs.setViewpoint(camera->getCamPosition());
+//   if (pvs.isVisible(object)) ...
+class Pvs
+{
+public:
+    static constexpr std::uint32_t VERSION = 1;
+
+    // region: the space the camera moves in. occluders: boxes that block the view.
+    // objects: the boxes to bake the visibility of, in the index order used at runtime.
+    void bake(const Bounds& region, const std::vector<Bounds>& occluders, const std::vector<Bounds>& objects,
+              const PvsBakeSettings& settings = PvsBakeSettings());
+
+    // hash of the bake inputs, stored with the sets so that changed inputs invalidate the file
+    static std::uint32_t signature(const Bounds& region, const std::vector<Bounds>& occluders, const std::vector<Bounds>& objects,
+                                   const PvsBakeSettings& settings = PvsBakeSettings());
+
+    // returns false if the file is missing, corrupt, or was baked from other inputs.
+    // expectedObjects is the number of objects isVisible() will be asked about.
+    bool load(const std::string& path, std::uint32_t expectedSignature, std::size_t expectedObjects);
+    bool save(const std::string& path, std::uint32_t inputSignature) const;
+
+    // -1 outside of the baked region
+    int cellAt(const glm::vec3& position) const;
+
+    // decompresses the set of the cell the position is in, if it isn't the current one already
+    void setViewpoint(const glm::vec3& position);
+
+    // against the set of the current viewpoint
+    bool isVisible(std::size_t object) const
+    {
+        return currentCell < 0 || (currentSet[object >> 3] >> (object & 7)) & 1;
+    }
+
+    // one byte per object, for sets of other cells (e.g. to visualize them)
+    void decompress(int cell, std::vector<unsigned char>& visible) const;
+
+    bool empty() const { return cellOffsets.empty(); }
+    std::size_t cellCount() const { return cellOffsets.empty() ? 0 : cellOffsets.size() - 1; }
+    std::size_t objectCount() const { return objects; }
+    int getCurrentCell() const { return currentCell; }
+
+    // of all sets, compressed and as plain bits
+    std::size_t compressedSize() const { return data.size(); }
+    std::size_t uncompressedSize() const { return cellCount() * ((objects + 7) / 8); }
+
+    // of the last bake
+    double bakeMilliseconds() const { return bakeMs; }
+
+private:
+    glm::vec3 origin = glm::vec3(0.0f);
+    float cellSize = 1.0f;
+    glm::ivec3 cells = glm::ivec3(0);
+    std::size_t objects = 0;
+
+    std::vector<std::uint32_t> cellOffsets;     // into data, one more than there are cells
+    std::vector<unsigned char> data;
+
+    int currentCell = -1;
+    std::vector<unsigned char> currentSet;      // packed bits
+    double bakeMs = 0.0;
+
+    void decompressBits(int cell, std::vector<unsigned char>& bits) const;
+};
@@ -0,0 +1,156 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include "RangeAllocator.h"
+
+#include <algorithm>
+#include <iterator>
+
+RangeAllocator::RangeAllocator(std::size_t capacity)
+    : totalCapacity(0), usedSize(0)
+{
+    grow(capacity);
+}
+
+RangeAllocator::Handle RangeAllocator::allocate(std::size_t size)
+{
+    if (size == 0)
+    {
+        return InvalidHandle;
+    }
+
+    // first fit, lowest offset first keeps the buffer packed towards the front
+    for (auto it = freeBlocks.begin(); it != freeBlocks.end(); ++it)
+    {
+        if (it->second < size)
+        {
+            continue;
+        }
+
+        const std::size_t blockOffset = it->first;
+        const std::size_t remaining = it->second - size;
+        freeBlocks.erase(it);
+        if (remaining > 0)
+        {
+            freeBlocks[blockOffset + size] = remaining;
+        }
+
+        Handle handle;
+        if (!freeHandles.empty())
+        {
+            handle = freeHandles.back();
+            freeHandles.pop_back();
+        }
+        else
+        {
+            handle = static_cast<Handle>(ranges.size());
+            ranges.push_back({});
+        }
+
+        ranges[handle] = { blockOffset, size, true };
+        usedSize += size;
+        return handle;
+    }
+
+    return InvalidHandle;
+}
+
+void RangeAllocator::free(Handle handle)
+{
+    if (handle >= ranges.size() || !ranges[handle].live)
+    {
+        return;
+    }
+
+    Range& range = ranges[handle];
+    insertFreeBlock(range.offset, range.size);
+    usedSize -= range.size;
+
+    range.live = false;
+    freeHandles.push_back(handle);
+}
+
+void RangeAllocator::grow(std::size_t newCapacity)
+{
+    if (newCapacity <= totalCapacity)
+    {
+        return;
+    }
+
+    insertFreeBlock(totalCapacity, newCapacity - totalCapacity);
+    totalCapacity = newCapacity;
+}
+
+std::vector<RangeAllocator::Move> RangeAllocator::defragment()
+{
+    std::vector<Handle> live;
+    for (Handle h = 0; h < ranges.size(); ++h)
+    {
+        if (ranges[h].live)
+            live.push_back(h);
+    }
+    std::sort(live.begin(), live.end(), [this](Handle a, Handle b) { return ranges[a].offset < ranges[b].offset; });
+
+    std::vector<Move> moves;
+    std::size_t cursor = 0;
+    for (Handle h : live)
+    {
+        Range& range = ranges[h];
+        if (range.offset != cursor)
+        {
+            moves.push_back({ range.offset, cursor, range.size });
+            range.offset = cursor;
+        }
+        cursor += range.size;
+    }
+
+    freeBlocks.clear();
+    if (cursor < totalCapacity)
+    {
+        freeBlocks[cursor] = totalCapacity - cursor;
+    }
+
+    return moves;
+}
+
+std::size_t RangeAllocator::largestFreeBlock() const
+{
+    std::size_t largest = 0;
+    for (const auto& block : freeBlocks)
+    {
+        largest = std::max(largest, block.second);
+    }
+    return largest;
+}
+
+void RangeAllocator::insertFreeBlock(std::size_t blockOffset, std::size_t blockSize)
+{
+    if (blockSize == 0)
+    {
+        return;
+    }
+
+    auto next = freeBlocks.lower_bound(blockOffset);
+
+    // merge with the preceding block
+    if (next != freeBlocks.begin())
+    {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == blockOffset)
+        {
+            blockOffset = prev->first;
+            blockSize += prev->second;
+            freeBlocks.erase(prev);
+        }
+    }
+
+    // merge with the following block
+    if (next != freeBlocks.end() && blockOffset + blockSize == next->first)
+    {
+        blockSize += next->second;
+        freeBlocks.erase(next);
+    }
+
+    freeBlocks[blockOffset] = blockSize;
+}
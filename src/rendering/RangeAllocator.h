@@ -0,0 +1,65 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+// Hands out [offset, offset + size) ranges of a linear resource (e.g. a GL buffer) measured
+// in arbitrary units. Free space is kept as a coalesced, offset-ordered free list.
+//
+// Allocations are referred to by handles rather than offsets, so that defragment() can
+// compact the live ranges and callers just look the new offset up afterwards.
+class RangeAllocator
+{
+public:
+    using Handle = unsigned int;
+    static constexpr Handle InvalidHandle = ~0u;
+
+    struct Move
+    {
+        std::size_t srcOffset;
+        std::size_t dstOffset;
+        std::size_t size;
+    };
+
+    explicit RangeAllocator(std::size_t capacity = 0);
+
+    // returns InvalidHandle if no single free block is large enough
+    Handle allocate(std::size_t size);
+    void free(Handle handle);
+
+    std::size_t offset(Handle handle) const { return ranges[handle].offset; }
+    std::size_t size(Handle handle) const   { return ranges[handle].size; }
+
+    // makes the resource larger; the new space is appended to the free list
+    void grow(std::size_t newCapacity);
+
+    // packs all live ranges towards offset 0 (keeping their order) and returns the moves
+    // the owner has to replicate on the underlying storage
+    std::vector<Move> defragment();
+
+    std::size_t capacity() const { return totalCapacity; }
+    std::size_t used() const     { return usedSize; }
+    std::size_t largestFreeBlock() const;
+
+private:
+    struct Range
+    {
+        std::size_t offset;
+        std::size_t size;
+        bool live;
+    };
+
+    std::vector<Range> ranges;          // indexed by handle
+    std::vector<Handle> freeHandles;
+    std::map<std::size_t, std::size_t> freeBlocks; // offset -> size
+
+    std::size_t totalCapacity;
+    std::size_t usedSize;
+
+    void insertFreeBlock(std::size_t blockOffset, std::size_t blockSize);
+};
@@ -0,0 +1,91 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+struct Ray
+{
+    glm::vec3 origin = glm::vec3(0.0f);
+    glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f);    // not necessarily normalized
+
+    glm::vec3 at(float t) const { return origin + t * direction; }
+
+    // ray through a pixel, from the near to the far plane (t in [0, 1]).
+    // x, y in window coordinates (origin top left), viewProjection = projection * view
+    static Ray fromScreen(float x, float y, float width, float height, const glm::mat4& viewProjection)
+    {
+        const glm::mat4 inverse = glm::inverse(viewProjection);
+        const float ndcX = 2.0f * x / width - 1.0f;
+        const float ndcY = 1.0f - 2.0f * y / height;
+
+        glm::vec4 nearPoint = inverse * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+        glm::vec4 farPoint = inverse * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+        nearPoint /= nearPoint.w;
+        farPoint /= farPoint.w;
+
+        Ray ray;
+        ray.origin = glm::vec3(nearPoint);
+        ray.direction = glm::vec3(farPoint - nearPoint);
+        return ray;
+    }
+
+    // the same ray in another space; t values stay valid since the direction isn't normalized
+    Ray transformed(const glm::mat4& m) const
+    {
+        Ray ray;
+        ray.origin = glm::vec3(m * glm::vec4(origin, 1.0f));
+        ray.direction = glm::vec3(m * glm::vec4(direction, 0.0f));
+        return ray;
+    }
+};
+
+// slab test; invDirection = 1 / direction. Returns the entry t, or FLT_MAX on a miss.
+inline float intersectAabb(const Ray& ray, const glm::vec3& invDirection, const glm::vec3& min, const glm::vec3& max, float maxT)
+{
+    const glm::vec3 t0 = (min - ray.origin) * invDirection;
+    const glm::vec3 t1 = (max - ray.origin) * invDirection;
+    const glm::vec3 tNear = glm::min(t0, t1);
+    const glm::vec3 tFar = glm::max(t0, t1);
+
+    const float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+    const float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxT));
+    return enter <= exit ? enter : FLT_MAX;
+}
+
+// Moeller-Trumbore, double sided. Returns t, or FLT_MAX on a miss.
+inline float intersectTriangle(const Ray& ray, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+    const glm::vec3 ab = b - a;
+    const glm::vec3 ac = c - a;
+    const glm::vec3 p = glm::cross(ray.direction, ac);
+    const float det = glm::dot(ab, p);
+    if (std::fabs(det) < 1e-12f)
+    {
+        return FLT_MAX;
+    }
+
+    const float invDet = 1.0f / det;
+    const glm::vec3 s = ray.origin - a;
+    const float u = glm::dot(s, p) * invDet;
+    if (u < 0.0f || u > 1.0f)
+    {
+        return FLT_MAX;
+    }
+
+    const glm::vec3 q = glm::cross(s, ab);
+    const float v = glm::dot(ray.direction, q) * invDet;
+    if (v < 0.0f || u + v > 1.0f)
+    {
+        return FLT_MAX;
+    }
+
+    const float t = glm::dot(ac, q) * invDet;
+    return t >= 0.0f ? t : FLT_MAX;
+}
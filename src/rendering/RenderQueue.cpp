@@ -0,0 +1,136 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr std::uint64_t mask(unsigned int bits)
+    {
+        return (std::uint64_t(1) << bits) - 1;
+    }
+
+    const unsigned int TRANSLUCENT_SHIFT = 64 - SortKey::PASS_BITS - SortKey::LAYER_BITS - 1;
+    const unsigned int LAYER_SHIFT = TRANSLUCENT_SHIFT + 1;
+    const unsigned int PASS_SHIFT = LAYER_SHIFT + SortKey::LAYER_BITS;
+
+    static_assert(SortKey::PASS_BITS + SortKey::LAYER_BITS + 1 + SortKey::SHADER_BITS + SortKey::MATERIAL_BITS + SortKey::DEPTH_BITS == 64,
+                  "sort key fields have to fill 64 bits");
+
+    std::uint64_t quantizeDepth(float depth)
+    {
+        const float clamped = std::min(std::max(depth, 0.0f), 1.0f);
+        return static_cast<std::uint64_t>(clamped * float(mask(SortKey::DEPTH_BITS))) & mask(SortKey::DEPTH_BITS);
+    }
+}
+
+std::uint64_t SortKey::pack() const
+{
+    std::uint64_t key = (std::uint64_t(pass) & mask(PASS_BITS)) << PASS_SHIFT
+                      | (std::uint64_t(layer) & mask(LAYER_BITS)) << LAYER_SHIFT;
+
+    const std::uint64_t quantized = quantizeDepth(depth);
+    const std::uint64_t state = (std::uint64_t(shader) & mask(SHADER_BITS)) << MATERIAL_BITS
+                              | (std::uint64_t(material) & mask(MATERIAL_BITS));
+    if (translucent)
+    {
+        // farthest first
+        key |= std::uint64_t(1) << TRANSLUCENT_SHIFT;
+        key |= (mask(DEPTH_BITS) - quantized) << (SHADER_BITS + MATERIAL_BITS);
+        key |= state;
+    }
+    else
+    {
+        key |= state << DEPTH_BITS;
+        key |= quantized;
+    }
+    return key;
+}
+
+SortKey SortKey::unpack(std::uint64_t key)
+{
+    SortKey result;
+    result.pass = unsigned((key >> PASS_SHIFT) & mask(PASS_BITS));
+    result.layer = unsigned((key >> LAYER_SHIFT) & mask(LAYER_BITS));
+    result.translucent = ((key >> TRANSLUCENT_SHIFT) & 1) != 0;
+
+    std::uint64_t state, quantized;
+    if (result.translucent)
+    {
+        quantized = mask(DEPTH_BITS) - ((key >> (SHADER_BITS + MATERIAL_BITS)) & mask(DEPTH_BITS));
+        state = key & mask(SHADER_BITS + MATERIAL_BITS);
+    }
+    else
+    {
+        quantized = key & mask(DEPTH_BITS);
+        state = (key >> DEPTH_BITS) & mask(SHADER_BITS + MATERIAL_BITS);
+    }
+    result.shader = unsigned(state >> MATERIAL_BITS);
+    result.material = unsigned(state & mask(MATERIAL_BITS));
+    result.depth = float(quantized) / float(mask(DEPTH_BITS));
+    return result;
+}
+
+float RenderQueue::depth(float distance, float nearDistance, float farDistance)
+{
+    return (distance - nearDistance) / std::max(farDistance - nearDistance, 1e-6f);
+}
+
+void RenderQueue::sort()
+{
+    counters.radixPasses = 0;
+    const std::size_t count = entries.size();
+    if (count < 2)
+    {
+        return;
+    }
+
+    // all 8 histograms in one read of the keys
+    std::size_t histograms[8][256] = {};
+    for (const Entry& entry : entries)
+    {
+        for (unsigned int digit = 0; digit < 8; ++digit)
+        {
+            ++histograms[digit][(entry.key >> (8 * digit)) & 0xFF];
+        }
+    }
+
+    scratch.resize(count);
+    Entry* source = entries.data();
+    Entry* target = scratch.data();
+    for (unsigned int digit = 0; digit < 8; ++digit)
+    {
+        std::size_t* histogram = histograms[digit];
+
+        // a digit all keys share doesn't reorder anything; in practice most of the pass, layer
+        // and shader bits are
+        if (histogram[(source[0].key >> (8 * digit)) & 0xFF] == count)
+        {
+            continue;
+        }
+
+        std::size_t offset = 0;
+        for (unsigned int bucket = 0; bucket < 256; ++bucket)
+        {
+            const std::size_t bucketCount = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketCount;
+        }
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            target[histogram[(source[i].key >> (8 * digit)) & 0xFF]++] = source[i];
+        }
+        std::swap(source, target);
+        ++counters.radixPasses;
+    }
+
+    if (source != entries.data())
+    {
+        entries.swap(scratch);
+    }
+}
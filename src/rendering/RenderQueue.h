@@ -0,0 +1,130 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// What a draw is sorted by, packed into 64 bits so the whole frame sorts as plain integers.
+// Most significant first:
+//   opaque       pass:4 layer:4 0:1 shader:11 material:16 depth:28      front to back
+//   translucent  pass:4 layer:4 1:1 depth:28 shader:11 material:16      back to front
+// Opaque draws share state first and go front to back inside a state so early depth rejects
+// the most; translucent draws have to go back to front whatever state they need, so their
+// (inverted) depth comes before the state. Translucent draws sort after the opaque ones of
+// their pass and layer.
+struct SortKey
+{
+    static constexpr unsigned PASS_BITS = 4;
+    static constexpr unsigned LAYER_BITS = 4;
+    static constexpr unsigned SHADER_BITS = 11;
+    static constexpr unsigned MATERIAL_BITS = 16;
+    static constexpr unsigned DEPTH_BITS = 28;
+
+    unsigned int pass = 0;
+    unsigned int layer = 0;
+    bool translucent = false;
+    unsigned int shader = 0;
+    unsigned int material = 0;
+    float depth = 0.0f;         // in [0, 1], 0 closest to the camera; see RenderQueue::depth()
+
+    // fields wider than their bits are masked
+    std::uint64_t pack() const;
+
+    // depth comes back quantized
+    static SortKey unpack(std::uint64_t key);
+};
+
+// Collects the draws of a frame as (key, payload) pairs, sorts them by key with an LSD radix
+// sort and walks them in that order, so program and texture switches happen once per run of
+// equal state instead of whenever the code happened to change them. The payload is up to the
+// caller, typically an index into its own draw list.
+//
+//   queue.clear();
+//   queue.submit(key, drawIndex);
+//   queue.sort();
+//   queue.execute([&](const SortKey& key, std::uint32_t payload, unsigned int changes) {
+//       if (changes & RenderQueue::SHADER_CHANGED) ...
+//   });
+class RenderQueue
+{
+public:
+    struct Entry
+    {
+        std::uint64_t key;
+        std::uint32_t payload;
+    };
+
+    // passed to execute() callbacks: the fields that differ from the previous entry
+    enum Change : unsigned int
+    {
+        PASS_CHANGED = 1 << 0,
+        LAYER_CHANGED = 1 << 1,
+        SHADER_CHANGED = 1 << 2,
+        MATERIAL_CHANGED = 1 << 3,
+    };
+
+    struct Stats
+    {
+        std::size_t draws = 0;
+        std::size_t shaderChanges = 0;
+        std::size_t materialChanges = 0;
+        unsigned int radixPasses = 0;   // of the 8 digits, those not shared by all keys
+    };
+
+    void clear() { entries.clear(); }
+    void reserve(std::size_t count) { entries.reserve(count); }
+
+    void submit(const SortKey& key, std::uint32_t payload) { entries.push_back(Entry{ key.pack(), payload }); }
+    void submit(std::uint64_t key, std::uint32_t payload) { entries.push_back(Entry{ key, payload }); }
+
+    // stable, 8 bit digits; digits every key has in common are skipped
+    void sort();
+
+    // fn(const SortKey& key, std::uint32_t payload, unsigned int changes) for every entry in
+    // key order; the first entry reports every field as changed
+    template <typename Fn>
+    void execute(Fn&& fn)
+    {
+        counters.draws = entries.size();
+        counters.shaderChanges = 0;
+        counters.materialChanges = 0;
+
+        SortKey previous;
+        for (std::size_t i = 0; i < entries.size(); ++i)
+        {
+            const SortKey key = SortKey::unpack(entries[i].key);
+            unsigned int changes = PASS_CHANGED | LAYER_CHANGED | SHADER_CHANGED | MATERIAL_CHANGED;
+            if (i > 0)
+            {
+                changes = (key.pass != previous.pass ? PASS_CHANGED : 0u)
+                        | (key.layer != previous.layer || key.translucent != previous.translucent ? LAYER_CHANGED : 0u)
+                        | (key.shader != previous.shader ? SHADER_CHANGED : 0u)
+                        | (key.material != previous.material ? MATERIAL_CHANGED : 0u);
+            }
+            counters.shaderChanges += (changes & SHADER_CHANGED) ? 1 : 0;
+            counters.materialChanges += (changes & MATERIAL_CHANGED) ? 1 : 0;
+
+            fn(key, entries[i].payload, changes);
+            previous = key;
+        }
+    }
+
+    const std::vector<Entry>& getEntries() const { return entries; }
+    std::size_t size() const { return entries.size(); }
+    bool empty() const { return entries.empty(); }
+
+    // counters of the last sort() and execute()
+    const Stats& stats() const { return counters; }
+
+    // distance from the camera mapped to the [0, 1] depth of a SortKey, linear between near and far
+    static float depth(float distance, float nearDistance, float farDistance);
+
+private:
+    std::vector<Entry> entries;
+    std::vector<Entry> scratch;
+    Stats counters;
+};
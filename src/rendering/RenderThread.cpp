@@ -0,0 +1,39 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include "RenderThread.h"
+
+#include <GLFW/glfw3.h>
+
+#include <utility>
+
+void RenderThread::start(GLFWwindow* newWindow, FrameFunction frame)
+{
+    stop();
+
+    window = newWindow;
+    quit.store(false);
+    glfwMakeContextCurrent(nullptr);
+
+    thread = std::thread([this, frame = std::move(frame)]()
+    {
+        glfwMakeContextCurrent(window);
+        while (!quit.load() && frame())
+        {
+        }
+        glfwMakeContextCurrent(nullptr);
+    });
+}
+
+void RenderThread::stop()
+{
+    if (!thread.joinable())
+    {
+        return;
+    }
+
+    quit.store(true);
+    thread.join();
+    glfwMakeContextCurrent(window);
+}
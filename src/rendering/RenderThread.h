@@ -0,0 +1,44 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <thread>
+
+struct GLFWwindow;
+
+// A thread that owns the GL context of a window while it runs, and calls a frame function in
+// a loop until it returns false or stop() is called. Meant to draw the snapshots a
+// FrameHandoff passes it, while the main thread keeps polling events and simulating.
+//
+// The context can only be current on one thread: start() releases it from the calling thread,
+// stop() makes it current there again. In between only the render thread may touch GL,
+// GLState included.
+class RenderThread
+{
+public:
+    using FrameFunction = std::function<bool()>;
+
+    RenderThread() = default;
+    ~RenderThread() { stop(); }
+
+    RenderThread(const RenderThread&) = delete;
+    RenderThread& operator=(const RenderThread&) = delete;
+
+    // call from the thread the context of window is current on
+    void start(GLFWwindow* window, FrameFunction frame);
+
+    // asks the loop to end after the current frame and waits for it; a frame function blocked
+    // on a FrameHandoff has to be released by closing the handoff first
+    void stop();
+
+    bool running() const { return thread.joinable(); }
+
+private:
+    std::thread thread;
+    std::atomic<bool> quit{ false };
+    GLFWwindow* window = nullptr;
+};
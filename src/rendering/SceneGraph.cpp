@@ -0,0 +1,281 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include "SceneGraph.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "Parallel.h"
+
+namespace
+{
+    glm::mat4 compose(const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale)
+    {
+        glm::mat4 m = glm::mat4_cast(rotation);
+        m[0] *= scale.x;
+        m[1] *= scale.y;
+        m[2] *= scale.z;
+        m[3] = glm::vec4(translation, 1.0f);
+        return m;
+    }
+}
+
+SceneGraph::Node SceneGraph::add(Node parent, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale)
+{
+    assert(parent == InvalidNode || parent < slots.size());
+
+    const Node node = static_cast<Node>(slots.size());
+    const unsigned int parentSlot = parent == InvalidNode ? InvalidNode : slots[parent];
+
+    // appended at the end, sortByDepth() moves it to its level on the next update()
+    slots.push_back(static_cast<unsigned int>(nodes.size()));
+    nodes.push_back(node);
+    translations.push_back(translation);
+    rotations.push_back(rotation);
+    scales.push_back(scale);
+    world.emplace_back(1.0f);
+    parents.push_back(parentSlot);
+    depths.push_back(parentSlot == InvalidNode ? 0 : depths[parentSlot] + 1);
+    dirty.push_back(1);
+
+    topologyChanged = true;
+    return node;
+}
+
+SceneGraph::Node SceneGraph::add(Node parent, const glm::mat4& local)
+{
+    glm::vec3 scale(glm::length(glm::vec3(local[0])), glm::length(glm::vec3(local[1])), glm::length(glm::vec3(local[2])));
+    // a mirroring matrix keeps a proper rotation by flipping one axis
+    if (glm::determinant(glm::mat3(local)) < 0.0f)
+        scale.x = -scale.x;
+
+    // an axis scaled to (almost) nothing has no direction to divide out. With one such axis the
+    // other two still fix the rotation, with more it is left as the identity.
+    const float MIN_SCALE = 1e-6f;
+    int degenerate = -1, degenerateCount = 0;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        if (std::abs(scale[axis]) < MIN_SCALE)
+        {
+            degenerate = axis;
+            ++degenerateCount;
+        }
+    }
+
+    glm::mat3 rotation(1.0f);
+    if (degenerateCount == 0)
+    {
+        rotation = glm::mat3(glm::vec3(local[0]) / scale.x, glm::vec3(local[1]) / scale.y, glm::vec3(local[2]) / scale.z);
+    }
+    else if (degenerateCount == 1)
+    {
+        const int a = (degenerate + 1) % 3, b = (degenerate + 2) % 3;
+        rotation[a] = glm::vec3(local[a]) / scale[a];
+        rotation[b] = glm::vec3(local[b]) / scale[b];
+        rotation[degenerate] = glm::normalize(glm::cross(rotation[a], rotation[b]));
+    }
+    return add(parent, glm::vec3(local[3]), glm::normalize(glm::quat_cast(rotation)), scale);
+}
+
+void SceneGraph::clear()
+{
+    translations.clear();
+    rotations.clear();
+    scales.clear();
+    world.clear();
+    parents.clear();
+    depths.clear();
+    dirty.clear();
+    nodes.clear();
+    slots.clear();
+    levels.clear();
+    changed.clear();
+    recomputed = 0;
+    topologyChanged = false;
+}
+
+void SceneGraph::setTranslation(Node node, const glm::vec3& translation)
+{
+    const unsigned int slot = slots[node];
+    translations[slot] = translation;
+    dirty[slot] = 1;
+}
+
+void SceneGraph::setRotation(Node node, const glm::quat& rotation)
+{
+    const unsigned int slot = slots[node];
+    rotations[slot] = rotation;
+    dirty[slot] = 1;
+}
+
+void SceneGraph::setScale(Node node, const glm::vec3& scale)
+{
+    const unsigned int slot = slots[node];
+    scales[slot] = scale;
+    dirty[slot] = 1;
+}
+
+void SceneGraph::setLocal(Node node, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale)
+{
+    const unsigned int slot = slots[node];
+    translations[slot] = translation;
+    rotations[slot] = rotation;
+    scales[slot] = scale;
+    dirty[slot] = 1;
+}
+
+SceneGraph::Node SceneGraph::getParent(Node node) const
+{
+    const unsigned int parent = parents[slots[node]];
+    return parent == InvalidNode ? InvalidNode : nodes[parent];
+}
+
+void SceneGraph::update()
+{
+    if (topologyChanged)
+        sortByDepth();
+
+    // level by level: the flags of the level above are final before a level reads them
+    recomputed = 0;
+    for (std::size_t level = 0; level + 1 < levels.size(); ++level)
+    {
+        const std::size_t begin = levels[level];
+        const std::size_t end = levels[level + 1];
+
+        if (end - begin < 2 * PARALLEL_GRAIN)
+        {
+            recomputed += updateSlots(begin, end);
+            continue;
+        }
+
+        std::atomic<std::size_t> count(0);
+        parallelFor(end - begin, PARALLEL_GRAIN, [&](std::size_t first, std::size_t last) {
+            count += updateSlots(begin + first, begin + last);
+        });
+        recomputed += count;
+    }
+
+    if (topologyChanged)
+    {
+        changed.assign(1, Range{ 0, nodes.size() });
+        std::fill(dirty.begin(), dirty.end(), 0);
+        topologyChanged = false;
+    }
+    else
+    {
+        collectChangedRanges();
+    }
+}
+
+void SceneGraph::sortByDepth()
+{
+    levels.clear();
+    if (nodes.empty())
+        return;
+
+    const unsigned int maxDepth = *std::max_element(depths.begin(), depths.end());
+    levels.assign(maxDepth + 2, 0);
+
+    // counting sort, stable so nodes of a level keep the order they were added in
+    for (unsigned int depth : depths)
+        ++levels[depth + 1];
+    for (std::size_t level = 1; level < levels.size(); ++level)
+        levels[level] += levels[level - 1];
+
+    if (std::is_sorted(depths.begin(), depths.end()))
+        return;
+
+    std::vector<std::size_t> next(levels.begin(), levels.end() - 1);
+    std::vector<unsigned int> newSlot(nodes.size());
+    for (std::size_t slot = 0; slot < nodes.size(); ++slot)
+        newSlot[slot] = static_cast<unsigned int>(next[depths[slot]]++);
+
+    auto permute = [&](auto& values) {
+        std::remove_reference_t<decltype(values)> sorted(values.size());
+        for (std::size_t slot = 0; slot < values.size(); ++slot)
+            sorted[newSlot[slot]] = values[slot];
+        values.swap(sorted);
+    };
+    permute(translations);
+    permute(rotations);
+    permute(scales);
+    permute(world);
+    permute(depths);
+    permute(dirty);
+    permute(nodes);
+    permute(parents);
+
+    for (unsigned int& parent : parents)
+    {
+        if (parent != InvalidNode)
+            parent = newSlot[parent];
+    }
+    for (std::size_t slot = 0; slot < nodes.size(); ++slot)
+        slots[nodes[slot]] = static_cast<unsigned int>(slot);
+}
+
+std::size_t SceneGraph::updateSlots(std::size_t begin, std::size_t end)
+{
+    std::size_t count = 0;
+    for (std::size_t slot = begin; slot < end; ++slot)
+    {
+        const unsigned int parent = parents[slot];
+        if (parent == InvalidNode)
+        {
+            if (!dirty[slot])
+                continue;
+            world[slot] = compose(translations[slot], rotations[slot], scales[slot]);
+        }
+        else
+        {
+            // a moved parent moves the whole subtree, passed down through the flags
+            if (!dirty[slot] && !dirty[parent])
+                continue;
+            world[slot] = world[parent] * compose(translations[slot], rotations[slot], scales[slot]);
+            dirty[slot] = 1;
+        }
+        ++count;
+    }
+    return count;
+}
+
+void SceneGraph::collectChangedRanges()
+{
+    changed.clear();
+
+    const std::size_t count = dirty.size();
+    unsigned char* flags = dirty.data();
+    std::size_t slot = 0;
+    while (slot < count)
+    {
+        // skip clean slots eight at a time
+        while (slot + 8 <= count)
+        {
+            std::uint64_t word;
+            std::memcpy(&word, flags + slot, sizeof(word));
+            if (word != 0)
+                break;
+            slot += 8;
+        }
+        while (slot < count && !flags[slot])
+            ++slot;
+        if (slot == count)
+            break;
+
+        const std::size_t first = slot;
+        while (slot < count && flags[slot])
+            flags[slot++] = 0;
+
+        if (!changed.empty() && first - (changed.back().first + changed.back().count) < RANGE_MERGE_GAP)
+            changed.back().count = slot - changed.back().first;
+        else
+            changed.push_back(Range{ first, slot - first });
+    }
+}
@@ -0,0 +1,104 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstddef>
+#include <vector>
+
+// Transform hierarchy stored as structure of arrays, sorted by depth: all roots first, then
+// all their children, and so on. One front to back pass sees every parent before its
+// children, and the nodes of one level can be updated in parallel.
+//
+// Local transforms are translation / rotation / scale. Changing one marks the node dirty, and
+// update() recomputes the world matrices of the dirty nodes and their subtrees only. The slots
+// that changed are reported as ranges, so GPU copies can be updated incrementally.
+// Nodes are referenced by handles, which stay valid when adding nodes reorders the slots.
+//
+//   SceneGraph::Node arm = graph.add(body, glm::vec3(0.0f, 1.0f, 0.0f));
+//   graph.setRotation(arm, rotation);
+//   graph.update();
+//   for (const SceneGraph::Range& range : graph.changedRanges())
+//       upload(graph.worldMatrices() + range.first, range.count);
+class SceneGraph
+{
+public:
+    using Node = unsigned int;
+    static constexpr Node InvalidNode = ~0u;
+
+    struct Range
+    {
+        std::size_t first;      // slot
+        std::size_t count;
+    };
+
+    // changed ranges closer than this many slots are merged, trading a few redundant
+    // matrices for fewer buffer updates
+    static constexpr std::size_t RANGE_MERGE_GAP = 16;
+    // nodes per job when a level is updated in parallel
+    static constexpr std::size_t PARALLEL_GRAIN = 4096;
+
+    // parent has to exist already, InvalidNode adds a root
+    Node add(Node parent, const glm::vec3& translation = glm::vec3(0.0f),
+             const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f), const glm::vec3& scale = glm::vec3(1.0f));
+    // the matrix is split into translation / rotation / scale, shear is lost
+    Node add(Node parent, const glm::mat4& local);
+    void clear();
+
+    void setTranslation(Node node, const glm::vec3& translation);
+    void setRotation(Node node, const glm::quat& rotation);
+    void setScale(Node node, const glm::vec3& scale);
+    void setLocal(Node node, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale);
+
+    const glm::vec3& getTranslation(Node node) const { return translations[slots[node]]; }
+    const glm::quat& getRotation(Node node) const    { return rotations[slots[node]]; }
+    const glm::vec3& getScale(Node node) const       { return scales[slots[node]]; }
+    Node getParent(Node node) const;
+
+    // recomputes the world matrices below dirty nodes and collects the changed ranges
+    void update();
+
+    // as of the last update()
+    const glm::mat4& worldMatrix(Node node) const { return world[slots[node]]; }
+
+    // world matrices in slot order, see slotOf()
+    const glm::mat4* worldMatrices() const { return world.data(); }
+    std::size_t slotOf(Node node) const { return slots[node]; }
+    Node nodeAt(std::size_t slot) const { return nodes[slot]; }
+
+    // slot ranges whose world matrix changed in the last update(), in increasing order.
+    // After nodes were added it is everything, since the slots may have moved.
+    const std::vector<Range>& changedRanges() const { return changed; }
+    // world matrices recomputed by the last update()
+    std::size_t recomputedCount() const { return recomputed; }
+
+    std::size_t size() const { return nodes.size(); }
+    std::size_t levelCount() const { return levels.empty() ? 0 : levels.size() - 1; }
+
+private:
+    // indexed by slot
+    std::vector<glm::vec3> translations;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+    std::vector<glm::mat4> world;
+    std::vector<unsigned int> parents;      // slot of the parent, InvalidNode for roots
+    std::vector<unsigned int> depths;
+    std::vector<unsigned char> dirty;
+    std::vector<Node> nodes;                // handle of the node in the slot
+
+    std::vector<unsigned int> slots;        // indexed by handle
+    std::vector<std::size_t> levels;        // first slot of every depth, then size()
+    bool topologyChanged = false;
+
+    std::vector<Range> changed;
+    std::size_t recomputed = 0;
+
+    void sortByDepth();
+    // returns the number of recomputed matrices
+    std::size_t updateSlots(std::size_t begin, std::size_t end);
+    void collectChangedRanges();
+};
@@ -9,6 +9,8 @@
 #include <string>
 #include <helpers/RootDir.h>
 
+#include "GLState.h"
+
 Shader::Shader(const std::string & vertexShaderFilename,
                const std::string & fragmentShaderFilename,
                const std::string & geometryShaderFilename, 
@@ -39,6 +41,12 @@ Shader::Shader(const std::string & vertexShaderFilename,
         return;
     }
 
+    const GLenum shaderTypes[5] = { GL_VERTEX_SHADER,
+                                    GL_FRAGMENT_SHADER,
+                                    GL_GEOMETRY_SHADER,
+                                    GL_TESS_CONTROL_SHADER,
+                                    GL_TESS_EVALUATION_SHADER };
+
     for (int i = 0; i < sizeof(shaderCodes) / sizeof(std::string); ++i)
     {
         if (shaderCodes[i].empty())
@@ -46,77 +54,76 @@ Shader::Shader(const std::string & vertexShaderFilename,
             continue;
         }
 
-        GLuint shaderType = 0;
-        
-        if (i == 0)
-            shaderType = GL_VERTEX_SHADER;
-        else
-        if (i == 1)
-            shaderType = GL_FRAGMENT_SHADER;
-        else
-        if (i == 2)
-            shaderType = GL_GEOMETRY_SHADER;
-        else
-        if (i == 3)
-            shaderType = GL_TESS_CONTROL_SHADER;
-        else
-        if (i == 4)
-            shaderType = GL_TESS_EVALUATION_SHADER;
-
-        if (shaderType == 0)
-        {
-            fprintf(stderr, "Error! Wrong shader type.\n");
-            continue;
-        }
+        compileStage(shaderTypes[i], shaderCodes[i], filenames[i]);
+    }
 
-        GLuint shaderObject = glCreateShader(shaderType);
+    link();
+}
 
-        if (shaderObject == 0)
-        {
-            fprintf(stderr, "Error while creating %s.\n", filenames[i].c_str());
-            continue;
-        }
+Shader::Shader(const std::string & computeShaderFilename)
+               : program_id(0),
+                 isLinked(false)
+{
+    program_id = glCreateProgram();
 
-        const char *shaderCode[1] = { shaderCodes[i].c_str() };
+    if (program_id == 0)
+    {
+        fprintf(stderr, "Error while creating program object.\n");
+        return;
+    }
 
-        glShaderSource (shaderObject, 1, shaderCode, nullptr);
-        glCompileShader(shaderObject);
+    compileStage(GL_COMPUTE_SHADER, loadFile(computeShaderFilename), computeShaderFilename);
+    link();
+}
 
-        GLint result;
-        glGetShaderiv(shaderObject, GL_COMPILE_STATUS, &result);
+void Shader::compileStage(GLenum shaderType, const std::string & code, const std::string & filename)
+{
+    GLuint shaderObject = glCreateShader(shaderType);
 
-        if (result == GL_FALSE)
-        {
-            fprintf(stderr, "%s compilation failed!\n", filenames[i].c_str());
+    if (shaderObject == 0)
+    {
+        fprintf(stderr, "Error while creating %s.\n", filename.c_str());
+        return;
+    }
+
+    const char *shaderCode[1] = { code.c_str() };
 
-            GLint logLen;
-            glGetShaderiv(shaderObject, GL_INFO_LOG_LENGTH, &logLen);
+    glShaderSource (shaderObject, 1, shaderCode, nullptr);
+    glCompileShader(shaderObject);
 
-            if (logLen > 0)
-            {
-                char * log = (char *)malloc(logLen);
+    GLint result;
+    glGetShaderiv(shaderObject, GL_COMPILE_STATUS, &result);
 
-                GLsizei written;
-                glGetShaderInfoLog(shaderObject, logLen, &written, log);
+    if (result == GL_FALSE)
+    {
+        fprintf(stderr, "%s compilation failed!\n", filename.c_str());
 
-                fprintf(stderr, "Shader log: \n%s", log);
-                free(log);
-            }
+        GLint logLen;
+        glGetShaderiv(shaderObject, GL_INFO_LOG_LENGTH, &logLen);
 
-            continue;
+        if (logLen > 0)
+        {
+            char * log = (char *)malloc(logLen);
+
+            GLsizei written;
+            glGetShaderInfoLog(shaderObject, logLen, &written, log);
+
+            fprintf(stderr, "Shader log: \n%s", log);
+            free(log);
         }
 
-        glAttachShader(program_id, shaderObject);
-        glDeleteShader(shaderObject);
+        return;
     }
 
-    link();
+    glAttachShader(program_id, shaderObject);
+    glDeleteShader(shaderObject);
 }
 
 Shader::~Shader()
 {
     if (program_id != 0)
     {
+        GLState::get().forgetProgram(program_id);
         glDeleteProgram(program_id);
         program_id = 0;
     }
@@ -158,7 +165,7 @@ void Shader::apply()
 {
     if (program_id != 0 && isLinked)
     {
-        glUseProgram(program_id);
+        GLState::get().useProgram(program_id);
     }
 }
 
@@ -312,6 +319,18 @@ void Shader::setUniform4fv(const std::string & uniformName, const glm::vec4 & ve
     }
 }
 
+void Shader::setUniform4fv(const std::string & uniformName, GLsizei count, const glm::vec4 * vectors)
+{
+    if (uniformsLocations.count(uniformName))
+    {
+        glProgramUniform4fv(program_id, uniformsLocations[uniformName], count, glm::value_ptr(vectors[0]));
+    }
+    else if (getUniformLocation(uniformName))
+    {
+        glProgramUniform4fv(program_id, uniformsLocations[uniformName], count, glm::value_ptr(vectors[0]));
+    }
+}
+
 void Shader::setUniformMatrix3fv(const std::string & uniformName, const glm::mat3 & matrix)
 {
     if (uniformsLocations.count(uniformName))
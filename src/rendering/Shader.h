@@ -19,6 +19,9 @@ public:
            const std::string & tessellationControlShaderFilename    = "",
            const std::string & tessellationEvaluationShaderFilename = "");
 
+    // compute program, run with apply() and glDispatchCompute
+    explicit Shader(const std::string & computeShaderFilename);
+
     virtual ~Shader();
 
     void setUniform1f       (const std::string & uniformName, float value);
@@ -29,6 +32,7 @@ public:
     void setUniform2fv      (const std::string & uniformName, const glm::vec2 & vector);
     void setUniform3fv      (const std::string & uniformName, const glm::vec3 & vector);
     void setUniform4fv      (const std::string & uniformName, const glm::vec4 & vector);
+    void setUniform4fv      (const std::string & uniformName, GLsizei count, const glm::vec4 * vectors);
     void setUniformMatrix3fv(const std::string & uniformName, const glm::mat3 & matrix);
     void setUniformMatrix4fv(const std::string & uniformName, const glm::mat4 & matrix);
     
@@ -40,6 +44,7 @@ private:
     GLuint program_id;
     bool isLinked;
 
+    void compileStage(GLenum shaderType, const std::string & code, const std::string & filename);
     bool link();
     bool getUniformLocation(const std::string & uniform_name);
     std::string loadFile(const std::string & filename);
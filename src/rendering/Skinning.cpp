@@ -0,0 +1,361 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include "Skinning.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+#include "GLState.h"
+#include "Parallel.h"
+#include "Shader.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SKINNING_AVX 1
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define SKINNING_SSE 1
+#endif
+
+namespace
+{
+    const GLuint GROUP_SIZE = 64;               // local size of skinning.comp
+    const std::size_t VERTICES_PER_JOB = 4096;  // CpuSkinner splits large meshes into jobs of this many
+
+    // std430 layout of SourceVertex in skinning.comp
+    struct GpuSourceVertex
+    {
+        glm::vec4 position;
+        glm::vec4 normal;
+        glm::vec4 weights;
+        glm::vec2 texCoords;
+        std::uint32_t bones;    // 4 x 8 bit, x in the lowest byte
+        std::uint32_t padding;
+    };
+
+    static_assert(sizeof(SkinnedVertex) == 8 * sizeof(float), "CpuSkinner writes 8 floats per vertex");
+}
+
+SkinnedCharacter SkinnedCharacter::procedural(int bones, int ringsPerBone, int sides)
+{
+    const float boneLength = 2.0f / bones;
+    const float radius = 0.2f;
+
+    SkinnedCharacter character;
+    Skeleton& skeleton = character.skeleton;
+    for (int j = 0; j < bones; ++j)
+    {
+        Skeleton::Joint joint;
+        joint.name = "bone" + std::to_string(j);
+        joint.parent = j - 1;
+        joint.bindPose.translation = glm::vec3(0.0f, j == 0 ? 0.0f : boneLength, 0.0f);
+        skeleton.joints.push_back(joint);
+        skeleton.addBone(j, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -j * boneLength, 0.0f)));
+    }
+
+    // rings of vertices up the tube, each blended between the two bones it lies between
+    SkinSource& source = character.source;
+    const int rings = bones * ringsPerBone + 1;
+    for (int r = 0; r < rings; ++r)
+    {
+        const float along = float(r) / ringsPerBone;
+        const int bone = std::min(int(along), bones - 1);
+        const float blend = std::min(along - bone, 1.0f);
+        const int next = std::min(bone + 1, bones - 1);
+
+        for (int s = 0; s <= sides; ++s)
+        {
+            const float angle = 2.0f * glm::pi<float>() * s / sides;
+            const glm::vec3 normal(std::cos(angle), 0.0f, std::sin(angle));
+            source.positions.push_back(glm::vec4(normal * radius + glm::vec3(0.0f, along * boneLength, 0.0f), 1.0f));
+            source.normals.push_back(glm::vec4(normal, 0.0f));
+            source.texCoords.push_back(glm::vec2(float(s) / sides, along / bones));
+            source.boneIndices.push_back(glm::u8vec4(bone, next, 0, 0));
+            source.boneWeights.push_back(glm::vec4(1.0f - blend, blend, 0.0f, 0.0f));
+        }
+    }
+    for (int r = 0; r + 1 < rings; ++r)
+    {
+        for (int s = 0; s < sides; ++s)
+        {
+            const unsigned int a = r * (sides + 1) + s;
+            const unsigned int b = a + sides + 1;
+            const unsigned int quad[6] = { a, b, a + 1, a + 1, b, b + 1 };
+            source.indices.insert(source.indices.end(), quad, quad + 6);
+        }
+    }
+
+    // keys at 30 Hz; the root twists, every other bone sways with a phase along the chain
+    AnimationClip clip;
+    clip.name = "sway";
+    clip.duration = 2.0f;
+    const int keys = 61;
+    for (int j = 0; j < bones; ++j)
+    {
+        AnimationChannel channel;
+        channel.joint = j;
+        for (int k = 0; k < keys; ++k)
+        {
+            const float time = clip.duration * k / (keys - 1);
+            const float phase = glm::pi<float>() * time;
+            glm::quat rotation;
+            if (j == 0)
+                rotation = glm::angleAxis(0.5f * std::sin(phase), glm::vec3(0.0f, 1.0f, 0.0f));
+            else
+                rotation = glm::angleAxis(0.12f * std::sin(phase + 0.4f * j), glm::vec3(0.0f, 0.0f, 1.0f)) *
+                           glm::angleAxis(0.08f * std::cos(phase + 0.3f * j), glm::vec3(1.0f, 0.0f, 0.0f));
+            channel.rotationTimes.push_back(time);
+            channel.rotations.push_back(rotation);
+        }
+        clip.channels.push_back(std::move(channel));
+    }
+    character.clips.push_back(std::move(clip));
+
+    return character;
+}
+
+SkinnedBuffer::~SkinnedBuffer()
+{
+    if (VAO != 0)
+    {
+        GLState::get().forgetVertexArray(VAO);
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+    }
+}
+
+void SkinnedBuffer::resize(const SkinSource& source, std::size_t instanceCount)
+{
+    if (currentSource == &source && instances == instanceCount && vertices == source.vertexCount() && indexCount == source.indices.size())
+    {
+        return;
+    }
+
+    if (VAO == 0)
+    {
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+    }
+
+    currentSource = &source;
+    instances = instanceCount;
+    vertices = source.vertexCount();
+    indexCount = source.indices.size();
+
+    GLState::get().bindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, instances * vertices * sizeof(SkinnedVertex), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), source.indices.data(), GL_STATIC_DRAW);
+    DefaultLayout::setup();
+    GLState::get().bindVertexArray(0);
+
+    // every instance draws the same indices, offset by its first vertex
+    counts.assign(instances, static_cast<GLsizei>(indexCount));
+    offsets.assign(instances, nullptr);
+    baseVertices.resize(instances);
+    for (std::size_t i = 0; i < instances; ++i)
+    {
+        baseVertices[i] = static_cast<GLint>(i * vertices);
+    }
+}
+
+void SkinnedBuffer::upload(const SkinnedVertex* skinned)
+{
+    const GLsizeiptr bytes = instances * vertices * sizeof(SkinnedVertex);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    // orphaned, so the upload doesn't wait for last frame's draws
+    glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, skinned);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void SkinnedBuffer::draw() const
+{
+    if (instances == 0 || indexCount == 0)
+    {
+        return;
+    }
+
+    GLState::get().bindVertexArray(VAO);
+    glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), GL_UNSIGNED_INT, offsets.data(),
+                                  static_cast<GLsizei>(instances), baseVertices.data());
+}
+
+void CpuSkinner::skin(const SkinSource& source, const glm::mat4* skinMatrices, std::size_t boneCount,
+                      std::size_t instanceCount, SkinnedVertex* out)
+{
+    const std::size_t vertexCount = source.vertexCount();
+    const std::size_t jobsPerInstance = (vertexCount + VERTICES_PER_JOB - 1) / VERTICES_PER_JOB;
+
+    parallelFor(instanceCount * jobsPerInstance, 1, [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t job = begin; job < end; ++job)
+        {
+            const std::size_t instance = job / jobsPerInstance;
+            const std::size_t first = (job % jobsPerInstance) * VERTICES_PER_JOB;
+            const std::size_t last = std::min(first + VERTICES_PER_JOB, vertexCount);
+            skinRange(source, skinMatrices + instance * boneCount, first, last, out + instance * vertexCount);
+        }
+    });
+}
+
+void CpuSkinner::skinRange(const SkinSource& source, const glm::mat4* skinMatrices, std::size_t begin, std::size_t end,
+                           SkinnedVertex* out)
+{
+    for (std::size_t v = begin; v < end; ++v)
+    {
+        const glm::u8vec4 bones = source.boneIndices[v];
+        const glm::vec4 weights = source.boneWeights[v];
+        float* o = &out[v].Position.x;
+
+#if defined(SKINNING_AVX) || defined(SKINNING_SSE)
+        const float* m0 = glm::value_ptr(skinMatrices[bones.x]);
+        const float* m1 = glm::value_ptr(skinMatrices[bones.y]);
+        const float* m2 = glm::value_ptr(skinMatrices[bones.z]);
+        const float* m3 = glm::value_ptr(skinMatrices[bones.w]);
+#if defined(SKINNING_AVX)
+        // columns 0-1 and 2-3 of the four matrices, blended two columns per instruction
+        const __m256 w0 = _mm256_set1_ps(weights.x);
+        const __m256 w1 = _mm256_set1_ps(weights.y);
+        const __m256 w2 = _mm256_set1_ps(weights.z);
+        const __m256 w3 = _mm256_set1_ps(weights.w);
+        const __m256 c01 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(w0, _mm256_loadu_ps(m0)), _mm256_mul_ps(w1, _mm256_loadu_ps(m1))),
+                                         _mm256_add_ps(_mm256_mul_ps(w2, _mm256_loadu_ps(m2)), _mm256_mul_ps(w3, _mm256_loadu_ps(m3))));
+        const __m256 c23 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(w0, _mm256_loadu_ps(m0 + 8)), _mm256_mul_ps(w1, _mm256_loadu_ps(m1 + 8))),
+                                         _mm256_add_ps(_mm256_mul_ps(w2, _mm256_loadu_ps(m2 + 8)), _mm256_mul_ps(w3, _mm256_loadu_ps(m3 + 8))));
+        const __m128 c0 = _mm256_castps256_ps128(c01);
+        const __m128 c1 = _mm256_extractf128_ps(c01, 1);
+        const __m128 c2 = _mm256_castps256_ps128(c23);
+        const __m128 c3 = _mm256_extractf128_ps(c23, 1);
+#else
+        const __m128 w0 = _mm_set1_ps(weights.x);
+        const __m128 w1 = _mm_set1_ps(weights.y);
+        const __m128 w2 = _mm_set1_ps(weights.z);
+        const __m128 w3 = _mm_set1_ps(weights.w);
+        auto blendColumn = [&](int column)
+        {
+            return _mm_add_ps(_mm_add_ps(_mm_mul_ps(w0, _mm_loadu_ps(m0 + column * 4)), _mm_mul_ps(w1, _mm_loadu_ps(m1 + column * 4))),
+                              _mm_add_ps(_mm_mul_ps(w2, _mm_loadu_ps(m2 + column * 4)), _mm_mul_ps(w3, _mm_loadu_ps(m3 + column * 4))));
+        };
+        const __m128 c0 = blendColumn(0);
+        const __m128 c1 = blendColumn(1);
+        const __m128 c2 = blendColumn(2);
+        const __m128 c3 = blendColumn(3);
+#endif
+        const __m128 p = _mm_loadu_ps(&source.positions[v].x);
+        const __m128 n = _mm_loadu_ps(&source.normals[v].x);
+
+        const __m128 position = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_shuffle_ps(p, p, 0x00)), _mm_mul_ps(c1, _mm_shuffle_ps(p, p, 0x55))),
+                                           _mm_add_ps(_mm_mul_ps(c2, _mm_shuffle_ps(p, p, 0xAA)), c3));
+        __m128 normal = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_shuffle_ps(n, n, 0x00)), _mm_mul_ps(c1, _mm_shuffle_ps(n, n, 0x55))),
+                                   _mm_mul_ps(c2, _mm_shuffle_ps(n, n, 0xAA)));
+
+        // w of the normal is 0, so the dot product can sum all 4 lanes
+        __m128 length = _mm_mul_ps(normal, normal);
+        length = _mm_add_ps(length, _mm_shuffle_ps(length, length, 0x4E));
+        length = _mm_add_ps(length, _mm_shuffle_ps(length, length, 0xB1));
+        normal = _mm_div_ps(normal, _mm_sqrt_ps(_mm_max_ps(length, _mm_set1_ps(1e-20f))));
+
+        // overlapping stores: the w lanes land on the next attribute and are overwritten after
+        _mm_storeu_ps(o, position);
+        _mm_storeu_ps(o + 3, normal);
+#else
+        const glm::mat4 m = weights.x * skinMatrices[bones.x] + weights.y * skinMatrices[bones.y] +
+                            weights.z * skinMatrices[bones.z] + weights.w * skinMatrices[bones.w];
+        const glm::vec3 position = glm::vec3(m * source.positions[v]);
+        const glm::vec3 normal = glm::normalize(glm::vec3(m * source.normals[v]));
+        std::memcpy(o, &position, sizeof(position));
+        std::memcpy(o + 3, &normal, sizeof(normal));
+#endif
+        o[6] = source.texCoords[v].x;
+        o[7] = source.texCoords[v].y;
+    }
+}
+
+const char* CpuSkinner::simdName()
+{
+#if defined(SKINNING_AVX)
+    return "AVX";
+#elif defined(SKINNING_SSE)
+    return "SSE";
+#else
+    return "scalar";
+#endif
+}
+
+GpuSkinner::~GpuSkinner()
+{
+    if (sourceBuffer != 0)
+    {
+        glDeleteBuffers(1, &sourceBuffer);
+        glDeleteBuffers(1, &matrixBuffer);
+    }
+    delete skinShader;
+}
+
+void GpuSkinner::setSource(const SkinSource& source)
+{
+    if (sourceBuffer == 0)
+    {
+        glGenBuffers(1, &sourceBuffer);
+        glGenBuffers(1, &matrixBuffer);
+    }
+
+    vertexCount = source.vertexCount();
+    std::vector<GpuSourceVertex> packed(vertexCount);
+    for (std::size_t i = 0; i < vertexCount; ++i)
+    {
+        packed[i].position = source.positions[i];
+        packed[i].normal = source.normals[i];
+        packed[i].weights = source.boneWeights[i];
+        packed[i].texCoords = source.texCoords[i];
+        std::memcpy(&packed[i].bones, &source.boneIndices[i], sizeof(packed[i].bones));
+        packed[i].padding = 0;
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, sourceBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, packed.size() * sizeof(GpuSourceVertex), packed.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void GpuSkinner::skin(const glm::mat4* skinMatrices, std::size_t boneCount, std::size_t instanceCount, SkinnedBuffer& output)
+{
+    if (sourceBuffer == 0 || vertexCount == 0 || instanceCount == 0)
+    {
+        return;
+    }
+    if (skinShader == nullptr)
+    {
+        skinShader = new Shader("skinning.comp");
+    }
+
+    // orphaned every frame, like SkinnedBuffer::upload()
+    const std::size_t matrixCount = boneCount * instanceCount;
+    matrixCapacity = std::max(matrixCapacity, matrixCount);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, matrixBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, matrixCapacity * sizeof(glm::mat4), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, matrixCount * sizeof(glm::mat4), skinMatrices);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    skinShader->setUniform1ui("vertexCount", static_cast<unsigned int>(vertexCount));
+    skinShader->setUniform1ui("boneCount", static_cast<unsigned int>(boneCount));
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SOURCE_BINDING, sourceBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATRIX_BINDING, matrixBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OUTPUT_BINDING, output.vertexBuffer());
+
+    skinShader->apply();
+    glDispatchCompute((static_cast<GLuint>(vertexCount) + GROUP_SIZE - 1) / GROUP_SIZE, static_cast<GLuint>(instanceCount), 1);
+    // the output is read as vertex attributes next
+    glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+}
@@ -0,0 +1,164 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Animation.h"
+#include "VertexLayout.h"
+
+class Shader;
+
+// The bind pose of a skinned model as the skinners read it: level 0 of all its meshes,
+// merged into one vertex and index list
+struct SkinSource
+{
+    std::vector<glm::vec4> positions;       // w = 1
+    std::vector<glm::vec4> normals;         // w = 0
+    std::vector<glm::vec2> texCoords;
+    std::vector<glm::u8vec4> boneIndices;
+    std::vector<glm::vec4> boneWeights;
+    std::vector<unsigned int> indices;
+
+    std::size_t vertexCount() const { return positions.size(); }
+
+    // vertices of a layout with position, normal, uvs and the bone attributes
+    template <typename Vertex>
+    void append(const std::vector<Vertex>& vertices, const unsigned int* meshIndices, std::size_t indexCount)
+    {
+        const unsigned int base = static_cast<unsigned int>(positions.size());
+        for (const Vertex& vertex : vertices)
+        {
+            positions.push_back(glm::vec4(vertex.Position, 1.0f));
+            normals.push_back(glm::vec4(vertex.Normal, 0.0f));
+            texCoords.push_back(vertex.TexCoords);
+            boneIndices.push_back(vertex.BoneIndices);
+            boneWeights.push_back(vertex.BoneWeights);
+        }
+        for (std::size_t i = 0; i < indexCount; ++i)
+            indices.push_back(base + meshIndices[i]);
+    }
+};
+
+// What it takes to animate a skinned model: its skeleton, its clips and its bind pose
+struct SkinnedCharacter
+{
+    Skeleton skeleton;
+    std::vector<AnimationClip> clips;
+    SkinSource source;
+
+    // from a BasicModel of a skinned layout, e.g. BasicModel<SkinnedLayout>
+    template <typename ModelType>
+    static SkinnedCharacter fromModel(const ModelType& model)
+    {
+        SkinnedCharacter character;
+        character.skeleton = model.skeleton;
+        character.clips = model.animations;
+        for (const auto& mesh : model.meshes)
+        {
+            const auto level = mesh.lod(0);
+            character.source.append(mesh.vertices, mesh.indices.data() + level.firstIndex, level.indexCount);
+        }
+        return character;
+    }
+
+    // an open tube along +y around a chain of bones, swaying and twisting in a 2 second loop:
+    // for benchmarks, and scenes without an animated asset at hand
+    static SkinnedCharacter procedural(int bones = 24, int ringsPerBone = 4, int sides = 16);
+};
+
+// the skinned vertices, in world space
+using SkinnedVertex = DefaultLayout::Vertex;
+
+// The skinned vertices of many instances of one SkinSource in one vertex buffer, instance
+// after instance, drawn with a single glMultiDrawElementsBaseVertex. Both skinners write
+// into it; as the vertices are in world space, the shader only needs the view and projection.
+class SkinnedBuffer
+{
+public:
+    SkinnedBuffer() = default;
+    SkinnedBuffer(const SkinnedBuffer&) = delete;
+    SkinnedBuffer& operator=(const SkinnedBuffer&) = delete;
+    ~SkinnedBuffer();
+
+    // (re)creates the buffers if the source or the instance count changed
+    void resize(const SkinSource& source, std::size_t instanceCount);
+
+    // for CpuSkinner, instanceCount() * vertexCount() vertices
+    void upload(const SkinnedVertex* vertices);
+
+    void draw() const;
+
+    std::size_t instanceCount() const { return instances; }
+    std::size_t vertexCount() const { return vertices; }
+    GLuint vertexBuffer() const { return VBO; }
+
+private:
+    GLuint VAO = 0, VBO = 0, EBO = 0;
+    std::size_t instances = 0;
+    std::size_t vertices = 0;
+    std::size_t indexCount = 0;
+    const SkinSource* currentSource = nullptr;
+
+    std::vector<GLsizei> counts;
+    std::vector<const void*> offsets;
+    std::vector<GLint> baseVertices;
+};
+
+// Skins on the CPU, in parallel over the instances (see Parallel.h). Each vertex blends its
+// 4 bone matrices with SSE, two columns at a time with AVX (ENABLE_AVX), and transforms its
+// position and normal by the blend. Normals go through the blended matrix, not its inverse
+// transpose, which is exact for rotations and uniform scales.
+class CpuSkinner
+{
+public:
+    // skinMatrices: boneCount per instance, instance after instance (Skeleton::computeSkinMatrices)
+    // out: source.vertexCount() per instance
+    static void skin(const SkinSource& source, const glm::mat4* skinMatrices, std::size_t boneCount,
+                     std::size_t instanceCount, SkinnedVertex* out);
+
+    // vertices [begin, end) of one instance, on the calling thread
+    static void skinRange(const SkinSource& source, const glm::mat4* skinMatrices, std::size_t begin, std::size_t end,
+                          SkinnedVertex* out);
+
+    // which instruction set skinRange() was compiled for
+    static const char* simdName();
+};
+
+// Skins on the GPU (skinning.comp): one invocation per vertex and instance reads the bind
+// pose from a shader storage buffer and writes straight into the vertex buffer of a
+// SkinnedBuffer, so nothing but the skin matrices crosses the bus every frame.
+class GpuSkinner
+{
+public:
+    // shader storage bindings, after those of GpuCuller.h
+    static constexpr GLuint SOURCE_BINDING = 7;
+    static constexpr GLuint MATRIX_BINDING = 8;
+    static constexpr GLuint OUTPUT_BINDING = 9;
+
+    GpuSkinner() = default;
+    GpuSkinner(const GpuSkinner&) = delete;
+    GpuSkinner& operator=(const GpuSkinner&) = delete;
+    ~GpuSkinner();
+
+    // uploads the bind pose
+    void setSource(const SkinSource& source);
+
+    // output must have been resized for the source and at least instanceCount instances
+    void skin(const glm::mat4* skinMatrices, std::size_t boneCount, std::size_t instanceCount, SkinnedBuffer& output);
+
+private:
+    Shader* skinShader = nullptr;
+    GLuint sourceBuffer = 0;
+    GLuint matrixBuffer = 0;
+    std::size_t matrixCapacity = 0;
+    std::size_t vertexCount = 0;
+};
@@ -0,0 +1,213 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include "SpatialGrid.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+SpatialGrid::SpatialGrid(float cellSize, unsigned int bucketCount)
+    : cellSize(cellSize), invCellSize(1.0f / cellSize)
+{
+    // round up to a power of two for masking
+    unsigned int count = 1;
+    while (count < bucketCount)
+        count <<= 1;
+
+    bucketMask = count - 1;
+    buckets.resize(count);
+}
+
+glm::ivec3 SpatialGrid::cellOf(const glm::vec3& p) const
+{
+    return glm::ivec3(glm::floor(p * invCellSize));
+}
+
+unsigned int SpatialGrid::bucketOf(const glm::ivec3& cell) const
+{
+    const std::uint32_t h = (std::uint32_t(cell.x) * 73856093u) ^ (std::uint32_t(cell.y) * 19349663u) ^ (std::uint32_t(cell.z) * 83492791u);
+    return h & bucketMask;
+}
+
+SpatialGrid::Handle SpatialGrid::insert(const Bounds& bounds, unsigned int value)
+{
+    Handle handle;
+    if (!freeHandles.empty())
+    {
+        handle = freeHandles.back();
+        freeHandles.pop_back();
+    }
+    else
+    {
+        handle = static_cast<Handle>(entries.size());
+        entries.emplace_back();
+    }
+
+    Entry& entry = entries[handle];
+    entry.min = bounds.min;
+    entry.max = bounds.max;
+    entry.value = value;
+    entry.live = true;
+    maxHalfSize = glm::max(maxHalfSize, 0.5f * (bounds.max - bounds.min));
+
+    link(handle);
+    ++liveCount;
+    return handle;
+}
+
+void SpatialGrid::move(Handle handle, const Bounds& bounds)
+{
+    Entry& entry = entries[handle];
+    assert(entry.live);
+
+    entry.min = bounds.min;
+    entry.max = bounds.max;
+    maxHalfSize = glm::max(maxHalfSize, 0.5f * (bounds.max - bounds.min));
+
+    if (cellOf(0.5f * (bounds.min + bounds.max)) != entry.cell)
+    {
+        unlink(handle);
+        link(handle);
+    }
+}
+
+void SpatialGrid::remove(Handle handle)
+{
+    Entry& entry = entries[handle];
+    if (!entry.live)
+    {
+        return;
+    }
+
+    unlink(handle);
+    entry.live = false;
+    freeHandles.push_back(handle);
+    --liveCount;
+}
+
+void SpatialGrid::clear()
+{
+    for (std::vector<Handle>& bucket : buckets)
+        bucket.clear();
+    entries.clear();
+    freeHandles.clear();
+    liveCount = 0;
+    maxHalfSize = glm::vec3(0.0f);
+}
+
+void SpatialGrid::link(Handle handle)
+{
+    Entry& entry = entries[handle];
+    entry.cell = cellOf(0.5f * (entry.min + entry.max));
+    entry.bucket = bucketOf(entry.cell);
+
+    std::vector<Handle>& bucket = buckets[entry.bucket];
+    entry.slot = static_cast<unsigned int>(bucket.size());
+    bucket.push_back(handle);
+}
+
+void SpatialGrid::unlink(Handle handle)
+{
+    // swap with the last one of the bucket
+    const Entry& entry = entries[handle];
+    std::vector<Handle>& bucket = buckets[entry.bucket];
+
+    const Handle last = bucket.back();
+    bucket[entry.slot] = last;
+    entries[last].slot = entry.slot;
+    bucket.pop_back();
+}
+
+template <typename CellFilter, typename Visit>
+void SpatialGrid::forEachCandidate(const glm::vec3& min, const glm::vec3& max, CellFilter cellFilter, Visit visit) const
+{
+    if (liveCount == 0)
+    {
+        return;
+    }
+
+    // a box can reach maxHalfSize out of the cell holding its center
+    const glm::ivec3 first = cellOf(min - maxHalfSize);
+    const glm::ivec3 last = cellOf(max + maxHalfSize);
+    const glm::dvec3 cellCount = glm::dvec3(last - first) + 1.0;
+
+    // large ranges: looking at every object is cheaper than walking mostly empty cells
+    if (cellCount.x * cellCount.y * cellCount.z > double(liveCount))
+    {
+        for (const Entry& entry : entries)
+        {
+            if (entry.live)
+                visit(entry);
+        }
+        return;
+    }
+
+    for (int z = first.z; z <= last.z; ++z)
+    {
+        for (int y = first.y; y <= last.y; ++y)
+        {
+            for (int x = first.x; x <= last.x; ++x)
+            {
+                const glm::ivec3 cell(x, y, z);
+                const glm::vec3 cellMin = glm::vec3(cell) * cellSize - maxHalfSize;
+                const glm::vec3 cellMax = glm::vec3(cell + 1) * cellSize + maxHalfSize;
+                if (!cellFilter(cellMin, cellMax))
+                    continue;
+
+                // other cells may hash to the same bucket
+                for (Handle handle : buckets[bucketOf(cell)])
+                {
+                    const Entry& entry = entries[handle];
+                    if (entry.cell == cell)
+                        visit(entry);
+                }
+            }
+        }
+    }
+}
+
+void SpatialGrid::queryAabb(const glm::vec3& min, const glm::vec3& max, std::vector<unsigned int>& result) const
+{
+    forEachCandidate(min, max,
+        [](const glm::vec3&, const glm::vec3&) { return true; },
+        [&](const Entry& entry) {
+            if (glm::all(glm::lessThanEqual(entry.min, max)) && glm::all(glm::greaterThanEqual(entry.max, min)))
+                result.push_back(entry.value);
+        });
+}
+
+void SpatialGrid::querySphere(const glm::vec3& center, float radius, std::vector<unsigned int>& result) const
+{
+    const float radius2 = radius * radius;
+    forEachCandidate(center - glm::vec3(radius), center + glm::vec3(radius),
+        [](const glm::vec3&, const glm::vec3&) { return true; },
+        [&](const Entry& entry) {
+            const glm::vec3 closest = glm::clamp(center, entry.min, entry.max);
+            const glm::vec3 d = closest - center;
+            if (glm::dot(d, d) <= radius2)
+                result.push_back(entry.value);
+        });
+}
+
+void SpatialGrid::queryFrustum(const Frustum& frustum, std::vector<unsigned int>& result) const
+{
+    glm::vec3 corners[8];
+    frustum.corners(corners);
+
+    glm::vec3 min(FLT_MAX), max(-FLT_MAX);
+    for (const glm::vec3& corner : corners)
+    {
+        min = glm::min(min, corner);
+        max = glm::max(max, corner);
+    }
+
+    forEachCandidate(min, max,
+        [&](const glm::vec3& cellMin, const glm::vec3& cellMax) { return frustum.intersectsAabb(cellMin, cellMax); },
+        [&](const Entry& entry) {
+            if (frustum.intersectsAabb(entry.min, entry.max))
+                result.push_back(entry.value);
+        });
+}
@@ -0,0 +1,77 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Bounds.h"
+#include "Frustum.h"
+
+// Loose uniform grid for objects that move every frame. The space is cut into cubic cells,
+// hashed into a fixed number of buckets, so the grid is unbounded and never rebuilt.
+//
+// An object lives in the one cell containing the center of its box ("loose": the box may
+// stick out of the cell). Queries widen their range by the largest half size seen, so
+// objects up to about a cell in size are cheap and larger ones still come out right.
+// insert(), move() and remove() are O(1); a move within the same cell only stores the box.
+class SpatialGrid
+{
+public:
+    using Handle = unsigned int;
+    static constexpr Handle InvalidHandle = ~0u;
+
+    explicit SpatialGrid(float cellSize = 4.0f, unsigned int bucketCount = 1u << 14);
+
+    // value is returned by the queries (e.g. an object index)
+    Handle insert(const Bounds& bounds, unsigned int value);
+    void move(Handle handle, const Bounds& bounds);
+    void remove(Handle handle);
+    void clear();
+
+    // appends the values of the objects whose box overlaps the given box / sphere / frustum
+    void queryAabb(const glm::vec3& min, const glm::vec3& max, std::vector<unsigned int>& result) const;
+    void querySphere(const glm::vec3& center, float radius, std::vector<unsigned int>& result) const;
+    void queryFrustum(const Frustum& frustum, std::vector<unsigned int>& result) const;
+
+    std::size_t size() const { return liveCount; }
+    float getCellSize() const { return cellSize; }
+
+private:
+    struct Entry
+    {
+        glm::vec3 min;
+        glm::vec3 max;
+        glm::ivec3 cell;
+        unsigned int bucket;
+        unsigned int slot;      // position in the bucket
+        unsigned int value;
+        bool live;
+    };
+
+    float cellSize;
+    float invCellSize;
+    unsigned int bucketMask;
+    glm::vec3 maxHalfSize = glm::vec3(0.0f);
+
+    std::vector<Entry> entries;                         // indexed by handle
+    std::vector<Handle> freeHandles;
+    std::vector<std::vector<Handle>> buckets;
+    std::size_t liveCount = 0;
+
+    glm::ivec3 cellOf(const glm::vec3& p) const;
+    unsigned int bucketOf(const glm::ivec3& cell) const;
+
+    void link(Handle handle);
+    void unlink(Handle handle);
+
+    // calls visit(entry) for every live entry in the cells overlapping [min, max]
+    // widened by maxHalfSize. cellFilter(cellMin, cellMax) can skip whole cells.
+    template <typename CellFilter, typename Visit>
+    void forEachCandidate(const glm::vec3& min, const glm::vec3& max, CellFilter cellFilter, Visit visit) const;
+};
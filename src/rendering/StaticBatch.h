@@ -0,0 +1,267 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <tuple>
+#include <vector>
+
+#include "Bounds.h"
+#include "DrawBucket.h"
+#include "FrustumCuller.h"
+#include "GeometryArena.h"
+#include "Mesh.h"
+
+// Merges geometry that never moves (floors, walls, scenery) at load time, so it stops costing
+// a draw call and a matrix per object.
+//
+// Sources are pre-transformed into world space as they are added. build() sorts them into the
+// cells of a uniform grid by the center of their world bounds, and merges the sources of a
+// cell sharing a material into one range of the geometry arena. A batch is drawn with an
+// identity model matrix, and has its own world bounds, so the cells are still culled one by
+// one: the bigger the cells, the fewer the draws but the more geometry outside the frustum
+// gets drawn along.
+//
+//   StaticBatcher<DefaultLayout> batcher(16.0f);
+//   batcher.add(mesh, matrix, material);
+//   batcher.build();
+//   ...
+//   batcher.cull(frustum);
+//   batcher.draw([&](GLuint material) { ... });
+template <typename Layout>
+class StaticBatcher
+{
+public:
+    using Arena = GeometryArena<Layout>;
+    using Vertex = typename Layout::Vertex;
+
+    struct Batch
+    {
+        typename Arena::Allocation allocation;
+        GLuint materialIndex = 0;
+        Bounds bounds;              // world space
+        glm::ivec3 cell = glm::ivec3(0);
+        std::size_t sourceCount = 0;
+    };
+
+    explicit StaticBatcher(float cellSize = 16.0f) : cellSize(cellSize) {}
+    StaticBatcher(const StaticBatcher&) = delete;
+    StaticBatcher& operator=(const StaticBatcher&) = delete;
+
+    ~StaticBatcher()
+    {
+        release();
+    }
+
+    // copies and transforms the vertices, indices are relative to them
+    void add(const Vertex* vertices, std::size_t vertexCount, const unsigned int* indices, std::size_t indexCount,
+             const glm::mat4& modelMatrix, GLuint materialIndex = 0)
+    {
+        if (vertexCount == 0 || indexCount == 0)
+        {
+            return;
+        }
+
+        Source source;
+        source.vertices.assign(vertices, vertices + vertexCount);
+        source.indices.assign(indices, indices + indexCount);
+        source.materialIndex = materialIndex;
+        Layout::transform(source.vertices.data(), vertexCount, modelMatrix);
+        source.bounds = Bounds::fromPoints(&source.vertices[0].Position, sizeof(Vertex), vertexCount);
+        sources.push_back(std::move(source));
+    }
+
+    void add(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const glm::mat4& modelMatrix, GLuint materialIndex = 0)
+    {
+        add(vertices.data(), vertices.size(), indices.data(), indices.size(), modelMatrix, materialIndex);
+    }
+
+    // one level of detail of a mesh; needs its CPU side vertices
+    void add(const BasicMesh<Layout>& mesh, const glm::mat4& modelMatrix, GLuint materialIndex = 0, unsigned int level = 0)
+    {
+        const MeshLod lod = mesh.lod(level);
+        add(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data() + lod.firstIndex, lod.indexCount, modelMatrix, materialIndex);
+    }
+
+    template <typename ModelType>
+    void addModel(const ModelType& model, const glm::mat4& modelMatrix, GLuint materialIndex = 0, unsigned int level = 0)
+    {
+        for (const auto& mesh : model.meshes)
+        {
+            add(mesh, modelMatrix, materialIndex, level);
+        }
+    }
+
+    // merges the sources added since the last build into batches and uploads them; the
+    // sources are dropped, batches of earlier builds are kept
+    void build()
+    {
+        // by material first, so draw() changes material as rarely as possible
+        std::vector<std::size_t> order(sources.size());
+        std::vector<glm::ivec3> cells(sources.size());
+        for (std::size_t i = 0; i < sources.size(); ++i)
+        {
+            order[i] = i;
+            cells[i] = cellOf(sources[i].bounds.center);
+        }
+        std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+            return std::make_tuple(sources[a].materialIndex, cells[a].x, cells[a].y, cells[a].z)
+                 < std::make_tuple(sources[b].materialIndex, cells[b].x, cells[b].y, cells[b].z);
+        });
+
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        for (std::size_t first = 0; first < order.size();)
+        {
+            const Source& head = sources[order[first]];
+            const glm::ivec3 cell = cells[order[first]];
+
+            Batch batch;
+            batch.materialIndex = head.materialIndex;
+            batch.cell = cell;
+
+            vertices.clear();
+            indices.clear();
+            std::size_t last = first;
+            for (; last < order.size(); ++last)
+            {
+                const Source& source = sources[order[last]];
+                if (source.materialIndex != batch.materialIndex || cells[order[last]] != cell)
+                {
+                    break;
+                }
+
+                const unsigned int base = static_cast<unsigned int>(vertices.size());
+                vertices.insert(vertices.end(), source.vertices.begin(), source.vertices.end());
+                for (unsigned int index : source.indices)
+                {
+                    indices.push_back(base + index);
+                }
+                ++batch.sourceCount;
+            }
+
+            batch.allocation = Arena::get().upload(vertices, indices);
+            batch.bounds = Bounds::fromPoints(&vertices[0].Position, sizeof(Vertex), vertices.size());
+            batches.push_back(batch);
+            batchBounds.add(batch.bounds);
+            sourceTotal += batch.sourceCount;
+            first = last;
+        }
+
+        sources.clear();
+        sources.shrink_to_fit();
+        visible.assign(batches.size(), 1);
+    }
+
+    // releases the batches from the arena
+    void release()
+    {
+        for (Batch& batch : batches)
+        {
+            Arena::get().release(batch.allocation);
+        }
+        batches.clear();
+        batchBounds.clear();
+        visible.clear();
+        sources.clear();
+        sourceTotal = 0;
+    }
+
+    // box test of every batch, see isVisible(); returns the number of visible batches
+    std::size_t cull(const Frustum& frustum)
+    {
+        culler.resetStats();
+        culler.setFrustum(frustum);
+        return culler.cullBoxes(batchBounds, visible);
+    }
+
+    // draws the visible batches with the program in use, an identity model matrix expected;
+    // setMaterial(materialIndex) is called whenever the material changes. Returns the draw calls.
+    template <typename SetMaterial>
+    std::size_t draw(SetMaterial setMaterial) const
+    {
+        const Arena& arena = Arena::get();
+        arena.bind();
+
+        std::size_t drawCalls = 0;
+        GLuint material = 0;
+        for (std::size_t i = 0; i < batches.size(); ++i)
+        {
+            if (!visible[i])
+            {
+                continue;
+            }
+            if (drawCalls == 0 || batches[i].materialIndex != material)
+            {
+                material = batches[i].materialIndex;
+                setMaterial(material);
+            }
+            arena.draw(batches[i].allocation);
+            ++drawCalls;
+        }
+        return drawCalls;
+    }
+
+    // the visible batches as draws of a multi-draw, sharing one object with an identity matrix
+    // per material (the objects are added on every call, for buckets cleared every frame)
+    void addDraws(DrawBucket<Layout>& bucket) const
+    {
+        std::size_t object = 0;
+        GLuint material = 0;
+        bool hasObject = false;
+        for (std::size_t i = 0; i < batches.size(); ++i)
+        {
+            if (!visible[i])
+            {
+                continue;
+            }
+            if (!hasObject || batches[i].materialIndex != material)
+            {
+                material = batches[i].materialIndex;
+                object = bucket.addObject(glm::mat4(1.0f), material);
+                hasObject = true;
+            }
+            bucket.addDraw(batches[i].allocation, object);
+        }
+    }
+
+    const std::vector<Batch>& getBatches() const { return batches; }
+    const BoundsBatch& getBounds() const { return batchBounds; }
+    bool isVisible(std::size_t batch) const { return visible[batch] != 0; }
+
+    // sources merged into the batches, and the culling counters of the last cull()
+    std::size_t sourceCount() const { return sourceTotal; }
+    const FrustumCuller::Stats& cullStats() const { return culler.stats(); }
+
+    float getCellSize() const { return cellSize; }
+
+private:
+    struct Source
+    {
+        std::vector<Vertex> vertices;       // world space
+        std::vector<unsigned int> indices;
+        Bounds bounds;
+        GLuint materialIndex = 0;
+    };
+
+    float cellSize;
+    std::vector<Source> sources;
+    std::vector<Batch> batches;
+    std::size_t sourceTotal = 0;
+
+    BoundsBatch batchBounds;
+    FrustumCuller culler;
+    std::vector<unsigned char> visible;
+
+    glm::ivec3 cellOf(const glm::vec3& position) const
+    {
+        return glm::ivec3(glm::floor(position / cellSize));
+    }
+};
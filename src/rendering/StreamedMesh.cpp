@@ -0,0 +1,437 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#include "StreamedMesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+
+#include "Lod.h"
+#include "Parallel.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    const char MAGIC[4] = { 'S', 'M', 'S', 'H' };
+
+    // magic, version, signature, stride, chunk count, page count, bounds
+    const std::size_t HEADER_SIZE = 4 + 5 * sizeof(std::uint32_t) + 2 * sizeof(glm::vec3);
+
+    template <typename T>
+    void write(std::ofstream& out, const T& value)
+    {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    void writeArray(std::ofstream& out, const std::vector<T>& values)
+    {
+        if (!values.empty())
+            out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+
+    template <typename T>
+    T readValue(const char*& p)
+    {
+        T value;
+        std::memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+        return value;
+    }
+
+    std::size_t alignUp(std::size_t value, std::size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    glm::vec3 positionOf(const unsigned char* vertexData, std::size_t stride, unsigned int vertex)
+    {
+        glm::vec3 position;
+        std::memcpy(&position, vertexData + std::size_t(vertex) * stride, sizeof(position));
+        return position;
+    }
+
+    // one level of a chunk while cooking
+    struct PageData
+    {
+        std::vector<unsigned char> vertexData;
+        std::vector<unsigned int> indices;
+        float error = 0.0f;
+    };
+
+    struct ChunkData
+    {
+        Bounds bounds;
+        std::vector<PageData> levels;
+    };
+
+    // a level-0 triangle of one of the meshes, sorted by the cell its centroid is in
+    struct BinnedTriangle
+    {
+        std::uint32_t cell;
+        std::uint32_t mesh;
+        std::uint32_t firstIndex;
+    };
+
+    // the triangles [first, last) of one cell, with their vertices copied out and a LOD chain
+    // built over them; each level is then compacted to the vertices it still uses
+    ChunkData cookChunk(const std::vector<CookedMesh>& meshes, std::size_t stride,
+                        const BinnedTriangle* first, const BinnedTriangle* last)
+    {
+        std::vector<unsigned char> vertexData;
+        std::vector<unsigned int> indices;
+        std::unordered_map<std::uint64_t, unsigned int> remap;
+
+        for (const BinnedTriangle* triangle = first; triangle != last; ++triangle)
+        {
+            const CookedMesh& mesh = meshes[triangle->mesh];
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                const unsigned int vertex = mesh.indices[triangle->firstIndex + corner];
+                const std::uint64_t key = (std::uint64_t(triangle->mesh) << 32) | vertex;
+                auto inserted = remap.emplace(key, static_cast<unsigned int>(vertexData.size() / stride));
+                if (inserted.second)
+                {
+                    const unsigned char* source = mesh.vertexData.data() + std::size_t(vertex) * stride;
+                    vertexData.insert(vertexData.end(), source, source + stride);
+                }
+                indices.push_back(inserted.first->second);
+            }
+        }
+
+        const std::size_t vertexCount = vertexData.size() / stride;
+        const std::vector<MeshLod> lods = LodBuilder::build(vertexData.data(), stride, vertexCount, indices);
+
+        ChunkData chunk;
+        chunk.bounds = Bounds::fromPoints(vertexData.data(), stride, vertexCount);
+        chunk.levels.resize(lods.size());
+
+        std::vector<unsigned int> local(vertexCount);
+        for (std::size_t level = 0; level < lods.size(); ++level)
+        {
+            PageData& page = chunk.levels[level];
+            page.error = lods[level].error;
+            page.indices.reserve(lods[level].indexCount);
+
+            // vertices in the order the level first uses them
+            std::fill(local.begin(), local.end(), ~0u);
+            for (unsigned int i = 0; i < lods[level].indexCount; ++i)
+            {
+                const unsigned int vertex = indices[lods[level].firstIndex + i];
+                if (local[vertex] == ~0u)
+                {
+                    local[vertex] = static_cast<unsigned int>(page.vertexData.size() / stride);
+                    page.vertexData.insert(page.vertexData.end(), vertexData.data() + vertex * stride, vertexData.data() + (vertex + 1) * stride);
+                }
+                page.indices.push_back(local[vertex]);
+            }
+        }
+        return chunk;
+    }
+}
+
+std::string StreamedMeshFile::cachePath(const std::string& sourcePath, std::uint32_t layoutSignature)
+{
+    std::string path = MeshCache::cachePath(sourcePath, layoutSignature);
+    return path.substr(0, path.find_last_of('.')) + ".smesh";
+}
+
+bool StreamedMeshFile::cook(const std::vector<CookedMesh>& meshes, std::uint32_t layoutSignature, std::uint32_t vertexStride,
+                            const std::string& path, std::size_t chunkTriangles)
+{
+    // level 0 of every mesh, binned into a grid sized for chunkTriangles per cell on average
+    Bounds modelBounds;
+    std::size_t triangleCount = 0;
+    bool first = true;
+    for (const CookedMesh& mesh : meshes)
+    {
+        const std::size_t vertexCount = mesh.vertexData.size() / vertexStride;
+        if (vertexCount == 0)
+            continue;
+
+        const Bounds meshBounds = Bounds::fromPoints(mesh.vertexData.data(), vertexStride, vertexCount);
+        if (first)
+            modelBounds = meshBounds;
+        else
+            modelBounds.merge(meshBounds);
+        first = false;
+
+        triangleCount += (mesh.lods.empty() ? mesh.indices.size() : mesh.lods[0].indexCount) / 3;
+    }
+    if (triangleCount == 0)
+    {
+        fprintf(stderr, "Nothing to stream in %s\n", path.c_str());
+        return false;
+    }
+
+    const glm::vec3 size = modelBounds.max - modelBounds.min;
+    // flat models still get cells of some height
+    const glm::vec3 extent = glm::max(size, glm::vec3(std::max(std::max(size.x, size.y), size.z) * 0.05f + 1e-6f));
+    const float cellCount = std::max(1.0f, float(triangleCount) / float(std::max<std::size_t>(chunkTriangles, 1)));
+    const float cellSize = std::cbrt(extent.x * extent.y * extent.z / cellCount);
+    const glm::ivec3 cells = glm::max(glm::ivec3(glm::ceil(extent / cellSize)), glm::ivec3(1));
+
+    std::vector<BinnedTriangle> binned;
+    binned.reserve(triangleCount);
+    for (std::size_t m = 0; m < meshes.size(); ++m)
+    {
+        const CookedMesh& mesh = meshes[m];
+        if (mesh.vertexData.empty())
+            continue;
+
+        const std::size_t indexCount = mesh.lods.empty() ? mesh.indices.size() : mesh.lods[0].indexCount;
+        for (std::size_t i = 0; i + 2 < indexCount; i += 3)
+        {
+            const glm::vec3 centroid = (positionOf(mesh.vertexData.data(), vertexStride, mesh.indices[i]) +
+                                        positionOf(mesh.vertexData.data(), vertexStride, mesh.indices[i + 1]) +
+                                        positionOf(mesh.vertexData.data(), vertexStride, mesh.indices[i + 2])) / 3.0f;
+            const glm::ivec3 c = glm::clamp(glm::ivec3((centroid - modelBounds.min) / cellSize), glm::ivec3(0), cells - 1);
+            binned.push_back({ std::uint32_t((c.z * cells.y + c.y) * cells.x + c.x), std::uint32_t(m), std::uint32_t(i) });
+        }
+    }
+    std::stable_sort(binned.begin(), binned.end(), [](const BinnedTriangle& a, const BinnedTriangle& b) { return a.cell < b.cell; });
+
+    std::vector<std::size_t> cellStarts;
+    for (std::size_t i = 0; i < binned.size(); ++i)
+    {
+        if (i == 0 || binned[i].cell != binned[i - 1].cell)
+            cellStarts.push_back(i);
+    }
+    cellStarts.push_back(binned.size());
+
+    std::vector<ChunkData> chunkData(cellStarts.size() - 1);
+    parallelFor(chunkData.size(), 1, [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t c = begin; c < end; ++c)
+            chunkData[c] = cookChunk(meshes, vertexStride, binned.data() + cellStarts[c], binned.data() + cellStarts[c + 1]);
+    });
+
+    // tables, with the page offsets laid out behind them
+    std::vector<StreamChunk> chunkTable;
+    std::vector<StreamPage> pageTable;
+    for (const ChunkData& chunk : chunkData)
+    {
+        chunkTable.push_back({ chunk.bounds.min, chunk.bounds.max, std::uint32_t(pageTable.size()), std::uint32_t(chunk.levels.size()) });
+        for (const PageData& level : chunk.levels)
+        {
+            StreamPage page = {};
+            page.vertexCount = static_cast<std::uint32_t>(level.vertexData.size() / vertexStride);
+            page.indexCount = static_cast<std::uint32_t>(level.indices.size());
+            page.error = level.error;
+            pageTable.push_back(page);
+        }
+    }
+
+    std::size_t offset = HEADER_SIZE + chunkTable.size() * sizeof(StreamChunk) + pageTable.size() * sizeof(StreamPage);
+    for (StreamPage& page : pageTable)
+    {
+        offset = alignUp(offset, PAGE_ALIGNMENT);
+        page.offset = offset;
+        offset += page.bytes(vertexStride);
+    }
+
+    std::error_code error;
+    fs::create_directories(fs::path(path).parent_path(), error);
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        fprintf(stderr, "Could not write streamed mesh %s\n", path.c_str());
+        return false;
+    }
+
+    out.write(MAGIC, 4);
+    write(out, VERSION);
+    write(out, layoutSignature);
+    write(out, vertexStride);
+    write(out, static_cast<std::uint32_t>(chunkTable.size()));
+    write(out, static_cast<std::uint32_t>(pageTable.size()));
+    write(out, modelBounds.min);
+    write(out, modelBounds.max);
+    writeArray(out, chunkTable);
+    writeArray(out, pageTable);
+
+    const std::vector<char> zeros(PAGE_ALIGNMENT, 0);
+    std::size_t written = HEADER_SIZE + chunkTable.size() * sizeof(StreamChunk) + pageTable.size() * sizeof(StreamPage);
+    std::size_t page = 0;
+    for (const ChunkData& chunk : chunkData)
+    {
+        for (const PageData& level : chunk.levels)
+        {
+            out.write(zeros.data(), pageTable[page].offset - written);
+            writeArray(out, level.vertexData);
+            writeArray(out, level.indices);
+            written = pageTable[page].offset + pageTable[page].bytes(vertexStride);
+            ++page;
+        }
+    }
+
+    return bool(out);
+}
+
+bool StreamedMeshFile::open(const std::string& path, std::uint32_t layoutSignature, std::uint32_t stride)
+{
+    close();
+    if (!file.open(path))
+    {
+        return false;
+    }
+
+    const char* p = file.data();
+    if (file.size() < HEADER_SIZE || std::memcmp(p, MAGIC, 4) != 0)
+    {
+        close();
+        return false;
+    }
+    p += 4;
+
+    const std::uint32_t version = readValue<std::uint32_t>(p);
+    const std::uint32_t signature = readValue<std::uint32_t>(p);
+    const std::uint32_t fileStride = readValue<std::uint32_t>(p);
+    const std::uint32_t chunkCount = readValue<std::uint32_t>(p);
+    const std::uint32_t pageCount = readValue<std::uint32_t>(p);
+    const glm::vec3 boundsMin = readValue<glm::vec3>(p);
+    const glm::vec3 boundsMax = readValue<glm::vec3>(p);
+    if (version != VERSION || signature != layoutSignature || fileStride != stride ||
+        file.size() < HEADER_SIZE + std::size_t(chunkCount) * sizeof(StreamChunk) + std::size_t(pageCount) * sizeof(StreamPage))
+    {
+        close();
+        return false;
+    }
+
+    chunks.resize(chunkCount);
+    pages.resize(pageCount);
+    if (chunkCount > 0)
+        std::memcpy(chunks.data(), p, chunkCount * sizeof(StreamChunk));
+    p += chunkCount * sizeof(StreamChunk);
+    if (pageCount > 0)
+        std::memcpy(pages.data(), p, pageCount * sizeof(StreamPage));
+
+    vertexStride = stride;
+    const bool valid = std::all_of(chunks.begin(), chunks.end(), [&](const StreamChunk& chunk)
+    {
+        return chunk.levelCount > 0 && std::size_t(chunk.firstPage) + chunk.levelCount <= pages.size();
+    }) && std::all_of(pages.begin(), pages.end(), [&](const StreamPage& page)
+    {
+        // written so that a huge offset can't wrap around
+        return page.offset <= file.size() && page.bytes(vertexStride) <= file.size() - page.offset;
+    });
+    if (!valid)
+    {
+        fprintf(stderr, "Corrupt streamed mesh %s\n", path.c_str());
+        close();
+        return false;
+    }
+
+    bounds.min = boundsMin;
+    bounds.max = boundsMax;
+    bounds.center = 0.5f * (boundsMin + boundsMax);
+    bounds.radius = glm::length(bounds.max - bounds.center);
+    return true;
+}
+
+void StreamedMeshFile::close()
+{
+    file.close();
+    chunks.clear();
+    pages.clear();
+    vertexStride = 0;
+}
+
+PageLoader::PageLoader()
+{
+    thread = std::thread(&PageLoader::threadLoop, this);
+}
+
+PageLoader::~PageLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+void PageLoader::request(std::uint32_t page, const char* source, const StreamPage& info, std::size_t vertexStride)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back({ page, source, info.bytes(vertexStride), info.vertexCount * vertexStride, info.vertexCount, Clock::now() });
+    }
+    wake.notify_one();
+}
+
+bool PageLoader::cancel(std::uint32_t page)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = std::find_if(queue.begin(), queue.end(), [&](const Request& request) { return request.page == page; });
+    if (it == queue.end())
+    {
+        return false;
+    }
+    queue.erase(it);
+    return true;
+}
+
+void PageLoader::poll(std::vector<Result>& done)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (Result& result : finished)
+    {
+        done.push_back(std::move(result));
+    }
+    finished.clear();
+}
+
+std::size_t PageLoader::pendingCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return queue.size() + reading + finished.size();
+}
+
+void PageLoader::threadLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        wake.wait(lock, [this] { return quit || !queue.empty(); });
+        if (quit)
+        {
+            return;
+        }
+
+        const Request request = queue.front();
+        queue.pop_front();
+        ++reading;
+        lock.unlock();
+
+        // the copy touches every page of the mapping, so this is where the disk is read
+        Result result;
+        result.page = request.page;
+        result.requested = request.requested;
+        const Clock::time_point start = Clock::now();
+        result.data.assign(request.source, request.source + request.bytes);
+        result.readMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        // an index past the page's vertices would draw vertices of other meshes in the arena
+        const std::size_t indexCount = (request.bytes - request.indexOffset) / sizeof(std::uint32_t);
+        for (std::size_t i = 0; i < indexCount && result.valid; ++i)
+        {
+            std::uint32_t index;
+            std::memcpy(&index, result.data.data() + request.indexOffset + i * sizeof(std::uint32_t), sizeof(index));
+            result.valid = index < request.vertexCount;
+        }
+
+        lock.lock();
+        finished.push_back(std::move(result));
+        --reading;
+    }
+}
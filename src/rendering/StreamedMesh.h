@@ -0,0 +1,157 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Bounds.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+
+// A spatial chunk of a streamed mesh: its levels of detail are consecutive pages, finest first
+struct StreamChunk
+{
+    glm::vec3 min;
+    glm::vec3 max;
+    std::uint32_t firstPage;
+    std::uint32_t levelCount;
+};
+
+// The unit of streaming: one level of one chunk, with its own vertices and indices relative to them
+struct StreamPage
+{
+    std::uint64_t offset;           // from the start of the file; vertices, then indices
+    std::uint32_t vertexCount;
+    std::uint32_t indexCount;
+    float error;                    // object space deviation from level 0
+    std::uint32_t padding;
+
+    std::size_t bytes(std::size_t vertexStride) const { return vertexCount * vertexStride + indexCount * sizeof(std::uint32_t); }
+};
+
+static_assert(sizeof(StreamChunk) == 32, "StreamChunk is stored as is");
+static_assert(sizeof(StreamPage) == 24, "StreamPage is stored as is");
+
+// Cooked meshes split into spatial chunks, every level of every chunk stored as a page that
+// can be read without touching the others. The file is memory-mapped, so only the tables are
+// read when opening it; the pages are faulted in by whoever copies them out (see PageLoader).
+//
+// Cooking merges all meshes of the model, sorts the triangles into a grid by their centroid
+// and builds a LOD chain per chunk. Chunk borders are open borders for the LOD builder and only
+// collapse along themselves, but neighbours drawn at different levels can still show hairline
+// cracks. Cooking is an offline step: it needs the whole model in memory once.
+//
+// File layout (little endian):
+//   char[4] "SMSH", u32 version, u32 layout signature, u32 vertex stride,
+//   u32 chunk count, u32 page count, vec3 bounds min, vec3 bounds max,
+//   StreamChunk[chunk count], StreamPage[page count],
+//   page data, each page starting on a PAGE_ALIGNMENT boundary
+class StreamedMeshFile
+{
+public:
+    static constexpr std::uint32_t VERSION = 1;
+    static constexpr std::size_t PAGE_ALIGNMENT = 4096;
+
+    // like MeshCache::cachePath(), with an .smesh extension
+    static std::string cachePath(const std::string& sourcePath, std::uint32_t layoutSignature);
+
+    // positions are the first member of the vertices. Chunks hold about chunkTriangles
+    // triangles on level 0, fewer where the model is sparse.
+    static bool cook(const std::vector<CookedMesh>& meshes, std::uint32_t layoutSignature, std::uint32_t vertexStride,
+                     const std::string& path, std::size_t chunkTriangles = 16384);
+
+    // returns false if the file is missing, corrupt, or was cooked for another layout
+    bool open(const std::string& path, std::uint32_t layoutSignature, std::uint32_t vertexStride);
+    void close();
+    bool isOpen() const { return file.isOpen(); }
+
+    const std::vector<StreamChunk>& getChunks() const { return chunks; }
+    const std::vector<StreamPage>& getPages() const { return pages; }
+    const Bounds& getBounds() const { return bounds; }
+    std::uint32_t getVertexStride() const { return vertexStride; }
+
+    // the mapped bytes of a page, not paged in until they are read
+    const char* pageData(std::size_t page) const { return file.data() + pages[page].offset; }
+    std::size_t pageBytes(std::size_t page) const { return pages[page].bytes(vertexStride); }
+
+private:
+    MappedFile file;
+    std::uint32_t vertexStride = 0;
+    std::vector<StreamChunk> chunks;
+    std::vector<StreamPage> pages;
+    Bounds bounds;
+};
+
+// Copies pages out of a mapped StreamedMeshFile on a background thread, so the page faults
+// (the actual disk reads) don't stall the frame. Uploading to the GPU stays with the caller,
+// on the thread owning the GL context.
+//
+//   loader.request(page, file.pageData(page), file.getPages()[page], file.getVertexStride());
+//   ...
+//   loader.poll(done);     // every frame
+class PageLoader
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Result
+    {
+        std::uint32_t page = 0;
+        std::vector<unsigned char> data;
+        Clock::time_point requested;
+        double readMs = 0.0;        // copying out of the mapping, page faults included
+        bool valid = true;          // every index is below the page's vertex count
+    };
+
+    PageLoader();
+    ~PageLoader();
+
+    PageLoader(const PageLoader&) = delete;
+    PageLoader& operator=(const PageLoader&) = delete;
+
+    // source must stay mapped until the result was polled or the request cancelled; info
+    // describes the page at source, its indices are checked against its vertex count
+    void request(std::uint32_t page, const char* source, const StreamPage& info, std::size_t vertexStride);
+
+    // drops a request that wasn't started yet; returns false if it is being read or done already
+    bool cancel(std::uint32_t page);
+
+    // appends the finished pages
+    void poll(std::vector<Result>& done);
+
+    // requested and not polled yet
+    std::size_t pendingCount() const;
+
+private:
+    struct Request
+    {
+        std::uint32_t page;
+        const char* source;
+        std::size_t bytes;
+        std::size_t indexOffset;
+        std::uint32_t vertexCount;
+        Clock::time_point requested;
+    };
+
+    std::thread thread;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Request> queue;
+    std::vector<Result> finished;
+    std::size_t reading = 0;
+    bool quit = false;
+
+    void threadLoop();
+};
@@ -0,0 +1,389 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "DrawBucket.h"
+#include "GeometryArena.h"
+#include "Lod.h"
+#include "Model.h"
+#include "StreamedMesh.h"
+#include "helpers/RootDir.h"
+
+// A model that doesn't have to fit into memory: its geometry lives in a StreamedMeshFile and
+// only the chunks near the camera are resident in the geometry arena, at the level of detail
+// their distance calls for.
+//
+// Every update() picks a level per chunk with the LodSelector, then fits the levels into the
+// budget: first the coarsest level of every chunk, nearest first, until the budget runs out,
+// then finer levels towards the picked ones, nearest first again. Missing pages are requested
+// from the PageLoader thread nearest first; until a page arrives its chunk keeps drawing the
+// level it has resident, so the budget can be exceeded by those for a few frames. Pages
+// neither wanted nor drawn are evicted.
+//
+//   StreamedModel streamed("res/models/city.glb", 64 << 20);
+//   lodSelector.setView(cameraPosition, projection, viewportHeight);
+//   streamed.update(lodSelector, modelMatrix);
+//   streamed.Draw();
+template <typename Layout>
+class BasicStreamedModel
+{
+public:
+    using Arena = GeometryArena<Layout>;
+    using Vertex = typename Layout::Vertex;
+
+    struct Stats
+    {
+        std::size_t chunks = 0;
+        std::size_t chunksDrawn = 0;
+        std::size_t chunksMissing = 0;      // wanted, but nothing of them is resident yet
+        std::size_t residentPages = 0;
+        std::size_t residentBytes = 0;
+        std::size_t wantedBytes = 0;        // of the levels picked this frame, at most the budget
+        std::size_t pendingPages = 0;
+
+        // of this frame
+        std::size_t pageIns = 0;
+        std::size_t evictions = 0;
+        double maxPageInMs = 0.0;           // from the request to the upload
+        double uploadMs = 0.0;
+
+        // over all page-ins so far
+        std::size_t totalPageIns = 0;
+        double averagePageInMs = 0.0;
+        double averageReadMs = 0.0;         // the part spent on the loader thread
+    };
+
+    // pages requested at once; more only sit in the loader queue and can't be reprioritized
+    std::size_t maxInFlight = 16;
+
+    // cooks the stream file under res/cache/ first if there is none or the source is newer
+    BasicStreamedModel(const std::string& path, std::size_t budgetBytes, std::size_t chunkTriangles = 16384)
+        : budget(budgetBytes)
+    {
+        const std::string streamPath = StreamedMeshFile::cachePath(path, Layout::signature);
+        if (!isUpToDate(path, streamPath) || !file.open(streamPath, Layout::signature, Layout::stride))
+        {
+            std::vector<CookedMesh> cooked;
+            if (!BasicModel<Layout>::import(path, cooked) ||
+                !StreamedMeshFile::cook(cooked, Layout::signature, Layout::stride, streamPath, chunkTriangles) ||
+                !file.open(streamPath, Layout::signature, Layout::stride))
+            {
+                std::cout << "ERROR::STREAMING:: could not cook " << path << std::endl;
+                return;
+            }
+        }
+
+        const std::vector<StreamChunk>& chunks = file.getChunks();
+        chunkErrors.resize(chunks.size());
+        for (std::size_t c = 0; c < chunks.size(); ++c)
+        {
+            for (std::uint32_t level = 0; level < chunks[c].levelCount; ++level)
+                chunkErrors[c].push_back(file.getPages()[chunks[c].firstPage + level].error);
+        }
+        selected.assign(chunks.size(), 0);
+        wanted.assign(chunks.size(), -1);
+        drawn.assign(chunks.size(), -1);
+        pageStates.assign(file.getPages().size(), PAGE_NONE);
+        allocations.resize(file.getPages().size());
+        order.resize(chunks.size());
+        counters.chunks = chunks.size();
+    }
+
+    BasicStreamedModel(const BasicStreamedModel&) = delete;
+    BasicStreamedModel& operator=(const BasicStreamedModel&) = delete;
+
+    ~BasicStreamedModel()
+    {
+        for (typename Arena::Allocation& allocation : allocations)
+            Arena::get().release(allocation);
+    }
+
+    bool isOpen() const { return file.isOpen(); }
+
+    // object space bounds of the whole model
+    const Bounds& getBounds() const { return file.getBounds(); }
+
+    void setBudget(std::size_t bytes) { budget = bytes; }
+    std::size_t getBudget() const { return budget; }
+
+    // picks the levels, uploads what the loader finished, requests and evicts pages. Expects
+    // the selector's view to be set for this frame.
+    void update(const LodSelector& selector, const glm::mat4& modelMatrix)
+    {
+        if (!isOpen())
+            return;
+
+        counters.pageIns = 0;
+        counters.evictions = 0;
+        counters.maxPageInMs = 0.0;
+        counters.uploadMs = 0.0;
+
+        uploadFinished();
+        selectLevels(selector, modelMatrix);
+        requestPages();
+        pickDrawn();
+        evict();
+
+        counters.pendingPages = loader.pendingCount();
+    }
+
+    // draws the resident level of every chunk
+    void Draw() const
+    {
+        Arena::get().bind();
+        DrawRanges();
+    }
+
+    // expects the arena VAO of the layout to be bound
+    void DrawRanges() const
+    {
+        const Arena& arena = Arena::get();
+        for (std::size_t c = 0; c < drawn.size(); ++c)
+        {
+            if (drawn[c] >= 0)
+                arena.draw(allocations[file.getChunks()[c].firstPage + drawn[c]]);
+        }
+    }
+
+    // a draw per drawn chunk for an existing object of the bucket
+    void addDraws(DrawBucket<Layout>& bucket, std::size_t objectIndex) const
+    {
+        for (std::size_t c = 0; c < drawn.size(); ++c)
+        {
+            if (drawn[c] >= 0)
+                bucket.addDraw(allocations[file.getChunks()[c].firstPage + drawn[c]], objectIndex);
+        }
+    }
+
+    std::size_t chunkCount() const { return drawn.size(); }
+
+    // level the chunk is drawn at, -1 if nothing of it is resident
+    int drawnLevel(std::size_t chunk) const { return drawn[chunk]; }
+    const typename Arena::Allocation& drawnAllocation(std::size_t chunk) const { return allocations[file.getChunks()[chunk].firstPage + drawn[chunk]]; }
+
+    const Stats& stats() const { return counters; }
+
+private:
+    // corrupt pages are never requested or drawn again, their chunks use the other levels
+    enum PageState : unsigned char { PAGE_NONE, PAGE_PENDING, PAGE_RESIDENT, PAGE_CORRUPT };
+
+    StreamedMeshFile file;
+    // after the file, so the thread reading from its mapping stops first
+    PageLoader loader;
+
+    std::size_t budget = 0;
+    std::vector<std::vector<float>> chunkErrors;
+    std::vector<unsigned int> selected;     // by the LodSelector, kept for its hysteresis
+    std::vector<int> wanted;                // within the budget, -1 for none
+    std::vector<int> drawn;
+    std::vector<PageState> pageStates;
+    std::vector<typename Arena::Allocation> allocations;
+    std::vector<std::uint32_t> order;       // chunks, nearest first
+    std::vector<PageLoader::Result> finished;
+
+    Stats counters;
+
+    static bool isUpToDate(const std::string& sourcePath, const std::string& streamPath)
+    {
+        std::error_code error;
+        const std::filesystem::file_time_type streamTime = std::filesystem::last_write_time(streamPath, error);
+        if (error)
+            return false;
+        const std::filesystem::file_time_type sourceTime = std::filesystem::last_write_time(ROOT_DIR + sourcePath, error);
+        return error || sourceTime <= streamTime;
+    }
+
+    std::uint32_t pageOf(std::size_t chunk, int level) const
+    {
+        return file.getChunks()[chunk].firstPage + static_cast<std::uint32_t>(level);
+    }
+
+    void uploadFinished()
+    {
+        finished.clear();
+        loader.poll(finished);
+
+        const auto start = PageLoader::Clock::now();
+        for (PageLoader::Result& result : finished)
+        {
+            // cancelled while it was being read
+            if (pageStates[result.page] != PAGE_PENDING)
+                continue;
+
+            if (!result.valid)
+            {
+                std::cout << "ERROR::STREAMING:: page " << result.page << " has indices past its vertices" << std::endl;
+                pageStates[result.page] = PAGE_CORRUPT;
+                continue;
+            }
+
+            const StreamPage& page = file.getPages()[result.page];
+            const Vertex* vertices = reinterpret_cast<const Vertex*>(result.data.data());
+            const unsigned int* indices = reinterpret_cast<const unsigned int*>(result.data.data() + page.vertexCount * sizeof(Vertex));
+            allocations[result.page] = Arena::get().upload(vertices, page.vertexCount, indices, page.indexCount);
+            pageStates[result.page] = PAGE_RESIDENT;
+
+            const double latencyMs = std::chrono::duration<double, std::milli>(PageLoader::Clock::now() - result.requested).count();
+            const double total = double(counters.totalPageIns);
+            counters.averagePageInMs = (counters.averagePageInMs * total + latencyMs) / (total + 1.0);
+            counters.averageReadMs = (counters.averageReadMs * total + result.readMs) / (total + 1.0);
+            counters.maxPageInMs = std::max(counters.maxPageInMs, latencyMs);
+            counters.residentBytes += result.data.size();
+            ++counters.residentPages;
+            ++counters.totalPageIns;
+            ++counters.pageIns;
+        }
+        counters.uploadMs = std::chrono::duration<double, std::milli>(PageLoader::Clock::now() - start).count();
+    }
+
+    void selectLevels(const LodSelector& selector, const glm::mat4& modelMatrix)
+    {
+        const std::vector<StreamChunk>& chunks = file.getChunks();
+        const float scale = std::max(glm::length(glm::vec3(modelMatrix[0])),
+                                     std::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+
+        std::vector<float> distances(chunks.size());
+        for (std::size_t c = 0; c < chunks.size(); ++c)
+        {
+            const glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(0.5f * (chunks[c].min + chunks[c].max), 1.0f));
+            distances[c] = glm::length(center - selector.getCameraPosition());
+            selected[c] = selector.select(chunkErrors[c], center, scale, selected[c]);
+        }
+
+        std::iota(order.begin(), order.end(), 0u);
+        std::sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) { return distances[a] < distances[b]; });
+
+        // every chunk gets its coarsest level first, nearest first, so the budget covers as much
+        // of the model as it can; what is left then refines the chunks towards their selected
+        // level, nearest first again
+        std::size_t left = budget;
+        for (std::uint32_t c : order)
+        {
+            const int coarsest = int(chunks[c].levelCount) - 1;
+            const std::size_t bytes = file.pageBytes(pageOf(c, coarsest));
+            wanted[c] = bytes <= left ? coarsest : -1;
+            if (wanted[c] >= 0)
+                left -= bytes;
+        }
+        for (std::uint32_t c : order)
+        {
+            if (wanted[c] < 0)
+                continue;
+
+            const std::size_t current = file.pageBytes(pageOf(c, wanted[c]));
+            for (int level = int(selected[c]); level < wanted[c]; ++level)
+            {
+                const std::size_t bytes = file.pageBytes(pageOf(c, level));
+                if (bytes - current <= left)
+                {
+                    left -= bytes - current;
+                    wanted[c] = level;
+                    break;
+                }
+            }
+        }
+        counters.wantedBytes = budget - left;
+    }
+
+    void requestPages()
+    {
+        // pages no longer wanted leave the queue, unless they are being read already
+        for (std::size_t c = 0; c < wanted.size(); ++c)
+        {
+            for (int level = 0; level < int(file.getChunks()[c].levelCount); ++level)
+            {
+                const std::uint32_t page = pageOf(c, level);
+                if (level != wanted[c] && pageStates[page] == PAGE_PENDING && loader.cancel(page))
+                    pageStates[page] = PAGE_NONE;
+            }
+        }
+
+        std::size_t inFlight = loader.pendingCount();
+        for (std::uint32_t c : order)
+        {
+            if (inFlight >= maxInFlight)
+                break;
+            if (wanted[c] < 0)
+                continue;
+
+            const std::uint32_t page = pageOf(c, wanted[c]);
+            if (pageStates[page] == PAGE_NONE)
+            {
+                loader.request(page, file.pageData(page), file.getPages()[page], file.getVertexStride());
+                pageStates[page] = PAGE_PENDING;
+                ++inFlight;
+            }
+        }
+    }
+
+    void pickDrawn()
+    {
+        counters.chunksDrawn = 0;
+        counters.chunksMissing = 0;
+        for (std::size_t c = 0; c < drawn.size(); ++c)
+        {
+            if (wanted[c] >= 0 && pageStates[pageOf(c, wanted[c])] == PAGE_RESIDENT)
+            {
+                drawn[c] = wanted[c];
+            }
+            else if (drawn[c] < 0 || pageStates[pageOf(c, drawn[c])] != PAGE_RESIDENT)
+            {
+                // the resident level closest to the wanted one, if any
+                drawn[c] = -1;
+                const int target = wanted[c] >= 0 ? wanted[c] : 0;
+                for (int level = 0; level < int(file.getChunks()[c].levelCount); ++level)
+                {
+                    if (pageStates[pageOf(c, level)] == PAGE_RESIDENT &&
+                        (drawn[c] < 0 || std::abs(level - target) < std::abs(drawn[c] - target)))
+                        drawn[c] = level;
+                }
+            }
+
+            // a chunk that fell out of the budget stays hidden rather than drawn from leftovers
+            if (wanted[c] < 0)
+                drawn[c] = -1;
+
+            if (drawn[c] >= 0)
+                ++counters.chunksDrawn;
+            else if (wanted[c] >= 0)
+                ++counters.chunksMissing;
+        }
+    }
+
+    void evict()
+    {
+        for (std::size_t c = 0; c < drawn.size(); ++c)
+        {
+            for (int level = 0; level < int(file.getChunks()[c].levelCount); ++level)
+            {
+                const std::uint32_t page = pageOf(c, level);
+                if (pageStates[page] != PAGE_RESIDENT || level == wanted[c] || level == drawn[c])
+                    continue;
+
+                Arena::get().release(allocations[page]);
+                pageStates[page] = PAGE_NONE;
+                counters.residentBytes -= file.pageBytes(page);
+                --counters.residentPages;
+                ++counters.evictions;
+            }
+        }
+    }
+};
+
+using StreamedModel = BasicStreamedModel<DefaultLayout>;
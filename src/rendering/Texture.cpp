@@ -17,6 +17,7 @@ Texture::~Texture()
 {
     if(to_id != 0)
     {
+        GLState::get().forgetTexture(to_id);
         glDeleteTextures(1, &to_id);
         to_id = 0;
     }
@@ -52,7 +53,7 @@ bool Texture::load(const std::string & file_name, bool gamma_correction)
     if(pixels != nullptr)
     {
         glGenTextures(1, &to_id);
-        glBindTexture(GL_TEXTURE_2D, to_id);
+        GLState::get().bindTexture(GL_TEXTURE_2D, to_id);
         glTexImage2D(GL_TEXTURE_2D, 0, internalformat, width, height, 0, dataFormat, GL_UNSIGNED_BYTE, pixels);
         
         glTexStorage2D(GL_TEXTURE_2D, 2 /* mip map levels */, internalformat, width, height);
@@ -86,7 +87,7 @@ bool Texture::loadDepthMap(int width, int height)
 
 	// create depth texture
 	glGenTextures(1, &to_id);
-	glBindTexture(GL_TEXTURE_2D, to_id);
+	GLState::get().bindTexture(GL_TEXTURE_2D, to_id);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, FBOWidth, FBOHeight, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -96,11 +97,11 @@ bool Texture::loadDepthMap(int width, int height)
 	glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
 
 	// attach depth texture as FBO's depth buffer
-	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+	GLState::get().bindFramebuffer(GL_FRAMEBUFFER, FBO);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, to_id, 0);
 	glDrawBuffer(GL_NONE);
 	glReadBuffer(GL_NONE);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0); // unbind
+	GLState::get().bindFramebuffer(GL_FRAMEBUFFER, 0); // unbind
 
     return true;
 }
@@ -115,7 +116,7 @@ bool Texture::loadColorFrameBuffer(int width, int height)
 
     // create color texture
     glGenTextures(1, &to_id);
-    glBindTexture(GL_TEXTURE_2D, to_id);
+    GLState::get().bindTexture(GL_TEXTURE_2D, to_id);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, FBOWidth, FBOHeight, 0, GL_RGBA, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -127,12 +128,12 @@ bool Texture::loadColorFrameBuffer(int width, int height)
     glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, FBOWidth, FBOHeight);
 
     // attach color buffer
-    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    GLState::get().bindFramebuffer(GL_FRAMEBUFFER, FBO);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, to_id, 0);
     glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
         std::cout << "Framebuffer not complete!" << std::endl;
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLState::get().bindFramebuffer(GL_FRAMEBUFFER, 0);
 
     return true;
 }
@@ -6,6 +6,8 @@
 #include <string>
 #include <glad/glad.h>
 
+#include "GLState.h"
+
 class Texture
 {
 public:
@@ -20,20 +22,19 @@ public:
     {
         if(to_id != 0)
         {
-            glActiveTexture(GL_TEXTURE0 + index);
-            glBindTexture(GL_TEXTURE_2D, to_id);
+            GLState::get().bindTextureUnit(index, GL_TEXTURE_2D, to_id);
         }
     }
 
     void bindFrameBuffer() const
     {
-		glBindFramebuffer(GL_FRAMEBUFFER, FBO);
-		glViewport(0, 0, FBOWidth, FBOHeight);
+		GLState::get().bindFramebuffer(GL_FRAMEBUFFER, FBO);
+		GLState::get().viewport(0, 0, GLsizei(FBOWidth), GLsizei(FBOHeight));
     }
     
     void unbindFrameBuffer() const
     {
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		GLState::get().bindFramebuffer(GL_FRAMEBUFFER, 0);
     }
 
     bool use_linear;
@@ -0,0 +1,446 @@
+/**
+ * Copyright (C) 2023 Jooh
+ **/
+
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
+#include <assimp/mesh.h>
+#include <assimp/postprocess.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <type_traits>
+
+#include "GlbFile.h"
+#include "ObjLoader.h"
+
+// Vertex attributes that can be put into a VertexLayout.
+// Each attribute knows its GL format, the Assimp post-process steps it depends on,
+// and how to read itself out of an aiMesh (or an ObjMesh of the OBJ fast path, or a glTF
+// primitive). The nested Field struct is what ends up in the packed vertex, so members keep
+// their usual names (vertex.Position, ...).
+namespace attr
+{
+    struct Position
+    {
+        static constexpr char id = 'P';
+        static constexpr GLint components = 3;
+        static constexpr GLenum glType = GL_FLOAT;
+        static constexpr bool integer = false;
+        static constexpr unsigned int importFlags = 0;
+        static constexpr const char* gltfName = "POSITION";
+
+        struct Field { glm::vec3 Position; };
+
+        static void read(Field & field, const aiMesh * mesh, unsigned int i)
+        {
+            field.Position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+        }
+
+        static void read(Field & field, const ObjMesh & mesh, unsigned int i)
+        {
+            field.Position = mesh.positions[i];
+        }
+
+        // the whole column, first points at the field of vertex 0
+        static void read(unsigned char * first, std::size_t stride, const GlbPrimitive & primitive)
+        {
+            const float fallback[] = { 0.0f, 0.0f, 0.0f };
+            primitive.copy(gltfName, first, stride, 3, fallback);
+        }
+
+        static void transform(Field & field, const glm::mat4 & matrix, const glm::mat3 &)
+        {
+            field.Position = glm::vec3(matrix * glm::vec4(field.Position, 1.0f));
+        }
+    };
+
+    struct Normal
+    {
+        static constexpr char id = 'N';
+        static constexpr GLint components = 3;
+        static constexpr GLenum glType = GL_FLOAT;
+        static constexpr bool integer = false;
+        static constexpr unsigned int importFlags = aiProcess_GenSmoothNormals;
+        static constexpr const char* gltfName = "NORMAL";
+
+        struct Field { glm::vec3 Normal; };
+
+        static void read(Field & field, const aiMesh * mesh, unsigned int i)
+        {
+            if (mesh->mNormals)
+                field.Normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
+            else
+                field.Normal = glm::vec3(0.0f, 1.0f, 0.0f);
+        }
+
+        static void read(Field & field, const ObjMesh & mesh, unsigned int i)
+        {
+            field.Normal = mesh.normals[i];
+        }
+
+        static void read(unsigned char * first, std::size_t stride, const GlbPrimitive & primitive)
+        {
+            const float fallback[] = { 0.0f, 1.0f, 0.0f };
+            primitive.copy(gltfName, first, stride, 3, fallback);
+        }
+
+        static void transform(Field & field, const glm::mat4 &, const glm::mat3 & normalMatrix)
+        {
+            field.Normal = glm::normalize(normalMatrix * field.Normal);
+        }
+    };
+
+    struct TexCoords
+    {
+        static constexpr char id = 'T';
+        static constexpr GLint components = 2;
+        static constexpr GLenum glType = GL_FLOAT;
+        static constexpr bool integer = false;
+        static constexpr unsigned int importFlags = aiProcess_FlipUVs;
+        // glTF uvs already have their origin at the top left, like flipped Assimp ones
+        static constexpr const char* gltfName = "TEXCOORD_0";
+
+        struct Field { glm::vec2 TexCoords; };
+
+        static void read(Field & field, const aiMesh * mesh, unsigned int i)
+        {
+            // we only ever use the first of the (up to 8) texture coordinate sets
+            if (mesh->mTextureCoords[0])
+                field.TexCoords = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
+            else
+                field.TexCoords = glm::vec2(0.0f, 0.0f);
+        }
+
+        static void read(Field & field, const ObjMesh & mesh, unsigned int i)
+        {
+            field.TexCoords = mesh.texCoords[i];
+        }
+
+        static void read(unsigned char * first, std::size_t stride, const GlbPrimitive & primitive)
+        {
+            const float fallback[] = { 0.0f, 0.0f };
+            primitive.copy(gltfName, first, stride, 2, fallback);
+        }
+
+        static void transform(Field &, const glm::mat4 &, const glm::mat3 &) {}
+    };
+
+    struct Tangent
+    {
+        static constexpr char id = 'G';
+        static constexpr GLint components = 3;
+        static constexpr GLenum glType = GL_FLOAT;
+        static constexpr bool integer = false;
+        static constexpr unsigned int importFlags = aiProcess_CalcTangentSpace;
+        static constexpr const char* gltfName = "TANGENT";
+
+        struct Field { glm::vec3 Tangent; };
+
+        static void read(Field & field, const aiMesh * mesh, unsigned int i)
+        {
+            if (mesh->mTangents)
+                field.Tangent = glm::vec3(mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z);
+            else
+                field.Tangent = glm::vec3(1.0f, 0.0f, 0.0f);
+        }
+
+        static void read(Field & field, const ObjMesh & mesh, unsigned int i)
+        {
+            field.Tangent = mesh.tangents.empty() ? glm::vec3(1.0f, 0.0f, 0.0f) : mesh.tangents[i];
+        }
+
+        // xyz of the glTF vec4 tangent
+        static void read(unsigned char * first, std::size_t stride, const GlbPrimitive & primitive)
+        {
+            const float fallback[] = { 1.0f, 0.0f, 0.0f };
+            primitive.copy(gltfName, first, stride, 3, fallback);
+        }
+
+        static void transform(Field & field, const glm::mat4 & matrix, const glm::mat3 &)
+        {
+            field.Tangent = glm::normalize(glm::mat3(matrix) * field.Tangent);
+        }
+    };
+
+    struct Bitangent
+    {
+        static constexpr char id = 'B';
+        static constexpr GLint components = 3;
+        static constexpr GLenum glType = GL_FLOAT;
+        static constexpr bool integer = false;
+        static constexpr unsigned int importFlags = aiProcess_CalcTangentSpace;
+        // glTF has no bitangents, they come from the normal and the tangent's handedness (w)
+        static constexpr const char* gltfName = nullptr;
+
+        struct Field { glm::vec3 Bitangent; };
+
+        static void read(Field & field, const aiMesh * mesh, unsigned int i)
+        {
+            if (mesh->mBitangents)
+                field.Bitangent = glm::vec3(mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z);
+            else
+                field.Bitangent = glm::vec3(0.0f, 0.0f, 1.0f);
+        }
+
+        static void read(Field & field, const ObjMesh & mesh, unsigned int i)
+        {
+            field.Bitangent = mesh.bitangents.empty() ? glm::vec3(0.0f, 0.0f, 1.0f) : mesh.bitangents[i];
+        }
+
+        static void read(unsigned char * first, std::size_t stride, const GlbPrimitive & primitive)
+        {
+            const GlbAccessor* normals = primitive.attribute("NORMAL");
+            const GlbAccessor* tangents = primitive.attribute("TANGENT");
+            for (std::size_t i = 0; i < primitive.vertexCount; ++i)
+            {
+                glm::vec3 bitangent(0.0f, 0.0f, 1.0f);
+                if (normals && tangents)
+                {
+                    const glm::vec4 tangent = tangents->get(i);
+                    bitangent = glm::cross(glm::vec3(normals->get(i)), glm::vec3(tangent)) * (tangent.w < 0.0f ? -1.0f : 1.0f);
+                }
+                std::memcpy(first + i * stride, &bitangent, sizeof(bitangent));
+            }
+        }
+
+        static void transform(Field & field, const glm::mat4 & matrix, const glm::mat3 &)
+        {
+            field.Bitangent = glm::normalize(glm::mat3(matrix) * field.Bitangent);
+        }
+    };
+
+    // Up to 4 bones per vertex, indices into the skin palette of the model's Skeleton (see
+    // Animation.h). Assimp keeps the weights per bone rather than per vertex, so the aiMesh
+    // readers only clear the fields; BasicModel fills both from aiMesh::mBones afterwards.
+    // glTF skins aren't read by GlbFile, skinned models go through Assimp.
+    struct BoneIndices
+    {
+        static constexpr char id = 'J';
+        static constexpr GLint components = 4;
+        static constexpr GLenum glType = GL_UNSIGNED_BYTE;
+        static constexpr bool integer = true;
+        static constexpr unsigned int importFlags = aiProcess_LimitBoneWeights;
+        static constexpr const char* gltfName = nullptr;
+
+        struct Field { glm::u8vec4 BoneIndices; };
+
+        static void read(Field & field, const aiMesh *, unsigned int)
+        {
+            field.BoneIndices = glm::u8vec4(0);
+        }
+
+        static void read(Field & field, const ObjMesh &, unsigned int)
+        {
+            field.BoneIndices = glm::u8vec4(0);
+        }
+
+        static void read(unsigned char * first, std::size_t stride, const GlbPrimitive & primitive)
+        {
+            for (std::size_t i = 0; i < primitive.vertexCount; ++i)
+                std::memset(first + i * stride, 0, sizeof(Field));
+        }
+
+        static void transform(Field &, const glm::mat4 &, const glm::mat3 &) {}
+    };
+
+    // the weights of BoneIndices, summing up to 1
+    struct BoneWeights
+    {
+        static constexpr char id = 'W';
+        static constexpr GLint components = 4;
+        static constexpr GLenum glType = GL_FLOAT;
+        static constexpr bool integer = false;
+        static constexpr unsigned int importFlags = aiProcess_LimitBoneWeights;
+        static constexpr const char* gltfName = nullptr;
+
+        struct Field { glm::vec4 BoneWeights; };
+
+        static void read(Field & field, const aiMesh *, unsigned int)
+        {
+            field.BoneWeights = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+        }
+
+        static void read(Field & field, const ObjMesh &, unsigned int)
+        {
+            field.BoneWeights = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+        }
+
+        static void read(unsigned char * first, std::size_t stride, const GlbPrimitive & primitive)
+        {
+            const glm::vec4 weights(1.0f, 0.0f, 0.0f, 0.0f);
+            for (std::size_t i = 0; i < primitive.vertexCount; ++i)
+                std::memcpy(first + i * stride, &weights, sizeof(weights));
+        }
+
+        static void transform(Field &, const glm::mat4 &, const glm::mat3 &) {}
+    };
+}
+
+namespace detail
+{
+    template <typename T, typename... Ts>
+    struct IndexOf;
+
+    template <typename T, typename... Ts>
+    struct IndexOf<T, T, Ts...> : std::integral_constant<std::size_t, 0> {};
+
+    template <typename T, typename U, typename... Ts>
+    struct IndexOf<T, U, Ts...> : std::integral_constant<std::size_t, 1 + IndexOf<T, Ts...>::value> {};
+
+    template <typename T>
+    struct IndexOf<T> : std::integral_constant<std::size_t, 0> {};
+
+    // FNV-1a over the attribute ids
+    constexpr std::uint32_t hashIds(std::initializer_list<char> ids)
+    {
+        std::uint32_t hash = 2166136261u;
+        for (char id : ids)
+        {
+            hash ^= static_cast<std::uint32_t>(id);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+}
+
+// Describes an interleaved vertex format at compile time.
+//
+//   using Layout = VertexLayout<attr::Position, attr::Normal, attr::TexCoords>;
+//   Layout::Vertex v;          // packed struct with v.Position, v.Normal, v.TexCoords
+//   Layout::setup();           // glVertexAttribPointer for locations 0, 1, 2
+//   Layout::importFlags        // Assimp flags needed to fill exactly these attributes
+//
+// Attribute locations follow the order of the template arguments.
+template <typename... Attrs>
+class VertexLayout
+{
+public:
+    struct Vertex : Attrs::Field... {};
+
+    static constexpr std::size_t count = sizeof...(Attrs);
+    static constexpr GLsizei stride = static_cast<GLsizei>((sizeof(typename Attrs::Field) + ... + 0));
+
+    static constexpr unsigned int importFlags = aiProcess_Triangulate | (Attrs::importFlags | ... | 0u);
+
+    // identifies the layout in cooked mesh files (see MeshCache)
+    static constexpr std::uint32_t signature = detail::hashIds({ Attrs::id... });
+
+    template <typename A>
+    static constexpr bool has = (std::is_same<A, Attrs>::value || ...);
+
+    template <typename A>
+    static constexpr std::size_t locationOf = detail::IndexOf<A, Attrs...>::value;
+
+    template <typename A>
+    static constexpr std::size_t offsetOf()
+    {
+        static_assert(has<A>, "attribute is not part of this layout");
+        constexpr std::size_t sizes[] = { sizeof(typename Attrs::Field)... };
+        std::size_t offset = 0;
+        for (std::size_t i = 0; i < locationOf<A>; ++i)
+            offset += sizes[i];
+        return offset;
+    }
+
+    // sets the attribute pointers of the currently bound VAO / GL_ARRAY_BUFFER
+    static void setup(GLuint baseOffset = 0)
+    {
+        (enableAttribute<Attrs>(baseOffset), ...);
+    }
+
+    // fills every declared attribute of vertex i from an Assimp mesh
+    static void read(Vertex & vertex, const aiMesh * mesh, unsigned int i)
+    {
+        (Attrs::read(vertex, mesh, i), ...);
+    }
+
+    // same for a mesh read by the OBJ fast path
+    static void read(Vertex & vertex, const ObjMesh & mesh, unsigned int i)
+    {
+        (Attrs::read(vertex, mesh, i), ...);
+    }
+
+    // fills the vertices of a glTF primitive. A primitive stored in exactly this vertex format
+    // is a single copy of its whole vertex range, otherwise every attribute is copied as a
+    // strided column (converted only when quantized).
+    static void read(Vertex * vertices, const GlbPrimitive & primitive)
+    {
+        if (primitive.vertexCount == 0)
+        {
+            return;
+        }
+
+        if constexpr (has<attr::Position>)
+        {
+            // where vertex 0 would start if the file was interleaved like this layout
+            const GlbAccessor* position = primitive.attribute(attr::Position::gltfName);
+            const std::uintptr_t base = position ? reinterpret_cast<std::uintptr_t>(position->data) - offsetOf<attr::Position>() : 0;
+            if (position && (storedAs<Attrs>(primitive, base) && ...))
+            {
+                std::memcpy(vertices, reinterpret_cast<const void*>(base), primitive.vertexCount * sizeof(Vertex));
+                return;
+            }
+        }
+
+        unsigned char* bytes = reinterpret_cast<unsigned char*>(vertices);
+        (Attrs::read(bytes + offsetOf<Attrs>(), stride, primitive), ...);
+    }
+
+    // applies a node transform to the vertices (normals with the inverse transpose)
+    static void transform(Vertex * vertices, std::size_t count, const glm::mat4 & matrix)
+    {
+        if (matrix == glm::mat4(1.0f))
+        {
+            return;
+        }
+
+        const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(matrix)));
+        for (std::size_t i = 0; i < count; ++i)
+            (Attrs::transform(vertices[i], matrix, normalMatrix), ...);
+    }
+
+    // ObjLoader flags doing what the Assimp import flags of these attributes do
+    static constexpr unsigned int objFlags =
+        ((importFlags & aiProcess_FlipUVs) ? ObjLoader::FLIP_UVS : 0u) |
+        ((importFlags & aiProcess_CalcTangentSpace) ? ObjLoader::TANGENTS : 0u);
+
+private:
+    static_assert(sizeof(Vertex) == stride, "vertex attributes must pack without padding");
+
+    // whether the primitive stores attribute A interleaved exactly as this layout would
+    template <typename A>
+    static bool storedAs(const GlbPrimitive & primitive, std::uintptr_t base)
+    {
+        const GlbAccessor* accessor = A::gltfName ? primitive.attribute(A::gltfName) : nullptr;
+        return accessor && accessor->isFloat() && accessor->components == static_cast<unsigned int>(A::components) &&
+               accessor->stride == stride && reinterpret_cast<std::uintptr_t>(accessor->data) == base + offsetOf<A>();
+    }
+
+    template <typename A>
+    static void enableAttribute(GLuint baseOffset)
+    {
+        const GLuint location = static_cast<GLuint>(locationOf<A>);
+        glEnableVertexAttribArray(location);
+        if constexpr (A::integer)
+            glVertexAttribIPointer(location, A::components, A::glType, stride, (void*)(baseOffset + offsetOf<A>()));
+        else
+            glVertexAttribPointer(location, A::components, A::glType, GL_FALSE, stride, (void*)(baseOffset + offsetOf<A>()));
+    }
+};
+
+// Position / normal / uv, the format used by Model and most of the chapters.
+using DefaultLayout = VertexLayout<attr::Position, attr::Normal, attr::TexCoords>;
+// Default format plus tangent frame, for normal mapping.
+using TangentLayout = VertexLayout<attr::Position, attr::Normal, attr::TexCoords, attr::Tangent, attr::Bitangent>;
+// Position / uv only, for unlit textured geometry.
+using TexturedLayout = VertexLayout<attr::Position, attr::TexCoords>;
+// Position / normal, for the light cubes.
+using PositionNormalLayout = VertexLayout<attr::Position, attr::Normal>;
+// Default format plus 4 bone influences, for animated models (see Skinning.h).
+using SkinnedLayout = VertexLayout<attr::Position, attr::Normal, attr::TexCoords, attr::BoneIndices, attr::BoneWeights>;